@@ -0,0 +1,188 @@
+/*
+ * OpenMetrics Writer - Streaming Prometheus text exposition
+ *
+ * Renders metric families line by line into a staging chunk that is
+ * handed to a caller-supplied sink whenever it fills. Numbers are
+ * formatted by hand rather than with snprintf, and nothing is allocated,
+ * so a scrape costs the same however many families are exposed.
+ */
+
+#include "openmetrics_writer.h"
+#include <string.h>
+
+static const char *const TYPE_NAMES[] = {
+    [OPENMETRICS_COUNTER] = "counter",
+    [OPENMETRICS_GAUGE] = "gauge",
+    [OPENMETRICS_HISTOGRAM] = "histogram",
+};
+
+// Internal function prototypes
+static void put(openmetrics_writer_t *w, const char *data, size_t len);
+static void put_str(openmetrics_writer_t *w, const char *str);
+static void put_char(openmetrics_writer_t *w, char c);
+static void put_uint(openmetrics_writer_t *w, uint64_t value);
+static void put_seconds(openmetrics_writer_t *w, uint64_t value_us);
+static void put_label_value(openmetrics_writer_t *w, const char *value);
+static void flush(openmetrics_writer_t *w);
+
+void openmetrics_writer_init(openmetrics_writer_t *w, openmetrics_sink_t sink, void *ctx)
+{
+    w->sink = sink;
+    w->ctx = ctx;
+    w->err = ESP_OK;
+    w->len = 0;
+}
+
+void openmetrics_family(openmetrics_writer_t *w, const char *name, openmetrics_type_t type,
+                        const char *unit, const char *help)
+{
+    put_str(w, "# TYPE ");
+    put_str(w, name);
+    put_char(w, ' ');
+    put_str(w, TYPE_NAMES[type]);
+    put_char(w, '\n');
+
+    if (unit != NULL) {
+        put_str(w, "# UNIT ");
+        put_str(w, name);
+        put_char(w, ' ');
+        put_str(w, unit);
+        put_char(w, '\n');
+    }
+
+    put_str(w, "# HELP ");
+    put_str(w, name);
+    put_char(w, ' ');
+    put_str(w, help);
+    put_char(w, '\n');
+}
+
+void openmetrics_sample(openmetrics_writer_t *w, const char *name, const char *suffix,
+                        const char *label, const char *label_value, uint64_t value)
+{
+    put_str(w, name);
+    put_str(w, suffix);
+    if (label != NULL) {
+        put_char(w, '{');
+        put_str(w, label);
+        put_str(w, "=\"");
+        put_label_value(w, label_value);
+        put_str(w, "\"}");
+    }
+    put_char(w, ' ');
+    put_uint(w, value);
+    put_char(w, '\n');
+}
+
+void openmetrics_sample_us(openmetrics_writer_t *w, const char *name, const char *suffix,
+                           uint64_t value_us)
+{
+    put_str(w, name);
+    put_str(w, suffix);
+    put_char(w, ' ');
+    put_seconds(w, value_us);
+    put_char(w, '\n');
+}
+
+void openmetrics_bucket_us(openmetrics_writer_t *w, const char *name, uint32_t le_us,
+                           uint64_t cumulative)
+{
+    put_str(w, name);
+    put_str(w, "_bucket{le=\"");
+    if (le_us == OPENMETRICS_INF) {
+        put_str(w, "+Inf");
+    } else {
+        put_seconds(w, le_us);
+    }
+    put_str(w, "\"} ");
+    put_uint(w, cumulative);
+    put_char(w, '\n');
+}
+
+esp_err_t openmetrics_writer_finish(openmetrics_writer_t *w)
+{
+    put_str(w, "# EOF\n");
+    flush(w);
+    return w->err;
+}
+
+static void put(openmetrics_writer_t *w, const char *data, size_t len)
+{
+    while (len > 0 && w->err == ESP_OK) {
+        size_t space = sizeof(w->chunk) - w->len;
+        size_t n = len < space ? len : space;
+
+        memcpy(w->chunk + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+        if (w->len == sizeof(w->chunk)) {
+            flush(w);
+        }
+    }
+}
+
+static void put_str(openmetrics_writer_t *w, const char *str)
+{
+    put(w, str, strlen(str));
+}
+
+static void put_char(openmetrics_writer_t *w, char c)
+{
+    put(w, &c, 1);
+}
+
+static void put_uint(openmetrics_writer_t *w, uint64_t value)
+{
+    char digits[20];
+    size_t n = 0;
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    put(w, digits + sizeof(digits) - n, n);
+}
+
+static void put_seconds(openmetrics_writer_t *w, uint64_t value_us)
+{
+    // Whole seconds, then six fraction digits with trailing zeros dropped
+    char fraction[7] = { '.' };
+    uint32_t micros = (uint32_t)(value_us % 1000000);
+    size_t n = 7;
+
+    put_uint(w, value_us / 1000000);
+    if (micros == 0) {
+        return;
+    }
+    for (int i = 6; i >= 1; i--) {
+        fraction[i] = (char)('0' + micros % 10);
+        micros /= 10;
+    }
+    while (fraction[n - 1] == '0') {
+        n--;
+    }
+    put(w, fraction, n);
+}
+
+static void put_label_value(openmetrics_writer_t *w, const char *value)
+{
+    for (const char *p = value; *p != '\0'; p++) {
+        if (*p == '\\' || *p == '"') {
+            put_char(w, '\\');
+            put_char(w, *p);
+        } else if (*p == '\n') {
+            put_str(w, "\\n");
+        } else {
+            put_char(w, *p);
+        }
+    }
+}
+
+static void flush(openmetrics_writer_t *w)
+{
+    if (w->len > 0 && w->err == ESP_OK) {
+        w->err = w->sink(w->ctx, w->chunk, w->len);
+    }
+    w->len = 0;
+}
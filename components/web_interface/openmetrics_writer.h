@@ -0,0 +1,121 @@
+#ifndef OPENMETRICS_WRITER_H
+#define OPENMETRICS_WRITER_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OPENMETRICS_CHUNK_SIZE 512  ///< Bytes staged before the sink is called
+#define OPENMETRICS_INF UINT32_MAX  ///< Bucket bound meaning +Inf
+
+/**
+ * @brief Destination for rendered text
+ *
+ * @param ctx Sink context given to openmetrics_writer_init()
+ * @param data Rendered bytes, not NUL-terminated
+ * @param len Length of @p data
+ * @return esp_err_t ESP_OK to continue, any error stops the writer
+ */
+typedef esp_err_t (*openmetrics_sink_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Metric family types
+ */
+typedef enum {
+    OPENMETRICS_COUNTER = 0,
+    OPENMETRICS_GAUGE,
+    OPENMETRICS_HISTOGRAM
+} openmetrics_type_t;
+
+/**
+ * @brief Streaming OpenMetrics text renderer state
+ *
+ * Lines go to the sink in chunks as they are produced, so an exposition
+ * of any size needs only this struct in memory. The first sink error is
+ * latched; later calls do nothing and openmetrics_writer_finish()
+ * returns it.
+ */
+typedef struct {
+    openmetrics_sink_t sink;
+    void *ctx;
+    esp_err_t err;                         ///< First sink error, ESP_OK otherwise
+    size_t len;                            ///< Staged bytes in @p chunk
+    char chunk[OPENMETRICS_CHUNK_SIZE];
+} openmetrics_writer_t;
+
+/**
+ * @brief Start an exposition
+ *
+ * @param w Writer to initialize
+ * @param sink Destination for output
+ * @param ctx Passed through to @p sink
+ */
+void openmetrics_writer_init(openmetrics_writer_t *w, openmetrics_sink_t sink, void *ctx);
+
+/**
+ * @brief Start a metric family with its TYPE, UNIT and HELP lines
+ *
+ * @param w Writer
+ * @param name Family name, without the _total suffix for counters
+ * @param type Family type
+ * @param unit Unit, which must also end @p name; NULL if unitless
+ * @param help One-line description
+ */
+void openmetrics_family(openmetrics_writer_t *w, const char *name, openmetrics_type_t type,
+                        const char *unit, const char *help);
+
+/**
+ * @brief Write an integer sample
+ *
+ * @param w Writer
+ * @param name Family name
+ * @param suffix Appended to @p name, e.g. "_total" or "_count"; "" for none
+ * @param label Label name, NULL for an unlabelled sample
+ * @param label_value Label value, escaped as needed
+ * @param value Sample value
+ */
+void openmetrics_sample(openmetrics_writer_t *w, const char *name, const char *suffix,
+                        const char *label, const char *label_value, uint64_t value);
+
+/**
+ * @brief Write a sample given in microseconds as seconds
+ *
+ * @param w Writer
+ * @param name Family name
+ * @param suffix Appended to @p name, e.g. "_sum"; "" for none
+ * @param value_us Sample value in microseconds
+ */
+void openmetrics_sample_us(openmetrics_writer_t *w, const char *name, const char *suffix,
+                           uint64_t value_us);
+
+/**
+ * @brief Write one cumulative histogram bucket with a bound in microseconds
+ *
+ * Buckets must be written in increasing order of bound and end with
+ * OPENMETRICS_INF, followed by the _count and _sum samples.
+ *
+ * @param w Writer
+ * @param name Family name
+ * @param le_us Inclusive upper bound in microseconds, OPENMETRICS_INF for +Inf
+ * @param cumulative Samples at or below the bound
+ */
+void openmetrics_bucket_us(openmetrics_writer_t *w, const char *name, uint32_t le_us,
+                           uint64_t cumulative);
+
+/**
+ * @brief Write the # EOF terminator and flush
+ *
+ * @param w Writer
+ * @return esp_err_t ESP_OK, or the first error returned by the sink
+ */
+esp_err_t openmetrics_writer_finish(openmetrics_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OPENMETRICS_WRITER_H
@@ -0,0 +1,155 @@
+/*
+ * Web Interface - Metrics endpoint
+ *
+ * Serves GET /metrics in the OpenMetrics text format for fleet
+ * monitoring. The body is streamed through an openmetrics_writer_t whose
+ * chunks go straight out as HTTP chunked encoding, so a scrape needs no
+ * buffer beyond the writer and nothing is allocated per request. Heap
+ * and task families are rendered here; the application adds its own
+ * through the collector callback.
+ */
+
+#include "web_ui.h"
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "web_ui";
+
+#define OPENMETRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+#define SERVER_TASK_PRIORITY 2      // Below honeypot_task, so a scrape never delays it
+#define SERVER_STACK_SIZE 4096
+#define SERVER_MAX_SOCKETS 2        // Scrapers only; keeps lwIP sockets for the honeypot
+#define MAX_REPORTED_TASKS 32
+
+static httpd_handle_t server = NULL;
+static web_ui_config_t web_config;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+// Only the single server task renders scrapes, so one array is enough
+static TaskStatus_t task_status[MAX_REPORTED_TASKS];
+#endif
+
+// Internal function prototypes
+static esp_err_t metrics_handler(httpd_req_t *req);
+static esp_err_t chunk_sink(void *ctx, const char *data, size_t len);
+static void write_system_metrics(openmetrics_writer_t *w);
+
+esp_err_t web_ui_start(const web_ui_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (server != NULL) {
+        ESP_LOGW(TAG, "Web interface already running");
+        return ESP_OK;
+    }
+
+    memcpy(&web_config, config, sizeof(web_ui_config_t));
+
+    httpd_config_t httpd_config = HTTPD_DEFAULT_CONFIG();
+    httpd_config.server_port = config->port;
+    httpd_config.task_priority = SERVER_TASK_PRIORITY;
+    httpd_config.stack_size = SERVER_STACK_SIZE;
+    httpd_config.max_open_sockets = SERVER_MAX_SOCKETS;
+    httpd_config.lru_purge_enable = true;
+
+    esp_err_t err = httpd_start(&server, &httpd_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start HTTP server on port %d: %s", config->port, esp_err_to_name(err));
+        server = NULL;
+        return err;
+    }
+
+    static const httpd_uri_t metrics_uri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = metrics_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &metrics_uri);
+
+    ESP_LOGI(TAG, "Serving /metrics on port %d", config->port);
+    return ESP_OK;
+}
+
+esp_err_t web_ui_stop(void)
+{
+    if (server == NULL) {
+        return ESP_OK;
+    }
+
+    esp_err_t err = httpd_stop(server);
+    server = NULL;
+    return err;
+}
+
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    openmetrics_writer_t writer;
+
+    httpd_resp_set_type(req, OPENMETRICS_CONTENT_TYPE);
+    openmetrics_writer_init(&writer, chunk_sink, req);
+
+    write_system_metrics(&writer);
+    if (web_config.collector != NULL) {
+        web_config.collector(&writer, web_config.collector_ctx);
+    }
+
+    esp_err_t err = openmetrics_writer_finish(&writer);
+    if (err != ESP_OK) {
+        // Returning an error makes the server drop the connection
+        ESP_LOGW(TAG, "Metrics scrape aborted: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // A zero-length chunk ends the chunked response
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t chunk_sink(void *ctx, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+static void write_system_metrics(openmetrics_writer_t *w)
+{
+    openmetrics_family(w, "honeypot_uptime_seconds", OPENMETRICS_GAUGE, "seconds",
+                       "Time since boot");
+    openmetrics_sample_us(w, "honeypot_uptime_seconds", "", esp_timer_get_time());
+
+    openmetrics_family(w, "honeypot_heap_free_bytes", OPENMETRICS_GAUGE, "bytes",
+                       "Free heap");
+    openmetrics_sample(w, "honeypot_heap_free_bytes", "", NULL, NULL, esp_get_free_heap_size());
+
+    openmetrics_family(w, "honeypot_heap_min_free_bytes", OPENMETRICS_GAUGE, "bytes",
+                       "Lowest free heap since boot");
+    openmetrics_sample(w, "honeypot_heap_min_free_bytes", "", NULL, NULL,
+                       esp_get_minimum_free_heap_size());
+
+    openmetrics_family(w, "honeypot_heap_largest_free_block_bytes", OPENMETRICS_GAUGE, "bytes",
+                       "Largest allocatable heap block");
+    openmetrics_sample(w, "honeypot_heap_largest_free_block_bytes", "", NULL, NULL,
+                       heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+    openmetrics_family(w, "honeypot_tasks", OPENMETRICS_GAUGE, NULL, "FreeRTOS tasks");
+    openmetrics_sample(w, "honeypot_tasks", "", NULL, NULL, uxTaskGetNumberOfTasks());
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t count = uxTaskGetSystemState(task_status, MAX_REPORTED_TASKS, NULL);
+
+    openmetrics_family(w, "honeypot_task_stack_free_bytes", OPENMETRICS_GAUGE, "bytes",
+                       "Least free stack each task has had");
+    for (UBaseType_t i = 0; i < count; i++) {
+        openmetrics_sample(w, "honeypot_task_stack_free_bytes", "", "task",
+                           task_status[i].pcTaskName, task_status[i].usStackHighWaterMark);
+    }
+#endif
+}
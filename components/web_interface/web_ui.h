@@ -0,0 +1,54 @@
+#ifndef WEB_UI_H
+#define WEB_UI_H
+
+#include "esp_err.h"
+#include "openmetrics_writer.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Adds application metric families to a scrape
+ *
+ * Runs in the HTTP server task once per scrape, after the built-in heap
+ * and task families. Must not block on the network task.
+ *
+ * @param writer Writer to render families into
+ * @param ctx Context given in web_ui_config_t
+ */
+typedef void (*web_ui_metrics_collector_t)(openmetrics_writer_t *writer, void *ctx);
+
+/**
+ * @brief Web interface configuration
+ */
+typedef struct {
+    uint16_t port;                         ///< TCP port to serve on
+    web_ui_metrics_collector_t collector;  ///< Application metrics, may be NULL
+    void *collector_ctx;                   ///< Passed to @p collector
+} web_ui_config_t;
+
+/**
+ * @brief Start the HTTP server and serve GET /metrics
+ *
+ * The server task runs below the honeypot task's priority, and a scrape
+ * streams its response in chunks from a fixed buffer without allocating.
+ *
+ * @param config Server configuration
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t web_ui_start(const web_ui_config_t *config);
+
+/**
+ * @brief Stop the HTTP server
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t web_ui_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WEB_UI_H
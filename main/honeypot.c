@@ -10,25 +10,29 @@
 
 #include "honeypot.h"
 #include "networking/socket_manager.h"
-#include "services/http_service.h"
-#include "services/telnet_service.h"
-#include "services/ftp_service.h"
-#include "services/mqtt_service.h"
+#include "services/service_registry.h"
 #include "logging/attack_logger.h"
 #include "security/rate_limiter.h"
+#include "security/attack_signatures.h"
 #include "utils/helpers.h"
+#include "utils/metrics.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <string.h>
 
 static const char *TAG = "honeypot";
 
-// Honeypot state
+#define MAX_SELECT_WAIT_MS 1000         // Upper bound on a select() sleep
+#define MAX_ACCEPTS_PER_PASS 16         // accept() calls per listener per wake-up
+#define MAX_BUSY_LOOP_MS 100            // Longest run without blocking in select()
+
+// Honeypot state; ports left empty are filled from the service registry
 static honeypot_config_t current_config = {
-    .ports = {80, 23, 21, 1883, 8080, 2323},
-    .port_count = 6,
+    .port_count = 0,
     .max_connections = MAX_CONCURRENT_CONNECTIONS,
     .connection_timeout_ms = CONNECTION_TIMEOUT_MS,
+    .handshake_timeout_ms = CONNECTION_HANDSHAKE_TIMEOUT_MS,
+    .session_timeout_ms = CONNECTION_SESSION_TIMEOUT_MS,
     .enable_logging = true,
     .enable_remote_upload = false
 };
@@ -36,12 +40,15 @@ static honeypot_config_t current_config = {
 static honeypot_stats_t stats = {0};
 static TaskHandle_t honeypot_task_handle = NULL;
 static bool honeypot_running = false;
+static int64_t loop_wake_us = 0;  // When the current select() pass woke up
 
 // Internal function prototypes
 static void honeypot_task(void *pvParameters);
-static void handle_incoming_connection(int sock_fd, uint16_t port, struct sockaddr_in *client_addr);
-static void cleanup_stale_connections(void);
-static void update_statistics(uint16_t port);
+static void accept_pending(int listen_fd, uint16_t port);
+static void handle_incoming_connection(int listen_fd, int sock_fd, uint16_t port,
+                                       struct sockaddr_in *client_addr);
+static socket_service_handler_t service_handler_for_port(uint16_t port);
+static void process_timeouts(void);
 
 esp_err_t honeypot_init(void)
 {
@@ -53,17 +60,36 @@ esp_err_t honeypot_init(void)
         return ESP_FAIL;
     }
     
+    // Initialize connection pool and timers
+    if (socket_manager_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize socket manager");
+        return ESP_FAIL;
+    }
+    
     // Initialize rate limiter
     if (rate_limiter_init() != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize rate limiter");
         return ESP_FAIL;
     }
     
-    // Initialize services
-    http_service_init();
-    telnet_service_init();
-    ftp_service_init();
-    mqtt_service_init();
+    // Build the exploit signature matcher
+    if (attack_signatures_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize attack signatures");
+        return ESP_FAIL;
+    }
+    
+    // Initialize services and their port lookup
+    if (service_registry_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize services");
+        return ESP_FAIL;
+    }
+    socket_manager_set_close_handler(service_registry_on_close);
+    
+    // Listen on every service's default ports unless configured otherwise
+    if (current_config.port_count == 0) {
+        current_config.port_count = service_registry_default_ports(current_config.ports,
+                                                                   MAX_LISTENING_PORTS);
+    }
     
     stats.start_time = time(NULL);
     
@@ -80,7 +106,23 @@ esp_err_t honeypot_start(void)
     
     ESP_LOGI(TAG, "Starting honeypot task");
     
+    // Set before the task exists: at priority 5 it can reach its loop
+    // before xTaskCreate() returns here
+    honeypot_running = true;
+    
     // Create honeypot task
+#if CONFIG_HONEYPOT_DUAL_CORE
+    // Accept/receive stays on the listener core, services run on the worker core
+    BaseType_t result = xTaskCreatePinnedToCore(
+        honeypot_task,
+        "honeypot_task",
+        8192,
+        NULL,
+        5,
+        &honeypot_task_handle,
+        CONFIG_HONEYPOT_LISTENER_CORE
+    );
+#else
     BaseType_t result = xTaskCreate(
         honeypot_task,
         "honeypot_task",
@@ -89,13 +131,14 @@ esp_err_t honeypot_start(void)
         5,
         &honeypot_task_handle
     );
+#endif
     
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create honeypot task");
+        honeypot_running = false;
         return ESP_FAIL;
     }
     
-    honeypot_running = true;
     ESP_LOGI(TAG, "Honeypot started successfully");
     return ESP_OK;
 }
@@ -115,7 +158,8 @@ esp_err_t honeypot_stop(void)
         honeypot_task_handle = NULL;
     }
     
-    // Close all listening sockets
+    // Stop the service worker, then close all sockets
+    socket_manager_stop_worker();
     socket_manager_close_all();
     
     ESP_LOGI(TAG, "Honeypot stopped");
@@ -129,6 +173,22 @@ esp_err_t honeypot_get_stats(honeypot_stats_t *out_stats)
     }
     
     memcpy(out_stats, &stats, sizeof(honeypot_stats_t));
+    
+    // Counters may be bumped from either core, so they live in sharded metrics
+    out_stats->total_connections = metrics_get_counter(METRIC_CONNECTIONS);
+    out_stats->attacks_logged = metrics_get_counter(METRIC_ATTACKS_LOGGED);
+    out_stats->rate_limited = metrics_get_counter(METRIC_RATE_LIMITED);
+    out_stats->loop_wakeups = metrics_get_counter(METRIC_LOOP_WAKEUPS);
+    out_stats->service_count = service_registry_count();
+    for (uint8_t id = 0; id < out_stats->service_count; id++) {
+        out_stats->services[id].connections =
+            metrics_get_service_counter(id, METRIC_SERVICE_CONNECTIONS);
+        out_stats->services[id].attacks = metrics_get_service_counter(id, METRIC_SERVICE_ATTACKS);
+    }
+    out_stats->top_source_count = heavy_hitters_top(HEAVY_HITTER_HOST, out_stats->top_sources,
+                                                    HEAVY_HITTER_TOP_K);
+    out_stats->top_subnet_count = heavy_hitters_top(HEAVY_HITTER_SUBNET, out_stats->top_subnets,
+                                                    HEAVY_HITTER_TOP_K);
     return ESP_OK;
 }
 
@@ -136,6 +196,7 @@ esp_err_t honeypot_reset_stats(void)
 {
     ESP_LOGI(TAG, "Resetting statistics");
     memset(&stats, 0, sizeof(stats));
+    metrics_reset();
     stats.start_time = time(NULL);
     return ESP_OK;
 }
@@ -165,29 +226,53 @@ static void honeypot_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Honeypot task started");
     
+    socket_manager_set_timeouts(current_config.handshake_timeout_ms,
+                                current_config.connection_timeout_ms,
+                                current_config.session_timeout_ms);
+    
     // Create listening sockets for all configured ports
     for (int i = 0; i < current_config.port_count; i++) {
-        if (socket_manager_create_listener(current_config.ports[i]) != ESP_OK) {
+        uint16_t port = current_config.ports[i];
+        if (socket_manager_create_listener(port, service_handler_for_port(port)) != ESP_OK) {
             ESP_LOGE(TAG, "Failed to create listener for port %d", current_config.ports[i]);
         }
     }
     
+    if (socket_manager_start_worker() != ESP_OK) {
+        ESP_LOGW(TAG, "Service worker unavailable, handling requests inline");
+    }
+    
+    // esp_timer counts from boot, so this is boot-to-ready time
+    stats.ready_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Accepting connections %lld ms after boot", (long long)(stats.ready_us / 1000));
+    
     fd_set read_fds;
     struct timeval timeout;
+    int64_t last_idle_us = esp_timer_get_time();
     
     while (honeypot_running) {
-        // Setup select() timeout
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-        
         // Get file descriptor set from socket manager
-        if (!socket_manager_get_fd_set(&read_fds)) {
+        int max_fd = socket_manager_get_fd_set(&read_fds);
+        if (max_fd < 0) {
             vTaskDelay(100 / portTICK_PERIOD_MS);
             continue;
         }
         
-        // Wait for socket activity
-        int activity = select(FD_SETSIZE, &read_fds, NULL, NULL, &timeout);
+        // Block until a socket is ready or the next connection deadline is due
+        int64_t before_us = esp_timer_get_time();
+        int32_t wait_ms = socket_manager_next_timeout_ms();
+        if (wait_ms < 0 || wait_ms > MAX_SELECT_WAIT_MS) {
+            wait_ms = MAX_SELECT_WAIT_MS;
+        }
+        int64_t deadline_us = before_us + (int64_t)wait_ms * 1000;
+        int64_t wait_us = (int64_t)wait_ms * 1000;
+        timeout.tv_sec = wait_us / 1000000;
+        timeout.tv_usec = wait_us % 1000000;
+        
+        int activity = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
+        int64_t wake_us = esp_timer_get_time();
+        loop_wake_us = wake_us;
+        metrics_count(METRIC_LOOP_WAKEUPS);
         
         if (activity < 0 && errno != EINTR) {
             ESP_LOGE(TAG, "select() error: %d", errno);
@@ -196,53 +281,71 @@ static void honeypot_task(void *pvParameters)
         }
         
         if (activity > 0) {
-            // Check for new connections on each port
-            for (int i = 0; i < current_config.port_count; i++) {
-                int sock_fd = socket_manager_get_listener_fd(current_config.ports[i]);
-                if (sock_fd >= 0 && FD_ISSET(sock_fd, &read_fds)) {
-                    struct sockaddr_in client_addr;
-                    socklen_t addr_len = sizeof(client_addr);
-                    
-                    int client_fd = accept(sock_fd, (struct sockaddr *)&client_addr, &addr_len);
-                    if (client_fd >= 0) {
-                        handle_incoming_connection(client_fd, current_config.ports[i], &client_addr);
-                    }
-                }
-            }
-            
-            // Handle data on existing connections
-            socket_manager_handle_connections(&read_fds);
+            // One pass over the ready set: listeners are drained through
+            // accept_pending(), connections go straight to their service
+            socket_manager_dispatch(&read_fds, activity, accept_pending);
         }
         
-        // Cleanup stale connections periodically
-        static TickType_t last_cleanup = 0;
-        TickType_t now = xTaskGetTickCount();
-        if (now - last_cleanup > pdMS_TO_TICKS(5000)) {
-            cleanup_stale_connections();
-            last_cleanup = now;
+        // Expire connection deadlines that have passed
+        int64_t now_us = esp_timer_get_time();
+        if (now_us >= deadline_us) {
+            histogram_record(&stats.loop_lag_us, now_us - deadline_us);
         }
+        process_timeouts();
         
-        // Feed the watchdog
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        // select() normally blocks and lets IDLE run; under a sustained
+        // burst it never does, so yield a tick to keep the task watchdog fed
+        if (activity <= 0 || wake_us - before_us > 1000) {
+            last_idle_us = wake_us;
+        } else if (now_us - last_idle_us > (int64_t)MAX_BUSY_LOOP_MS * 1000) {
+            vTaskDelay(1);
+            last_idle_us = esp_timer_get_time();
+        }
     }
     
     ESP_LOGI(TAG, "Honeypot task exiting");
     vTaskDelete(NULL);
 }
 
-static void handle_incoming_connection(int sock_fd, uint16_t port, struct sockaddr_in *client_addr)
+static void accept_pending(int listen_fd, uint16_t port)
+{
+    // Listeners are non-blocking, so accept until the backlog is empty.
+    // The per-pass budget keeps one flooded port from starving the rest.
+    for (int n = 0; n < MAX_ACCEPTS_PER_PASS; n++) {
+        struct sockaddr_in client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        
+        int client_fd = accept(listen_fd, (struct sockaddr *)&client_addr, &addr_len);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                ESP_LOGW(TAG, "accept() error on port %d: %d", port, errno);
+            }
+            return;
+        }
+        
+        handle_incoming_connection(listen_fd, client_fd, port, &client_addr);
+        histogram_record(&stats.accept_latency_us, esp_timer_get_time() - loop_wake_us);
+    }
+}
+
+static void handle_incoming_connection(int listen_fd, int sock_fd, uint16_t port,
+                                       struct sockaddr_in *client_addr)
 {
     char client_ip[16];
-    inet_ntoa_r(client_addr->sin_addr, client_ip, sizeof(client_ip) - 1);
     
-    // Check rate limit
-    if (!rate_limiter_check(client_ip)) {
-        ESP_LOGW(TAG, "Rate limiting connection from %s", client_ip);
+    // Check rate limit on the raw address; only format it when needed
+    rate_limit_result_t limit = rate_limiter_check(client_addr->sin_addr.s_addr);
+    if (limit != RATE_LIMIT_ALLOWED) {
+        inet_ntoa_r(client_addr->sin_addr, client_ip, sizeof(client_ip) - 1);
+        ESP_LOGW(TAG, "Rate limiting connection from %s (%s)", client_ip,
+                 rate_limiter_result_name(limit));
         close(sock_fd);
-        stats.rate_limited++;
+        metrics_count(METRIC_RATE_LIMITED);
         return;
     }
     
+    inet_ntoa_r(client_addr->sin_addr, client_ip, sizeof(client_ip) - 1);
+    
     // Check max connections
     if (!socket_manager_can_accept_connection()) {
         ESP_LOGW(TAG, "Max connections reached, rejecting %s", client_ip);
@@ -251,42 +354,34 @@ static void handle_incoming_connection(int sock_fd, uint16_t port, struct sockad
     }
     
     // Add connection to socket manager
-    if (socket_manager_add_connection(sock_fd, port, client_addr) != ESP_OK) {
+    socket_conn_t *conn;
+    if (socket_manager_add_connection(listen_fd, sock_fd, client_addr, &conn) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add connection from %s", client_ip);
         close(sock_fd);
         return;
     }
     
-    stats.total_connections++;
+    metrics_count(METRIC_CONNECTIONS);
     ESP_LOGI(TAG, "New connection from %s on port %d", client_ip, port);
+    
+    // Services that speak first send their greeting now
+    service_registry_on_connect(conn);
 }
 
-static void cleanup_stale_connections(void)
+static void process_timeouts(void)
 {
-    int cleaned = socket_manager_cleanup_stale_connections(current_config.connection_timeout_ms);
-    if (cleaned > 0) {
-        ESP_LOGI(TAG, "Cleaned up %d stale connections", cleaned);
+    int closed = socket_manager_process_timeouts();
+    if (closed > 0) {
+        ESP_LOGI(TAG, "Closed %d timed out connections", closed);
     }
 }
 
-static void update_statistics(uint16_t port)
+static socket_service_handler_t service_handler_for_port(uint16_t port)
 {
-    stats.attacks_logged++;
-    
-    switch (port) {
-        case 80:
-        case 8080:
-            stats.http_attacks++;
-            break;
-        case 23:
-        case 2323:
-            stats.telnet_attacks++;
-            break;
-        case 21:
-            stats.ftp_attacks++;
-            break;
-        case 1883:
-            stats.mqtt_attacks++;
-            break;
+    const service_descriptor_t *service = service_registry_get(service_registry_lookup(port));
+    if (service == NULL) {
+        ESP_LOGW(TAG, "No service for port %d", port);
+        return NULL;
     }
+    return service->handler;
 }
\ No newline at end of file
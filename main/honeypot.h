@@ -5,6 +5,9 @@
 #include "freertos/task.h"
 #include "lwip/sockets.h"
 #include "utils/config.h"
+#include "utils/histogram.h"
+#include "security/heavy_hitters.h"
+#include "services/service_registry.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,11 +20,21 @@ typedef struct {
     uint16_t ports[MAX_LISTENING_PORTS];  ///< Ports to listen on
     uint8_t port_count;                    ///< Number of ports
     uint32_t max_connections;              ///< Maximum concurrent connections
-    uint32_t connection_timeout_ms;        ///< Connection timeout in milliseconds
+    uint32_t connection_timeout_ms;        ///< Idle timeout in milliseconds
+    uint32_t handshake_timeout_ms;         ///< Accept to first byte timeout in milliseconds
+    uint32_t session_timeout_ms;           ///< Total session timeout in milliseconds
     bool enable_logging;                   ///< Enable attack logging
     bool enable_remote_upload;             ///< Enable remote log upload
 } honeypot_config_t;
 
+/**
+ * @brief Per-service counters
+ */
+typedef struct {
+    uint32_t connections;                  ///< Connections accepted for the service
+    uint32_t attacks;                      ///< Attacks the service detected
+} honeypot_service_stats_t;
+
 /**
  * @brief Honeypot statistics
  */
@@ -29,10 +42,16 @@ typedef struct {
     uint32_t total_connections;            ///< Total connections received
     uint32_t attacks_logged;               ///< Total attacks logged
     uint32_t rate_limited;                 ///< Connections rate limited
-    uint32_t http_attacks;                 ///< HTTP attacks detected
-    uint32_t telnet_attacks;               ///< Telnet attacks detected
-    uint32_t ftp_attacks;                  ///< FTP attacks detected
-    uint32_t mqtt_attacks;                 ///< MQTT attacks detected
+    uint32_t loop_wakeups;                 ///< select() returns in the main loop
+    honeypot_service_stats_t services[SERVICE_REGISTRY_MAX]; ///< Indexed by service id
+    uint8_t service_count;                 ///< Valid entries in services
+    histogram_t loop_lag_us;               ///< Lateness of timer deadlines (us)
+    histogram_t accept_latency_us;         ///< Wake-up to connection accepted (us)
+    int64_t ready_us;                      ///< Boot to listeners accepting (us)
+    heavy_hitter_t top_sources[HEAVY_HITTER_TOP_K]; ///< Heaviest source addresses, heaviest first
+    heavy_hitter_t top_subnets[HEAVY_HITTER_TOP_K]; ///< Heaviest source /24s, heaviest first
+    uint8_t top_source_count;              ///< Valid entries in top_sources
+    uint8_t top_subnet_count;              ///< Valid entries in top_subnets
     time_t start_time;                     ///< Honeypot start time
 } honeypot_stats_t;
 
@@ -10,7 +10,14 @@
 
 #include "attack_logger.h"
 #include "flash_storage.h"
+#include "log_record.h"
+#include "payload_store.h"
 #include "utils/helpers.h"
+#include "utils/metrics.h"
+#include "utils/mpsc_ring.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <string.h>
@@ -18,14 +25,68 @@
 
 static const char *TAG = "attack_logger";
 
-// Circular buffer for logs
-static attack_log_t log_buffer[MAX_LOG_ENTRIES];
+// Records in RAM are framed by their length on both sides so the ring
+// can be walked newest-first and trimmed oldest-first
+#define FRAME_OVERHEAD (2 * sizeof(uint16_t))
+
+// Enough queued records to make waking the writer worthwhile
+#define LOG_WAKE_DEPTH (LOG_QUEUE_DEPTH / 2)
+
+// Records per flash batch whose queue time is kept for the commit latency
+#define BATCH_MAX_RECORDS 64
+
+_Static_assert(FLASH_STORAGE_MAX_APPEND >= LOG_RECORD_MAX_SIZE, "A flash batch must hold at least one record");
+_Static_assert(LOG_RAM_BUFFER_SIZE >= LOG_RECORD_MAX_SIZE + FRAME_OVERHEAD, "LOG_RAM_BUFFER_SIZE too small");
+
+// Queue slot: the record plus when it was handed to the logger
+typedef struct {
+    attack_log_t entry;
+    int64_t queued_us;
+} queued_log_t;
+
+// Sink state for attack_logger_format_json()
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t used;
+} json_buffer_sink_t;
+
+// Circular buffer of encoded logs, filled by the writer task
+static uint8_t log_buffer[LOG_RAM_BUFFER_SIZE];
 static size_t buffer_head = 0;
 static size_t buffer_tail = 0;
+static size_t buffer_used = 0;
 static size_t buffer_count = 0;
+static SemaphoreHandle_t buffer_mutex = NULL;
 
-// Statistics
+// Producer to writer queue
+static mpsc_ring_t log_queue;
+static atomic_uint log_queue_sequences[LOG_QUEUE_DEPTH];
+static queued_log_t log_queue_storage[LOG_QUEUE_DEPTH];
+static TaskHandle_t writer_task_handle = NULL;
+
+// Encoded records waiting for the next flash write
+static uint8_t batch[FLASH_STORAGE_MAX_APPEND];
+static log_record_ctx_t batch_ctx;
+static int64_t batch_queued_us[BATCH_MAX_RECORDS];
+
+// Statistics; stats_mutex is never held across flash I/O, so readers only
+// wait for a counter update, not for a batch write
 static logger_stats_t stats = {0};
+static SemaphoreHandle_t stats_mutex = NULL;
+static atomic_uint dropped_count;
+static atomic_uint queue_high_water;
+
+// Internal function prototypes
+static void log_writer_task(void *pvParameters);
+static void store_recent(const queued_log_t *item, const uint8_t *record, size_t len);
+static void flush_batch(size_t len, size_t count);
+static void load_batch(const uint8_t *data, size_t len, void *ctx);
+static void ring_write(size_t pos, const void *data, size_t len);
+static void ring_read(size_t pos, void *data, size_t len);
+static void note_queue_depth(uint32_t depth);
+static void log_to_console(const attack_log_t *log);
+static esp_err_t buffer_sink(void *ctx, const char *data, size_t len);
 
 esp_err_t attack_logger_init(void)
 {
@@ -37,16 +98,53 @@ esp_err_t attack_logger_init(void)
         return ESP_FAIL;
     }
     
-    // Load existing logs from flash
-    size_t loaded = flash_storage_load_logs(log_buffer, MAX_LOG_ENTRIES);
+    // Without it repeats are simply logged in full
+    if (payload_store_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Payload store unavailable, repeated payloads will not be deduplicated");
+    }
+    
+    buffer_mutex = xSemaphoreCreateMutex();
+    stats_mutex = xSemaphoreCreateMutex();
+    if (buffer_mutex == NULL || stats_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create log buffer mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Load existing logs from flash; the RAM ring keeps the newest
+    size_t loaded = 0;
+    flash_storage_read_batches(LOG_RAM_BUFFER_SIZE, load_batch, &loaded);
     if (loaded > 0) {
-        buffer_head = loaded % MAX_LOG_ENTRIES;
-        buffer_count = loaded;
-        ESP_LOGI(TAG, "Loaded %d logs from flash", loaded);
+        ESP_LOGI(TAG, "Loaded %d logs from flash, %d kept in RAM", (int)loaded, (int)buffer_count);
+    }
+    
+    if (!mpsc_ring_init(&log_queue, log_queue_sequences, log_queue_storage,
+                        sizeof(queued_log_t), LOG_QUEUE_DEPTH)) {
+        ESP_LOGE(TAG, "LOG_QUEUE_DEPTH must be a power of two");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    // Flash writes happen here, off the network path
+    BaseType_t result = xTaskCreate(
+        log_writer_task,
+        "log_writer",
+        LOG_WRITER_STACK_SIZE,
+        NULL,
+        LOG_WRITER_TASK_PRIORITY,
+        &writer_task_handle
+    );
+    
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create log writer task");
+        vSemaphoreDelete(buffer_mutex);
+        buffer_mutex = NULL;
+        vSemaphoreDelete(stats_mutex);
+        stats_mutex = NULL;
+        return ESP_FAIL;
     }
     
     stats.start_time = time(NULL);
-    ESP_LOGI(TAG, "Attack logger initialized");
+    ESP_LOGI(TAG, "Attack logger initialized (queue %d, %d byte writes)",
+             LOG_QUEUE_DEPTH, FLASH_STORAGE_MAX_APPEND);
     
     return ESP_OK;
 }
@@ -57,25 +155,26 @@ esp_err_t attack_logger_log(const attack_log_t *log_entry)
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Add to circular buffer
-    memcpy(&log_buffer[buffer_head], log_entry, sizeof(attack_log_t));
-    buffer_head = (buffer_head + 1) % MAX_LOG_ENTRIES;
-    
-    if (buffer_count < MAX_LOG_ENTRIES) {
-        buffer_count++;
-    } else {
-        buffer_tail = (buffer_tail + 1) % MAX_LOG_ENTRIES;
+    if (writer_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
     }
     
-    // Update statistics
-    stats.total_logged++;
-    stats.last_log_time = time(NULL);
+    queued_log_t item;
+    item.queued_us = esp_timer_get_time();
+    memcpy(&item.entry, log_entry, sizeof(attack_log_t));
     
-    // Save to flash
-    flash_storage_save_log(log_entry);
+    if (!mpsc_ring_push(&log_queue, &item)) {
+        atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
     
-    // Log to console for debugging
-    log_to_console(log_entry);
+    // Wake the writer for the first record of a batch and once the queue
+    // is filling up; in between it collects records on its own timer
+    uint32_t depth = mpsc_ring_depth(&log_queue);
+    note_queue_depth(depth);
+    if (depth == 1 || depth >= LOG_WAKE_DEPTH) {
+        xTaskNotifyGive(writer_task_handle);
+    }
     
     return ESP_OK;
 }
@@ -86,20 +185,35 @@ esp_err_t attack_logger_get_recent(attack_log_t *logs, size_t max_logs, size_t *
         return ESP_ERR_INVALID_ARG;
     }
     
-    size_t count = buffer_count < max_logs ? buffer_count : max_logs;
-    *num_logs = count;
-    
-    if (count == 0) {
-        return ESP_OK;
+    if (buffer_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
     }
     
-    // Copy logs in chronological order (newest first)
-    size_t idx = buffer_head;
+    xSemaphoreTake(buffer_mutex, portMAX_DELAY);
+    
+    size_t count = buffer_count < max_logs ? buffer_count : max_logs;
+    
+    // Decode logs in reverse chronological order (newest first)
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    size_t end = buffer_head;
+    size_t decoded = 0;
     for (size_t i = 0; i < count; i++) {
-        idx = (idx == 0) ? MAX_LOG_ENTRIES - 1 : idx - 1;
-        memcpy(&logs[i], &log_buffer[idx], sizeof(attack_log_t));
+        uint16_t len;
+        size_t start = (end + LOG_RAM_BUFFER_SIZE - sizeof(len)) % LOG_RAM_BUFFER_SIZE;
+        ring_read(start, &len, sizeof(len));
+        start = (start + LOG_RAM_BUFFER_SIZE - len) % LOG_RAM_BUFFER_SIZE;
+        ring_read(start, record, len);
+        end = (start + LOG_RAM_BUFFER_SIZE - sizeof(len)) % LOG_RAM_BUFFER_SIZE;
+        
+        // Each RAM record carries its absolute time
+        log_record_ctx_t ctx = {0};
+        if (log_record_decode(&ctx, record, len, &logs[decoded]) > 0) {
+            decoded++;
+        }
     }
+    *num_logs = decoded;
     
+    xSemaphoreGive(buffer_mutex);
     return ESP_OK;
 }
 
@@ -107,17 +221,28 @@ esp_err_t attack_logger_clear(void)
 {
     ESP_LOGI(TAG, "Clearing all logs");
     
+    if (buffer_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(buffer_mutex, portMAX_DELAY);
+    
     buffer_head = 0;
     buffer_tail = 0;
+    buffer_used = 0;
     buffer_count = 0;
     
     // Clear flash storage
     flash_storage_clear_all();
+    payload_store_clear_all();
     
     // Reset statistics (keep start time)
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
     stats.total_logged = 0;
     stats.last_log_time = 0;
+    xSemaphoreGive(stats_mutex);
     
+    xSemaphoreGive(buffer_mutex);
     return ESP_OK;
 }
 
@@ -127,7 +252,17 @@ esp_err_t attack_logger_get_stats(logger_stats_t *out_stats)
         return ESP_ERR_INVALID_ARG;
     }
     
+    if (stats_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
     memcpy(out_stats, &stats, sizeof(logger_stats_t));
+    xSemaphoreGive(stats_mutex);
+    
+    out_stats->dropped = atomic_load_explicit(&dropped_count, memory_order_relaxed);
+    out_stats->queue_depth = mpsc_ring_depth(&log_queue);
+    out_stats->queue_high_water = atomic_load_explicit(&queue_high_water, memory_order_relaxed);
     return ESP_OK;
 }
 
@@ -136,45 +271,247 @@ size_t attack_logger_count(void)
     return buffer_count;
 }
 
+static void log_writer_task(void *pvParameters)
+{
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    size_t batch_len = 0;
+    size_t batched = 0;
+    int64_t batch_started_us = 0;
+    
+    while (1) {
+        // Sleep until a producer wakes us or the partial batch is due
+        TickType_t wait = portMAX_DELAY;
+        if (mpsc_ring_depth(&log_queue) > 0) {
+            wait = 0;
+        } else if (batched > 0) {
+            int64_t remaining_ms = LOG_FLUSH_INTERVAL_MS -
+                                   (esp_timer_get_time() - batch_started_us) / 1000;
+            wait = remaining_ms > 0 ? pdMS_TO_TICKS(remaining_ms) : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        
+        queued_log_t item;
+        while (mpsc_ring_pop(&log_queue, &item)) {
+            // RAM records stand alone, so encode with a fresh time base
+            log_record_ctx_t standalone = {0};
+            size_t len = log_record_encode(&standalone, &item.entry, record, sizeof(record));
+            store_recent(&item, record, len);
+            
+            // Log to console for debugging
+            log_to_console(&item.entry);
+            
+            // Append to the flash batch, delta-encoded against the previous
+            // record; when it no longer fits, write the batch out first
+            if (batched == 0) {
+                memset(&batch_ctx, 0, sizeof(batch_ctx));
+                batch_started_us = esp_timer_get_time();
+            }
+            len = log_record_encode(&batch_ctx, &item.entry, batch + batch_len, sizeof(batch) - batch_len);
+            if (len == 0) {
+                flush_batch(batch_len, batched);
+                memset(&batch_ctx, 0, sizeof(batch_ctx));
+                batch_started_us = esp_timer_get_time();
+                batch_len = 0;
+                batched = 0;
+                len = log_record_encode(&batch_ctx, &item.entry, batch, sizeof(batch));
+            }
+            batch_queued_us[batched] = item.queued_us;
+            batch_len += len;
+            batched++;
+            
+            // A batch of small records can outgrow the queue time slots
+            if (batched == BATCH_MAX_RECORDS) {
+                flush_batch(batch_len, batched);
+                batch_len = 0;
+                batched = 0;
+            }
+        }
+        
+        // Samples of newly seen payloads
+        payload_store_flush();
+        
+        bool due = batched > 0 &&
+                   esp_timer_get_time() - batch_started_us >= (int64_t)LOG_FLUSH_INTERVAL_MS * 1000;
+        if (due) {
+            flush_batch(batch_len, batched);
+            batch_len = 0;
+            batched = 0;
+        }
+    }
+}
+
+static void store_recent(const queued_log_t *item, const uint8_t *record, size_t len)
+{
+    uint16_t frame_len = (uint16_t)len;
+    
+    xSemaphoreTake(buffer_mutex, portMAX_DELAY);
+    
+    // Make room by dropping the oldest records
+    while (LOG_RAM_BUFFER_SIZE - buffer_used < len + FRAME_OVERHEAD) {
+        uint16_t old_len;
+        ring_read(buffer_tail, &old_len, sizeof(old_len));
+        buffer_tail = (buffer_tail + old_len + FRAME_OVERHEAD) % LOG_RAM_BUFFER_SIZE;
+        buffer_used -= old_len + FRAME_OVERHEAD;
+        buffer_count--;
+    }
+    
+    // Add to circular buffer
+    ring_write(buffer_head, &frame_len, sizeof(frame_len));
+    ring_write(buffer_head + sizeof(frame_len), record, len);
+    ring_write(buffer_head + sizeof(frame_len) + len, &frame_len, sizeof(frame_len));
+    buffer_head = (buffer_head + len + FRAME_OVERHEAD) % LOG_RAM_BUFFER_SIZE;
+    buffer_used += len + FRAME_OVERHEAD;
+    buffer_count++;
+    
+    xSemaphoreGive(buffer_mutex);
+    
+    // Update statistics; records reloaded from flash have no queue entry
+    if (item != NULL) {
+        xSemaphoreTake(stats_mutex, portMAX_DELAY);
+        stats.total_logged++;
+        stats.last_log_time = time(NULL);
+        histogram_record(&stats.enqueue_latency_us, esp_timer_get_time() - item->queued_us);
+        xSemaphoreGive(stats_mutex);
+    }
+}
+
+static void flush_batch(size_t len, size_t count)
+{
+    // Held across the write so a concurrent clear cannot interleave
+    xSemaphoreTake(buffer_mutex, portMAX_DELAY);
+    
+    if (flash_storage_append(batch, len) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to write %d logs to flash", (int)count);
+    } else {
+        int64_t committed_us = esp_timer_get_time();
+        for (size_t i = 0; i < count; i++) {
+            metrics_record_latency(METRIC_LATENCY_ENQUEUE_TO_COMMIT, committed_us - batch_queued_us[i]);
+        }
+    }
+    
+    xSemaphoreGive(buffer_mutex);
+    
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.batches_written++;
+    xSemaphoreGive(stats_mutex);
+}
+
+static void load_batch(const uint8_t *data, size_t len, void *ctx)
+{
+    size_t *loaded = ctx;
+    log_record_ctx_t batch_base = {0};
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    attack_log_t entry;
+    size_t pos = 0;
+    
+    // Flash records are deltas within their batch; RAM needs them standalone
+    while (pos < len) {
+        size_t used = log_record_decode(&batch_base, data + pos, len - pos, &entry);
+        if (used == 0) {
+            break;
+        }
+        pos += used;
+        
+        log_record_ctx_t standalone = {0};
+        size_t record_len = log_record_encode(&standalone, &entry, record, sizeof(record));
+        store_recent(NULL, record, record_len);
+        (*loaded)++;
+    }
+}
+
+static void ring_write(size_t pos, const void *data, size_t len)
+{
+    pos %= LOG_RAM_BUFFER_SIZE;
+    size_t first = len < LOG_RAM_BUFFER_SIZE - pos ? len : LOG_RAM_BUFFER_SIZE - pos;
+    memcpy(&log_buffer[pos], data, first);
+    memcpy(log_buffer, (const uint8_t *)data + first, len - first);
+}
+
+static void ring_read(size_t pos, void *data, size_t len)
+{
+    pos %= LOG_RAM_BUFFER_SIZE;
+    size_t first = len < LOG_RAM_BUFFER_SIZE - pos ? len : LOG_RAM_BUFFER_SIZE - pos;
+    memcpy(data, &log_buffer[pos], first);
+    memcpy((uint8_t *)data + first, log_buffer, len - first);
+}
+
+static void note_queue_depth(uint32_t depth)
+{
+    uint32_t high = atomic_load_explicit(&queue_high_water, memory_order_relaxed);
+    while (depth > high &&
+           !atomic_compare_exchange_weak_explicit(&queue_high_water, &high, depth,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
 static void log_to_console(const attack_log_t *log)
 {
     struct tm *timeinfo = localtime(&log->timestamp);
     char time_str[32];
     strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", timeinfo);
     
-    ESP_LOGI(TAG, "Attack logged: [%s] %s -> %s:%d | User: %s | Pass: %s | Hash: %s",
+    ESP_LOGI(TAG, "Attack logged: [%s] %s -> %s:%d | User: %s | Pass: %s | Hash: %s (seen %lu)",
              time_str, log->source_ip, log->service, log->target_port,
-             log->username, log->password, log->payload_hash);
+             log->username, log->password, log->payload_hash, (unsigned long)log->payload_hits);
 }
 
-// Format log entry as JSON for remote transmission
-esp_err_t attack_logger_format_json(const attack_log_t *log, char *buffer, size_t buffer_size)
+// Stream log entry as JSON for remote transmission
+esp_err_t attack_logger_write_json(const attack_log_t *log, json_sink_t sink, void *ctx)
 {
-    if (log == NULL || buffer == NULL) {
+    if (log == NULL || sink == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    struct tm *timeinfo = localtime(&log->timestamp);
+    // Timestamps carry a Z suffix, so render them in UTC
+    struct tm timeinfo;
     char time_str[32];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%SZ", timeinfo);
-    
-    int written = snprintf(buffer, buffer_size,
-        "{\"timestamp\":\"%s\","
-        "\"source_ip\":\"%s\","
-        "\"target_port\":%d,"
-        "\"service\":\"%s\","
-        "\"username\":\"%s\","
-        "\"password\":\"%s\","
-        "\"user_agent\":\"%s\","
-        "\"payload_hash\":\"%s\","
-        "\"metadata\":\"%s\"}",
-        time_str, log->source_ip, log->target_port, log->service,
-        log->username, log->password, log->user_agent,
-        log->payload_hash, log->metadata);
-    
-    if (written < 0 || written >= buffer_size) {
+    gmtime_r(&log->timestamp, &timeinfo);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+    
+    json_writer_t w;
+    json_writer_init(&w, sink, ctx);
+    json_writer_begin_object(&w);
+    json_writer_field_string(&w, "timestamp", time_str);
+    json_writer_field_string(&w, "source_ip", log->source_ip);
+    json_writer_field_int(&w, "target_port", log->target_port);
+    json_writer_field_string(&w, "service", log->service);
+    json_writer_field_string(&w, "username", log->username);
+    json_writer_field_string(&w, "password", log->password);
+    json_writer_field_string(&w, "user_agent", log->user_agent);
+    json_writer_field_string(&w, "payload_hash", log->payload_hash);
+    json_writer_field_string(&w, "metadata", log->metadata);
+    json_writer_field_string(&w, "indicators", log->indicators);
+    json_writer_field_int(&w, "payload_hits", log->payload_hits);
+    json_writer_field_int(&w, "payload_first_seen", log->payload_first_seen);
+    json_writer_end_object(&w);
+    
+    return json_writer_finish(&w);
+}
+
+// Format log entry as JSON into a caller buffer
+esp_err_t attack_logger_format_json(const attack_log_t *log, char *buffer, size_t buffer_size)
+{
+    if (log == NULL || buffer == NULL || buffer_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Leave room for the terminator
+    json_buffer_sink_t out = { .buffer = buffer, .size = buffer_size - 1, .used = 0 };
+    esp_err_t ret = attack_logger_write_json(log, buffer_sink, &out);
+    buffer[out.used] = '\0';
+    
+    return ret;
+}
+
+static esp_err_t buffer_sink(void *ctx, const char *data, size_t len)
+{
+    json_buffer_sink_t *out = (json_buffer_sink_t *)ctx;
+    
+    if (len > out->size - out->used) {
         return ESP_ERR_INVALID_SIZE;
     }
     
+    memcpy(out->buffer + out->used, data, len);
+    out->used += len;
     return ESP_OK;
-}
\ No newline at end of file
+}
@@ -0,0 +1,132 @@
+#ifndef ATTACK_LOGGER_H
+#define ATTACK_LOGGER_H
+
+#include "esp_err.h"
+#include "utils/config.h"
+#include "utils/histogram.h"
+#include "utils/json_writer.h"
+#include "utils/md5_hash.h"
+#include "security/indicators.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One recorded attack
+ *
+ * Once stored, repeats of a known payload (payload_hits > 1) keep no user
+ * agent, metadata or indicators; the payload store's sample of that
+ * payload has them.
+ */
+typedef struct {
+    time_t timestamp;                      ///< Wall-clock time of the attack
+    char source_ip[16];                    ///< Attacker address, dotted quad
+    uint16_t target_port;                  ///< Honeypot port that was hit
+    char service[16];                      ///< Emulated service name
+    char username[64];                     ///< Captured username, "N/A" if none
+    char password[64];                     ///< Captured password, "N/A" if none
+    char user_agent[128];                  ///< Client identification, if any
+    char payload_hash[PAYLOAD_HASH_HEX_SIZE]; ///< Payload digest, hex, see md5_hash.h
+    char metadata[128];                    ///< Service-specific details
+    char indicators[INDICATOR_TEXT_SIZE];  ///< Dropper URLs, hosts and payloads, see indicators.h
+    uint32_t payload_hits;                 ///< Sightings of this payload, 1 the first time
+    time_t payload_first_seen;             ///< Time of the first sighting
+} attack_log_t;
+
+/**
+ * @brief Logger statistics
+ */
+typedef struct {
+    uint32_t total_logged;                 ///< Records accepted by attack_logger_log()
+    time_t last_log_time;                  ///< Time of the most recent record
+    time_t start_time;                     ///< Time the logger was initialized
+    uint32_t dropped;                      ///< Records lost because the queue was full
+    uint32_t queue_depth;                  ///< Records waiting for the writer task
+    uint32_t queue_high_water;             ///< Deepest the queue has been
+    uint32_t batches_written;              ///< Flash writes issued by the writer task
+    histogram_t enqueue_latency_us;        ///< Time records waited in the queue until the writer task took them
+} logger_stats_t;
+
+/**
+ * @brief Initialize the logger, load stored records and start the writer task
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t attack_logger_init(void);
+
+/**
+ * @brief Queue a record for storage
+ *
+ * Safe to call from any task; never blocks. The record is copied, and
+ * written to flash later by the low-priority writer task. When the queue
+ * is full the record is dropped and counted.
+ *
+ * @param log_entry Record to store
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if dropped
+ */
+esp_err_t attack_logger_log(const attack_log_t *log_entry);
+
+/**
+ * @brief Copy the most recent records, newest first
+ *
+ * @param logs Output array
+ * @param max_logs Capacity of @p logs
+ * @param num_logs Number of records copied
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t attack_logger_get_recent(attack_log_t *logs, size_t max_logs, size_t *num_logs);
+
+/**
+ * @brief Discard all records in RAM and flash
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t attack_logger_clear(void);
+
+/**
+ * @brief Get logger statistics
+ *
+ * @param out_stats Receives the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t attack_logger_get_stats(logger_stats_t *out_stats);
+
+/**
+ * @brief Number of records held in RAM
+ *
+ * @return size_t Record count
+ */
+size_t attack_logger_count(void);
+
+/**
+ * @brief Stream a record as a JSON object
+ *
+ * All string fields are escaped; output goes to @p sink in small chunks
+ * so no record-sized buffer is needed.
+ *
+ * @param log Record to encode
+ * @param sink Destination for the encoded bytes
+ * @param ctx Passed through to @p sink
+ * @return esp_err_t ESP_OK on success, the first sink error otherwise
+ */
+esp_err_t attack_logger_write_json(const attack_log_t *log, json_sink_t sink, void *ctx);
+
+/**
+ * @brief Format a record as a JSON object into a buffer
+ *
+ * @param log Record to format
+ * @param buffer Output buffer
+ * @param buffer_size Size of @p buffer
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if truncated
+ */
+esp_err_t attack_logger_format_json(const attack_log_t *log, char *buffer, size_t buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ATTACK_LOGGER_H
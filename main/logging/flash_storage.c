@@ -0,0 +1,359 @@
+/*
+ * Flash Storage - Log-structured attack record store
+ *
+ * The raw log partition is a ring of sector-sized segments. Each segment
+ * starts with a header carrying a sequence number one higher than the
+ * previous segment's, followed by CRC-protected frames (one per append).
+ * Appends only ever program erased flash; the segment after the head is
+ * erased when the head fills, so every sector wears at the same rate.
+ *
+ * Because segments are written in ring order with rising sequence
+ * numbers, the header sequence is a rotated sorted array and the head is
+ * found with a binary search at boot instead of a full scan.
+ */
+
+#include "flash_storage.h"
+#include "utils/config.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "flash_storage";
+
+#define SEGMENT_MAGIC 0x484c4f47u   // "HLOG"
+#define FRAME_MARKER 0xa55a
+#define FRAME_ERASED 0xffff
+#define NO_SEGMENT UINT32_MAX
+
+#define ALIGN4(x) (((x) + 3u) & ~3u)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t crc;                 ///< CRC32 of magic and sequence
+} segment_header_t;
+
+typedef struct {
+    uint16_t length;              ///< Payload bytes, FRAME_ERASED past the last frame
+    uint16_t marker;              ///< FRAME_MARKER
+    uint32_t crc;                 ///< CRC32 of the payload
+} frame_header_t;
+
+_Static_assert(sizeof(segment_header_t) == FLASH_STORAGE_SEGMENT_HEADER_SIZE, "Segment header size mismatch");
+_Static_assert(sizeof(frame_header_t) == FLASH_STORAGE_FRAME_HEADER_SIZE, "Frame header size mismatch");
+
+static const esp_partition_t *partition = NULL;
+static uint32_t segment_count = 0;
+static uint32_t head_segment = NO_SEGMENT;
+static uint32_t head_sequence = 0;
+static uint32_t write_offset = 0;
+static flash_storage_stats_t stats = {0};
+
+// Scratch for reading one frame back
+static uint8_t read_buffer[FLASH_STORAGE_MAX_APPEND];
+
+// Internal function prototypes
+static bool read_segment_sequence(uint32_t segment, uint32_t *sequence);
+static uint32_t find_head_segment(void);
+static uint32_t scan_segment_end(uint32_t segment, bool *clean);
+static esp_err_t open_next_segment(void);
+static uint32_t segment_crc(uint32_t sequence);
+
+esp_err_t flash_storage_init(void)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         FLASH_LOG_PARTITION);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", FLASH_LOG_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    segment_count = partition->size / FLASH_STORAGE_SECTOR_SIZE;
+    if (segment_count < 2) {
+        ESP_LOGE(TAG, "Partition '%s' needs at least two sectors", FLASH_LOG_PARTITION);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    head_segment = find_head_segment();
+    if (head_segment == NO_SEGMENT) {
+        // Blank partition; the first append opens segment 0
+        write_offset = FLASH_STORAGE_SECTOR_SIZE;
+        head_sequence = 0;
+    } else {
+        bool clean;
+        write_offset = scan_segment_end(head_segment, &clean);
+        if (!clean) {
+            // A torn frame left programmed bytes behind; never write over them
+            ESP_LOGW(TAG, "Torn write in segment %lu, starting a new one",
+                     (unsigned long)head_segment);
+            write_offset = FLASH_STORAGE_SECTOR_SIZE;
+        }
+    }
+
+    stats.segments = segment_count;
+    stats.head_segment = head_segment;
+    stats.head_sequence = head_sequence;
+    stats.recovery_us = esp_timer_get_time() - start_us;
+
+    ESP_LOGI(TAG, "Log store: %lu segments, head %ld seq %lu, %lu header reads, %lld us",
+             (unsigned long)segment_count, head_segment == NO_SEGMENT ? -1L : (long)head_segment,
+             (unsigned long)head_sequence, (unsigned long)stats.recovery_header_reads,
+             (long long)stats.recovery_us);
+    return ESP_OK;
+}
+
+esp_err_t flash_storage_append(const uint8_t *data, size_t len)
+{
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (data == NULL || len == 0 || len > FLASH_STORAGE_MAX_APPEND) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t frame_size = FLASH_STORAGE_FRAME_HEADER_SIZE + ALIGN4(len);
+    if (write_offset + frame_size > FLASH_STORAGE_SECTOR_SIZE) {
+        esp_err_t err = open_next_segment();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    frame_header_t header = {
+        .length = (uint16_t)len,
+        .marker = FRAME_MARKER,
+        .crc = esp_rom_crc32_le(0, data, len),
+    };
+    size_t address = (size_t)head_segment * FLASH_STORAGE_SECTOR_SIZE + write_offset;
+
+    esp_err_t err = esp_partition_write(partition, address, &header, sizeof(header));
+    if (err == ESP_OK) {
+        err = esp_partition_write(partition, address + sizeof(header), data, len);
+    }
+
+    // Even on failure the space is consumed; the CRC will reject it later
+    write_offset += frame_size;
+    stats.appended_bytes += len;
+    stats.written_bytes += sizeof(header) + len;
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write at 0x%x failed: %s", (unsigned)address, esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t flash_storage_read_batches(size_t max_bytes, flash_batch_cb_t cb, void *ctx)
+{
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (cb == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (head_segment == NO_SEGMENT) {
+        return ESP_OK;
+    }
+
+    // Walk back from the head until enough payload is covered; a segment
+    // holds at most FLASH_STORAGE_MAX_APPEND payload bytes
+    uint32_t first = head_segment;
+    uint32_t first_sequence = head_sequence;
+    uint32_t walked = 1;
+    size_t covered = FLASH_STORAGE_MAX_APPEND;
+    while (walked < segment_count && (max_bytes == 0 || covered < max_bytes)) {
+        uint32_t prev = (first + segment_count - 1) % segment_count;
+        uint32_t sequence;
+        if (!read_segment_sequence(prev, &sequence) || sequence >= first_sequence) {
+            break;
+        }
+        first = prev;
+        first_sequence = sequence;
+        walked++;
+        covered += FLASH_STORAGE_MAX_APPEND;
+    }
+
+    for (uint32_t i = 0; i < walked; i++) {
+        uint32_t segment = (first + i) % segment_count;
+        size_t base = (size_t)segment * FLASH_STORAGE_SECTOR_SIZE;
+        uint32_t offset = FLASH_STORAGE_SEGMENT_HEADER_SIZE;
+
+        while (offset + FLASH_STORAGE_FRAME_HEADER_SIZE <= FLASH_STORAGE_SECTOR_SIZE) {
+            frame_header_t header;
+            if (esp_partition_read(partition, base + offset, &header, sizeof(header)) != ESP_OK ||
+                header.length == FRAME_ERASED || header.marker != FRAME_MARKER ||
+                header.length > FLASH_STORAGE_MAX_APPEND) {
+                break;
+            }
+
+            if (esp_partition_read(partition, base + offset + sizeof(header),
+                                   read_buffer, header.length) == ESP_OK &&
+                esp_rom_crc32_le(0, read_buffer, header.length) == header.crc) {
+                cb(read_buffer, header.length, ctx);
+            } else {
+                stats.corrupt_frames++;
+            }
+            offset += FLASH_STORAGE_FRAME_HEADER_SIZE + ALIGN4(header.length);
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t flash_storage_clear_all(void)
+{
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ESP_LOGI(TAG, "Erasing log partition");
+
+    esp_err_t err = esp_partition_erase_range(partition, 0, (size_t)segment_count * FLASH_STORAGE_SECTOR_SIZE);
+    stats.erases += segment_count;
+
+    head_segment = NO_SEGMENT;
+    head_sequence = 0;
+    write_offset = FLASH_STORAGE_SECTOR_SIZE;
+    stats.head_segment = head_segment;
+    stats.head_sequence = head_sequence;
+    return err;
+}
+
+esp_err_t flash_storage_get_stats(flash_storage_stats_t *out_stats)
+{
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(out_stats, &stats, sizeof(flash_storage_stats_t));
+    return ESP_OK;
+}
+
+static bool read_segment_sequence(uint32_t segment, uint32_t *sequence)
+{
+    segment_header_t header;
+
+    if (esp_partition_read(partition, (size_t)segment * FLASH_STORAGE_SECTOR_SIZE,
+                           &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+
+    if (header.magic != SEGMENT_MAGIC || header.crc != segment_crc(header.sequence)) {
+        return false;
+    }
+
+    *sequence = header.sequence;
+    return true;
+}
+
+static uint32_t find_head_segment(void)
+{
+    uint32_t first_sequence;
+
+    stats.recovery_header_reads++;
+    // Segment 0 unreadable: either the partition is blank, or the ring
+    // wrapped and segment 0 was being erased, leaving the last one as head
+    if (!read_segment_sequence(0, &first_sequence)) {
+        uint32_t last = segment_count - 1;
+        stats.recovery_header_reads++;
+        if (read_segment_sequence(last, &head_sequence)) {
+            return last;
+        }
+        return NO_SEGMENT;
+    }
+
+    // Segments 0..head hold sequences >= segment 0's; everything after is
+    // either older or blank. Find the last index where that holds.
+    uint32_t lo = 0;
+    uint32_t hi = segment_count - 1;
+    head_sequence = first_sequence;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        uint32_t sequence;
+        stats.recovery_header_reads++;
+        if (read_segment_sequence(mid, &sequence) && sequence >= first_sequence) {
+            lo = mid;
+            head_sequence = sequence;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    if (lo != 0 && head_sequence != first_sequence + lo) {
+        // Only happens if headers were damaged; trust what was read
+        ESP_LOGW(TAG, "Segment sequence gap at %lu", (unsigned long)lo);
+    }
+    return lo;
+}
+
+static uint32_t scan_segment_end(uint32_t segment, bool *clean)
+{
+    size_t base = (size_t)segment * FLASH_STORAGE_SECTOR_SIZE;
+    uint32_t offset = FLASH_STORAGE_SEGMENT_HEADER_SIZE;
+
+    *clean = true;
+    while (offset + FLASH_STORAGE_FRAME_HEADER_SIZE <= FLASH_STORAGE_SECTOR_SIZE) {
+        frame_header_t header;
+        if (esp_partition_read(partition, base + offset, &header, sizeof(header)) != ESP_OK) {
+            *clean = false;
+            break;
+        }
+
+        if (header.length == FRAME_ERASED && header.marker == FRAME_ERASED) {
+            break;
+        }
+
+        if (header.marker != FRAME_MARKER || header.length > FLASH_STORAGE_MAX_APPEND) {
+            *clean = false;
+            break;
+        }
+        offset += FLASH_STORAGE_FRAME_HEADER_SIZE + ALIGN4(header.length);
+    }
+
+    return offset;
+}
+
+static esp_err_t open_next_segment(void)
+{
+    uint32_t next = head_segment == NO_SEGMENT ? 0 : (head_segment + 1) % segment_count;
+    size_t address = (size_t)next * FLASH_STORAGE_SECTOR_SIZE;
+
+    esp_err_t err = esp_partition_erase_range(partition, address, FLASH_STORAGE_SECTOR_SIZE);
+    stats.erases++;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Erase of segment %lu failed: %s", (unsigned long)next, esp_err_to_name(err));
+        return err;
+    }
+
+    segment_header_t header = {
+        .magic = SEGMENT_MAGIC,
+        .sequence = head_sequence + 1,
+        .crc = segment_crc(head_sequence + 1),
+    };
+    err = esp_partition_write(partition, address, &header, sizeof(header));
+    stats.written_bytes += sizeof(header);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Header write of segment %lu failed: %s", (unsigned long)next, esp_err_to_name(err));
+        return err;
+    }
+
+    head_segment = next;
+    head_sequence = header.sequence;
+    write_offset = FLASH_STORAGE_SEGMENT_HEADER_SIZE;
+    stats.head_segment = head_segment;
+    stats.head_sequence = head_sequence;
+    return ESP_OK;
+}
+
+static uint32_t segment_crc(uint32_t sequence)
+{
+    uint32_t words[2] = { SEGMENT_MAGIC, sequence };
+    return esp_rom_crc32_le(0, (const uint8_t *)words, sizeof(words));
+}
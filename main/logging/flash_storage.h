@@ -0,0 +1,94 @@
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_STORAGE_SECTOR_SIZE 4096          ///< Erase unit, one segment per sector
+#define FLASH_STORAGE_SEGMENT_HEADER_SIZE 12    ///< Magic, sequence number, CRC
+#define FLASH_STORAGE_FRAME_HEADER_SIZE 8       ///< Length, marker, CRC of each append
+
+/** Largest batch flash_storage_append() accepts: one frame filling a segment */
+#define FLASH_STORAGE_MAX_APPEND (FLASH_STORAGE_SECTOR_SIZE - FLASH_STORAGE_SEGMENT_HEADER_SIZE - \
+                                  FLASH_STORAGE_FRAME_HEADER_SIZE)
+
+/**
+ * @brief Flash store statistics
+ */
+typedef struct {
+    uint32_t segments;                     ///< Sectors in the log partition
+    uint32_t head_segment;                 ///< Segment currently being appended to
+    uint32_t head_sequence;                ///< Sequence number of the head segment
+    uint32_t recovery_header_reads;        ///< Segment headers read to find the head at boot
+    int64_t recovery_us;                   ///< Time spent in flash_storage_init()
+    uint64_t appended_bytes;               ///< Payload bytes passed to flash_storage_append()
+    uint64_t written_bytes;                ///< Bytes programmed, including headers
+    uint32_t erases;                       ///< Sector erases since boot
+    uint32_t corrupt_frames;               ///< Frames skipped because of a bad CRC
+} flash_storage_stats_t;
+
+/**
+ * @brief Mount the log partition and locate the newest segment
+ *
+ * Only O(log n) segment headers are read; records are not touched.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_storage_init(void);
+
+/**
+ * @brief Callback receiving one stored batch of encoded records
+ *
+ * @param data Batch contents, see log_record.h
+ * @param len Length of @p data
+ * @param ctx Caller context
+ */
+typedef void (*flash_batch_cb_t)(const uint8_t *data, size_t len, void *ctx);
+
+/**
+ * @brief Append a batch of encoded records in a single flash write
+ *
+ * @param data Encoded records
+ * @param len Length of @p data, at most FLASH_STORAGE_MAX_APPEND
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_storage_append(const uint8_t *data, size_t len);
+
+/**
+ * @brief Walk the newest stored batches, oldest first
+ *
+ * Batches whose CRC does not match are skipped.
+ *
+ * @param max_bytes Stop going back once this many payload bytes are
+ *                  covered, 0 to walk the whole log
+ * @param cb Called once per batch
+ * @param ctx Passed through to @p cb
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_storage_read_batches(size_t max_bytes, flash_batch_cb_t cb, void *ctx);
+
+/**
+ * @brief Erase all stored records
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_storage_clear_all(void);
+
+/**
+ * @brief Get flash store statistics
+ *
+ * @param out_stats Receives the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_storage_get_stats(flash_storage_stats_t *out_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLASH_STORAGE_H
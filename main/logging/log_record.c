@@ -0,0 +1,326 @@
+/*
+ * Log Record - Compact binary attack record encoding
+ *
+ * Layout, in order:
+ *   flags        u8, which optional fields follow
+ *   service      u8, log_service_t
+ *   timestamp    zigzag varint, delta from the previous record
+ *   source IPv4  4 bytes, network order
+ *   port         varint
+ *   hash         16 raw bytes                       (RECORD_HAS_HASH)
+ *   repeat       varint hits, varint seconds since first seen
+ *                                                  (RECORD_HAS_REPEAT)
+ *   strings      varint length + bytes, each only if its flag is set:
+ *                service name, username, password, user agent, metadata,
+ *                indicators
+ *
+ * Repeats of a known payload leave out the user agent, metadata and
+ * indicators; all come from the payload, which the payload store keeps a
+ * sample of.
+ */
+
+#include "log_record.h"
+#include "utils/helpers.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RECORD_HAS_HASH         0x01
+#define RECORD_HAS_SERVICE_NAME 0x02
+#define RECORD_HAS_USERNAME     0x04
+#define RECORD_HAS_PASSWORD     0x08
+#define RECORD_HAS_USER_AGENT   0x10
+#define RECORD_HAS_METADATA     0x20
+#define RECORD_HAS_REPEAT       0x40
+#define RECORD_HAS_INDICATORS   0x80
+
+#define HASH_BYTES 16
+
+static const char *const SERVICE_NAMES[LOG_SERVICE_COUNT] = {
+    [LOG_SERVICE_OTHER] = "",
+    [LOG_SERVICE_HTTP] = "HTTP",
+    [LOG_SERVICE_TELNET] = "TELNET",
+    [LOG_SERVICE_FTP] = "FTP",
+    [LOG_SERVICE_MQTT] = "MQTT",
+};
+
+// Bounded output cursor; overflow latches and the record is rejected
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t pos;
+    bool overflow;
+} writer_t;
+
+// Bounded input cursor; running past the end latches an error
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool error;
+} reader_t;
+
+// Internal function prototypes
+static void put_byte(writer_t *w, uint8_t value);
+static void put_bytes(writer_t *w, const void *data, size_t len);
+static void put_varint(writer_t *w, uint64_t value);
+static void put_string(writer_t *w, const char *str, size_t field_size);
+static uint8_t get_byte(reader_t *r);
+static void get_bytes(reader_t *r, void *data, size_t len);
+static uint64_t get_varint(reader_t *r);
+static void get_string(reader_t *r, char *str, size_t field_size);
+static bool is_absent(const char *str);
+static bool parse_ipv4(const char *str, uint8_t out[4]);
+
+size_t log_record_encode(log_record_ctx_t *ctx, const attack_log_t *log, uint8_t *buf, size_t buf_size)
+{
+    writer_t w = { buf, buf_size, 0, false };
+    uint8_t service = LOG_SERVICE_OTHER;
+    uint8_t ip[4] = {0};
+    uint8_t hash[HASH_BYTES];
+    uint8_t flags = 0;
+
+    for (int i = LOG_SERVICE_OTHER + 1; i < LOG_SERVICE_COUNT; i++) {
+        if (strcmp(log->service, SERVICE_NAMES[i]) == 0) {
+            service = i;
+            break;
+        }
+    }
+
+    if (parse_hash(log->payload_hash, hash, HASH_BYTES)) {
+        flags |= RECORD_HAS_HASH;
+        if (log->payload_hits > 1) {
+            flags |= RECORD_HAS_REPEAT;
+        }
+    }
+    if (service == LOG_SERVICE_OTHER && log->service[0] != '\0') {
+        flags |= RECORD_HAS_SERVICE_NAME;
+    }
+    if (!is_absent(log->username)) {
+        flags |= RECORD_HAS_USERNAME;
+    }
+    if (!is_absent(log->password)) {
+        flags |= RECORD_HAS_PASSWORD;
+    }
+    if (log->user_agent[0] != '\0' && !(flags & RECORD_HAS_REPEAT)) {
+        flags |= RECORD_HAS_USER_AGENT;
+    }
+    if (log->metadata[0] != '\0' && !(flags & RECORD_HAS_REPEAT)) {
+        flags |= RECORD_HAS_METADATA;
+    }
+    if (log->indicators[0] != '\0' && !(flags & RECORD_HAS_REPEAT)) {
+        flags |= RECORD_HAS_INDICATORS;
+    }
+    parse_ipv4(log->source_ip, ip);
+
+    // Zigzag keeps small negative deltas (clock steps back) small
+    int64_t delta = (int64_t)log->timestamp - (int64_t)ctx->last_timestamp;
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+
+    put_byte(&w, flags);
+    put_byte(&w, service);
+    put_varint(&w, zigzag);
+    put_bytes(&w, ip, sizeof(ip));
+    put_varint(&w, log->target_port);
+    if (flags & RECORD_HAS_HASH) {
+        put_bytes(&w, hash, sizeof(hash));
+    }
+    if (flags & RECORD_HAS_REPEAT) {
+        int64_t age = (int64_t)log->timestamp - (int64_t)log->payload_first_seen;
+        put_varint(&w, log->payload_hits);
+        put_varint(&w, age > 0 ? (uint64_t)age : 0);
+    }
+    if (flags & RECORD_HAS_SERVICE_NAME) {
+        put_string(&w, log->service, sizeof(log->service));
+    }
+    if (flags & RECORD_HAS_USERNAME) {
+        put_string(&w, log->username, sizeof(log->username));
+    }
+    if (flags & RECORD_HAS_PASSWORD) {
+        put_string(&w, log->password, sizeof(log->password));
+    }
+    if (flags & RECORD_HAS_USER_AGENT) {
+        put_string(&w, log->user_agent, sizeof(log->user_agent));
+    }
+    if (flags & RECORD_HAS_METADATA) {
+        put_string(&w, log->metadata, sizeof(log->metadata));
+    }
+    if (flags & RECORD_HAS_INDICATORS) {
+        put_string(&w, log->indicators, sizeof(log->indicators));
+    }
+
+    if (w.overflow) {
+        return 0;
+    }
+
+    ctx->last_timestamp = log->timestamp;
+    return w.pos;
+}
+
+size_t log_record_decode(log_record_ctx_t *ctx, const uint8_t *buf, size_t len, attack_log_t *log)
+{
+    reader_t r = { buf, len, 0, false };
+    uint8_t ip[4];
+
+    memset(log, 0, sizeof(*log));
+
+    uint8_t flags = get_byte(&r);
+    uint8_t service = get_byte(&r);
+    uint64_t zigzag = get_varint(&r);
+    get_bytes(&r, ip, sizeof(ip));
+    uint64_t port = get_varint(&r);
+
+    if (flags & RECORD_HAS_HASH) {
+        uint8_t hash[HASH_BYTES];
+        get_bytes(&r, hash, sizeof(hash));
+        for (int i = 0; i < HASH_BYTES && !r.error; i++) {
+            snprintf(&log->payload_hash[i * 2], 3, "%02x", hash[i]);
+        }
+    }
+    uint64_t hits = flags & RECORD_HAS_HASH ? 1 : 0;
+    uint64_t age = 0;
+    if (flags & RECORD_HAS_REPEAT) {
+        hits = get_varint(&r);
+        age = get_varint(&r);
+    }
+
+    if (flags & RECORD_HAS_SERVICE_NAME) {
+        get_string(&r, log->service, sizeof(log->service));
+    } else if (service < LOG_SERVICE_COUNT) {
+        strcpy(log->service, SERVICE_NAMES[service]);
+    } else {
+        r.error = true;
+    }
+
+    if (flags & RECORD_HAS_USERNAME) {
+        get_string(&r, log->username, sizeof(log->username));
+    } else {
+        strcpy(log->username, "N/A");
+    }
+    if (flags & RECORD_HAS_PASSWORD) {
+        get_string(&r, log->password, sizeof(log->password));
+    } else {
+        strcpy(log->password, "N/A");
+    }
+    if (flags & RECORD_HAS_USER_AGENT) {
+        get_string(&r, log->user_agent, sizeof(log->user_agent));
+    }
+    if (flags & RECORD_HAS_METADATA) {
+        get_string(&r, log->metadata, sizeof(log->metadata));
+    }
+    if (flags & RECORD_HAS_INDICATORS) {
+        get_string(&r, log->indicators, sizeof(log->indicators));
+    }
+
+    if (r.error || port > UINT16_MAX || hits > UINT32_MAX) {
+        return 0;
+    }
+
+    int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    log->timestamp = (time_t)((int64_t)ctx->last_timestamp + delta);
+    log->target_port = (uint16_t)port;
+    log->payload_hits = (uint32_t)hits;
+    log->payload_first_seen = hits > 0 ? (time_t)((int64_t)log->timestamp - (int64_t)age) : 0;
+    snprintf(log->source_ip, sizeof(log->source_ip), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+
+    ctx->last_timestamp = log->timestamp;
+    return r.pos;
+}
+
+static void put_byte(writer_t *w, uint8_t value)
+{
+    put_bytes(w, &value, 1);
+}
+
+static void put_bytes(writer_t *w, const void *data, size_t len)
+{
+    if (w->overflow || len > w->size - w->pos) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->pos, data, len);
+    w->pos += len;
+}
+
+static void put_varint(writer_t *w, uint64_t value)
+{
+    while (value >= 0x80) {
+        put_byte(w, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(w, (uint8_t)value);
+}
+
+static void put_string(writer_t *w, const char *str, size_t field_size)
+{
+    size_t len = strnlen(str, field_size - 1);
+    put_varint(w, len);
+    put_bytes(w, str, len);
+}
+
+static uint8_t get_byte(reader_t *r)
+{
+    uint8_t value = 0;
+    get_bytes(r, &value, 1);
+    return value;
+}
+
+static void get_bytes(reader_t *r, void *data, size_t len)
+{
+    if (r->error || len > r->len - r->pos) {
+        r->error = true;
+        memset(data, 0, len);
+        return;
+    }
+    memcpy(data, r->buf + r->pos, len);
+    r->pos += len;
+}
+
+static uint64_t get_varint(reader_t *r)
+{
+    uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = get_byte(r);
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+
+    r->error = true;
+    return 0;
+}
+
+static void get_string(reader_t *r, char *str, size_t field_size)
+{
+    uint64_t len = get_varint(r);
+
+    if (len >= field_size) {
+        r->error = true;
+        return;
+    }
+    get_bytes(r, str, (size_t)len);
+    str[r->error ? 0 : len] = '\0';
+}
+
+static bool is_absent(const char *str)
+{
+    return str[0] == '\0' || strcmp(str, "N/A") == 0;
+}
+
+static bool parse_ipv4(const char *str, uint8_t out[4])
+{
+    unsigned int a, b, c, d;
+    char tail;
+
+    if (sscanf(str, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 ||
+        a > 255 || b > 255 || c > 255 || d > 255) {
+        return false;
+    }
+    out[0] = a;
+    out[1] = b;
+    out[2] = c;
+    out[3] = d;
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include "logging/attack_logger.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Largest encoded record
+ *
+ * Flags, service, timestamp varint, IPv4, port varint and hash, plus every
+ * string at its full field length with its length prefix. Repeats add two
+ * varints but drop the three longest strings, so they are always smaller.
+ */
+#define LOG_RECORD_MAX_SIZE (1 + 1 + 10 + 4 + 3 + 16 + \
+                             (1 + 15) + (1 + 63) + (1 + 63) + (2 + 127) + (2 + 127) + (2 + 127))
+
+/**
+ * @brief Emulated service, stored as one byte
+ */
+typedef enum {
+    LOG_SERVICE_OTHER = 0,        ///< Name is stored as a string
+    LOG_SERVICE_HTTP,
+    LOG_SERVICE_TELNET,
+    LOG_SERVICE_FTP,
+    LOG_SERVICE_MQTT,
+    LOG_SERVICE_COUNT
+} log_service_t;
+
+/**
+ * @brief Timestamp base shared by consecutive records in a stream
+ *
+ * Timestamps are stored as signed deltas from the previous record. Start
+ * each independently decodable run (a flash batch, a RAM slot) with a
+ * zeroed context; the first record then carries the absolute time.
+ */
+typedef struct {
+    time_t last_timestamp;
+} log_record_ctx_t;
+
+/**
+ * @brief Encode a record
+ *
+ * Usernames and passwords of "N/A" or "" are stored as absent. A payload
+ * hash that is not 32 hex digits is dropped. Records with payload_hits
+ * above 1 are stored without user agent, metadata and indicators; lower
+ * counts are stored as first sightings.
+ *
+ * @param ctx Stream context, updated on success
+ * @param log Record to encode
+ * @param buf Output buffer
+ * @param buf_size Size of @p buf
+ * @return size_t Encoded length, 0 if it does not fit in @p buf
+ */
+size_t log_record_encode(log_record_ctx_t *ctx, const attack_log_t *log, uint8_t *buf, size_t buf_size);
+
+/**
+ * @brief Decode a record
+ *
+ * @param ctx Stream context, updated on success
+ * @param buf Encoded bytes
+ * @param len Bytes available in @p buf
+ * @param log Receives the record; absent username and password decode as "N/A"
+ * @return size_t Bytes consumed, 0 if the record is truncated or malformed
+ */
+size_t log_record_decode(log_record_ctx_t *ctx, const uint8_t *buf, size_t len, attack_log_t *log);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_RECORD_H
@@ -0,0 +1,719 @@
+/*
+ * Payload Store - Content-addressed payload samples
+ *
+ * Botnets replay identical payloads, so each unique payload hash gets one
+ * index entry in RAM (hit count, first and last sighting) and one bounded
+ * sample in flash. Log records for repeats then only need the hash, the
+ * hit count and the first-seen time. When the index is full the least
+ * recently seen payload is evicted.
+ *
+ * The sample partition is a set of sectors split into fixed slots that
+ * are programmed in order. One sector is always kept erased as a spare:
+ * when the head sector fills, the spare becomes the head, the sector with
+ * the fewest live samples is reclaimed by copying its live samples into
+ * the new head, and the reclaimed sector is erased to become the next
+ * spare. Keeping fewer index entries than slots in all but one sector
+ * guarantees those copies always fit.
+ *
+ * Only RAM is touched on the network path; flash is written from the log
+ * writer task through payload_store_flush().
+ */
+
+#include "payload_store.h"
+#include "utils/config.h"
+#include "utils/helpers.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "payload_store";
+
+#define SECTOR_SIZE 4096
+#define SLOTS_PER_SECTOR (SECTOR_SIZE / PAYLOAD_STORE_SLOT_SIZE)
+#define MAX_SECTORS 16
+#define MAX_SLOTS (MAX_SECTORS * SLOTS_PER_SECTOR)
+#define HASH_BYTES 16
+
+#define SLOT_MAGIC 0x50534d50u   // "PMSP"
+#define NIL 0xff                 // End of an entry list
+#define NO_SLOT (-1)
+#define NO_SECTOR UINT32_MAX
+
+// Slot owners other than an entry index
+#define SLOT_ERASED (-1)         // Never programmed since the last erase
+#define SLOT_DEAD (-2)           // Programmed, sample no longer referenced
+
+typedef struct {
+    uint32_t magic;
+    uint8_t hash[HASH_BYTES];
+    uint32_t first_seen;
+    uint16_t length;              ///< Sample bytes after the header
+    uint16_t reserved;
+    uint32_t crc;                 ///< CRC32 of the fields above and the sample
+} slot_header_t;
+
+typedef struct {
+    uint8_t hash[HASH_BYTES];
+    uint32_t hits;
+    time_t first_seen;
+    time_t last_seen;
+    int16_t slot;                 ///< Flash slot holding the sample, NO_SLOT if none
+    int8_t pending;               ///< Pending pool index of its queued sample, -1 if none
+    uint8_t prev;                 ///< Recency list neighbours, NIL at the ends
+    uint8_t next;
+} entry_t;
+
+typedef struct {
+    bool used;
+    uint8_t entry;
+    uint8_t hash[HASH_BYTES];
+    time_t first_seen;
+    uint16_t length;
+    uint8_t data[PAYLOAD_STORE_SAMPLE_MAX];
+} pending_sample_t;
+
+_Static_assert(sizeof(slot_header_t) == PAYLOAD_STORE_SLOT_HEADER_SIZE, "Slot header size mismatch");
+_Static_assert(SECTOR_SIZE % PAYLOAD_STORE_SLOT_SIZE == 0, "Slots must tile a sector");
+_Static_assert(PAYLOAD_STORE_MAX_ENTRIES < NIL, "Entry indices must fit in a byte");
+_Static_assert(PAYLOAD_STORE_PENDING <= INT8_MAX, "Pending indices must fit in an int8_t");
+
+static const esp_partition_t *partition = NULL;
+static SemaphoreHandle_t store_mutex = NULL;
+static uint32_t sector_count = 0;
+
+// Index, guarded by store_mutex; MRU at lru_head
+static entry_t entries[PAYLOAD_STORE_MAX_ENTRIES];
+static uint8_t lru_head = NIL;
+static uint8_t lru_tail = NIL;
+static uint8_t free_head = NIL;
+static uint32_t entry_count = 0;
+static int8_t slot_owner[MAX_SLOTS];
+static pending_sample_t pending[PAYLOAD_STORE_PENDING];
+static bool clear_requested = false;
+static payload_store_stats_t stats = {0};
+
+// Writer task only
+static uint32_t head_sector = NO_SECTOR;
+static uint32_t head_next = SLOTS_PER_SECTOR;
+static uint32_t spare_sector = NO_SECTOR;
+static uint8_t io_buffer[PAYLOAD_STORE_SAMPLE_MAX];
+
+// Internal function prototypes
+static void reset_index(void);
+static uint8_t find_entry(const uint8_t hash[HASH_BYTES]);
+static uint8_t insert_entry(const uint8_t hash[HASH_BYTES], time_t now);
+static void drop_entry(uint8_t e);
+static void lru_unlink(uint8_t e);
+static void lru_push_front(uint8_t e);
+static void queue_sample(uint8_t e, const uint8_t *data, size_t len);
+static void write_pending(int index);
+static int32_t alloc_slot(void);
+static esp_err_t reclaim_sector(void);
+static esp_err_t make_spare(void);
+static uint32_t least_live_sector(uint32_t exclude);
+static esp_err_t erase_sector(uint32_t sector);
+static void choose_sectors(void);
+static bool read_slot(uint32_t slot, slot_header_t *header, uint8_t *data);
+static esp_err_t write_slot(uint32_t slot, const slot_header_t *header, const uint8_t *data);
+static uint32_t slot_crc(const slot_header_t *header, const uint8_t *data);
+static bool is_erased(const void *data, size_t len);
+
+esp_err_t payload_store_init(void)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         PAYLOAD_STORE_PARTITION);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", PAYLOAD_STORE_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sector_count = partition->size / SECTOR_SIZE;
+    if (sector_count > MAX_SECTORS) {
+        sector_count = MAX_SECTORS;
+    }
+    // Reclaiming must always find a sector with a free slot left over
+    if (sector_count < 2 || (sector_count - 1) * SLOTS_PER_SECTOR <= PAYLOAD_STORE_MAX_ENTRIES) {
+        ESP_LOGE(TAG, "Partition '%s' too small for %d entries", PAYLOAD_STORE_PARTITION,
+                 PAYLOAD_STORE_MAX_ENTRIES);
+        partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    store_mutex = xSemaphoreCreateMutex();
+    if (store_mutex == NULL) {
+        partition = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Rebuild the index from the samples; counts restart from zero
+    reset_index();
+    for (uint32_t slot = 0; slot < sector_count * SLOTS_PER_SECTOR; slot++) {
+        slot_header_t header;
+
+        slot_owner[slot] = SLOT_DEAD;
+        if (esp_partition_read(partition, (size_t)slot * PAYLOAD_STORE_SLOT_SIZE,
+                               &header, sizeof(header)) != ESP_OK) {
+            continue;
+        }
+        if (is_erased(&header, sizeof(header))) {
+            slot_owner[slot] = SLOT_ERASED;
+            continue;
+        }
+        if (!read_slot(slot, &header, io_buffer) || find_entry(header.hash) != NIL ||
+            free_head == NIL) {
+            continue;
+        }
+
+        uint8_t e = insert_entry(header.hash, (time_t)header.first_seen);
+        entries[e].hits = 0;
+        entries[e].slot = (int16_t)slot;
+        slot_owner[slot] = (int8_t)e;
+    }
+    choose_sectors();
+
+    stats.slots = sector_count * SLOTS_PER_SECTOR;
+    stats.unique = 0;
+    stats.recovery_us = esp_timer_get_time() - start_us;
+
+    ESP_LOGI(TAG, "Payload store: %lu slots, %lu samples recovered, %lld us",
+             (unsigned long)stats.slots, (unsigned long)entry_count, (long long)stats.recovery_us);
+    return ESP_OK;
+}
+
+esp_err_t payload_store_observe(const char *payload_hash, const uint8_t *data, size_t len,
+                                time_t now, payload_ref_t *out_ref)
+{
+    uint8_t hash[HASH_BYTES];
+
+    if (store_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (payload_hash == NULL || out_ref == NULL || !parse_hash(payload_hash, hash, HASH_BYTES)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+
+    uint8_t e = find_entry(hash);
+    if (e != NIL) {
+        entries[e].hits++;
+        entries[e].last_seen = now;
+        lru_unlink(e);
+        lru_push_front(e);
+        stats.repeats++;
+    } else {
+        e = insert_entry(hash, now);
+        stats.unique++;
+    }
+
+    // Also retries payloads whose sample could not be queued before
+    if (entries[e].slot == NO_SLOT && entries[e].pending < 0 && data != NULL && len > 0) {
+        queue_sample(e, data, len);
+    }
+
+    out_ref->hits = entries[e].hits;
+    out_ref->first_seen = entries[e].first_seen;
+
+    xSemaphoreGive(store_mutex);
+    return ESP_OK;
+}
+
+esp_err_t payload_store_flush(void)
+{
+    if (store_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    bool clear = clear_requested;
+    clear_requested = false;
+    xSemaphoreGive(store_mutex);
+
+    if (clear) {
+        esp_err_t err = esp_partition_erase_range(partition, 0, (size_t)sector_count * SECTOR_SIZE);
+        xSemaphoreTake(store_mutex, portMAX_DELAY);
+        stats.erases += sector_count;
+        for (uint32_t slot = 0; slot < sector_count * SLOTS_PER_SECTOR; slot++) {
+            slot_owner[slot] = err == ESP_OK ? SLOT_ERASED : SLOT_DEAD;
+        }
+        xSemaphoreGive(store_mutex);
+
+        head_sector = 0;
+        head_next = 0;
+        spare_sector = 1;
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Erase failed: %s", esp_err_to_name(err));
+            head_next = SLOTS_PER_SECTOR;
+            spare_sector = NO_SECTOR;
+        }
+    }
+
+    for (int i = 0; i < PAYLOAD_STORE_PENDING; i++) {
+        write_pending(i);
+    }
+    return ESP_OK;
+}
+
+esp_err_t payload_store_get_sample(const char *payload_hash, uint8_t *buffer, size_t buffer_size,
+                                   size_t *out_len)
+{
+    uint8_t hash[HASH_BYTES];
+    int32_t slot = NO_SLOT;
+
+    if (store_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (payload_hash == NULL || buffer == NULL || out_len == NULL || !parse_hash(payload_hash, hash, HASH_BYTES)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    uint8_t e = find_entry(hash);
+    if (e != NIL) {
+        slot = entries[e].slot;
+    }
+    xSemaphoreGive(store_mutex);
+
+    if (slot == NO_SLOT) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // The writer may relocate the sample meanwhile; the hash and CRC tell
+    slot_header_t header;
+    size_t address = (size_t)slot * PAYLOAD_STORE_SLOT_SIZE;
+    if (esp_partition_read(partition, address, &header, sizeof(header)) != ESP_OK ||
+        header.magic != SLOT_MAGIC || memcmp(header.hash, hash, HASH_BYTES) != 0 ||
+        header.length > PAYLOAD_STORE_SAMPLE_MAX) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *out_len = header.length;
+    if (buffer_size < header.length) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (esp_partition_read(partition, address + sizeof(header), buffer, header.length) != ESP_OK ||
+        slot_crc(&header, buffer) != header.crc) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+esp_err_t payload_store_clear_all(void)
+{
+    if (store_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ESP_LOGI(TAG, "Clearing payload store");
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    reset_index();
+    for (uint32_t slot = 0; slot < sector_count * SLOTS_PER_SECTOR; slot++) {
+        if (slot_owner[slot] >= 0) {
+            slot_owner[slot] = SLOT_DEAD;
+        }
+    }
+    clear_requested = true;
+    xSemaphoreGive(store_mutex);
+    return ESP_OK;
+}
+
+esp_err_t payload_store_get_stats(payload_store_stats_t *out_stats)
+{
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (store_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    memcpy(out_stats, &stats, sizeof(payload_store_stats_t));
+    out_stats->entries = entry_count;
+    out_stats->samples = 0;
+    for (uint32_t slot = 0; slot < sector_count * SLOTS_PER_SECTOR; slot++) {
+        if (slot_owner[slot] >= 0) {
+            out_stats->samples++;
+        }
+    }
+    xSemaphoreGive(store_mutex);
+    return ESP_OK;
+}
+
+static void reset_index(void)
+{
+    lru_head = NIL;
+    lru_tail = NIL;
+    free_head = NIL;
+    entry_count = 0;
+    for (int i = PAYLOAD_STORE_MAX_ENTRIES - 1; i >= 0; i--) {
+        entries[i].slot = NO_SLOT;
+        entries[i].pending = -1;
+        entries[i].next = free_head;
+        free_head = (uint8_t)i;
+    }
+}
+
+static uint8_t find_entry(const uint8_t hash[HASH_BYTES])
+{
+    // Walk from the most recent: during a wave the hit is near the front
+    for (uint8_t e = lru_head; e != NIL; e = entries[e].next) {
+        if (memcmp(entries[e].hash, hash, HASH_BYTES) == 0) {
+            return e;
+        }
+    }
+    return NIL;
+}
+
+static uint8_t insert_entry(const uint8_t hash[HASH_BYTES], time_t now)
+{
+    if (free_head == NIL) {
+        drop_entry(lru_tail);
+        stats.evictions++;
+    }
+
+    uint8_t e = free_head;
+    free_head = entries[e].next;
+    entry_count++;
+
+    memcpy(entries[e].hash, hash, HASH_BYTES);
+    entries[e].hits = 1;
+    entries[e].first_seen = now;
+    entries[e].last_seen = now;
+    entries[e].slot = NO_SLOT;
+    entries[e].pending = -1;
+    lru_push_front(e);
+    return e;
+}
+
+static void drop_entry(uint8_t e)
+{
+    lru_unlink(e);
+    if (entries[e].slot != NO_SLOT) {
+        slot_owner[entries[e].slot] = SLOT_DEAD;
+    }
+    // A sample still queued for it is discarded by write_pending()
+    entries[e].slot = NO_SLOT;
+    entries[e].pending = -1;
+    entries[e].next = free_head;
+    free_head = e;
+    entry_count--;
+}
+
+static void lru_unlink(uint8_t e)
+{
+    if (entries[e].prev != NIL) {
+        entries[entries[e].prev].next = entries[e].next;
+    } else {
+        lru_head = entries[e].next;
+    }
+    if (entries[e].next != NIL) {
+        entries[entries[e].next].prev = entries[e].prev;
+    } else {
+        lru_tail = entries[e].prev;
+    }
+}
+
+static void lru_push_front(uint8_t e)
+{
+    entries[e].prev = NIL;
+    entries[e].next = lru_head;
+    if (lru_head != NIL) {
+        entries[lru_head].prev = e;
+    } else {
+        lru_tail = e;
+    }
+    lru_head = e;
+}
+
+static void queue_sample(uint8_t e, const uint8_t *data, size_t len)
+{
+    for (int i = 0; i < PAYLOAD_STORE_PENDING; i++) {
+        pending_sample_t *p = &pending[i];
+        if (p->used) {
+            continue;
+        }
+
+        p->used = true;
+        p->entry = e;
+        memcpy(p->hash, entries[e].hash, HASH_BYTES);
+        p->first_seen = entries[e].first_seen;
+        p->length = (uint16_t)(len < PAYLOAD_STORE_SAMPLE_MAX ? len : PAYLOAD_STORE_SAMPLE_MAX);
+        memcpy(p->data, data, p->length);
+        entries[e].pending = (int8_t)i;
+        return;
+    }
+
+    stats.samples_dropped++;
+}
+
+static void write_pending(int index)
+{
+    pending_sample_t *p = &pending[index];
+
+    // Only the writer frees a used sample, so it is stable while unlocked
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    bool wanted = p->used && entries[p->entry].pending == index &&
+                  memcmp(entries[p->entry].hash, p->hash, HASH_BYTES) == 0;
+    if (p->used && !wanted) {
+        p->used = false;
+    }
+    xSemaphoreGive(store_mutex);
+
+    if (!wanted) {
+        return;
+    }
+
+    slot_header_t header = {
+        .magic = SLOT_MAGIC,
+        .first_seen = (uint32_t)p->first_seen,
+        .length = p->length,
+        .reserved = 0xffff,
+    };
+    memcpy(header.hash, p->hash, HASH_BYTES);
+    header.crc = slot_crc(&header, p->data);
+
+    int32_t slot = alloc_slot();
+    esp_err_t err = slot == NO_SLOT ? ESP_ERR_NO_MEM : write_slot(slot, &header, p->data);
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    bool still_wanted = entries[p->entry].pending == index &&
+                        memcmp(entries[p->entry].hash, p->hash, HASH_BYTES) == 0;
+    if (still_wanted) {
+        entries[p->entry].pending = -1;
+    }
+    if (slot != NO_SLOT) {
+        if (err == ESP_OK && still_wanted) {
+            entries[p->entry].slot = (int16_t)slot;
+            slot_owner[slot] = (int8_t)p->entry;
+            stats.samples_written++;
+        } else {
+            slot_owner[slot] = SLOT_DEAD;
+        }
+    }
+    p->used = false;
+    xSemaphoreGive(store_mutex);
+}
+
+static int32_t alloc_slot(void)
+{
+    if (head_next >= SLOTS_PER_SECTOR && reclaim_sector() != ESP_OK) {
+        return NO_SLOT;
+    }
+    return (int32_t)(head_sector * SLOTS_PER_SECTOR + head_next++);
+}
+
+static esp_err_t reclaim_sector(void)
+{
+    if (spare_sector == NO_SECTOR) {
+        // A previous erase failed; sacrifice the emptiest sector's samples
+        esp_err_t err = make_spare();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    head_sector = spare_sector;
+    head_next = 0;
+    spare_sector = NO_SECTOR;
+
+    uint32_t victim = least_live_sector(head_sector);
+
+    // Copy the victim's live samples into the new head
+    for (uint32_t i = 0; i < SLOTS_PER_SECTOR; i++) {
+        uint32_t slot = victim * SLOTS_PER_SECTOR + i;
+
+        xSemaphoreTake(store_mutex, portMAX_DELAY);
+        int8_t owner = slot_owner[slot];
+        xSemaphoreGive(store_mutex);
+        if (owner < 0) {
+            continue;
+        }
+
+        slot_header_t header;
+        bool copied = false;
+        uint32_t dest = head_sector * SLOTS_PER_SECTOR + head_next;
+        if (head_next < SLOTS_PER_SECTOR && read_slot(slot, &header, io_buffer)) {
+            head_next++;
+            copied = write_slot(dest, &header, io_buffer) == ESP_OK;
+        }
+
+        xSemaphoreTake(store_mutex, portMAX_DELAY);
+        bool still_owned = slot_owner[slot] == owner && entries[owner].slot == (int16_t)slot;
+        if (still_owned) {
+            entries[owner].slot = copied ? (int16_t)dest : NO_SLOT;
+        }
+        if (copied) {
+            slot_owner[dest] = still_owned ? owner : SLOT_DEAD;
+            stats.relocations++;
+        }
+        slot_owner[slot] = SLOT_DEAD;
+        xSemaphoreGive(store_mutex);
+    }
+
+    esp_err_t err = erase_sector(victim);
+    if (err == ESP_OK) {
+        spare_sector = victim;
+    }
+    // The new head has room either way
+    return ESP_OK;
+}
+
+static esp_err_t make_spare(void)
+{
+    uint32_t victim = least_live_sector(head_sector);
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < SLOTS_PER_SECTOR; i++) {
+        int8_t owner = slot_owner[victim * SLOTS_PER_SECTOR + i];
+        if (owner >= 0) {
+            entries[owner].slot = NO_SLOT;
+        }
+        slot_owner[victim * SLOTS_PER_SECTOR + i] = SLOT_DEAD;
+    }
+    xSemaphoreGive(store_mutex);
+
+    esp_err_t err = erase_sector(victim);
+    if (err == ESP_OK) {
+        spare_sector = victim;
+    }
+    return err;
+}
+
+static uint32_t least_live_sector(uint32_t exclude)
+{
+    uint32_t best = NO_SECTOR;
+    uint32_t best_live = SLOTS_PER_SECTOR + 1;
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    for (uint32_t sector = 0; sector < sector_count; sector++) {
+        if (sector == exclude) {
+            continue;
+        }
+
+        uint32_t live = 0;
+        for (uint32_t i = 0; i < SLOTS_PER_SECTOR; i++) {
+            if (slot_owner[sector * SLOTS_PER_SECTOR + i] >= 0) {
+                live++;
+            }
+        }
+        if (live < best_live) {
+            best = sector;
+            best_live = live;
+        }
+    }
+    xSemaphoreGive(store_mutex);
+    return best;
+}
+
+static esp_err_t erase_sector(uint32_t sector)
+{
+    esp_err_t err = esp_partition_erase_range(partition, (size_t)sector * SECTOR_SIZE, SECTOR_SIZE);
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    stats.erases++;
+    if (err == ESP_OK) {
+        for (uint32_t i = 0; i < SLOTS_PER_SECTOR; i++) {
+            slot_owner[sector * SLOTS_PER_SECTOR + i] = SLOT_ERASED;
+        }
+    }
+    xSemaphoreGive(store_mutex);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Erase of sector %lu failed: %s", (unsigned long)sector, esp_err_to_name(err));
+    }
+    return err;
+}
+
+static void choose_sectors(void)
+{
+    // Slots are programmed in order, so a sector's erased slots form a
+    // suffix. The spare must be fully erased; the head is the fullest
+    // sector that still has an erased suffix.
+    head_sector = NO_SECTOR;
+    head_next = SLOTS_PER_SECTOR;
+    spare_sector = NO_SECTOR;
+
+    for (uint32_t sector = 0; sector < sector_count; sector++) {
+        uint32_t next = SLOTS_PER_SECTOR;
+        while (next > 0 && slot_owner[sector * SLOTS_PER_SECTOR + next - 1] == SLOT_ERASED) {
+            next--;
+        }
+
+        if (next == 0 && spare_sector == NO_SECTOR) {
+            spare_sector = sector;
+        } else if (next < SLOTS_PER_SECTOR && (head_sector == NO_SECTOR || next > head_next)) {
+            head_sector = sector;
+            head_next = next;
+        }
+    }
+
+    if (spare_sector == NO_SECTOR) {
+        // Interrupted while reclaiming; the next allocation makes a spare
+        ESP_LOGW(TAG, "No erased spare sector");
+    }
+    if (head_sector == NO_SECTOR) {
+        // No room anywhere: the first write starts by reclaiming
+        head_sector = spare_sector == 0 ? 1 : 0;
+        head_next = SLOTS_PER_SECTOR;
+    }
+}
+
+static bool read_slot(uint32_t slot, slot_header_t *header, uint8_t *data)
+{
+    size_t address = (size_t)slot * PAYLOAD_STORE_SLOT_SIZE;
+
+    if (esp_partition_read(partition, address, header, sizeof(*header)) != ESP_OK ||
+        header->magic != SLOT_MAGIC || header->length > PAYLOAD_STORE_SAMPLE_MAX) {
+        return false;
+    }
+
+    return esp_partition_read(partition, address + sizeof(*header), data, header->length) == ESP_OK &&
+           slot_crc(header, data) == header->crc;
+}
+
+static esp_err_t write_slot(uint32_t slot, const slot_header_t *header, const uint8_t *data)
+{
+    size_t address = (size_t)slot * PAYLOAD_STORE_SLOT_SIZE;
+
+    // Header first: a torn write then always fails the CRC instead of
+    // leaving an erased-looking header over programmed bytes
+    esp_err_t err = esp_partition_write(partition, address, header, sizeof(*header));
+    if (err == ESP_OK) {
+        err = esp_partition_write(partition, address + sizeof(*header), data, header->length);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write of slot %lu failed: %s", (unsigned long)slot, esp_err_to_name(err));
+    }
+    return err;
+}
+
+static uint32_t slot_crc(const slot_header_t *header, const uint8_t *data)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(slot_header_t, crc));
+    return esp_rom_crc32_le(crc, data, header->length);
+}
+
+static bool is_erased(const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        if (bytes[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
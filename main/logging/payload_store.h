@@ -0,0 +1,107 @@
+#ifndef PAYLOAD_STORE_H
+#define PAYLOAD_STORE_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PAYLOAD_STORE_SLOT_SIZE 512             ///< Flash bytes per stored sample, header included
+#define PAYLOAD_STORE_SLOT_HEADER_SIZE 32       ///< Magic, hash, first seen, length, CRC
+#define PAYLOAD_STORE_SAMPLE_MAX (PAYLOAD_STORE_SLOT_SIZE - PAYLOAD_STORE_SLOT_HEADER_SIZE)
+
+/**
+ * @brief What the store knows about a payload
+ */
+typedef struct {
+    uint32_t hits;                         ///< Sightings since it entered the index, this one included
+    time_t first_seen;                     ///< Time of the first of those sightings
+} payload_ref_t;
+
+/**
+ * @brief Payload store statistics
+ */
+typedef struct {
+    uint32_t entries;                      ///< Unique payloads in the index
+    uint32_t samples;                      ///< Entries whose sample is in flash
+    uint32_t slots;                        ///< Sample slots in the partition
+    uint32_t unique;                       ///< New payloads seen since boot
+    uint32_t repeats;                      ///< Sightings of an already indexed payload
+    uint32_t evictions;                    ///< Least recently seen entries dropped for new ones
+    uint32_t samples_written;              ///< Samples programmed, relocations excluded
+    uint32_t samples_dropped;              ///< Samples not queued because the pending pool was full
+    uint32_t relocations;                  ///< Live samples copied out of a sector being reclaimed
+    uint32_t erases;                       ///< Sector erases since boot
+    int64_t recovery_us;                   ///< Time spent rebuilding the index at boot
+} payload_store_stats_t;
+
+/**
+ * @brief Mount the sample partition and rebuild the index from it
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t payload_store_init(void);
+
+/**
+ * @brief Record a sighting of a payload
+ *
+ * Cheap enough for the network path: only RAM is touched. The first
+ * sighting queues a copy of up to PAYLOAD_STORE_SAMPLE_MAX bytes that
+ * payload_store_flush() later writes to flash.
+ *
+ * @param payload_hash Payload digest, 32 hex digits
+ * @param data Payload bytes
+ * @param len Length of @p data
+ * @param now Time of the sighting
+ * @param out_ref Receives the hit count and first-seen time
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t payload_store_observe(const char *payload_hash, const uint8_t *data, size_t len,
+                                time_t now, payload_ref_t *out_ref);
+
+/**
+ * @brief Write queued samples to flash
+ *
+ * Must only be called from the log writer task.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t payload_store_flush(void);
+
+/**
+ * @brief Read back the stored sample of a payload
+ *
+ * @param payload_hash Payload digest, 32 hex digits
+ * @param buffer Output buffer
+ * @param buffer_size Size of @p buffer
+ * @param out_len Receives the sample length
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no sample is
+ *         stored, ESP_ERR_INVALID_SIZE if @p buffer is too small
+ */
+esp_err_t payload_store_get_sample(const char *payload_hash, uint8_t *buffer, size_t buffer_size,
+                                   size_t *out_len);
+
+/**
+ * @brief Forget all payloads; the partition is erased by the next flush
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t payload_store_clear_all(void);
+
+/**
+ * @brief Get payload store statistics
+ *
+ * @param out_stats Receives the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t payload_store_get_stats(payload_store_stats_t *out_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAYLOAD_STORE_H
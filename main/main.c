@@ -18,8 +18,16 @@
 #include "nvs_flash.h"
 #include "honeypot.h"
 #include "networking/wifi_manager.h"
+#include "networking/socket_manager.h"
+#include "logging/attack_logger.h"
+#include "logging/flash_storage.h"
+#include "logging/payload_store.h"
+#include "security/rate_limiter.h"
 #include "security/watchdog.h"
+#include "services/service_registry.h"
 #include "utils/config.h"
+#include "utils/metrics.h"
+#include "web_ui.h"
 
 static const char *TAG = "main";
 
@@ -27,6 +35,14 @@ static const char *TAG = "main";
 static void initialize_nvs(void);
 static void print_banner(void);
 static void monitor_task(void *pvParameters);
+#if CONFIG_HONEYPOT_METRICS_ENDPOINT
+static void collect_metrics(openmetrics_writer_t *w, void *ctx);
+static void write_counter(openmetrics_writer_t *w, const char *name, const char *help, uint64_t value);
+static void write_service_counter(openmetrics_writer_t *w, const metrics_snapshot_t *metrics,
+                                  metric_service_counter_t counter, const char *name, const char *help);
+static void write_latency(openmetrics_writer_t *w, const char *name, const char *help,
+                          const histogram_t *hist);
+#endif
 
 void app_main(void)
 {
@@ -54,6 +70,13 @@ void app_main(void)
     ESP_LOGI(TAG, "Waiting for WiFi connection...");
     vTaskDelay(3000 / portTICK_PERIOD_MS);
     
+    // Initialize honeypot subsystems
+    if (honeypot_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize honeypot");
+        vTaskDelay(5000 / portTICK_PERIOD_MS);
+        esp_restart();
+    }
+    
     // Create honeypot task
     if (honeypot_start() != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start honeypot");
@@ -62,7 +85,19 @@ void app_main(void)
     }
     
     // Create monitoring task
-    xTaskCreate(monitor_task, "monitor_task", 4096, NULL, 2, NULL);
+    xTaskCreate(monitor_task, "monitor_task", 6144, NULL, 2, NULL);
+    
+#if CONFIG_HONEYPOT_METRICS_ENDPOINT
+    // Scrape endpoint for the monitoring network
+    web_ui_config_t web_config = {
+        .port = CONFIG_HONEYPOT_METRICS_PORT,
+        .collector = collect_metrics,
+        .collector_ctx = NULL
+    };
+    if (web_ui_start(&web_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics endpoint unavailable");
+    }
+#endif
     
     ESP_LOGI(TAG, "Honeypot system initialized successfully");
 }
@@ -106,7 +141,217 @@ static void monitor_task(void *pvParameters)
         ESP_LOGI(TAG, "System monitor: Free heap: %d bytes", esp_get_free_heap_size());
         ESP_LOGI(TAG, "Minimum free heap: %d bytes", esp_get_minimum_free_heap_size());
         
+        socket_pool_stats_t pool;
+        if (socket_manager_get_pool_stats(&pool) == ESP_OK) {
+            ESP_LOGI(TAG, "Connection pool: %lu/%lu in use, high water %lu, %lu refused",
+                     (unsigned long)pool.in_use, (unsigned long)pool.capacity,
+                     (unsigned long)pool.high_water, (unsigned long)pool.alloc_failures);
+        }
+        
+        logger_stats_t logger;
+        if (attack_logger_get_stats(&logger) == ESP_OK) {
+            ESP_LOGI(TAG, "Log queue: depth %lu, high water %lu, %lu dropped, p99 wait %lu us",
+                     (unsigned long)logger.queue_depth, (unsigned long)logger.queue_high_water,
+                     (unsigned long)logger.dropped,
+                     (unsigned long)histogram_percentile(&logger.enqueue_latency_us, 99));
+        }
+        
+        flash_storage_stats_t flash;
+        if (flash_storage_get_stats(&flash) == ESP_OK && flash.appended_bytes > 0) {
+            ESP_LOGI(TAG, "Flash log: segment %lu seq %lu, %lu erases, write amplification %.2f",
+                     (unsigned long)flash.head_segment, (unsigned long)flash.head_sequence,
+                     (unsigned long)flash.erases,
+                     (double)flash.erases * FLASH_STORAGE_SECTOR_SIZE / flash.appended_bytes);
+        }
+        
+        rate_limiter_stats_t limiter;
+        if (rate_limiter_get_stats(&limiter) == ESP_OK &&
+            limiter.allowed > 0) {
+            ESP_LOGI(TAG, "Rate limiter: %lu allowed, refused %lu by /32, %lu by /24, %lu by /16, "
+                     "%lu as heavy hitters",
+                     (unsigned long)limiter.allowed,
+                     (unsigned long)limiter.refused[RATE_LIMIT_REFUSED_HOST],
+                     (unsigned long)limiter.refused[RATE_LIMIT_REFUSED_SUBNET_24],
+                     (unsigned long)limiter.refused[RATE_LIMIT_REFUSED_SUBNET_16],
+                     (unsigned long)limiter.refused[RATE_LIMIT_REFUSED_HEAVY_HITTER]);
+            
+            static const char *const LEVEL_NAMES[RATE_LIMIT_LEVELS] = { "/32", "/24", "/16" };
+            for (int l = 0; l < RATE_LIMIT_LEVELS; l++) {
+                const rate_limiter_level_stats_t *level = &limiter.levels[l];
+                if (level->evictions > 0) {
+                    ESP_LOGI(TAG, "Rate limiter %s: %lu/%lu tracked, %lu evicted (%lu while limited), "
+                             "max probe %lu", LEVEL_NAMES[l],
+                             (unsigned long)level->tracked, (unsigned long)level->capacity,
+                             (unsigned long)level->evictions, (unsigned long)level->evicted_limited,
+                             (unsigned long)level->max_probe);
+                }
+            }
+        }
+        
+        honeypot_stats_t honeypot;
+        if (honeypot_get_stats(&honeypot) == ESP_OK && honeypot.top_source_count > 0) {
+            const uint8_t *source = (const uint8_t *)&honeypot.top_sources[0].prefix;
+            const uint8_t *subnet = (const uint8_t *)&honeypot.top_subnets[0].prefix;
+            ESP_LOGI(TAG, "Heaviest source %u.%u.%u.%u (~%lu), heaviest /24 %u.%u.%u.0 (~%lu)",
+                     source[0], source[1], source[2], source[3],
+                     (unsigned long)honeypot.top_sources[0].count,
+                     subnet[0], subnet[1], subnet[2], (unsigned long)honeypot.top_subnets[0].count);
+        }
+        
+        // Static: the merged histograms are too big for this task's stack
+        static metrics_snapshot_t metrics;
+        static const char *const LATENCY_NAMES[METRIC_LATENCY_COUNT] = {
+            [METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE] = "accept to first byte",
+            [METRIC_LATENCY_FIRST_BYTE_TO_RESPONSE] = "first byte to response",
+            [METRIC_LATENCY_ENQUEUE_TO_COMMIT] = "log enqueue to flash commit",
+        };
+        if (metrics_get_snapshot(&metrics) == ESP_OK) {
+            for (int i = 0; i < METRIC_LATENCY_COUNT; i++) {
+                const histogram_t *latency = &metrics.latency_us[i];
+                if (latency->count > 0) {
+                    ESP_LOGI(TAG, "Latency %s: p50 %lu us, p99 %lu us, max %lu us over %lu",
+                             LATENCY_NAMES[i], (unsigned long)histogram_percentile(latency, 50),
+                             (unsigned long)histogram_percentile(latency, 99),
+                             (unsigned long)latency->max, (unsigned long)latency->count);
+                }
+            }
+        }
+        
+        payload_store_stats_t payloads;
+        if (payload_store_get_stats(&payloads) == ESP_OK) {
+            ESP_LOGI(TAG, "Payloads: %lu unique indexed, %lu samples, %lu repeats, %lu evicted",
+                     (unsigned long)payloads.entries, (unsigned long)payloads.samples,
+                     (unsigned long)payloads.repeats, (unsigned long)payloads.evictions);
+        }
+        
         // Reset watchdog
         watchdog_feed();
     }
-}
\ No newline at end of file
+}
+
+#if CONFIG_HONEYPOT_METRICS_ENDPOINT
+static void collect_metrics(openmetrics_writer_t *w, void *ctx)
+{
+    // Scrapes run one at a time in the HTTP server task, so the larger
+    // structs can live outside its stack
+    static metrics_snapshot_t metrics;
+    static logger_stats_t logger;
+    static rate_limiter_stats_t limiter;
+    static const char *const REFUSAL_REASONS[RATE_LIMIT_RESULT_COUNT] = {
+        [RATE_LIMIT_REFUSED_HOST] = "host",
+        [RATE_LIMIT_REFUSED_SUBNET_24] = "subnet_24",
+        [RATE_LIMIT_REFUSED_SUBNET_16] = "subnet_16",
+        [RATE_LIMIT_REFUSED_HEAVY_HITTER] = "heavy_hitter",
+    };
+    static const char *const LIMIT_LEVELS[RATE_LIMIT_LEVELS] = { "32", "24", "16" };
+    socket_pool_stats_t pool;
+    
+    // Every source below is lock-free or behind a lock that is only held
+    // for a counter update; nothing here waits on a flash write or on the
+    // honeypot task
+    if (metrics_get_snapshot(&metrics) == ESP_OK) {
+        write_counter(w, "honeypot_connections", "Connections accepted",
+                      metrics.counters[METRIC_CONNECTIONS]);
+        write_counter(w, "honeypot_loop_wakeups", "Network loop wake-ups",
+                      metrics.counters[METRIC_LOOP_WAKEUPS]);
+        
+        write_service_counter(w, &metrics, METRIC_SERVICE_CONNECTIONS, "honeypot_service_connections",
+                              "Connections accepted by service");
+        write_service_counter(w, &metrics, METRIC_SERVICE_ATTACKS, "honeypot_attacks",
+                              "Attacks detected by service");
+        
+        write_latency(w, "honeypot_accept_to_first_byte_seconds", "Connection accepted to first data",
+                      &metrics.latency_us[METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE]);
+        write_latency(w, "honeypot_first_byte_to_response_seconds", "First data to first reply",
+                      &metrics.latency_us[METRIC_LATENCY_FIRST_BYTE_TO_RESPONSE]);
+        write_latency(w, "honeypot_log_commit_seconds", "Attack record queued to written to flash",
+                      &metrics.latency_us[METRIC_LATENCY_ENQUEUE_TO_COMMIT]);
+    }
+    
+    if (socket_manager_get_pool_stats(&pool) == ESP_OK) {
+        openmetrics_family(w, "honeypot_connections_open", OPENMETRICS_GAUGE, NULL, "Connections open now");
+        openmetrics_sample(w, "honeypot_connections_open", "", NULL, NULL, pool.in_use);
+        
+        openmetrics_family(w, "honeypot_connection_timeouts", OPENMETRICS_COUNTER, NULL,
+                           "Connections closed by a deadline");
+        openmetrics_sample(w, "honeypot_connection_timeouts", "_total", "deadline", "handshake",
+                           pool.handshake_timeouts);
+        openmetrics_sample(w, "honeypot_connection_timeouts", "_total", "deadline", "idle",
+                           pool.idle_timeouts);
+        openmetrics_sample(w, "honeypot_connection_timeouts", "_total", "deadline", "session",
+                           pool.session_timeouts);
+    }
+    
+    if (attack_logger_get_stats(&logger) == ESP_OK) {
+        write_counter(w, "honeypot_log_records", "Attack records stored", logger.total_logged);
+        write_counter(w, "honeypot_log_dropped", "Attack records lost to a full queue", logger.dropped);
+        write_counter(w, "honeypot_log_batches", "Flash writes of attack records", logger.batches_written);
+        
+        openmetrics_family(w, "honeypot_log_queue_depth", OPENMETRICS_GAUGE, NULL,
+                           "Attack records waiting for the writer");
+        openmetrics_sample(w, "honeypot_log_queue_depth", "", NULL, NULL, logger.queue_depth);
+    }
+    
+    if (rate_limiter_get_stats(&limiter) == ESP_OK) {
+        write_counter(w, "honeypot_rate_limit_allowed", "Connections allowed by the rate limiter",
+                      limiter.allowed);
+        
+        openmetrics_family(w, "honeypot_rate_limited", OPENMETRICS_COUNTER, NULL,
+                           "Connections refused by the rate limiter");
+        for (int r = RATE_LIMIT_REFUSED_HOST; r < RATE_LIMIT_RESULT_COUNT; r++) {
+            openmetrics_sample(w, "honeypot_rate_limited", "_total", "reason", REFUSAL_REASONS[r],
+                               limiter.refused[r]);
+        }
+        
+        openmetrics_family(w, "honeypot_rate_limit_tracked", OPENMETRICS_GAUGE, NULL,
+                           "Prefixes with a token bucket");
+        for (int l = 0; l < RATE_LIMIT_LEVELS; l++) {
+            openmetrics_sample(w, "honeypot_rate_limit_tracked", "", "prefix_len", LIMIT_LEVELS[l],
+                               limiter.levels[l].tracked);
+        }
+        
+        openmetrics_family(w, "honeypot_rate_limit_evictions", OPENMETRICS_COUNTER, NULL,
+                           "Token buckets dropped for a new prefix");
+        for (int l = 0; l < RATE_LIMIT_LEVELS; l++) {
+            openmetrics_sample(w, "honeypot_rate_limit_evictions", "_total", "prefix_len", LIMIT_LEVELS[l],
+                               limiter.levels[l].evictions);
+        }
+    }
+}
+
+static void write_counter(openmetrics_writer_t *w, const char *name, const char *help, uint64_t value)
+{
+    openmetrics_family(w, name, OPENMETRICS_COUNTER, NULL, help);
+    openmetrics_sample(w, name, "_total", NULL, NULL, value);
+}
+
+static void write_service_counter(openmetrics_writer_t *w, const metrics_snapshot_t *metrics,
+                                  metric_service_counter_t counter, const char *name, const char *help)
+{
+    openmetrics_family(w, name, OPENMETRICS_COUNTER, NULL, help);
+    for (uint8_t id = 0; id < service_registry_count(); id++) {
+        openmetrics_sample(w, name, "_total", "service", service_registry_get(id)->name,
+                           metrics->services[id][counter]);
+    }
+}
+
+static void write_latency(openmetrics_writer_t *w, const char *name, const char *help,
+                          const histogram_t *hist)
+{
+    const int sub_buckets = 1 << HISTOGRAM_SUB_BITS;
+    uint64_t cumulative = 0;
+    
+    openmetrics_family(w, name, OPENMETRICS_HISTOGRAM, "seconds", help);
+    
+    // Only the power-of-two edges are exported, which keeps a scrape small
+    for (int i = 0; i < HISTOGRAM_BUCKETS - 1; i++) {
+        cumulative += hist->buckets[i];
+        if (i % sub_buckets == sub_buckets - 1) {
+            openmetrics_bucket_us(w, name, histogram_bucket_upper(i), cumulative);
+        }
+    }
+    openmetrics_bucket_us(w, name, OPENMETRICS_INF, hist->count);
+    openmetrics_sample(w, name, "_count", NULL, NULL, hist->count);
+    openmetrics_sample_us(w, name, "_sum", hist->sum);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,676 @@
+/*
+ * Socket Manager - Listener and connection bookkeeping
+ *
+ * Owns the listening sockets and the set of open client connections,
+ * builds the select() read set and hands received data to the services.
+ *
+ * Every socket is tracked in a dense table indexed by file descriptor, so
+ * a readiness event is dispatched to its listener or connection and
+ * service handler without searching. Connection objects, including their
+ * receive buffers, come from a fixed slab so the heap is never touched
+ * on the accept path. Handshake, idle and session deadlines live in a
+ * timer wheel and drive the select() timeout.
+ *
+ * With CONFIG_HONEYPOT_DUAL_CORE the calling task only accepts and
+ * receives. Filled connections are passed through a lock-free ring to a
+ * worker pinned on the other core, which runs the service handler and
+ * returns the connection through a second ring. A loopback UDP socket in
+ * the read set wakes select() when completions are waiting.
+ */
+
+#include "socket_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "utils/metrics.h"
+#include "utils/spsc_ring.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <fcntl.h>
+#include <string.h>
+
+static const char *TAG = "socket_manager";
+
+#define LISTEN_BACKLOG 8
+
+// lwIP hands out descriptors in [LWIP_SOCKET_OFFSET, +CONFIG_LWIP_MAX_SOCKETS)
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+#define FD_TABLE_SIZE CONFIG_LWIP_MAX_SOCKETS
+#else
+#define FD_TABLE_SIZE 16
+#endif
+
+#ifndef LWIP_SOCKET_OFFSET
+#define LWIP_SOCKET_OFFSET 0
+#endif
+
+typedef enum {
+    FD_SLOT_FREE = 0,
+    FD_SLOT_LISTENER,
+    FD_SLOT_CONNECTION,
+    FD_SLOT_WAKEUP
+} fd_slot_type_t;
+
+typedef struct {
+    fd_slot_type_t type;
+    uint16_t port;                         ///< Local port of the listener
+    socket_service_handler_t handler;      ///< Service that owns the port
+    socket_conn_t *conn;                   ///< Connection object, NULL for listeners
+} fd_slot_t;
+
+static fd_slot_t fd_table[FD_TABLE_SIZE];
+static fd_set master_fds;
+static int max_fd = -1;
+
+// Connection slab and its free list
+static socket_conn_t conn_slab[MAX_CONCURRENT_CONNECTIONS];
+static socket_conn_t *free_list = NULL;
+static socket_pool_stats_t pool_stats = {
+    .capacity = MAX_CONCURRENT_CONNECTIONS
+};
+
+// Connection deadlines
+static timer_wheel_t conn_timers;
+static uint32_t timeout_ms[CONN_TIMER_COUNT] = {
+    [CONN_TIMER_HANDSHAKE] = CONNECTION_HANDSHAKE_TIMEOUT_MS,
+    [CONN_TIMER_IDLE] = CONNECTION_TIMEOUT_MS,
+    [CONN_TIMER_SESSION] = CONNECTION_SESSION_TIMEOUT_MS
+};
+
+#if CONFIG_HONEYPOT_DUAL_CORE
+#define WORKER_STACK_SIZE 8192
+#define WORKER_PRIORITY 5
+#define WORK_QUEUE_DEPTH CONFIG_HONEYPOT_WORK_QUEUE_DEPTH
+
+_Static_assert(WORK_QUEUE_DEPTH > 0 && (WORK_QUEUE_DEPTH & (WORK_QUEUE_DEPTH - 1)) == 0,
+               "CONFIG_HONEYPOT_WORK_QUEUE_DEPTH must be a power of two");
+
+// Listener -> worker requests and worker -> listener completions. The
+// number of requests in flight never exceeds the queue depth, so the
+// completion ring cannot overflow.
+static void *work_slots[WORK_QUEUE_DEPTH];
+static void *done_slots[WORK_QUEUE_DEPTH];
+static spsc_ring_t work_ring;
+static spsc_ring_t done_ring;
+static TaskHandle_t worker_handle = NULL;
+static int wake_fd = -1;
+static struct sockaddr_in wake_addr;
+static uint32_t in_flight = 0;
+#endif
+
+static socket_pipeline_stats_t pipeline_stats = {0};
+static socket_close_handler_t close_handler = NULL;
+
+// Internal function prototypes
+static fd_slot_t *slot_for_fd(int fd);
+static void track_fd(int fd, fd_slot_type_t type, uint16_t port,
+                     socket_service_handler_t handler, socket_conn_t *conn);
+static void untrack_fd(int fd);
+static socket_conn_t *conn_alloc(void);
+static void conn_free(socket_conn_t *conn);
+static esp_err_t set_nonblocking(int fd);
+static void handle_readable_connection(int fd, fd_slot_t *slot);
+static void close_connection(int fd);
+static void on_conn_timeout(timer_node_t *node, void *ctx);
+static int64_t now_ms(void);
+#if CONFIG_HONEYPOT_DUAL_CORE
+static bool hand_off_to_worker(socket_conn_t *conn);
+static void drain_completions(void);
+static void worker_task(void *pvParameters);
+#endif
+
+esp_err_t socket_manager_init(void)
+{
+    free_list = NULL;
+    for (int i = MAX_CONCURRENT_CONNECTIONS - 1; i >= 0; i--) {
+        conn_slab[i].fd = -1;
+        for (int t = 0; t < CONN_TIMER_COUNT; t++) {
+            timer_node_init(&conn_slab[i].timers[t]);
+        }
+        conn_slab[i].next_free = free_list;
+        free_list = &conn_slab[i];
+    }
+
+    timer_wheel_init(&conn_timers, now_ms());
+    return ESP_OK;
+}
+
+void socket_manager_set_timeouts(uint32_t handshake_ms, uint32_t idle_ms, uint32_t session_ms)
+{
+    timeout_ms[CONN_TIMER_HANDSHAKE] = handshake_ms;
+    timeout_ms[CONN_TIMER_IDLE] = idle_ms;
+    timeout_ms[CONN_TIMER_SESSION] = session_ms;
+}
+
+void socket_manager_set_close_handler(socket_close_handler_t handler)
+{
+    close_handler = handler;
+}
+
+esp_err_t socket_manager_start_worker(void)
+{
+#if CONFIG_HONEYPOT_DUAL_CORE
+    if (worker_handle != NULL) {
+        return ESP_OK;
+    }
+
+    if (!spsc_ring_init(&work_ring, work_slots, WORK_QUEUE_DEPTH) ||
+        !spsc_ring_init(&done_ring, done_slots, WORK_QUEUE_DEPTH)) {
+        ESP_LOGE(TAG, "Work queue depth %d is not a power of two", WORK_QUEUE_DEPTH);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    in_flight = 0;
+
+    // Loopback datagram socket the worker pokes to wake select()
+    wake_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (wake_fd < 0 || slot_for_fd(wake_fd) == NULL) {
+        ESP_LOGE(TAG, "Failed to create worker wake socket: %d", errno);
+        if (wake_fd >= 0) {
+            close(wake_fd);
+        }
+        wake_fd = -1;
+        return ESP_FAIL;
+    }
+
+    socklen_t addr_len = sizeof(wake_addr);
+    memset(&wake_addr, 0, sizeof(wake_addr));
+    wake_addr.sin_family = AF_INET;
+    wake_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    wake_addr.sin_port = 0;
+
+    if (bind(wake_fd, (struct sockaddr *)&wake_addr, sizeof(wake_addr)) != 0 ||
+        getsockname(wake_fd, (struct sockaddr *)&wake_addr, &addr_len) != 0 ||
+        set_nonblocking(wake_fd) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to bind worker wake socket: %d", errno);
+        close(wake_fd);
+        wake_fd = -1;
+        return ESP_FAIL;
+    }
+    track_fd(wake_fd, FD_SLOT_WAKEUP, 0, NULL, NULL);
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        worker_task,
+        "service_worker",
+        WORKER_STACK_SIZE,
+        NULL,
+        WORKER_PRIORITY,
+        &worker_handle,
+        CONFIG_HONEYPOT_WORKER_CORE
+    );
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create service worker task");
+        untrack_fd(wake_fd);
+        close(wake_fd);
+        wake_fd = -1;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Service worker started on core %d", CONFIG_HONEYPOT_WORKER_CORE);
+#endif
+    return ESP_OK;
+}
+
+void socket_manager_stop_worker(void)
+{
+#if CONFIG_HONEYPOT_DUAL_CORE
+    if (worker_handle != NULL) {
+        vTaskDelete(worker_handle);
+        worker_handle = NULL;
+    }
+
+    // Take back connections the worker still held
+    for (int i = 0; i < MAX_CONCURRENT_CONNECTIONS; i++) {
+        conn_slab[i].in_flight = false;
+    }
+    in_flight = 0;
+
+    if (wake_fd >= 0) {
+        untrack_fd(wake_fd);
+        close(wake_fd);
+        wake_fd = -1;
+    }
+#endif
+}
+
+esp_err_t socket_manager_create_listener(uint16_t port, socket_service_handler_t handler)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "socket() failed for port %d: %d", port, errno);
+        return ESP_FAIL;
+    }
+
+    if (slot_for_fd(fd) == NULL) {
+        ESP_LOGE(TAG, "fd %d outside dispatch table", fd);
+        close(fd);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, LISTEN_BACKLOG) != 0) {
+        ESP_LOGE(TAG, "bind/listen failed for port %d: %d", port, errno);
+        close(fd);
+        return ESP_FAIL;
+    }
+
+    // Non-blocking so the accept loop can drain the backlog until EAGAIN
+    if (set_nonblocking(fd) != ESP_OK) {
+        close(fd);
+        return ESP_FAIL;
+    }
+
+    track_fd(fd, FD_SLOT_LISTENER, port, handler, NULL);
+
+    ESP_LOGI(TAG, "Listening on port %d (fd %d)", port, fd);
+    return ESP_OK;
+}
+
+int socket_manager_get_listener_fd(uint16_t port)
+{
+    for (int fd = LWIP_SOCKET_OFFSET; fd <= max_fd; fd++) {
+        fd_slot_t *slot = slot_for_fd(fd);
+        if (slot->type == FD_SLOT_LISTENER && slot->port == port) {
+            return fd;
+        }
+    }
+    return -1;
+}
+
+int socket_manager_get_fd_set(fd_set *read_fds)
+{
+    // The master set is kept up to date as sockets come and go
+    memcpy(read_fds, &master_fds, sizeof(fd_set));
+    return max_fd;
+}
+
+void socket_manager_dispatch(const fd_set *read_fds, int ready_count,
+                             socket_accept_handler_t on_accept)
+{
+    int last_fd = max_fd;
+
+    for (int fd = LWIP_SOCKET_OFFSET; fd <= last_fd && ready_count > 0; fd++) {
+        if (!FD_ISSET(fd, read_fds)) {
+            continue;
+        }
+        ready_count--;
+
+        fd_slot_t *slot = slot_for_fd(fd);
+        switch (slot->type) {
+            case FD_SLOT_LISTENER:
+                on_accept(fd, slot->port);
+                break;
+            case FD_SLOT_CONNECTION:
+                handle_readable_connection(fd, slot);
+                break;
+#if CONFIG_HONEYPOT_DUAL_CORE
+            case FD_SLOT_WAKEUP:
+                drain_completions();
+                break;
+#endif
+            default:
+                // Closed earlier in this pass
+                break;
+        }
+    }
+}
+
+bool socket_manager_can_accept_connection(void)
+{
+    return pool_stats.in_use < pool_stats.capacity;
+}
+
+esp_err_t socket_manager_add_connection(int listen_fd, int sock_fd,
+                                        const struct sockaddr_in *client_addr,
+                                        socket_conn_t **out_conn)
+{
+    fd_slot_t *listener = slot_for_fd(listen_fd);
+    fd_slot_t *slot = slot_for_fd(sock_fd);
+
+    if (client_addr == NULL || listener == NULL || listener->type != FD_SLOT_LISTENER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (slot == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    socket_conn_t *conn = conn_alloc();
+    if (conn == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    conn->fd = sock_fd;
+    conn->port = listener->port;
+    inet_ntoa_r(client_addr->sin_addr, conn->client_ip, sizeof(conn->client_ip) - 1);
+    conn->accepted_us = esp_timer_get_time();
+    conn->last_activity_us = conn->accepted_us;
+    conn->first_byte_us = 0;
+    conn->responded = false;
+    set_nonblocking(sock_fd);
+
+    int64_t now = conn->accepted_us / 1000;
+    timer_wheel_arm(&conn_timers, &conn->timers[CONN_TIMER_HANDSHAKE], now,
+                    timeout_ms[CONN_TIMER_HANDSHAKE]);
+    timer_wheel_arm(&conn_timers, &conn->timers[CONN_TIMER_SESSION], now,
+                    timeout_ms[CONN_TIMER_SESSION]);
+
+    track_fd(sock_fd, FD_SLOT_CONNECTION, listener->port, listener->handler, conn);
+    if (out_conn != NULL) {
+        *out_conn = conn;
+    }
+    return ESP_OK;
+}
+
+int socket_manager_send(socket_conn_t *conn, const void *data, size_t len)
+{
+    if (!conn->responded && conn->first_byte_us != 0) {
+        metrics_record_latency(METRIC_LATENCY_FIRST_BYTE_TO_RESPONSE,
+                               esp_timer_get_time() - conn->first_byte_us);
+    }
+    conn->responded = true;
+
+    return send(conn->fd, data, len, 0);
+}
+
+int socket_manager_process_timeouts(void)
+{
+    return timer_wheel_advance(&conn_timers, now_ms(), on_conn_timeout, NULL);
+}
+
+int32_t socket_manager_next_timeout_ms(void)
+{
+    return timer_wheel_next_expiry_ms(&conn_timers, now_ms());
+}
+
+void socket_manager_close_all(void)
+{
+    for (int fd = max_fd; fd >= LWIP_SOCKET_OFFSET; fd--) {
+        fd_slot_t *slot = slot_for_fd(fd);
+        if (slot->type == FD_SLOT_CONNECTION) {
+            close_connection(fd);
+        } else if (slot->type == FD_SLOT_LISTENER) {
+            untrack_fd(fd);
+            close(fd);
+        }
+    }
+}
+
+esp_err_t socket_manager_get_pool_stats(socket_pool_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(stats, &pool_stats, sizeof(socket_pool_stats_t));
+    return ESP_OK;
+}
+
+esp_err_t socket_manager_get_pipeline_stats(socket_pipeline_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(stats, &pipeline_stats, sizeof(socket_pipeline_stats_t));
+    return ESP_OK;
+}
+
+static fd_slot_t *slot_for_fd(int fd)
+{
+    int index = fd - LWIP_SOCKET_OFFSET;
+    if (index < 0 || index >= FD_TABLE_SIZE) {
+        return NULL;
+    }
+    return &fd_table[index];
+}
+
+static void track_fd(int fd, fd_slot_type_t type, uint16_t port,
+                     socket_service_handler_t handler, socket_conn_t *conn)
+{
+    fd_slot_t *slot = slot_for_fd(fd);
+
+    slot->type = type;
+    slot->port = port;
+    slot->handler = handler;
+    slot->conn = conn;
+
+    FD_SET(fd, &master_fds);
+    if (fd > max_fd) {
+        max_fd = fd;
+    }
+}
+
+static void untrack_fd(int fd)
+{
+    memset(slot_for_fd(fd), 0, sizeof(fd_slot_t));
+    FD_CLR(fd, &master_fds);
+
+    // Only closing the top descriptor moves the bound
+    while (max_fd >= LWIP_SOCKET_OFFSET && slot_for_fd(max_fd)->type == FD_SLOT_FREE) {
+        max_fd--;
+    }
+    if (max_fd < LWIP_SOCKET_OFFSET) {
+        max_fd = -1;
+    }
+}
+
+static socket_conn_t *conn_alloc(void)
+{
+    socket_conn_t *conn = free_list;
+    if (conn == NULL) {
+        pool_stats.alloc_failures++;
+        return NULL;
+    }
+    free_list = conn->next_free;
+
+    // Only the header needs resetting; the buffer is bounded by rx_len
+    conn->rx_len = 0;
+    conn->rx_buf[0] = '\0';
+    memset(conn->service_state, 0, sizeof(conn->service_state));
+    payload_hasher_init(&conn->payload_hash);
+    conn->in_flight = false;
+    conn->next_free = NULL;
+
+    pool_stats.in_use++;
+    pool_stats.total_allocs++;
+    if (pool_stats.in_use > pool_stats.high_water) {
+        pool_stats.high_water = pool_stats.in_use;
+    }
+    return conn;
+}
+
+static void conn_free(socket_conn_t *conn)
+{
+    for (int t = 0; t < CONN_TIMER_COUNT; t++) {
+        timer_wheel_cancel(&conn_timers, &conn->timers[t]);
+    }
+
+    payload_hasher_free(&conn->payload_hash);
+    conn->fd = -1;
+    conn->next_free = free_list;
+    free_list = conn;
+    pool_stats.in_use--;
+}
+
+static esp_err_t set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        ESP_LOGE(TAG, "Failed to set fd %d non-blocking: %d", fd, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void handle_readable_connection(int fd, fd_slot_t *slot)
+{
+    socket_conn_t *conn = slot->conn;
+
+    int received = recv(fd, conn->rx_buf + conn->rx_len,
+                        CONNECTION_RX_BUFFER_SIZE - conn->rx_len, 0);
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+
+    bool keep_open = false;
+    if (received > 0) {
+        // Hash as it arrives, so the digest survives handlers resetting rx_len
+        payload_hasher_update(&conn->payload_hash, conn->rx_buf + conn->rx_len, received);
+        conn->rx_len += received;
+        conn->rx_buf[conn->rx_len] = '\0';
+        conn->last_activity_us = esp_timer_get_time();
+        if (conn->first_byte_us == 0) {
+            conn->first_byte_us = conn->last_activity_us;
+            metrics_record_latency(METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE,
+                                   conn->first_byte_us - conn->accepted_us);
+        }
+
+        // First data ends the handshake window; every read pushes the idle deadline
+        timer_wheel_cancel(&conn_timers, &conn->timers[CONN_TIMER_HANDSHAKE]);
+        timer_wheel_arm(&conn_timers, &conn->timers[CONN_TIMER_IDLE],
+                        conn->last_activity_us / 1000, timeout_ms[CONN_TIMER_IDLE]);
+
+        if (slot->handler != NULL) {
+#if CONFIG_HONEYPOT_DUAL_CORE
+            if (hand_off_to_worker(conn)) {
+                return;
+            }
+            pipeline_stats.inline_handled++;
+#endif
+            keep_open = slot->handler(conn, conn->rx_buf, conn->rx_len);
+        }
+    }
+
+    // A handler asking for more data with a full buffer can never get it
+    if (!keep_open || conn->rx_len >= CONNECTION_RX_BUFFER_SIZE) {
+        close_connection(fd);
+    }
+}
+
+static void close_connection(int fd)
+{
+    fd_slot_t *slot = slot_for_fd(fd);
+
+    if (close_handler != NULL) {
+        close_handler(slot->conn);
+    }
+    conn_free(slot->conn);
+    untrack_fd(fd);
+    close(fd);
+}
+
+static void on_conn_timeout(timer_node_t *node, void *ctx)
+{
+    // Timers are embedded in slab objects, so the owner is found by offset
+    size_t index = ((const char *)node - (const char *)conn_slab) / sizeof(socket_conn_t);
+    socket_conn_t *conn = &conn_slab[index];
+    conn_timer_kind_t kind = (conn_timer_kind_t)(node - conn->timers);
+
+    if (conn->in_flight) {
+        // The worker owns the socket; retry once the request has completed
+        timer_wheel_arm(&conn_timers, node, now_ms(), TIMER_WHEEL_TICK_MS);
+        return;
+    }
+
+    switch (kind) {
+        case CONN_TIMER_HANDSHAKE:
+            pool_stats.handshake_timeouts++;
+            break;
+        case CONN_TIMER_IDLE:
+            pool_stats.idle_timeouts++;
+            break;
+        default:
+            pool_stats.session_timeouts++;
+            break;
+    }
+
+    ESP_LOGD(TAG, "Closing %s:%d after timeout %d", conn->client_ip, conn->port, kind);
+    close_connection(conn->fd);
+}
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+#if CONFIG_HONEYPOT_DUAL_CORE
+static bool hand_off_to_worker(socket_conn_t *conn)
+{
+    if (worker_handle == NULL || in_flight >= WORK_QUEUE_DEPTH) {
+        return false;
+    }
+
+    // Stop watching the socket while the worker owns the connection
+    conn->in_flight = true;
+    FD_CLR(conn->fd, &master_fds);
+
+    if (!spsc_ring_push(&work_ring, conn)) {
+        conn->in_flight = false;
+        FD_SET(conn->fd, &master_fds);
+        return false;
+    }
+
+    in_flight++;
+    pipeline_stats.handoffs++;
+    if (in_flight > pipeline_stats.max_in_flight) {
+        pipeline_stats.max_in_flight = in_flight;
+    }
+
+    xTaskNotifyGive(worker_handle);
+    return true;
+}
+
+static void drain_completions(void)
+{
+    char scratch[16];
+    while (recv(wake_fd, scratch, sizeof(scratch), 0) > 0) {
+        // Wake-up tokens carry no data
+    }
+
+    socket_conn_t *conn;
+    while ((conn = spsc_ring_pop(&done_ring)) != NULL) {
+        conn->in_flight = false;
+        in_flight--;
+        pipeline_stats.completions++;
+
+        if (conn->keep_open && conn->rx_len < CONNECTION_RX_BUFFER_SIZE) {
+            FD_SET(conn->fd, &master_fds);
+        } else {
+            close_connection(conn->fd);
+        }
+    }
+}
+
+static void worker_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Service worker running on core %d", xPortGetCoreID());
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        socket_conn_t *conn;
+        bool completed = false;
+        while ((conn = spsc_ring_pop(&work_ring)) != NULL) {
+            // The slot cannot change while the connection is in flight
+            socket_service_handler_t handler = slot_for_fd(conn->fd)->handler;
+            conn->keep_open = handler(conn, conn->rx_buf, conn->rx_len);
+
+            spsc_ring_push(&done_ring, conn);
+            completed = true;
+        }
+
+        if (completed) {
+            sendto(wake_fd, "", 1, 0, (struct sockaddr *)&wake_addr, sizeof(wake_addr));
+        }
+    }
+}
+#endif
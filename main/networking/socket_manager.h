@@ -0,0 +1,248 @@
+#ifndef SOCKET_MANAGER_H
+#define SOCKET_MANAGER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "lwip/sockets.h"
+#include "utils/config.h"
+#include "utils/md5_hash.h"
+#include "timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Per-connection deadlines
+ */
+typedef enum {
+    CONN_TIMER_HANDSHAKE = 0,              ///< Accept until the first byte arrives
+    CONN_TIMER_IDLE,                       ///< Since the last received data
+    CONN_TIMER_SESSION,                    ///< Total lifetime of the connection
+    CONN_TIMER_COUNT
+} conn_timer_kind_t;
+
+/**
+ * @brief Client connection object
+ *
+ * Connections live in a statically sized slab and are recycled through a
+ * free list, so accepting a connection never touches the heap.
+ */
+typedef struct socket_conn {
+    int fd;                                ///< Client socket
+    uint16_t port;                         ///< Local port the connection arrived on
+    char client_ip[16];                    ///< Peer address in dotted notation
+    int64_t accepted_us;                   ///< Time the connection was accepted
+    int64_t last_activity_us;              ///< Time of the last received data
+    int64_t first_byte_us;                 ///< Time the first data arrived, 0 until then
+    bool responded;                        ///< Something has been sent back
+    size_t rx_len;                         ///< Bytes held in rx_buf
+    char rx_buf[CONNECTION_RX_BUFFER_SIZE + 1]; ///< Receive buffer, kept NUL-terminated
+    uint32_t service_state[CONNECTION_STATE_SIZE / sizeof(uint32_t)]; ///< Parser state owned by the service
+    payload_hasher_t payload_hash;         ///< Digest of every byte received so far
+    timer_node_t timers[CONN_TIMER_COUNT]; ///< Deadlines, linked into the timer wheel
+    bool in_flight;                        ///< Owned by the service worker (dual-core mode)
+    bool keep_open;                        ///< Handler result carried back from the worker
+    struct socket_conn *next_free;         ///< Free list link while unused
+} socket_conn_t;
+
+/**
+ * @brief Connection pool occupancy counters
+ */
+typedef struct {
+    uint32_t capacity;                     ///< Number of connection objects in the slab
+    uint32_t in_use;                       ///< Objects currently allocated
+    uint32_t high_water;                   ///< Highest in_use seen since boot
+    uint32_t total_allocs;                 ///< Successful allocations
+    uint32_t alloc_failures;               ///< Allocations refused because the slab was full
+    uint32_t handshake_timeouts;           ///< Closed before sending any data
+    uint32_t idle_timeouts;                ///< Closed after going quiet
+    uint32_t session_timeouts;             ///< Closed at the session time limit
+} socket_pool_stats_t;
+
+/**
+ * @brief Listener to worker pipeline counters (dual-core mode)
+ */
+typedef struct {
+    uint32_t handoffs;                     ///< Requests handed to the worker core
+    uint32_t completions;                  ///< Requests the worker finished
+    uint32_t inline_handled;               ///< Handled on the listener because the queue was full or no worker ran
+    uint32_t max_in_flight;                ///< Highest number of requests queued or running
+} socket_pipeline_stats_t;
+
+/**
+ * @brief Service handler invoked with data received on a connection
+ *
+ * @p data is the connection's receive buffer holding every byte received
+ * since the handler last reset conn->rx_len. Return true to keep the
+ * connection open and wait for more data, false to close it.
+ */
+typedef bool (*socket_service_handler_t)(socket_conn_t *conn, const char *data, size_t len);
+
+/**
+ * @brief Callback invoked for a connection about to be closed
+ *
+ * The connection is still intact, including its payload digest, but the
+ * peer may already be gone.
+ */
+typedef void (*socket_close_handler_t)(socket_conn_t *conn);
+
+/**
+ * @brief Callback invoked when a listening socket has pending connections
+ */
+typedef void (*socket_accept_handler_t)(int listen_fd, uint16_t port);
+
+/**
+ * @brief Initialize the connection pool and timer wheel
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t socket_manager_init(void);
+
+/**
+ * @brief Set connection deadlines applied to new connections
+ *
+ * @param handshake_ms Maximum time from accept to the first byte
+ * @param idle_ms Maximum time between received data
+ * @param session_ms Maximum total connection lifetime
+ */
+void socket_manager_set_timeouts(uint32_t handshake_ms, uint32_t idle_ms, uint32_t session_ms);
+
+/**
+ * @brief Set the callback run for every connection as it is closed
+ *
+ * Runs in the listener task however the connection ends: peer close,
+ * handler request, timeout or shutdown.
+ *
+ * @param handler Close callback, NULL for none
+ */
+void socket_manager_set_close_handler(socket_close_handler_t handler);
+
+/**
+ * @brief Start the service worker task on the worker core
+ *
+ * With CONFIG_HONEYPOT_DUAL_CORE disabled this does nothing and service
+ * handlers keep running in the calling task.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t socket_manager_start_worker(void);
+
+/**
+ * @brief Stop the service worker task
+ */
+void socket_manager_stop_worker(void);
+
+/**
+ * @brief Create a non-blocking listening socket on a port
+ *
+ * @param port TCP port to listen on
+ * @param handler Service handler for connections accepted on this port
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t socket_manager_create_listener(uint16_t port, socket_service_handler_t handler);
+
+/**
+ * @brief Get the listening socket for a port
+ *
+ * @param port TCP port
+ * @return int Listener file descriptor, -1 if the port has no listener
+ */
+int socket_manager_get_listener_fd(uint16_t port);
+
+/**
+ * @brief Fill a read set with all listeners and open connections
+ *
+ * @param read_fds Set to fill
+ * @return int Highest file descriptor in the set, -1 if the set is empty
+ */
+int socket_manager_get_fd_set(fd_set *read_fds);
+
+/**
+ * @brief Dispatch every ready descriptor in one pass
+ *
+ * Listeners are handed to @p on_accept, connections are read and passed
+ * to the service handler registered for their port.
+ *
+ * @param read_fds Read set returned by select()
+ * @param ready_count Number of ready descriptors reported by select()
+ * @param on_accept Called for each listener with pending connections
+ */
+void socket_manager_dispatch(const fd_set *read_fds, int ready_count,
+                             socket_accept_handler_t on_accept);
+
+/**
+ * @brief Check whether another connection can be tracked
+ *
+ * @return true if a connection slot is free
+ */
+bool socket_manager_can_accept_connection(void);
+
+/**
+ * @brief Start tracking an accepted connection
+ *
+ * @param listen_fd Listener the connection was accepted on
+ * @param sock_fd Accepted client socket
+ * @param client_addr Peer address
+ * @param out_conn Receives the connection object, may be NULL
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t socket_manager_add_connection(int listen_fd, int sock_fd,
+                                        const struct sockaddr_in *client_addr,
+                                        socket_conn_t **out_conn);
+
+/**
+ * @brief Send a reply on a connection
+ *
+ * Use instead of send() from service handlers so the first reply is
+ * timed against the first received byte.
+ *
+ * @param conn Connection to reply on
+ * @param data Bytes to send
+ * @param len Length of @p data
+ * @return int Result of send(): bytes sent, or -1 with errno set
+ */
+int socket_manager_send(socket_conn_t *conn, const void *data, size_t len);
+
+/**
+ * @brief Close every connection whose deadline has passed
+ *
+ * @return int Number of connections closed
+ */
+int socket_manager_process_timeouts(void);
+
+/**
+ * @brief Time until the next connection deadline
+ *
+ * @return int32_t Milliseconds until the next deadline, -1 if none is pending
+ */
+int32_t socket_manager_next_timeout_ms(void);
+
+/**
+ * @brief Close all connections and listening sockets
+ */
+void socket_manager_close_all(void);
+
+/**
+ * @brief Get connection pool occupancy counters
+ *
+ * @param stats Pointer to store the counters
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t socket_manager_get_pool_stats(socket_pool_stats_t *stats);
+
+/**
+ * @brief Get listener to worker pipeline counters
+ *
+ * @param stats Pointer to store the counters
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t socket_manager_get_pipeline_stats(socket_pipeline_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOCKET_MANAGER_H
@@ -0,0 +1,114 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_WHEEL_SLOTS 256     ///< Number of slots, must be a power of two
+#define TIMER_WHEEL_TICK_MS 50    ///< Resolution of one slot
+
+/**
+ * @brief Timer embedded in the object it belongs to
+ *
+ * Nodes are linked into the wheel directly, so arming and cancelling
+ * never allocate. Deadlines beyond one revolution stay in their slot and
+ * are skipped until the wheel comes round to them again.
+ */
+typedef struct timer_node {
+    struct timer_node *prev;
+    struct timer_node *next;
+    uint32_t expires_tick;               ///< Absolute tick the timer is due
+} timer_node_t;
+
+/**
+ * @brief Hashed timer wheel
+ */
+typedef struct {
+    timer_node_t slots[TIMER_WHEEL_SLOTS]; ///< List heads, one per slot
+    uint32_t current_tick;               ///< Last tick that was processed
+    uint32_t armed;                      ///< Number of armed timers
+} timer_wheel_t;
+
+/**
+ * @brief Callback for an expired timer
+ *
+ * The node is already unlinked; the callback may re-arm or cancel any
+ * timer, including other timers due in the same tick.
+ */
+typedef void (*timer_expire_cb_t)(timer_node_t *node, void *ctx);
+
+/**
+ * @brief Initialize an empty wheel
+ *
+ * @param wheel Wheel to initialize
+ * @param now_ms Current time in milliseconds
+ */
+void timer_wheel_init(timer_wheel_t *wheel, int64_t now_ms);
+
+/**
+ * @brief Initialize a timer node in the unarmed state
+ *
+ * @param node Node to initialize
+ */
+void timer_node_init(timer_node_t *node);
+
+/**
+ * @brief Arm (or re-arm) a timer, O(1)
+ *
+ * The deadline is rounded up to the next tick so a timer never fires early.
+ *
+ * @param wheel Wheel to insert into
+ * @param node Timer to arm
+ * @param now_ms Current time in milliseconds
+ * @param delay_ms Delay until expiry in milliseconds
+ */
+void timer_wheel_arm(timer_wheel_t *wheel, timer_node_t *node, int64_t now_ms, uint32_t delay_ms);
+
+/**
+ * @brief Cancel a timer if it is armed, O(1)
+ *
+ * @param wheel Wheel the timer belongs to
+ * @param node Timer to cancel
+ */
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_node_t *node);
+
+/**
+ * @brief Check whether a timer is armed
+ *
+ * @param node Timer to check
+ * @return true if armed
+ */
+bool timer_node_armed(const timer_node_t *node);
+
+/**
+ * @brief Expire every timer due at or before now
+ *
+ * @param wheel Wheel to advance
+ * @param now_ms Current time in milliseconds
+ * @param cb Called once per expired timer
+ * @param ctx Passed through to the callback
+ * @return int Number of timers expired
+ */
+int timer_wheel_advance(timer_wheel_t *wheel, int64_t now_ms, timer_expire_cb_t cb, void *ctx);
+
+/**
+ * @brief Time until the next timer is due
+ *
+ * Looks at most one revolution ahead; timers further out report the end
+ * of the revolution so the caller wakes up and rescans.
+ *
+ * @param wheel Wheel to inspect
+ * @param now_ms Current time in milliseconds
+ * @return int32_t Milliseconds until the next expiry, -1 if nothing is armed
+ */
+int32_t timer_wheel_next_expiry_ms(const timer_wheel_t *wheel, int64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMER_WHEEL_H
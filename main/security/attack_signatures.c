@@ -0,0 +1,326 @@
+/*
+ * Attack Signatures - Multi-pattern exploit detection
+ *
+ * Aho-Corasick automaton over a table of known IoT exploit URIs and
+ * payload fragments. The trie is built once at init into compact arrays
+ * (dense transitions at the root, sorted sparse edges elsewhere), after
+ * which a scan is a single pass over the input regardless of how many
+ * signatures are loaded.
+ */
+
+#include "attack_signatures.h"
+#include "esp_log.h"
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "attack_signatures";
+
+/*
+ * Signature table. IDs are the 1-based position in this list and end up in
+ * stored logs, so only ever append; never reorder or remove an entry.
+ */
+#define SIGNATURE_LIST(X) \
+    X("path-shell",          "/shell") \
+    X("path-cmd",            "/cmd") \
+    X("path-exec",           "/exec") \
+    X("path-traversal",      "..") \
+    X("traversal-encoded",   "%2e%2e") \
+    X("etc-passwd",          "/etc/passwd") \
+    X("gpon-diag",           "/gponform/diag_form") \
+    X("gpon-auth-bypass",    "?images/") \
+    X("hikvision-weblang",   "/sdk/weblanguage") \
+    X("hikvision-backdoor",  "auth=ywrtaw46mtek") \
+    X("thinkphp-rce",        "invokefunction&function=call_user_func_array") \
+    X("thinkphp-app",        "think\\app/") \
+    X("boa-login",           "/boaform/admin/formlogin") \
+    X("boa-ping",            "/boaform/admin/formping") \
+    X("huawei-hg532",        "/ctrlt/deviceupgrade_1") \
+    X("realtek-miniigd",     "/picsdesc.xml") \
+    X("realtek-wanipcn",     "/wanipcn.xml") \
+    X("dlink-hnap",          "/hnap1/") \
+    X("dlink-hedwig",        "/hedwig.cgi") \
+    X("dlink-getcfg",        "/getcfg.php") \
+    X("dlink-command",       "/command.php") \
+    X("linksys-tmunblock",   "/tmunblock.cgi") \
+    X("netgear-setup",       "/setup.cgi?next_file=netgear.cfg") \
+    X("zyxel-viewlog",       "/cgi-bin/viewlog.asp") \
+    X("avtech-cloudsetup",   "/cgi-bin/supervisor/cloudsetup.cgi") \
+    X("vacron-board",        "/board.cgi?cmd=") \
+    X("tenda-usbunload",     "/goform/setusbunload") \
+    X("eir-d1000",           "/ud/act?1") \
+    X("tplink-luci-stok",    "/cgi-bin/luci/;stok=") \
+    X("cgi-semicolon",       "/cgi-bin/;") \
+    X("dvr-ifs",             "${ifs}") \
+    X("phpunit-eval",        "/phpunit/src/util/php/eval-stdin.php") \
+    X("log4shell",           "${jndi:") \
+    X("spring4shell",        "class.module.classloader") \
+    X("shellshock",          "() {") \
+    X("mozi",                "mozi.") \
+    X("dropper-wget",        "wget http") \
+    X("dropper-curl",        "curl http") \
+    X("dropper-tftp",        "tftp -g") \
+    X("dropper-chmod",       "chmod 777") \
+    X("busybox",             "/bin/busybox") \
+    X("cd-tmp",              "cd /tmp") \
+    X("rm-rf",               "rm -rf") \
+    X("recon-dotenv",        "/.env") \
+    X("recon-git",           "/.git/config") \
+    X("recon-wp-login",      "/wp-login.php") \
+    X("recon-phpmyadmin",    "/phpmyadmin")
+
+#define SIG_NAME(name, pattern) name,
+#define SIG_PATTERN(name, pattern) pattern,
+#define SIG_LENGTH(name, pattern) + (sizeof(pattern) - 1)
+
+static const char *const SIGNATURE_NAMES[] = { SIGNATURE_LIST(SIG_NAME) };
+static const char *const SIGNATURE_PATTERNS[] = { SIGNATURE_LIST(SIG_PATTERN) };
+
+#define SIGNATURE_COUNT (sizeof(SIGNATURE_PATTERNS) / sizeof(SIGNATURE_PATTERNS[0]))
+
+// Every pattern byte adds at most one node, plus the root
+#define MAX_NODES (1 + 0 SIGNATURE_LIST(SIG_LENGTH))
+#define ROOT 0
+#define NO_SIGNATURE UINT16_MAX
+
+_Static_assert(MAX_NODES < UINT16_MAX, "Signature table too large for 16-bit node indices");
+
+typedef struct {
+    uint16_t fail;            ///< Longest proper suffix that is also a trie node
+    uint16_t dict;            ///< Nearest node on the fail chain that ends a pattern
+    uint16_t first_edge;      ///< Index of the first outgoing edge
+    uint16_t edge_count;      ///< Outgoing edges, sorted by byte
+    uint16_t signature;       ///< Signature ending here, NO_SIGNATURE if none
+} ac_node_t;
+
+static ac_node_t nodes[MAX_NODES];
+static uint8_t edge_byte[MAX_NODES];
+static uint16_t edge_target[MAX_NODES];
+static uint16_t root_next[256];
+static uint16_t node_count = 0;
+static bool initialized = false;
+
+static atomic_uint hit_counts[SIGNATURE_COUNT];
+
+// Internal function prototypes
+static uint16_t find_edge(uint16_t node, uint8_t c);
+static uint16_t step(uint16_t state, uint8_t c);
+static void record_match(signature_matches_t *matches, uint32_t *seen, uint16_t signature);
+
+esp_err_t attack_signatures_init(void)
+{
+    if (initialized) {
+        return ESP_OK;
+    }
+
+    // Build-time scratch: first-child / next-sibling trie, children kept sorted
+    uint16_t *child = calloc(MAX_NODES, sizeof(uint16_t));
+    uint16_t *sibling = calloc(MAX_NODES, sizeof(uint16_t));
+    uint8_t *label = calloc(MAX_NODES, sizeof(uint8_t));
+    uint16_t *queue = calloc(MAX_NODES, sizeof(uint16_t));
+
+    if (child == NULL || sibling == NULL || label == NULL || queue == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate build buffers");
+        free(child);
+        free(sibling);
+        free(label);
+        free(queue);
+        return ESP_ERR_NO_MEM;
+    }
+
+    node_count = 1;
+    nodes[ROOT].signature = NO_SIGNATURE;
+
+    for (uint16_t sig = 0; sig < SIGNATURE_COUNT; sig++) {
+        uint16_t node = ROOT;
+
+        for (const char *p = SIGNATURE_PATTERNS[sig]; *p; p++) {
+            uint8_t c = (uint8_t)tolower((unsigned char)*p);
+            uint16_t *link = &child[node];
+
+            while (*link != 0 && label[*link] < c) {
+                link = &sibling[*link];
+            }
+
+            if (*link != 0 && label[*link] == c) {
+                node = *link;
+                continue;
+            }
+
+            uint16_t created = node_count++;
+            label[created] = c;
+            sibling[created] = *link;
+            *link = created;
+            nodes[created].signature = NO_SIGNATURE;
+            node = created;
+        }
+
+        if (nodes[node].signature != NO_SIGNATURE) {
+            ESP_LOGW(TAG, "Duplicate pattern for %s", SIGNATURE_NAMES[sig]);
+            continue;
+        }
+        nodes[node].signature = sig;
+    }
+
+    // Breadth-first: lay out edges and compute failure links. A node's
+    // fail target is shallower, so its edges are already in place.
+    uint16_t head = 0;
+    uint16_t tail = 0;
+    uint16_t edges = 0;
+
+    queue[tail++] = ROOT;
+    while (head < tail) {
+        uint16_t node = queue[head++];
+
+        nodes[node].first_edge = edges;
+        nodes[node].edge_count = 0;
+
+        for (uint16_t next = child[node]; next != 0; next = sibling[next]) {
+            uint8_t c = label[next];
+
+            edge_byte[edges] = c;
+            edge_target[edges] = next;
+            edges++;
+            nodes[node].edge_count++;
+
+            if (node == ROOT) {
+                root_next[c] = next;
+                nodes[next].fail = ROOT;
+            } else {
+                nodes[next].fail = step(nodes[node].fail, c);
+            }
+
+            uint16_t fail = nodes[next].fail;
+            nodes[next].dict = nodes[fail].signature != NO_SIGNATURE ? fail : nodes[fail].dict;
+            queue[tail++] = next;
+        }
+    }
+
+    free(child);
+    free(sibling);
+    free(label);
+    free(queue);
+
+    initialized = true;
+    ESP_LOGI(TAG, "Loaded %d signatures (%d nodes, %d bytes)", (int)SIGNATURE_COUNT, node_count,
+             (int)(node_count * (sizeof(ac_node_t) + sizeof(uint8_t) + sizeof(uint16_t)) + sizeof(root_next)));
+    return ESP_OK;
+}
+
+void attack_signatures_scan(const char *data, size_t len, signature_matches_t *matches)
+{
+    uint32_t seen[(SIGNATURE_COUNT + 31) / 32] = {0};
+    uint16_t state = ROOT;
+
+    matches->count = 0;
+    matches->dropped = 0;
+
+    if (!initialized) {
+        return;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        state = step(state, (uint8_t)tolower((unsigned char)data[i]));
+
+        uint16_t out = nodes[state].signature != NO_SIGNATURE ? state : nodes[state].dict;
+        while (out != ROOT) {
+            record_match(matches, seen, nodes[out].signature);
+            out = nodes[out].dict;
+        }
+    }
+}
+
+int attack_signatures_format_ids(const signature_matches_t *matches, char *buffer, size_t buffer_size)
+{
+    size_t used = 0;
+
+    if (buffer_size == 0) {
+        return 0;
+    }
+    buffer[0] = '\0';
+
+    for (int i = 0; i < matches->count; i++) {
+        int written = snprintf(buffer + used, buffer_size - used, "%s%u",
+                               i > 0 ? "," : "", matches->ids[i]);
+        if (written < 0 || (size_t)written >= buffer_size - used) {
+            buffer[used] = '\0';
+            break;
+        }
+        used += written;
+    }
+    return (int)used;
+}
+
+const char *attack_signatures_name(uint16_t id)
+{
+    if (id == 0 || id > SIGNATURE_COUNT) {
+        return "unknown";
+    }
+    return SIGNATURE_NAMES[id - 1];
+}
+
+uint32_t attack_signatures_hits(uint16_t id)
+{
+    if (id == 0 || id > SIGNATURE_COUNT) {
+        return 0;
+    }
+    return atomic_load_explicit(&hit_counts[id - 1], memory_order_relaxed);
+}
+
+uint16_t attack_signatures_count(void)
+{
+    return SIGNATURE_COUNT;
+}
+
+static uint16_t find_edge(uint16_t node, uint8_t c)
+{
+    const ac_node_t *n = &nodes[node];
+    int lo = n->first_edge;
+    int hi = n->first_edge + n->edge_count - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (edge_byte[mid] == c) {
+            return edge_target[mid];
+        }
+        if (edge_byte[mid] < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return ROOT;
+}
+
+static uint16_t step(uint16_t state, uint8_t c)
+{
+    while (state != ROOT) {
+        uint16_t next = find_edge(state, c);
+        if (next != ROOT) {
+            return next;
+        }
+        state = nodes[state].fail;
+    }
+    return root_next[c];
+}
+
+static void record_match(signature_matches_t *matches, uint32_t *seen, uint16_t signature)
+{
+    uint32_t bit = 1u << (signature % 32);
+
+    if (seen[signature / 32] & bit) {
+        return;
+    }
+    seen[signature / 32] |= bit;
+
+    atomic_fetch_add_explicit(&hit_counts[signature], 1, memory_order_relaxed);
+
+    if (matches->count < SIGNATURE_MAX_MATCHES) {
+        matches->ids[matches->count++] = signature + 1;
+    } else if (matches->dropped < UINT8_MAX) {
+        matches->dropped++;
+    }
+}
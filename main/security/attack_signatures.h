@@ -0,0 +1,83 @@
+#ifndef ATTACK_SIGNATURES_H
+#define ATTACK_SIGNATURES_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIGNATURE_MAX_MATCHES 8   ///< Distinct signatures reported per scan
+
+/**
+ * @brief Signatures matched by one scan
+ *
+ * Each signature is reported at most once, in the order it was first seen.
+ */
+typedef struct {
+    uint8_t count;                         ///< Entries in @p ids
+    uint8_t dropped;                       ///< Matches beyond SIGNATURE_MAX_MATCHES
+    uint16_t ids[SIGNATURE_MAX_MATCHES];   ///< Matched signature IDs
+} signature_matches_t;
+
+/**
+ * @brief Build the matching automaton from the built-in signature table
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t attack_signatures_init(void);
+
+/**
+ * @brief Scan a buffer for every known signature in one linear pass
+ *
+ * Matching is case-insensitive. Hit counters of matched signatures are
+ * incremented once per scan.
+ *
+ * @param data Bytes to scan
+ * @param len Length of @p data
+ * @param matches Filled with the matched signature IDs
+ */
+void attack_signatures_scan(const char *data, size_t len, signature_matches_t *matches);
+
+/**
+ * @brief Format matched IDs as a comma-separated list
+ *
+ * @param matches Scan result
+ * @param buffer Output buffer
+ * @param buffer_size Size of @p buffer
+ * @return int Characters written, excluding the terminator
+ */
+int attack_signatures_format_ids(const signature_matches_t *matches, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Short name of a signature
+ *
+ * @param id Signature ID
+ * @return const char* Name, "unknown" for an invalid ID
+ */
+const char *attack_signatures_name(uint16_t id);
+
+/**
+ * @brief Number of scans that matched a signature
+ *
+ * @param id Signature ID
+ * @return uint32_t Hit count, 0 for an invalid ID
+ */
+uint32_t attack_signatures_hits(uint16_t id);
+
+/**
+ * @brief Number of signatures in the table
+ *
+ * Valid IDs are 1 to this value inclusive.
+ *
+ * @return uint16_t Signature count
+ */
+uint16_t attack_signatures_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ATTACK_SIGNATURES_H
@@ -0,0 +1,256 @@
+/*
+ * Heavy Hitters - Count-Min Sketch of connection sources
+ *
+ * Scanners spread over thousands of addresses overflow any exact per-IP
+ * table, so connection counts per address and per /24 are also kept in a
+ * Count-Min Sketch: DEPTH rows of WIDTH saturating counters, each row
+ * indexed by its own hash. A prefix's estimate is the smallest of its
+ * DEPTH counters, which never undercounts. Conservative update only raises
+ * the counters that equal that minimum, which keeps collisions from
+ * inflating everyone else. Memory is fixed however many sources there are.
+ *
+ * A min-heap of the TOP_K largest estimates per level gives the current
+ * heavy hitters. Everything is halved once per window so old floods fade.
+ * The sketches belong to the accept loop; the heaps are also read by the
+ * monitor task, so every change to them and every copy out of them is
+ * made under a spinlock held for a few dozen entries at most.
+ */
+
+#include "heavy_hitters.h"
+#include "utils/config.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/inet.h"
+#include <string.h>
+
+#define SKETCH_DEPTH 4
+#define SKETCH_WIDTH 256                    // Power of two
+#define COUNTER_MAX UINT16_MAX
+
+typedef struct {
+    uint16_t counters[SKETCH_DEPTH][SKETCH_WIDTH];
+    uint32_t total;                         ///< Decayed sum of everything counted
+    heavy_hitter_t heap[HEAVY_HITTER_TOP_K]; ///< Min-heap on count
+    size_t heap_size;
+} sketch_t;
+
+static sketch_t sketches[HEAVY_HITTER_LEVELS];
+static uint32_t row_seeds[SKETCH_DEPTH];
+static int64_t next_decay_us = 0;
+static portMUX_TYPE heap_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint32_t LIMITS[HEAVY_HITTER_LEVELS] = {
+    [HEAVY_HITTER_HOST] = HEAVY_HITTER_HOST_LIMIT,
+    [HEAVY_HITTER_SUBNET] = HEAVY_HITTER_SUBNET_LIMIT,
+};
+
+// Internal function prototypes
+static uint32_t sketch_add(sketch_t *sketch, uint32_t key);
+static void top_update(sketch_t *sketch, uint32_t key, uint32_t count);
+static void heap_sift_down(sketch_t *sketch, size_t i);
+static void heap_sift_up(sketch_t *sketch, size_t i);
+static void decay(uint32_t halvings);
+static bool confidently_over(const sketch_t *sketch, uint32_t estimate, uint32_t limit);
+static uint32_t mix(uint32_t x);
+
+esp_err_t heavy_hitters_init(void)
+{
+    portENTER_CRITICAL(&heap_lock);
+    memset(sketches, 0, sizeof(sketches));
+    portEXIT_CRITICAL(&heap_lock);
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        row_seeds[row] = esp_random();
+    }
+    next_decay_us = esp_timer_get_time() + (int64_t)HEAVY_HITTER_WINDOW_MS * 1000;
+    return ESP_OK;
+}
+
+void heavy_hitters_record(uint32_t addr, heavy_hitter_estimate_t *out)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (now_us >= next_decay_us) {
+        // Halve once per window that has passed, idle ones included
+        int64_t window_us = (int64_t)HEAVY_HITTER_WINDOW_MS * 1000;
+        int64_t windows = (now_us - next_decay_us) / window_us + 1;
+        decay(windows > 16 ? 16 : (uint32_t)windows);
+        next_decay_us += windows * window_us;
+    }
+
+    uint32_t subnet = addr & htonl(0xffffff00);
+    uint32_t host_count = sketch_add(&sketches[HEAVY_HITTER_HOST], addr);
+    uint32_t subnet_count = sketch_add(&sketches[HEAVY_HITTER_SUBNET], subnet);
+
+    portENTER_CRITICAL(&heap_lock);
+    top_update(&sketches[HEAVY_HITTER_HOST], addr, host_count);
+    top_update(&sketches[HEAVY_HITTER_SUBNET], subnet, subnet_count);
+    portEXIT_CRITICAL(&heap_lock);
+
+    if (out != NULL) {
+        out->host = host_count;
+        out->subnet = subnet_count;
+        out->heavy = confidently_over(&sketches[HEAVY_HITTER_HOST], host_count,
+                                      LIMITS[HEAVY_HITTER_HOST]) ||
+                     confidently_over(&sketches[HEAVY_HITTER_SUBNET], subnet_count,
+                                      LIMITS[HEAVY_HITTER_SUBNET]);
+    }
+}
+
+size_t heavy_hitters_top(heavy_hitter_level_t level, heavy_hitter_t *out, size_t max)
+{
+    if (level >= HEAVY_HITTER_LEVELS || out == NULL) {
+        return 0;
+    }
+
+    const sketch_t *sketch = &sketches[level];
+    heavy_hitter_t sorted[HEAVY_HITTER_TOP_K];
+
+    // Copy under the lock, then sort the copy outside it; the heap is
+    // tiny, so an insertion sort is plenty
+    portENTER_CRITICAL(&heap_lock);
+    size_t count = sketch->heap_size;
+    memcpy(sorted, sketch->heap, count * sizeof(heavy_hitter_t));
+    portEXIT_CRITICAL(&heap_lock);
+
+    size_t n = count < max ? count : max;
+    for (size_t i = 1; i < count; i++) {
+        heavy_hitter_t item = sorted[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1].count < item.count) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = item;
+    }
+
+    memcpy(out, sorted, n * sizeof(heavy_hitter_t));
+    return n;
+}
+
+static uint32_t sketch_add(sketch_t *sketch, uint32_t key)
+{
+    uint16_t *cells[SKETCH_DEPTH];
+    uint32_t estimate = COUNTER_MAX;
+
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        cells[row] = &sketch->counters[row][mix(key ^ row_seeds[row]) & (SKETCH_WIDTH - 1)];
+        if (*cells[row] < estimate) {
+            estimate = *cells[row];
+        }
+    }
+
+    // Conservative update: only the counters at the minimum move
+    if (estimate < COUNTER_MAX) {
+        for (int row = 0; row < SKETCH_DEPTH; row++) {
+            if (*cells[row] == estimate) {
+                (*cells[row])++;
+            }
+        }
+        estimate++;
+    }
+
+    sketch->total++;
+    return estimate;
+}
+
+static void top_update(sketch_t *sketch, uint32_t key, uint32_t count)
+{
+    for (size_t i = 0; i < sketch->heap_size; i++) {
+        if (sketch->heap[i].prefix == key) {
+            // Counts only grow between decays, so it can only sink
+            sketch->heap[i].count = count;
+            heap_sift_down(sketch, i);
+            return;
+        }
+    }
+
+    if (sketch->heap_size < HEAVY_HITTER_TOP_K) {
+        sketch->heap[sketch->heap_size] = (heavy_hitter_t){ .prefix = key, .count = count };
+        heap_sift_up(sketch, sketch->heap_size++);
+    } else if (count > sketch->heap[0].count) {
+        sketch->heap[0] = (heavy_hitter_t){ .prefix = key, .count = count };
+        heap_sift_down(sketch, 0);
+    }
+}
+
+static void heap_sift_down(sketch_t *sketch, size_t i)
+{
+    heavy_hitter_t *heap = sketch->heap;
+
+    while (1) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+
+        if (left < sketch->heap_size && heap[left].count < heap[smallest].count) {
+            smallest = left;
+        }
+        if (right < sketch->heap_size && heap[right].count < heap[smallest].count) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+
+        heavy_hitter_t tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void heap_sift_up(sketch_t *sketch, size_t i)
+{
+    heavy_hitter_t *heap = sketch->heap;
+
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent].count <= heap[i].count) {
+            return;
+        }
+
+        heavy_hitter_t tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static void decay(uint32_t halvings)
+{
+    // Halving keeps relative order, so the heaps stay valid; 16 halvings
+    // clear a 16-bit counter
+    for (int level = 0; level < HEAVY_HITTER_LEVELS; level++) {
+        sketch_t *sketch = &sketches[level];
+
+        for (int row = 0; row < SKETCH_DEPTH; row++) {
+            for (int col = 0; col < SKETCH_WIDTH; col++) {
+                sketch->counters[row][col] >>= halvings;
+            }
+        }
+        sketch->total >>= halvings;
+        portENTER_CRITICAL(&heap_lock);
+        for (size_t i = 0; i < sketch->heap_size; i++) {
+            sketch->heap[i].count >>= halvings;
+        }
+        portEXIT_CRITICAL(&heap_lock);
+    }
+}
+
+static bool confidently_over(const sketch_t *sketch, uint32_t estimate, uint32_t limit)
+{
+    // Collisions add at most about total / WIDTH to an estimate; only act
+    // when the count is over the limit even after allowing for that
+    return estimate > limit + sketch->total / SKETCH_WIDTH;
+}
+
+static uint32_t mix(uint32_t x)
+{
+    // MurmurHash3 finalizer
+    x ^= x >> 16;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16;
+    return x;
+}
@@ -0,0 +1,77 @@
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEAVY_HITTER_TOP_K 8               ///< Heaviest prefixes reported per level
+
+/**
+ * @brief Prefix lengths the sketch counts
+ */
+typedef enum {
+    HEAVY_HITTER_HOST = 0,                 ///< Single addresses (/32)
+    HEAVY_HITTER_SUBNET,                   ///< /24 networks
+    HEAVY_HITTER_LEVELS
+} heavy_hitter_level_t;
+
+/**
+ * @brief One heavy prefix
+ */
+typedef struct {
+    uint32_t prefix;                       ///< Address or network, network byte order
+    uint32_t count;                        ///< Estimated decayed connection count
+} heavy_hitter_t;
+
+/**
+ * @brief Estimates for the source of one connection
+ */
+typedef struct {
+    uint32_t host;                         ///< Estimated decayed count of the address
+    uint32_t subnet;                       ///< Estimated decayed count of its /24
+    bool heavy;                            ///< Either is confidently above its limit
+} heavy_hitter_estimate_t;
+
+/**
+ * @brief Initialize the sketches and clear the top lists
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t heavy_hitters_init(void);
+
+/**
+ * @brief Count one connection attempt from an address
+ *
+ * Counts halve every HEAVY_HITTER_WINDOW_MS, so they track roughly the
+ * last one to two windows. Call from the accept loop only: the sketches
+ * are not shared, only the top lists are.
+ *
+ * @param addr IPv4 source address, network byte order
+ * @param out Receives the estimates including this attempt; may be NULL
+ */
+void heavy_hitters_record(uint32_t addr, heavy_hitter_estimate_t *out);
+
+/**
+ * @brief Copy the current heaviest prefixes of a level, heaviest first
+ *
+ * Safe from any task while the accept loop records; the copy is taken
+ * under the lock that guards the top lists, so it is one consistent list.
+ *
+ * @param level Prefix level
+ * @param out Output array
+ * @param max Capacity of @p out
+ * @return size_t Entries written
+ */
+size_t heavy_hitters_top(heavy_hitter_level_t level, heavy_hitter_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HEAVY_HITTERS_H
@@ -0,0 +1,509 @@
+/*
+ * Indicators - Dropper URLs, hosts and payloads in attacker commands
+ *
+ * Bots fetch their second stage with wget, curl, tftp or ftpget, or write
+ * it out with echo -ne '\x7f\x45\x4c\x46...'. The same command lines reach
+ * the honeypot as telnet input, URL query strings and form bodies, so one
+ * tokenizer serves every service: bytes are %XX-decoded and split into
+ * words on the fly, and each word is classified once when it ends.
+ *
+ * Bare host names are only trusted as arguments of a known download tool;
+ * anywhere else a word like "bins.sh" is far more likely a file name.
+ * Duplicates are caught by a small open-addressed set of 32-bit hashes.
+ */
+
+#include "indicators.h"
+#include "utils/helpers.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define SEEN_SLOTS (INDICATOR_MAX * 2)
+#define ELF_HEADER_BYTES 20           // Through e_machine
+#define VERB_BUSYBOX 0xFF             // Applet name follows as the next word
+
+_Static_assert((SEEN_SLOTS & (SEEN_SLOTS - 1)) == 0, "SEEN_SLOTS must be a power of two");
+_Static_assert(INDICATOR_TEXT_SIZE <= UINT8_MAX + 1, "text_len is a uint8_t");
+_Static_assert(INDICATOR_TOKEN_SIZE <= UINT8_MAX + 1, "token_len is a uint8_t");
+
+typedef enum {
+    INDICATOR_URL = 0,
+    INDICATOR_IP,
+    INDICATOR_HOST,
+    INDICATOR_ELF,
+    INDICATOR_TYPE_COUNT
+} indicator_type_t;
+
+static const char *const TYPE_PREFIXES[INDICATOR_TYPE_COUNT] = {
+    [INDICATOR_URL] = "url:",
+    [INDICATOR_IP] = "ip:",
+    [INDICATOR_HOST] = "host:",
+    [INDICATOR_ELF] = "elf:",
+};
+
+// How a byte affects tokenizing; anything not listed is part of a word
+typedef enum {
+    CHAR_WORD = 0,
+    CHAR_SPACE,                       // Ends the word
+    CHAR_COMMAND,                     // Ends the word and the command
+    CHAR_QUOTE,                       // Dropped, quoting does not split words
+} char_class_t;
+
+static const uint8_t CHAR_CLASSES[256] = {
+    ['\0'] = CHAR_SPACE, ['\t'] = CHAR_SPACE, [' '] = CHAR_SPACE, ['+'] = CHAR_SPACE,
+    [','] = CHAR_SPACE, ['<'] = CHAR_SPACE, ['>'] = CHAR_SPACE, ['$'] = CHAR_SPACE,
+    ['{'] = CHAR_SPACE, ['}'] = CHAR_SPACE,
+    ['\r'] = CHAR_COMMAND, ['\n'] = CHAR_COMMAND, [';'] = CHAR_COMMAND, ['|'] = CHAR_COMMAND,
+    ['&'] = CHAR_COMMAND, ['`'] = CHAR_COMMAND, ['('] = CHAR_COMMAND, [')'] = CHAR_COMMAND,
+    ['\''] = CHAR_QUOTE, ['"'] = CHAR_QUOTE,
+};
+
+typedef struct {
+    const char *name;
+    const char *value_options;        // Short options that consume the next word
+    bool url_arguments;               // Every argument is a URL, not just the first a host
+} downloader_t;
+
+static const downloader_t DOWNLOADERS[] = {
+    { "wget",   "OoPTUY",        true },
+    { "curl",   "oAHdXxerTmbcu", true },
+    { "tftp",   "lrb",           false },
+    { "ftpget", "upP",           false },
+    { "ftpput", "upP",           false },
+    { "nc",     "pswiq",         false },
+};
+
+#define DOWNLOADER_COUNT (sizeof(DOWNLOADERS) / sizeof(DOWNLOADERS[0]))
+
+static const char *const URL_SCHEMES[] = { "http", "https", "ftp", "tftp" };
+
+static const struct {
+    uint16_t machine;
+    const char *name;
+} ELF_MACHINES[] = {
+    { 2, "sparc" }, { 3, "x86" }, { 4, "m68k" }, { 8, "mips" }, { 20, "ppc" },
+    { 40, "arm" }, { 42, "sh4" }, { 62, "x86_64" }, { 93, "arc" }, { 183, "aarch64" },
+    { 243, "riscv" },
+};
+
+// Internal function prototypes
+static void put_char(indicator_set_t *set, uint8_t c);
+static void end_word(indicator_set_t *set);
+static void end_command(indicator_set_t *set);
+static uint8_t find_verb(const char *word, size_t len);
+static void classify_word(indicator_set_t *set, const char *word, size_t len, bool argument);
+static bool add_elf(indicator_set_t *set, const char *word, size_t len);
+static bool add_url(indicator_set_t *set, const char *word, size_t len);
+static bool add_host(indicator_set_t *set, const char *host, size_t len);
+static void add_ipv4s(indicator_set_t *set, const char *word, size_t len);
+static void add_indicator(indicator_set_t *set, indicator_type_t type, const char *value, size_t len);
+static size_t parse_ipv4(const char *str, size_t len);
+static bool is_hostname(const char *str, size_t len);
+static const char *find_last(const char *str, size_t len, char c);
+
+void indicators_init(indicator_set_t *set)
+{
+    memset(set, 0, sizeof(*set));
+}
+
+void indicators_scan(indicator_set_t *set, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+
+        // %XX escapes decode into the byte they stand for; anything else
+        // after a % is taken literally
+        if (set->percent == 1) {
+            if (hex_value(c) >= 0) {
+                set->percent_digit = c;
+                set->percent = 2;
+                continue;
+            }
+            set->percent = 0;
+            put_char(set, '%');
+        } else if (set->percent == 2) {
+            set->percent = 0;
+            if (hex_value(c) >= 0) {
+                put_char(set, (uint8_t)(hex_value(set->percent_digit) << 4 | hex_value(c)));
+                continue;
+            }
+            put_char(set, '%');
+            put_char(set, (uint8_t)set->percent_digit);
+        }
+
+        if (c == '%') {
+            set->percent = 1;
+        } else {
+            put_char(set, (uint8_t)c);
+        }
+    }
+}
+
+void indicators_flush(indicator_set_t *set)
+{
+    if (set->percent > 0) {
+        put_char(set, '%');
+        if (set->percent == 2) {
+            put_char(set, (uint8_t)set->percent_digit);
+        }
+        set->percent = 0;
+    }
+    end_word(set);
+    end_command(set);
+}
+
+static void put_char(indicator_set_t *set, uint8_t c)
+{
+    switch (CHAR_CLASSES[c]) {
+        case CHAR_WORD:
+            if (set->token_len < INDICATOR_TOKEN_SIZE - 1) {
+                set->token[set->token_len++] = (char)c;
+            }
+            break;
+        case CHAR_SPACE:
+            end_word(set);
+            break;
+        case CHAR_COMMAND:
+            end_word(set);
+            end_command(set);
+            break;
+        default:
+            break;
+    }
+}
+
+static void end_word(indicator_set_t *set)
+{
+    const char *word = set->token;
+    size_t len = set->token_len;
+    bool argument = false;
+
+    if (len == 0) {
+        return;
+    }
+    set->token_len = 0;
+    set->token[len] = '\0';
+
+    // Left over from ${IFS}, the usual stand-in for a space in exploit URLs
+    if (len == 3 && memcmp(word, "IFS", 3) == 0) {
+        return;
+    }
+
+    if (set->word == 0 || (set->word == 1 && set->verb == VERB_BUSYBOX)) {
+        set->verb = find_verb(word, len);
+    } else if (set->verb == 0 || set->verb == VERB_BUSYBOX) {
+        // Not a download command
+    } else if (set->skip_value) {
+        set->skip_value = false;
+    } else if (word[0] == '-') {
+        set->skip_value = len == 2 && strchr(DOWNLOADERS[set->verb - 1].value_options, word[1]) != NULL;
+    } else {
+        argument = set->args == 0 || DOWNLOADERS[set->verb - 1].url_arguments;
+        if (set->args < UINT8_MAX) {
+            set->args++;
+        }
+    }
+    if (set->word < UINT8_MAX) {
+        set->word++;
+    }
+
+    classify_word(set, word, len, argument);
+}
+
+static void end_command(indicator_set_t *set)
+{
+    set->word = 0;
+    set->verb = 0;
+    set->args = 0;
+    set->skip_value = false;
+}
+
+static uint8_t find_verb(const char *word, size_t len)
+{
+    // Tools are often called by path, e.g. /bin/busybox
+    const char *name = find_last(word, len, '/');
+    name = name != NULL ? name + 1 : word;
+
+    if (strcmp(name, "busybox") == 0) {
+        return VERB_BUSYBOX;
+    }
+    for (size_t i = 0; i < DOWNLOADER_COUNT; i++) {
+        if (strcmp(name, DOWNLOADERS[i].name) == 0) {
+            return (uint8_t)(i + 1);
+        }
+    }
+    return 0;
+}
+
+static void classify_word(indicator_set_t *set, const char *word, size_t len, bool argument)
+{
+    if (add_elf(set, word, len) || add_url(set, word, len)) {
+        return;
+    }
+
+    // Download tool argument without a scheme: host[:port][/path]
+    if (argument) {
+        size_t host_len = strcspn(word, ":/?#");
+        if (add_host(set, word, host_len)) {
+            // The path, if any, starts after an optional :port
+            size_t path = host_len;
+            if (path < len && word[path] == ':') {
+                do {
+                    path++;
+                } while (path < len && word[path] >= '0' && word[path] <= '9');
+            }
+            if (path < len && word[path] == '/' && DOWNLOADERS[set->verb - 1].url_arguments) {
+                add_indicator(set, INDICATOR_URL, word, len);
+            }
+            return;
+        }
+    }
+
+    add_ipv4s(set, word, len);
+}
+
+static bool add_elf(indicator_set_t *set, const char *word, size_t len)
+{
+    const char *p = strstr(word, "\\x7f");
+    if (p == NULL) {
+        p = strstr(word, "\\x7F");
+    }
+    if (p == NULL) {
+        return false;
+    }
+
+    // Decode as echo -e would, tolerating doubled backslashes from JSON
+    // or shell quoting
+    const char *end = word + len;
+    uint8_t header[ELF_HEADER_BYTES];
+    size_t n = 0;
+    while (p < end && n < ELF_HEADER_BYTES) {
+        if (p[0] == '\\' && p + 1 < end && p[1] == '\\') {
+            p++;
+        } else if (p[0] == '\\' && end - p >= 4 && p[1] == 'x' &&
+                   hex_value(p[2]) >= 0 && hex_value(p[3]) >= 0) {
+            header[n++] = (uint8_t)(hex_value(p[2]) << 4 | hex_value(p[3]));
+            p += 4;
+        } else {
+            header[n++] = (uint8_t)*p++;
+        }
+    }
+    if (n < ELF_HEADER_BYTES || memcmp(header, "\x7f" "ELF", 4) != 0) {
+        return false;
+    }
+
+    bool big_endian = header[5] == 2;
+    uint16_t machine = big_endian ? (uint16_t)(header[18] << 8 | header[19]) :
+                                    (uint16_t)(header[19] << 8 | header[18]);
+    const char *name = NULL;
+    for (size_t i = 0; i < sizeof(ELF_MACHINES) / sizeof(ELF_MACHINES[0]); i++) {
+        if (ELF_MACHINES[i].machine == machine) {
+            name = ELF_MACHINES[i].name;
+            break;
+        }
+    }
+
+    char value[24];
+    int value_len;
+    if (name != NULL) {
+        value_len = snprintf(value, sizeof(value), "%s-%s%s", name,
+                             header[4] == 2 ? "64" : "32", big_endian ? "be" : "le");
+    } else {
+        value_len = snprintf(value, sizeof(value), "machine%u-%s%s", machine,
+                             header[4] == 2 ? "64" : "32", big_endian ? "be" : "le");
+    }
+    add_indicator(set, INDICATOR_ELF, value, (size_t)value_len);
+    return true;
+}
+
+static bool add_url(indicator_set_t *set, const char *word, size_t len)
+{
+    const char *sep = strstr(word, "://");
+    if (sep == NULL) {
+        return false;
+    }
+
+    // The scheme is the run of letters before ://, wherever the word started
+    const char *scheme = sep;
+    while (scheme > word && isalpha((unsigned char)scheme[-1])) {
+        scheme--;
+    }
+    size_t scheme_len = (size_t)(sep - scheme);
+    bool known = false;
+    for (size_t i = 0; i < sizeof(URL_SCHEMES) / sizeof(URL_SCHEMES[0]); i++) {
+        if (scheme_len == strlen(URL_SCHEMES[i]) && strncasecmp(scheme, URL_SCHEMES[i], scheme_len) == 0) {
+            known = true;
+            break;
+        }
+    }
+    if (!known) {
+        return false;
+    }
+
+    add_indicator(set, INDICATOR_URL, scheme, (size_t)(word + len - scheme));
+
+    // Host is the authority without credentials or port
+    const char *host = sep + 3;
+    size_t authority_len = strcspn(host, "/?#");
+    const char *at = find_last(host, authority_len, '@');
+    if (at != NULL) {
+        authority_len -= (size_t)(at + 1 - host);
+        host = at + 1;
+    }
+    const char *colon = memchr(host, ':', authority_len);
+    add_host(set, host, colon != NULL ? (size_t)(colon - host) : authority_len);
+    return true;
+}
+
+static bool add_host(indicator_set_t *set, const char *host, size_t len)
+{
+    if (len > 0 && parse_ipv4(host, len) == len) {
+        add_indicator(set, INDICATOR_IP, host, len);
+        return true;
+    }
+    if (is_hostname(host, len)) {
+        add_indicator(set, INDICATOR_HOST, host, len);
+        return true;
+    }
+    return false;
+}
+
+static void add_ipv4s(indicator_set_t *set, const char *word, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        if (!isdigit((unsigned char)word[i])) {
+            i++;
+            continue;
+        }
+
+        // A dotted quad standing on its own, not part of a longer dotted run
+        size_t n = parse_ipv4(word + i, len - i);
+        if (n > 0 && (i + n == len || (!isdigit((unsigned char)word[i + n]) && word[i + n] != '.'))) {
+            add_indicator(set, INDICATOR_IP, word + i, n);
+        }
+        while (i < len && (isdigit((unsigned char)word[i]) || word[i] == '.')) {
+            i++;
+        }
+    }
+}
+
+static void add_indicator(indicator_set_t *set, indicator_type_t type, const char *value, size_t len)
+{
+    const char *prefix = TYPE_PREFIXES[type];
+    size_t prefix_len = strlen(prefix);
+
+    // FNV-1a over the prefix and value; 0 marks a free slot
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < prefix_len; i++) {
+        hash = (hash ^ (uint8_t)prefix[i]) * 16777619u;
+    }
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)value[i]) * 16777619u;
+    }
+    if (hash == 0) {
+        hash = 1;
+    }
+
+    // Never more than half full, so an empty slot ends every probe
+    uint32_t slot = hash & (SEEN_SLOTS - 1);
+    while (set->seen[slot] != 0) {
+        if (set->seen[slot] == hash) {
+            return;
+        }
+        slot = (slot + 1) & (SEEN_SLOTS - 1);
+    }
+
+    size_t need = (set->text_len > 0 ? 1 : 0) + prefix_len + len;
+    if (set->count == INDICATOR_MAX || need >= (size_t)(INDICATOR_TEXT_SIZE - set->text_len)) {
+        if (set->dropped < UINT8_MAX) {
+            set->dropped++;
+        }
+        return;
+    }
+    set->seen[slot] = hash;
+    set->count++;
+
+    char *out = set->text + set->text_len;
+    if (set->text_len > 0) {
+        *out++ = ' ';
+    }
+    memcpy(out, prefix, prefix_len);
+    memcpy(out + prefix_len, value, len);
+    set->text_len += (uint8_t)need;
+    set->text[set->text_len] = '\0';
+}
+
+static size_t parse_ipv4(const char *str, size_t len)
+{
+    size_t i = 0;
+
+    for (int part = 0; part < 4; part++) {
+        if (part > 0) {
+            if (i >= len || str[i] != '.') {
+                return 0;
+            }
+            i++;
+        }
+        unsigned value = 0;
+        size_t digits = 0;
+        while (i < len && isdigit((unsigned char)str[i]) && digits < 4) {
+            value = value * 10 + (unsigned)(str[i] - '0');
+            i++;
+            digits++;
+        }
+        if (digits == 0 || digits > 3 || value > 255) {
+            return 0;
+        }
+    }
+    return i;
+}
+
+static bool is_hostname(const char *str, size_t len)
+{
+    size_t label = 0;
+    size_t tld = 0;
+    bool dotted = false;
+
+    if (len > 63) {
+        return false;
+    }
+
+    // Letters, digits and hyphens in dot-separated labels, ending in an
+    // alphabetic top-level domain
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == '.') {
+            if (label == 0) {
+                return false;
+            }
+            dotted = true;
+            label = 0;
+            tld = i + 1;
+        } else if (isalnum((unsigned char)str[i]) || str[i] == '-') {
+            label++;
+        } else {
+            return false;
+        }
+    }
+    if (!dotted || len - tld < 2) {
+        return false;
+    }
+    for (size_t i = tld; i < len; i++) {
+        if (!isalpha((unsigned char)str[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const char *find_last(const char *str, size_t len, char c)
+{
+    while (len > 0) {
+        if (str[--len] == c) {
+            return str + len;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,75 @@
+#ifndef INDICATORS_H
+#define INDICATORS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INDICATOR_TEXT_SIZE 128   ///< Formatted indicator list, including the terminator
+#define INDICATOR_MAX 8           ///< Distinct indicators kept per set
+#define INDICATOR_TOKEN_SIZE 96   ///< Longest word examined, longer words are cut
+
+/**
+ * @brief Indicators extracted from attacker input
+ *
+ * @p text lists each distinct indicator once, in the order it was first
+ * seen, as space-separated "type:value" items. Types are url, ip, host
+ * and elf (the architecture of a hex-escaped ELF header, e.g.
+ * "elf:mips-32be").
+ */
+typedef struct {
+    char text[INDICATOR_TEXT_SIZE];        ///< Formatted list, empty if nothing was found
+    uint8_t text_len;                      ///< Length of @p text
+    uint8_t count;                         ///< Items in @p text
+    uint8_t dropped;                       ///< Items that did not fit
+    uint32_t seen[INDICATOR_MAX * 2];      ///< Hashes of the items, 0 marks a free slot
+    char token[INDICATOR_TOKEN_SIZE];      ///< Word being collected
+    uint8_t token_len;
+    uint8_t percent;                       ///< Hex digits of a %XX escape read so far
+    char percent_digit;                    ///< First digit of that escape
+    uint8_t word;                          ///< Words seen in the current command
+    uint8_t verb;                          ///< Download tool the command runs, 0 if none
+    uint8_t args;                          ///< Arguments given to that tool so far
+    bool skip_value;                       ///< Next word is the value of an option
+} indicator_set_t;
+
+/**
+ * @brief Start an empty set
+ *
+ * @param set Set to initialize
+ */
+void indicators_init(indicator_set_t *set);
+
+/**
+ * @brief Extract indicators from a chunk of input
+ *
+ * Input is tokenized in a single pass as a shell command line would be,
+ * after %XX decoding, so telnet lines, URL query strings and form bodies
+ * all go through the same path. A chunk may end mid-word; the word is
+ * completed by the next call or by indicators_flush().
+ *
+ * @param set Set to add to
+ * @param data Input bytes
+ * @param len Length of @p data
+ */
+void indicators_scan(indicator_set_t *set, const char *data, size_t len);
+
+/**
+ * @brief End the current field
+ *
+ * Completes the pending word and command. Call after the last chunk of a
+ * field, before scanning an unrelated one into the same set.
+ *
+ * @param set Set to complete
+ */
+void indicators_flush(indicator_set_t *set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INDICATORS_H
@@ -0,0 +1,353 @@
+/*
+ * Rate Limiter - Per-prefix token buckets
+ *
+ * Every connection is charged to its /32, its /24 and its /16, each level
+ * with its own budget and refill window, so a botnet rotating through a
+ * subnet runs dry at the subnet even though each address looks quiet. A
+ * connection is only charged when every level can afford it, and a
+ * refusal names the most specific level that could not.
+ *
+ * Each level keeps its buckets in a fixed pool keyed by the masked 32-bit
+ * prefix, so memory stays bounded however many sources a distributed
+ * flood uses. A linear probing index twice the pool size maps prefixes to
+ * pool entries in O(1); the pool entries never move, which lets them sit
+ * on an intrusive recency list that picks the eviction victim in O(1) as
+ * well.
+ *
+ * Credit is kept in units of one millisecond of refill: a bucket gains
+ * max_connections units per millisecond and a connection costs window_ms
+ * units, so no division is needed on the hot path.
+ *
+ * Evicting a bucket forgets its prefix, so every attempt is also counted
+ * in the heavy hitter sketch, which refuses sources and /24s that stay
+ * heavy however many addresses are rotated through the tables.
+ */
+
+#include "rate_limiter.h"
+#include "heavy_hitters.h"
+#include "utils/config.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "lwip/inet.h"
+#include <string.h>
+
+static const char *TAG = "rate_limiter";
+
+#define NIL 0xffff
+
+_Static_assert((RATE_LIMIT_TRACKED_SOURCES & (RATE_LIMIT_TRACKED_SOURCES - 1)) == 0,
+               "RATE_LIMIT_TRACKED_SOURCES must be a power of two");
+_Static_assert((RATE_LIMIT_SUBNET24_TRACKED & (RATE_LIMIT_SUBNET24_TRACKED - 1)) == 0,
+               "RATE_LIMIT_SUBNET24_TRACKED must be a power of two");
+_Static_assert((RATE_LIMIT_SUBNET16_TRACKED & (RATE_LIMIT_SUBNET16_TRACKED - 1)) == 0,
+               "RATE_LIMIT_SUBNET16_TRACKED must be a power of two");
+_Static_assert(RATE_LIMIT_TRACKED_SOURCES * 2 < NIL && RATE_LIMIT_SUBNET24_TRACKED * 2 < NIL &&
+               RATE_LIMIT_SUBNET16_TRACKED * 2 < NIL, "Pool indices must fit in 16 bits");
+_Static_assert((uint64_t)RATE_LIMIT_MAX_CONNECTIONS * RATE_LIMIT_WINDOW_MS <= UINT32_MAX / 2 &&
+               (uint64_t)RATE_LIMIT_SUBNET24_MAX_CONNECTIONS * RATE_LIMIT_SUBNET24_WINDOW_MS <= UINT32_MAX / 2 &&
+               (uint64_t)RATE_LIMIT_SUBNET16_MAX_CONNECTIONS * RATE_LIMIT_SUBNET16_WINDOW_MS <= UINT32_MAX / 2,
+               "Bucket credit must not overflow while refilling");
+
+typedef struct {
+    uint32_t key;                 ///< Masked prefix, network byte order
+    uint32_t credit;              ///< Refill milliseconds banked, at most the level's capacity
+    uint32_t last_ms;             ///< Time credit was last brought up to date
+    uint16_t prev;                ///< Recency list neighbours, NIL at the ends
+    uint16_t next;
+} bucket_t;
+
+typedef struct {
+    uint8_t prefix_len;
+    uint32_t max_connections;
+    uint32_t window_ms;           ///< Also the cost of one connection
+    uint32_t capacity;            ///< Full bucket: max_connections * window_ms
+    uint32_t pool_size;
+    bucket_t *buckets;
+    uint16_t *index_table;        ///< pool_size * 2 slots
+    uint32_t mask;                ///< Prefix mask, network byte order
+    uint16_t lru_head;
+    uint16_t lru_tail;
+    uint32_t count;
+} level_t;
+
+static bucket_t host_buckets[RATE_LIMIT_TRACKED_SOURCES];
+static uint16_t host_index[RATE_LIMIT_TRACKED_SOURCES * 2];
+static bucket_t subnet24_buckets[RATE_LIMIT_SUBNET24_TRACKED];
+static uint16_t subnet24_index[RATE_LIMIT_SUBNET24_TRACKED * 2];
+static bucket_t subnet16_buckets[RATE_LIMIT_SUBNET16_TRACKED];
+static uint16_t subnet16_index[RATE_LIMIT_SUBNET16_TRACKED * 2];
+
+static level_t levels[RATE_LIMIT_LEVELS] = {
+    [RATE_LIMIT_LEVEL_HOST] = {
+        .prefix_len = 32,
+        .max_connections = RATE_LIMIT_MAX_CONNECTIONS,
+        .window_ms = RATE_LIMIT_WINDOW_MS,
+        .capacity = (uint32_t)RATE_LIMIT_MAX_CONNECTIONS * RATE_LIMIT_WINDOW_MS,
+        .pool_size = RATE_LIMIT_TRACKED_SOURCES,
+        .buckets = host_buckets,
+        .index_table = host_index,
+    },
+    [RATE_LIMIT_LEVEL_SUBNET_24] = {
+        .prefix_len = 24,
+        .max_connections = RATE_LIMIT_SUBNET24_MAX_CONNECTIONS,
+        .window_ms = RATE_LIMIT_SUBNET24_WINDOW_MS,
+        .capacity = (uint32_t)RATE_LIMIT_SUBNET24_MAX_CONNECTIONS * RATE_LIMIT_SUBNET24_WINDOW_MS,
+        .pool_size = RATE_LIMIT_SUBNET24_TRACKED,
+        .buckets = subnet24_buckets,
+        .index_table = subnet24_index,
+    },
+    [RATE_LIMIT_LEVEL_SUBNET_16] = {
+        .prefix_len = 16,
+        .max_connections = RATE_LIMIT_SUBNET16_MAX_CONNECTIONS,
+        .window_ms = RATE_LIMIT_SUBNET16_WINDOW_MS,
+        .capacity = (uint32_t)RATE_LIMIT_SUBNET16_MAX_CONNECTIONS * RATE_LIMIT_SUBNET16_WINDOW_MS,
+        .pool_size = RATE_LIMIT_SUBNET16_TRACKED,
+        .buckets = subnet16_buckets,
+        .index_table = subnet16_index,
+    },
+};
+
+static const char *const RESULT_NAMES[RATE_LIMIT_RESULT_COUNT] = {
+    [RATE_LIMIT_ALLOWED] = "allowed",
+    [RATE_LIMIT_REFUSED_HOST] = "/32 budget",
+    [RATE_LIMIT_REFUSED_SUBNET_24] = "/24 budget",
+    [RATE_LIMIT_REFUSED_SUBNET_16] = "/16 budget",
+    [RATE_LIMIT_REFUSED_HEAVY_HITTER] = "heavy hitter",
+};
+
+static uint32_t hash_seed = 0;
+static rate_limiter_stats_t stats = {0};
+
+// Internal function prototypes
+static uint16_t touch_bucket(level_t *level, rate_limiter_level_stats_t *level_stats,
+                             uint32_t key, uint32_t now_ms);
+static uint32_t home_slot(const level_t *level, uint32_t key);
+static uint16_t evict_oldest(level_t *level, rate_limiter_level_stats_t *level_stats,
+                             uint32_t now_ms);
+static void index_remove(level_t *level, uint16_t b);
+static void index_insert(level_t *level, uint16_t b);
+static void lru_unlink(level_t *level, uint16_t b);
+static void lru_push_front(level_t *level, uint16_t b);
+static uint32_t refill(const level_t *level, const bucket_t *bucket, uint32_t now_ms);
+
+esp_err_t rate_limiter_init(void)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    for (int l = 0; l < RATE_LIMIT_LEVELS; l++) {
+        level_t *level = &levels[l];
+
+        level->mask = htonl(level->prefix_len == 32 ? UINT32_MAX : ~(UINT32_MAX >> level->prefix_len));
+        memset(level->index_table, 0xff, level->pool_size * 2 * sizeof(uint16_t));
+        level->lru_head = NIL;
+        level->lru_tail = NIL;
+        level->count = 0;
+        stats.levels[l].capacity = level->pool_size;
+
+        ESP_LOGI(TAG, "Rate limiter /%d: %lu connections per %lu ms, %lu prefixes tracked",
+                 level->prefix_len, (unsigned long)level->max_connections,
+                 (unsigned long)level->window_ms, (unsigned long)level->pool_size);
+    }
+
+    // A per-boot seed keeps attackers from choosing colliding addresses
+    hash_seed = esp_random();
+    heavy_hitters_init();
+    return ESP_OK;
+}
+
+rate_limit_result_t rate_limiter_check(uint32_t addr)
+{
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint16_t charged[RATE_LIMIT_LEVELS];
+    rate_limit_result_t result = RATE_LIMIT_ALLOWED;
+    heavy_hitter_estimate_t estimate;
+
+    heavy_hitters_record(addr, &estimate);
+
+    // Every level is refilled and touched, even past the first refusal, so
+    // recency reflects the attempt and the most specific refusal wins
+    for (int l = 0; l < RATE_LIMIT_LEVELS; l++) {
+        level_t *level = &levels[l];
+
+        charged[l] = touch_bucket(level, &stats.levels[l], addr & level->mask, now_ms);
+        if (result == RATE_LIMIT_ALLOWED && level->buckets[charged[l]].credit < level->window_ms) {
+            result = (rate_limit_result_t)(RATE_LIMIT_REFUSED_HOST + l);
+        }
+    }
+
+    if (result == RATE_LIMIT_ALLOWED && estimate.heavy) {
+        result = RATE_LIMIT_REFUSED_HEAVY_HITTER;
+    }
+
+    if (result != RATE_LIMIT_ALLOWED) {
+        stats.refused[result]++;
+        return result;
+    }
+
+    // Charge only once every level has agreed, so a refusal at one level
+    // does not drain the budgets of the others
+    for (int l = 0; l < RATE_LIMIT_LEVELS; l++) {
+        levels[l].buckets[charged[l]].credit -= levels[l].window_ms;
+    }
+    stats.allowed++;
+    return RATE_LIMIT_ALLOWED;
+}
+
+const char *rate_limiter_result_name(rate_limit_result_t result)
+{
+    if (result >= RATE_LIMIT_RESULT_COUNT) {
+        return "unknown";
+    }
+    return RESULT_NAMES[result];
+}
+
+esp_err_t rate_limiter_get_stats(rate_limiter_stats_t *out_stats)
+{
+    if (out_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(out_stats, &stats, sizeof(rate_limiter_stats_t));
+    for (int l = 0; l < RATE_LIMIT_LEVELS; l++) {
+        out_stats->levels[l].tracked = levels[l].count;
+    }
+    return ESP_OK;
+}
+
+static uint16_t touch_bucket(level_t *level, rate_limiter_level_stats_t *level_stats,
+                             uint32_t key, uint32_t now_ms)
+{
+    uint32_t index_mask = level->pool_size * 2 - 1;
+    uint32_t slot = home_slot(level, key);
+    uint32_t probes = 1;
+    uint16_t b;
+
+    while ((b = level->index_table[slot]) != NIL && level->buckets[b].key != key) {
+        slot = (slot + 1) & index_mask;
+        probes++;
+    }
+    if (probes > level_stats->max_probe) {
+        level_stats->max_probe = probes;
+    }
+
+    if (b == NIL) {
+        // New prefix: take a free bucket or recycle the least recent one
+        b = level->count < level->pool_size ? (uint16_t)level->count++ :
+                                              evict_oldest(level, level_stats, now_ms);
+        level->buckets[b].key = key;
+        level->buckets[b].credit = level->capacity;
+        index_insert(level, b);
+    } else {
+        level->buckets[b].credit = refill(level, &level->buckets[b], now_ms);
+        lru_unlink(level, b);
+    }
+    level->buckets[b].last_ms = now_ms;
+    lru_push_front(level, b);
+    return b;
+}
+
+static uint32_t home_slot(const level_t *level, uint32_t key)
+{
+    // Multiplicative hashing; the top bits are the best mixed
+    uint32_t h = (key ^ hash_seed) * 0x9e3779b1u;
+    return h >> (32 - __builtin_ctz(level->pool_size * 2));
+}
+
+static uint16_t evict_oldest(level_t *level, rate_limiter_level_stats_t *level_stats,
+                             uint32_t now_ms)
+{
+    uint16_t b = level->lru_tail;
+
+    // Forgetting a prefix that is being refused hands it a fresh bucket
+    if (refill(level, &level->buckets[b], now_ms) < level->window_ms) {
+        level_stats->evicted_limited++;
+    }
+    level_stats->evictions++;
+
+    lru_unlink(level, b);
+    index_remove(level, b);
+    return b;
+}
+
+static void index_remove(level_t *level, uint16_t b)
+{
+    uint32_t index_mask = level->pool_size * 2 - 1;
+    uint16_t *index_table = level->index_table;
+    uint32_t hole = home_slot(level, level->buckets[b].key);
+
+    while (index_table[hole] != b) {
+        hole = (hole + 1) & index_mask;
+    }
+
+    // Backward-shift deletion: pull later entries of the cluster into the
+    // hole unless that would move them before their home slot
+    uint32_t slot = hole;
+    while (1) {
+        slot = (slot + 1) & index_mask;
+        uint16_t moved = index_table[slot];
+        if (moved == NIL) {
+            break;
+        }
+
+        uint32_t home = home_slot(level, level->buckets[moved].key);
+        if (((slot - home) & index_mask) >= ((slot - hole) & index_mask)) {
+            index_table[hole] = moved;
+            hole = slot;
+        }
+    }
+    index_table[hole] = NIL;
+}
+
+static void index_insert(level_t *level, uint16_t b)
+{
+    uint32_t index_mask = level->pool_size * 2 - 1;
+    uint32_t slot = home_slot(level, level->buckets[b].key);
+
+    while (level->index_table[slot] != NIL) {
+        slot = (slot + 1) & index_mask;
+    }
+    level->index_table[slot] = b;
+}
+
+static void lru_unlink(level_t *level, uint16_t b)
+{
+    bucket_t *buckets = level->buckets;
+
+    if (buckets[b].prev != NIL) {
+        buckets[buckets[b].prev].next = buckets[b].next;
+    } else {
+        level->lru_head = buckets[b].next;
+    }
+    if (buckets[b].next != NIL) {
+        buckets[buckets[b].next].prev = buckets[b].prev;
+    } else {
+        level->lru_tail = buckets[b].prev;
+    }
+}
+
+static void lru_push_front(level_t *level, uint16_t b)
+{
+    bucket_t *buckets = level->buckets;
+
+    buckets[b].prev = NIL;
+    buckets[b].next = level->lru_head;
+    if (level->lru_head != NIL) {
+        buckets[level->lru_head].prev = b;
+    } else {
+        level->lru_tail = b;
+    }
+    level->lru_head = b;
+}
+
+static uint32_t refill(const level_t *level, const bucket_t *bucket, uint32_t now_ms)
+{
+    // Anything idle for a full window is back at capacity
+    uint32_t elapsed = now_ms - bucket->last_ms;
+    if (elapsed >= level->window_ms) {
+        return level->capacity;
+    }
+
+    uint32_t credit = bucket->credit + elapsed * level->max_connections;
+    return credit < level->capacity ? credit : level->capacity;
+}
@@ -0,0 +1,96 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Prefix levels with their own connection budgets
+ */
+typedef enum {
+    RATE_LIMIT_LEVEL_HOST = 0,             ///< Single address (/32)
+    RATE_LIMIT_LEVEL_SUBNET_24,            ///< /24 network
+    RATE_LIMIT_LEVEL_SUBNET_16,            ///< /16 network
+    RATE_LIMIT_LEVELS
+} rate_limit_level_t;
+
+/**
+ * @brief Outcome of a rate limit check; refusals say what triggered them
+ */
+typedef enum {
+    RATE_LIMIT_ALLOWED = 0,
+    RATE_LIMIT_REFUSED_HOST,               ///< The address is out of budget
+    RATE_LIMIT_REFUSED_SUBNET_24,          ///< Its /24 is out of budget
+    RATE_LIMIT_REFUSED_SUBNET_16,          ///< Its /16 is out of budget
+    RATE_LIMIT_REFUSED_HEAVY_HITTER,       ///< The heavy hitter sketch flagged it
+    RATE_LIMIT_RESULT_COUNT
+} rate_limit_result_t;
+
+/**
+ * @brief Bucket table statistics for one prefix level
+ */
+typedef struct {
+    uint32_t tracked;                      ///< Prefixes with a bucket
+    uint32_t capacity;                     ///< Most prefixes tracked at once
+    uint32_t evictions;                    ///< Buckets dropped to make room for a new prefix
+    uint32_t evicted_limited;              ///< Evicted buckets that were still refusing connections
+    uint32_t max_probe;                    ///< Longest table probe seen
+} rate_limiter_level_stats_t;
+
+/**
+ * @brief Rate limiter statistics
+ */
+typedef struct {
+    uint32_t allowed;                      ///< Connections let through
+    uint32_t refused[RATE_LIMIT_RESULT_COUNT]; ///< Refusals by result; the RATE_LIMIT_ALLOWED slot stays 0
+    rate_limiter_level_stats_t levels[RATE_LIMIT_LEVELS]; ///< Per prefix level
+} rate_limiter_stats_t;
+
+/**
+ * @brief Initialize the rate limiter
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t rate_limiter_init(void);
+
+/**
+ * @brief Charge one connection to a source address
+ *
+ * The address, its /24 and its /16 each get a token bucket with their own
+ * budget and refill window (RATE_LIMIT_* in config.h). The connection is
+ * allowed, and charged at every level, only if all three buckets hold a
+ * token and the heavy hitter sketch does not flag the source. When a
+ * level's table is full its least recently seen prefix is forgotten.
+ * Call from the accept loop only.
+ *
+ * @param addr IPv4 source address, network byte order (sin_addr.s_addr)
+ * @return rate_limit_result_t RATE_LIMIT_ALLOWED, or the most specific reason for refusal
+ */
+rate_limit_result_t rate_limiter_check(uint32_t addr);
+
+/**
+ * @brief Short description of a check result for logs
+ *
+ * @param result Result of rate_limiter_check()
+ * @return const char* Static string
+ */
+const char *rate_limiter_result_name(rate_limit_result_t result);
+
+/**
+ * @brief Get rate limiter statistics
+ *
+ * @param out_stats Receives the statistics
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t rate_limiter_get_stats(rate_limiter_stats_t *out_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RATE_LIMITER_H
@@ -0,0 +1,614 @@
+/*
+ * FTP Service - Command state machine and upload capture
+ *
+ * Control connections are read line by line. Every USER/PASS pair is
+ * logged and accepted, so bots go on to show what they came to upload.
+ *
+ * Passive mode uses one fixed data port. PASV and EPSV reserve an entry
+ * in a small transfer table for the client's address, and the next data
+ * connection from that address takes it. Uploads are never buffered:
+ * each read is counted and dropped, the connection's running digest
+ * already covers it, and only the first FTP_MAGIC_SIZE bytes are kept to
+ * tell the file type. The upload is logged when its data connection
+ * closes, so a transfer of any size costs one connection object and one
+ * table entry.
+ *
+ * Transfer replies send 150 and 226 together. The client only reads the
+ * 226 once its data connection is done, so no signal has to pass from
+ * the data connection back to the control connection.
+ */
+
+#include "ftp_service.h"
+#include "service_registry.h"
+#include "logging/attack_logger.h"
+#include "logging/payload_store.h"
+#include "utils/config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "ftp_service";
+
+#define FTP_USER_SIZE 32
+#define FTP_PATH_SIZE 64
+
+#define REPLY_NEED_PASSWORD   "331 Please specify the password.\r\n"
+#define REPLY_LOGGED_IN       "230 Login successful.\r\n"
+#define REPLY_NEED_USER       "503 Login with USER first.\r\n"
+#define REPLY_NOT_LOGGED_IN   "530 Please login with USER and PASS.\r\n"
+#define REPLY_SYSTEM          "215 UNIX Type: L8\r\n"
+#define REPLY_DIRECTORY       "257 \"/\" is the current directory\r\n"
+#define REPLY_DIRECTORY_OK    "250 Directory successfully changed.\r\n"
+#define REPLY_TYPE_BINARY     "200 Switching to Binary mode.\r\n"
+#define REPLY_TYPE_ASCII      "200 Switching to ASCII mode.\r\n"
+#define REPLY_TYPE_UNKNOWN    "500 Unrecognised TYPE command.\r\n"
+#define REPLY_NOOP            "200 NOOP ok.\r\n"
+#define REPLY_NO_DATA         "425 Use PASV or EPSV first.\r\n"
+#define REPLY_DATA_BUSY       "425 Can't open data connection.\r\n"
+#define REPLY_LISTING         "150 Here comes the directory listing.\r\n226 Directory send OK.\r\n"
+#define REPLY_UPLOAD          "150 Ok to send data.\r\n226 Transfer complete.\r\n"
+#define REPLY_NO_FILE         "550 Failed to open file.\r\n"
+#define REPLY_GOODBYE         "221 Goodbye.\r\n"
+#define REPLY_UNKNOWN         "502 Command not implemented.\r\n"
+
+#define DIRECTORY_LISTING \
+    "drwxr-xr-x    2 0        0               0 Jan  1  1970 bin\r\n" \
+    "drwxr-xr-x    3 0        0               0 Jan  1  1970 etc\r\n" \
+    "drwxr-xr-x    2 0        0               0 Jan  1  1970 lib\r\n" \
+    "drwxrwxrwt    2 0        0               0 Jan  1  1970 tmp\r\n" \
+    "drwxr-xr-x    5 0        0               0 Jan  1  1970 var\r\n"
+
+typedef enum {
+    FTP_PHASE_USER = 0,
+    FTP_PHASE_PASS,
+    FTP_PHASE_READY
+} ftp_phase_t;
+
+// Control connection state, kept in the connection's service_state
+typedef struct {
+    uint8_t phase;                         ///< ftp_phase_t
+    uint8_t attempts;                      ///< PASS commands received
+    uint8_t transfer;                      ///< Reserved transfer entry + 1, 0 if none
+    char user[FTP_USER_SIZE];              ///< Last USER argument
+} ftp_session_t;
+
+// Data connection state, kept in the connection's service_state
+typedef struct {
+    uint8_t transfer;                      ///< Transfer entry + 1, 0 if unsolicited
+    uint8_t magic_len;                     ///< Bytes held in @p magic
+    uint8_t magic[FTP_MAGIC_SIZE];         ///< First bytes of the upload
+    uint32_t size;                         ///< Bytes received, saturating
+} ftp_upload_t;
+
+_Static_assert(sizeof(ftp_session_t) <= CONNECTION_STATE_SIZE, "ftp_session_t must fit in service_state");
+_Static_assert(sizeof(ftp_upload_t) <= CONNECTION_STATE_SIZE, "ftp_upload_t must fit in service_state");
+
+typedef enum {
+    TRANSFER_FREE = 0,
+    TRANSFER_WAITING,                      ///< Passive port announced, no connection yet
+    TRANSFER_OPEN                          ///< Data connection accepted
+} transfer_state_t;
+
+// Passive transfer shared by a control and a data connection
+typedef struct {
+    uint8_t state;                         ///< transfer_state_t
+    bool list_pending;                     ///< LIST arrived before the data connection
+    char client_ip[16];                    ///< Only this address may connect
+    socket_conn_t *control;                ///< Session that reserved it, NULL once it moved on
+    socket_conn_t *data;                   ///< Data connection, NULL until accepted
+    char user[FTP_USER_SIZE];              ///< Session user, for the upload record
+    char path[FTP_PATH_SIZE];              ///< STOR argument, empty if none was sent
+} ftp_transfer_t;
+
+typedef bool (*ftp_command_t)(socket_conn_t *conn, ftp_session_t *session,
+                              const char *arg, size_t arg_len);
+
+// Internal function prototypes
+static bool handle_command(socket_conn_t *conn, ftp_session_t *session, const char *line, size_t len);
+static bool cmd_user(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_pass(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_quit(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_syst(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_noop(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_pwd(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_cwd(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_type(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_pasv(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_epsv(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_list(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_retr(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static bool cmd_stor(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len);
+static void open_passive(socket_conn_t *conn, ftp_session_t *session, bool extended);
+static ftp_transfer_t *owned_transfer(const socket_conn_t *conn, const ftp_session_t *session);
+static void release_transfer(const socket_conn_t *conn, ftp_session_t *session);
+static void attach_data_connection(socket_conn_t *conn);
+static bool receive_upload(socket_conn_t *conn, const char *data, size_t len);
+static void finish_upload(socket_conn_t *conn);
+static void send_listing(socket_conn_t *data_conn);
+static void log_login_attempt(const socket_conn_t *conn, const ftp_session_t *session,
+                              const char *password, size_t password_len);
+static void log_upload(const socket_conn_t *conn, const ftp_upload_t *upload,
+                       const char *user, const char *path);
+static void reply(socket_conn_t *conn, const char *text);
+static void copy_arg(char *dst, size_t dst_size, const char *arg, size_t arg_len);
+
+static const struct {
+    const char *verb;
+    bool needs_login;
+    ftp_command_t run;
+} COMMANDS[] = {
+    { "USER", false, cmd_user },
+    { "PASS", false, cmd_pass },
+    { "QUIT", false, cmd_quit },
+    { "SYST", false, cmd_syst },
+    { "NOOP", false, cmd_noop },
+    { "PWD",  true,  cmd_pwd },
+    { "XPWD", true,  cmd_pwd },
+    { "CWD",  true,  cmd_cwd },
+    { "TYPE", true,  cmd_type },
+    { "PASV", true,  cmd_pasv },
+    { "EPSV", true,  cmd_epsv },
+    { "LIST", true,  cmd_list },
+    { "NLST", true,  cmd_list },
+    { "RETR", true,  cmd_retr },
+    { "STOR", true,  cmd_stor },
+};
+
+static ftp_transfer_t transfers[FTP_MAX_TRANSFERS];
+static SemaphoreHandle_t transfer_mutex = NULL;
+
+esp_err_t ftp_service_init(void)
+{
+    memset(transfers, 0, sizeof(transfers));
+    transfer_mutex = xSemaphoreCreateMutex();
+    if (transfer_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create transfer mutex, passive mode disabled");
+    }
+    ESP_LOGI(TAG, "FTP service initialized, passive port %d", FTP_PASV_PORT);
+    return ESP_OK;
+}
+
+void ftp_service_on_connect(socket_conn_t *conn)
+{
+    if (conn->port == FTP_PASV_PORT) {
+        attach_data_connection(conn);
+        return;
+    }
+    reply(conn, FTP_BANNER);
+}
+
+void ftp_service_on_close(socket_conn_t *conn)
+{
+    if (conn->port == FTP_PASV_PORT) {
+        finish_upload(conn);
+        return;
+    }
+    release_transfer(conn, (ftp_session_t *)conn->service_state);
+}
+
+bool ftp_service_handle_request(socket_conn_t *conn, const char *data, size_t len)
+{
+    ftp_session_t *session = (ftp_session_t *)conn->service_state;
+    size_t start = 0;
+    bool keep_open = true;
+    const char *eol;
+
+    if (conn->port == FTP_PASV_PORT) {
+        return receive_upload(conn, data, len);
+    }
+
+    // Answer every complete line; a partial one waits for the next read
+    while (keep_open && (eol = memchr(data + start, '\n', len - start)) != NULL) {
+        size_t line_len = (size_t)(eol - (data + start));
+        if (line_len > 0 && data[start + line_len - 1] == '\r') {
+            line_len--;
+        }
+        keep_open = handle_command(conn, session, data + start, line_len);
+        start = (size_t)(eol - data) + 1;
+    }
+
+    memmove(conn->rx_buf, data + start, len - start);
+    conn->rx_len = len - start;
+    conn->rx_buf[conn->rx_len] = '\0';
+    return keep_open;
+}
+
+static bool handle_command(socket_conn_t *conn, ftp_session_t *session, const char *line, size_t len)
+{
+    size_t verb_len = 0;
+    while (verb_len < len && line[verb_len] != ' ') {
+        verb_len++;
+    }
+    const char *arg = line + verb_len;
+    size_t arg_len = len - verb_len;
+    while (arg_len > 0 && *arg == ' ') {
+        arg++;
+        arg_len--;
+    }
+
+    ESP_LOGI(TAG, "FTP command from %s: %.*s", conn->client_ip, (int)len, line);
+
+    for (size_t i = 0; i < sizeof(COMMANDS) / sizeof(COMMANDS[0]); i++) {
+        if (strlen(COMMANDS[i].verb) != verb_len || strncasecmp(line, COMMANDS[i].verb, verb_len) != 0) {
+            continue;
+        }
+        if (COMMANDS[i].needs_login && session->phase != FTP_PHASE_READY) {
+            reply(conn, REPLY_NOT_LOGGED_IN);
+            return true;
+        }
+        return COMMANDS[i].run(conn, session, arg, arg_len);
+    }
+
+    reply(conn, REPLY_UNKNOWN);
+    return true;
+}
+
+static bool cmd_user(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    copy_arg(session->user, sizeof(session->user), arg, arg_len);
+    session->phase = FTP_PHASE_PASS;
+    reply(conn, REPLY_NEED_PASSWORD);
+    return true;
+}
+
+static bool cmd_pass(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    if (session->phase != FTP_PHASE_PASS) {
+        reply(conn, REPLY_NEED_USER);
+        return true;
+    }
+
+    if (session->attempts < UINT8_MAX) {
+        session->attempts++;
+    }
+    log_login_attempt(conn, session, arg, arg_len);
+
+    session->phase = FTP_PHASE_READY;
+    reply(conn, REPLY_LOGGED_IN);
+    return true;
+}
+
+static bool cmd_quit(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    reply(conn, REPLY_GOODBYE);
+    return false;
+}
+
+static bool cmd_syst(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    reply(conn, REPLY_SYSTEM);
+    return true;
+}
+
+static bool cmd_noop(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    reply(conn, REPLY_NOOP);
+    return true;
+}
+
+static bool cmd_pwd(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    reply(conn, REPLY_DIRECTORY);
+    return true;
+}
+
+static bool cmd_cwd(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    reply(conn, REPLY_DIRECTORY_OK);
+    return true;
+}
+
+static bool cmd_type(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    // Transfers are never converted, so the type is only acknowledged
+    char type = arg_len > 0 ? arg[0] : '\0';
+    if (type == 'I' || type == 'i' || type == 'L' || type == 'l') {
+        reply(conn, REPLY_TYPE_BINARY);
+    } else if (type == 'A' || type == 'a') {
+        reply(conn, REPLY_TYPE_ASCII);
+    } else {
+        reply(conn, REPLY_TYPE_UNKNOWN);
+    }
+    return true;
+}
+
+static bool cmd_pasv(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    open_passive(conn, session, false);
+    return true;
+}
+
+static bool cmd_epsv(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    open_passive(conn, session, true);
+    return true;
+}
+
+static bool cmd_list(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    if (session->transfer == 0) {
+        reply(conn, REPLY_NO_DATA);
+        return true;
+    }
+
+    xSemaphoreTake(transfer_mutex, portMAX_DELAY);
+    ftp_transfer_t *transfer = owned_transfer(conn, session);
+    if (transfer != NULL && transfer->data != NULL) {
+        send_listing(transfer->data);
+    } else if (transfer != NULL) {
+        transfer->list_pending = true;
+    }
+    xSemaphoreGive(transfer_mutex);
+
+    reply(conn, transfer != NULL ? REPLY_LISTING : REPLY_NO_DATA);
+    return true;
+}
+
+static bool cmd_retr(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    // Nothing is ever served
+    reply(conn, REPLY_NO_FILE);
+    return true;
+}
+
+static bool cmd_stor(socket_conn_t *conn, ftp_session_t *session, const char *arg, size_t arg_len)
+{
+    if (session->transfer == 0) {
+        reply(conn, REPLY_NO_DATA);
+        return true;
+    }
+
+    xSemaphoreTake(transfer_mutex, portMAX_DELAY);
+    ftp_transfer_t *transfer = owned_transfer(conn, session);
+    if (transfer != NULL) {
+        copy_arg(transfer->path, sizeof(transfer->path), arg, arg_len);
+    }
+    xSemaphoreGive(transfer_mutex);
+
+    if (transfer == NULL) {
+        reply(conn, REPLY_NO_DATA);
+        return true;
+    }
+
+    ESP_LOGI(TAG, "FTP upload of %.*s from %s", (int)arg_len, arg, conn->client_ip);
+    reply(conn, REPLY_UPLOAD);
+    return true;
+}
+
+static void open_passive(socket_conn_t *conn, ftp_session_t *session, bool extended)
+{
+    struct sockaddr_in local;
+    socklen_t local_len = sizeof(local);
+    int index = -1;
+
+    // PASV must name the address the client reached us on
+    if (transfer_mutex == NULL ||
+        getsockname(conn->fd, (struct sockaddr *)&local, &local_len) != 0) {
+        reply(conn, REPLY_DATA_BUSY);
+        return;
+    }
+
+    release_transfer(conn, session);
+
+    xSemaphoreTake(transfer_mutex, portMAX_DELAY);
+    for (int i = 0; i < FTP_MAX_TRANSFERS; i++) {
+        if (transfers[i].state == TRANSFER_FREE) {
+            ftp_transfer_t *transfer = &transfers[i];
+            memset(transfer, 0, sizeof(*transfer));
+            transfer->state = TRANSFER_WAITING;
+            strcpy(transfer->client_ip, conn->client_ip);
+            transfer->control = conn;
+            strcpy(transfer->user, session->user);
+            index = i;
+            break;
+        }
+    }
+    xSemaphoreGive(transfer_mutex);
+
+    if (index < 0) {
+        ESP_LOGW(TAG, "No free passive transfer for %s", conn->client_ip);
+        reply(conn, REPLY_DATA_BUSY);
+        return;
+    }
+    session->transfer = (uint8_t)(index + 1);
+
+    char text[64];
+    if (extended) {
+        snprintf(text, sizeof(text), "229 Entering Extended Passive Mode (|||%u|).\r\n",
+                 (unsigned)FTP_PASV_PORT);
+    } else {
+        uint32_t ip = ntohl(local.sin_addr.s_addr);
+        snprintf(text, sizeof(text), "227 Entering Passive Mode (%u,%u,%u,%u,%u,%u).\r\n",
+                 (unsigned)(ip >> 24), (unsigned)(ip >> 16) & 0xFF, (unsigned)(ip >> 8) & 0xFF,
+                 (unsigned)ip & 0xFF, (unsigned)FTP_PASV_PORT >> 8, (unsigned)FTP_PASV_PORT & 0xFF);
+    }
+    reply(conn, text);
+}
+
+// Caller holds transfer_mutex
+static ftp_transfer_t *owned_transfer(const socket_conn_t *conn, const ftp_session_t *session)
+{
+    if (session->transfer == 0) {
+        return NULL;
+    }
+
+    // The entry may have been finished and reused since it was reserved
+    ftp_transfer_t *transfer = &transfers[session->transfer - 1];
+    return transfer->control == conn ? transfer : NULL;
+}
+
+static void release_transfer(const socket_conn_t *conn, ftp_session_t *session)
+{
+    if (session->transfer == 0) {
+        return;
+    }
+
+    // A transfer in progress stays until its data connection closes
+    xSemaphoreTake(transfer_mutex, portMAX_DELAY);
+    ftp_transfer_t *transfer = owned_transfer(conn, session);
+    if (transfer != NULL) {
+        transfer->control = NULL;
+        if (transfer->state == TRANSFER_WAITING) {
+            memset(transfer, 0, sizeof(*transfer));
+        }
+    }
+    xSemaphoreGive(transfer_mutex);
+
+    session->transfer = 0;
+}
+
+static void attach_data_connection(socket_conn_t *conn)
+{
+    ftp_upload_t *upload = (ftp_upload_t *)conn->service_state;
+
+    if (transfer_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(transfer_mutex, portMAX_DELAY);
+    for (int i = 0; i < FTP_MAX_TRANSFERS; i++) {
+        ftp_transfer_t *transfer = &transfers[i];
+        if (transfer->state != TRANSFER_WAITING || strcmp(transfer->client_ip, conn->client_ip) != 0) {
+            continue;
+        }
+        transfer->state = TRANSFER_OPEN;
+        transfer->data = conn;
+        upload->transfer = (uint8_t)(i + 1);
+        if (transfer->list_pending) {
+            transfer->list_pending = false;
+            send_listing(conn);
+        }
+        break;
+    }
+    xSemaphoreGive(transfer_mutex);
+
+    if (upload->transfer == 0) {
+        ESP_LOGW(TAG, "Unexpected data connection from %s", conn->client_ip);
+    }
+}
+
+static bool receive_upload(socket_conn_t *conn, const char *data, size_t len)
+{
+    ftp_upload_t *upload = (ftp_upload_t *)conn->service_state;
+
+    if (upload->transfer == 0) {
+        return false;
+    }
+
+    size_t keep = FTP_MAGIC_SIZE - upload->magic_len;
+    if (keep > len) {
+        keep = len;
+    }
+    memcpy(upload->magic + upload->magic_len, data, keep);
+    upload->magic_len += keep;
+    upload->size = len > UINT32_MAX - upload->size ? UINT32_MAX : upload->size + (uint32_t)len;
+
+    // The payload digest has already taken these bytes; drop them so the
+    // whole buffer is free for the next read
+    conn->rx_len = 0;
+    conn->rx_buf[0] = '\0';
+    return true;
+}
+
+static void finish_upload(socket_conn_t *conn)
+{
+    const ftp_upload_t *upload = (const ftp_upload_t *)conn->service_state;
+    char user[FTP_USER_SIZE] = "";
+    char path[FTP_PATH_SIZE] = "";
+
+    if (upload->transfer == 0) {
+        return;
+    }
+
+    xSemaphoreTake(transfer_mutex, portMAX_DELAY);
+    ftp_transfer_t *transfer = &transfers[upload->transfer - 1];
+    if (transfer->data == conn) {
+        strcpy(user, transfer->user);
+        strcpy(path, transfer->path);
+        memset(transfer, 0, sizeof(*transfer));
+    }
+    xSemaphoreGive(transfer_mutex);
+
+    // Listings and abandoned transfers carry nothing to record
+    if (upload->size > 0) {
+        log_upload(conn, upload, user, path);
+    }
+}
+
+static void send_listing(socket_conn_t *data_conn)
+{
+    // Half-close so the client sees the end of the listing; it then closes
+    // and the connection is torn down the usual way
+    socket_manager_send(data_conn, DIRECTORY_LISTING, sizeof(DIRECTORY_LISTING) - 1);
+    shutdown(data_conn->fd, SHUT_WR);
+}
+
+static void log_login_attempt(const socket_conn_t *conn, const ftp_session_t *session,
+                              const char *password, size_t password_len)
+{
+    attack_log_t log_entry;
+
+    service_registry_log_entry(&log_entry, conn, "FTP");
+    strncpy(log_entry.username, session->user[0] != '\0' ? session->user : "N/A",
+            sizeof(log_entry.username) - 1);
+    copy_arg(log_entry.password, sizeof(log_entry.password), password, password_len);
+    payload_hasher_hex(&conn->payload_hash, log_entry.payload_hash);
+    snprintf(log_entry.metadata, sizeof(log_entry.metadata), "Login attempt %u",
+             (unsigned)session->attempts);
+
+    ESP_LOGI(TAG, "FTP login from %s: %s / %s", conn->client_ip, log_entry.username,
+             log_entry.password);
+
+    attack_logger_log(&log_entry);
+    service_registry_count_attack(conn->port);
+}
+
+static void log_upload(const socket_conn_t *conn, const ftp_upload_t *upload,
+                       const char *user, const char *path)
+{
+    attack_log_t log_entry;
+    char magic[FTP_MAGIC_SIZE * 2 + 1];
+
+    service_registry_log_entry(&log_entry, conn, "FTP");
+    strncpy(log_entry.username, user[0] != '\0' ? user : "N/A", sizeof(log_entry.username) - 1);
+    strcpy(log_entry.password, "N/A");
+
+    // Digest of the whole upload, streamed as it arrived
+    payload_hasher_hex(&conn->payload_hash, log_entry.payload_hash);
+
+    // Count repeats of the same file; the sample is its leading bytes
+    payload_ref_t payload;
+    if (payload_store_observe(log_entry.payload_hash, upload->magic, upload->magic_len,
+                              log_entry.timestamp, &payload) == ESP_OK) {
+        log_entry.payload_hits = payload.hits;
+        log_entry.payload_first_seen = payload.first_seen;
+    }
+
+    for (int i = 0; i < upload->magic_len; i++) {
+        snprintf(&magic[i * 2], 3, "%02x", upload->magic[i]);
+    }
+    magic[upload->magic_len * 2] = '\0';
+    snprintf(log_entry.metadata, sizeof(log_entry.metadata), "STOR %.48s, %lu bytes, magic %s",
+             path[0] != '\0' ? path : "-", (unsigned long)upload->size, magic);
+
+    ESP_LOGW(TAG, "FTP upload from %s: %s (%lu bytes, hash %s)", conn->client_ip,
+             path[0] != '\0' ? path : "-", (unsigned long)upload->size, log_entry.payload_hash);
+
+    attack_logger_log(&log_entry);
+    service_registry_count_attack(conn->port);
+}
+
+static void reply(socket_conn_t *conn, const char *text)
+{
+    socket_manager_send(conn, text, strlen(text));
+}
+
+static void copy_arg(char *dst, size_t dst_size, const char *arg, size_t arg_len)
+{
+    size_t n = arg_len < dst_size - 1 ? arg_len : dst_size - 1;
+    memcpy(dst, arg, n);
+    dst[n] = '\0';
+}
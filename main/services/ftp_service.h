@@ -0,0 +1,52 @@
+#ifndef FTP_SERVICE_H
+#define FTP_SERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "networking/socket_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the FTP service emulation
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t ftp_service_init(void);
+
+/**
+ * @brief Handle data received on an FTP connection
+ * 
+ * Control connections are answered line by line. On the passive data
+ * port the bytes are an upload; they are counted and discarded, the
+ * connection's payload digest already covers them.
+ * 
+ * @param conn Connection the data arrived on
+ * @param data Received bytes (NUL-terminated)
+ * @param len Number of bytes received
+ * @return true to keep the connection open for more data
+ */
+bool ftp_service_handle_request(socket_conn_t *conn, const char *data, size_t len);
+
+/**
+ * @brief Greet a new control connection, or pair a data connection with
+ *        the session that opened its passive port
+ *
+ * @param conn Connection just accepted
+ */
+void ftp_service_on_connect(socket_conn_t *conn);
+
+/**
+ * @brief Release a session's passive transfer, or log a finished upload
+ *
+ * @param conn Connection about to be closed
+ */
+void ftp_service_on_close(socket_conn_t *conn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FTP_SERVICE_H
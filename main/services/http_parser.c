@@ -0,0 +1,326 @@
+/*
+ * HTTP Request Parser
+ *
+ * Single-pass, non-allocating request parser. State is kept between
+ * calls so a request split over several recv() calls is resumed where it
+ * stopped; every byte is looked at exactly once. Bare LF line endings are
+ * accepted since plenty of scanners send them.
+ */
+
+#include "http_parser.h"
+#include <string.h>
+#include <strings.h>
+
+typedef enum {
+    STATE_METHOD = 0,
+    STATE_TARGET,
+    STATE_VERSION,
+    STATE_REQUEST_LF,
+    STATE_HEADER_START,
+    STATE_HEADER_NAME,
+    STATE_HEADER_VALUE_WS,
+    STATE_HEADER_VALUE,
+    STATE_HEADER_LF,
+    STATE_HEADERS_END_LF,
+    STATE_BODY,
+    STATE_DONE,
+    STATE_ERROR
+} parser_state_t;
+
+#define CONTENT_LENGTH_MAX_DIGITS 9
+
+// Internal function prototypes
+static bool is_token_char(char c);
+static size_t scan_token(const char *buf, size_t pos, size_t len);
+static size_t scan_visible(const char *buf, size_t pos, size_t len);
+static size_t scan_line(const char *buf, size_t pos, size_t len);
+static void finish_header(http_request_t *req, const char *buf);
+static http_parse_result_t check_body(http_request_t *req, size_t len);
+
+http_parse_result_t http_parser_execute(http_request_t *req, const char *buf, size_t len)
+{
+    if (len > UINT16_MAX) {
+        len = UINT16_MAX;
+    }
+
+    size_t pos = req->pos;
+    while (pos < len && req->state < STATE_BODY) {
+        char c = buf[pos];
+        bool tracking = req->header_count < HTTP_MAX_HEADERS;
+        http_header_t *hdr = &req->headers[tracking ? req->header_count : 0];
+
+        switch (req->state) {
+            case STATE_METHOD:
+                if (c == ' ' && req->method.len > 0) {
+                    req->target.off = pos + 1;
+                    req->state = STATE_TARGET;
+                } else if (is_token_char(c) && req->method.len < HTTP_MAX_METHOD_LEN) {
+                    req->method.len++;
+                } else {
+                    req->state = STATE_ERROR;
+                }
+                break;
+
+            case STATE_TARGET: {
+                // Targets and header values are most of a request; take the
+                // run of ordinary bytes in one go rather than one per pass
+                size_t run = scan_visible(buf, pos, len);
+                req->target.len += run;
+                pos += run;
+                if (pos == len) {
+                    continue;
+                }
+                c = buf[pos];
+                if (c == ' ' && req->target.len > 0) {
+                    req->version.off = pos + 1;
+                    req->state = STATE_VERSION;
+                } else {
+                    req->state = STATE_ERROR;
+                }
+                break;
+            }
+
+            case STATE_VERSION:
+                if (c == '\r' || c == '\n') {
+                    req->state = req->version.len == 0 ? STATE_ERROR :
+                                 c == '\r' ? STATE_REQUEST_LF : STATE_HEADER_START;
+                } else if (c > ' ' && c != 0x7f) {
+                    req->version.len++;
+                } else {
+                    req->state = STATE_ERROR;
+                }
+                break;
+
+            case STATE_REQUEST_LF:
+            case STATE_HEADER_LF:
+                req->state = c == '\n' ? STATE_HEADER_START : STATE_ERROR;
+                break;
+
+            case STATE_HEADER_START:
+                if (c == '\r') {
+                    req->state = STATE_HEADERS_END_LF;
+                } else if (c == '\n') {
+                    req->body_off = pos + 1;
+                    req->state = STATE_BODY;
+                } else if (is_token_char(c)) {
+                    if (tracking) {
+                        hdr->name.off = pos;
+                        hdr->name.len = 1;
+                    } else {
+                        req->headers_truncated = true;
+                    }
+                    req->state = STATE_HEADER_NAME;
+                } else {
+                    // Obsolete line folding and junk before the name
+                    req->state = STATE_ERROR;
+                }
+                break;
+
+            case STATE_HEADER_NAME: {
+                size_t run = scan_token(buf, pos, len);
+                if (tracking) {
+                    hdr->name.len += run;
+                }
+                pos += run;
+                if (pos == len) {
+                    continue;
+                }
+                c = buf[pos];
+                if (c == ':') {
+                    req->state = STATE_HEADER_VALUE_WS;
+                } else {
+                    req->state = STATE_ERROR;
+                }
+                break;
+            }
+
+            case STATE_HEADER_VALUE_WS:
+                if (c == ' ' || c == '\t') {
+                    break;
+                }
+                if (tracking) {
+                    hdr->value.off = pos;
+                    hdr->value.len = 0;
+                }
+                req->state = STATE_HEADER_VALUE;
+                continue;  // Re-examine this byte as part of the value
+
+            case STATE_HEADER_VALUE: {
+                size_t run = scan_line(buf, pos, len);
+                if (tracking) {
+                    hdr->value.len += run;
+                }
+                pos += run;
+                if (pos == len) {
+                    continue;
+                }
+                c = buf[pos];
+                finish_header(req, buf);
+                req->state = c == '\r' ? STATE_HEADER_LF : STATE_HEADER_START;
+                break;
+            }
+
+            case STATE_HEADERS_END_LF:
+                if (c == '\n') {
+                    req->body_off = pos + 1;
+                    req->state = STATE_BODY;
+                } else {
+                    req->state = STATE_ERROR;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (req->state == STATE_ERROR) {
+            req->pos = pos;
+            return HTTP_PARSE_ERROR;
+        }
+        pos++;
+    }
+
+    req->pos = pos;
+    return check_body(req, len);
+}
+
+bool http_parser_headers_complete(const http_request_t *req)
+{
+    return req->state == STATE_BODY || req->state == STATE_DONE;
+}
+
+http_view_t http_parser_view(const char *buf, http_span_t span)
+{
+    http_view_t view = { buf + span.off, span.len };
+    return view;
+}
+
+http_view_t http_parser_header(const http_request_t *req, const char *buf, const char *name)
+{
+    size_t name_len = strlen(name);
+
+    for (int i = 0; i < req->header_count; i++) {
+        const http_header_t *hdr = &req->headers[i];
+        if (hdr->name.len == name_len &&
+            strncasecmp(buf + hdr->name.off, name, name_len) == 0) {
+            return http_parser_view(buf, hdr->value);
+        }
+    }
+
+    http_view_t empty = { buf, 0 };
+    return empty;
+}
+
+http_view_t http_parser_body(const http_request_t *req, const char *buf, size_t len)
+{
+    http_view_t view = { buf, 0 };
+
+    if (http_parser_headers_complete(req) && len > req->body_off) {
+        view.ptr = buf + req->body_off;
+        view.len = len - req->body_off;
+        if (view.len > req->content_length) {
+            view.len = req->content_length;
+        }
+    }
+    return view;
+}
+
+bool http_view_equals(http_view_t view, const char *str)
+{
+    return strlen(str) == view.len && memcmp(view.ptr, str, view.len) == 0;
+}
+
+bool http_view_contains(http_view_t view, const char *needle)
+{
+    size_t needle_len = strlen(needle);
+
+    if (needle_len == 0 || needle_len > view.len) {
+        return needle_len == 0;
+    }
+
+    for (size_t i = 0; i + needle_len <= view.len; i++) {
+        if (view.ptr[i] == needle[0] && memcmp(view.ptr + i, needle, needle_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_token_char(char c)
+{
+    // RFC 9110 tchar, one bit per ASCII character
+    static const uint32_t TCHAR_BITS[4] = {
+        0x00000000,                 // Control characters
+        0x03ff6cfa,                 // ! # $ % & ' * + - . 0-9
+        0xc7fffffe,                 // A-Z ^ _
+        0x57ffffff,                 // ` a-z | ~
+    };
+    unsigned char u = (unsigned char)c;
+    return u < 128 && (TCHAR_BITS[u >> 5] >> (u & 31)) & 1;
+}
+
+static size_t scan_token(const char *buf, size_t pos, size_t len)
+{
+    size_t end = pos;
+    while (end < len && is_token_char(buf[end])) {
+        end++;
+    }
+    return end - pos;
+}
+
+static size_t scan_visible(const char *buf, size_t pos, size_t len)
+{
+    size_t end = pos;
+    while (end < len && buf[end] > ' ' && buf[end] != 0x7f) {
+        end++;
+    }
+    return end - pos;
+}
+
+static size_t scan_line(const char *buf, size_t pos, size_t len)
+{
+    size_t end = pos;
+    while (end < len && buf[end] != '\r' && buf[end] != '\n') {
+        end++;
+    }
+    return end - pos;
+}
+
+static void finish_header(http_request_t *req, const char *buf)
+{
+    if (req->header_count >= HTTP_MAX_HEADERS) {
+        return;
+    }
+
+    http_header_t *hdr = &req->headers[req->header_count++];
+
+    // Drop trailing whitespace from the value
+    while (hdr->value.len > 0) {
+        char c = buf[hdr->value.off + hdr->value.len - 1];
+        if (c != ' ' && c != '\t') {
+            break;
+        }
+        hdr->value.len--;
+    }
+
+    if (hdr->name.len == 14 && strncasecmp(buf + hdr->name.off, "Content-Length", 14) == 0) {
+        uint32_t value = 0;
+        for (int i = 0; i < hdr->value.len && i < CONTENT_LENGTH_MAX_DIGITS; i++) {
+            char c = buf[hdr->value.off + i];
+            if (c < '0' || c > '9') {
+                break;
+            }
+            value = value * 10 + (c - '0');
+        }
+        req->content_length = value;
+    }
+}
+
+static http_parse_result_t check_body(http_request_t *req, size_t len)
+{
+    if (req->state == STATE_BODY && len - req->body_off >= req->content_length) {
+        req->state = STATE_DONE;
+    }
+
+    return req->state == STATE_DONE ? HTTP_PARSE_DONE : HTTP_PARSE_INCOMPLETE;
+}
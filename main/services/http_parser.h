@@ -0,0 +1,139 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_MAX_HEADERS 12       ///< Headers indexed per request, extras are skipped
+#define HTTP_MAX_METHOD_LEN 15    ///< Longest accepted request method
+
+/**
+ * @brief Parse outcome
+ */
+typedef enum {
+    HTTP_PARSE_INCOMPLETE = 0,    ///< Need more bytes
+    HTTP_PARSE_DONE,              ///< Request line, headers and body are complete
+    HTTP_PARSE_ERROR              ///< Malformed request
+} http_parse_result_t;
+
+/**
+ * @brief Location of a field inside the receive buffer
+ *
+ * Offsets rather than pointers keep the parser state small enough to live
+ * in the connection object and survive between recv() calls.
+ */
+typedef struct {
+    uint16_t off;
+    uint16_t len;
+} http_span_t;
+
+/**
+ * @brief Read-only view of a field, valid while the receive buffer is
+ */
+typedef struct {
+    const char *ptr;
+    size_t len;
+} http_view_t;
+
+typedef struct {
+    http_span_t name;
+    http_span_t value;
+} http_header_t;
+
+/**
+ * @brief Resumable request parser state
+ *
+ * Zero-initialized state is ready to parse. Each byte is examined once
+ * across all calls, and nothing is copied out of the buffer.
+ */
+typedef struct {
+    uint16_t pos;                          ///< Next byte to examine
+    uint16_t body_off;                     ///< Start of the body once headers are done
+    uint8_t state;                         ///< Internal state machine position
+    uint8_t header_count;                  ///< Headers indexed in @p headers
+    bool headers_truncated;                ///< More than HTTP_MAX_HEADERS were sent
+    uint32_t content_length;               ///< Value of Content-Length, 0 if absent
+    http_span_t method;
+    http_span_t target;
+    http_span_t version;
+    http_header_t headers[HTTP_MAX_HEADERS];
+} http_request_t;
+
+/**
+ * @brief Continue parsing a request
+ *
+ * @p buf must hold every byte of the request received so far, at the same
+ * address as in earlier calls; only bytes not seen before are examined.
+ *
+ * @param req Parser state
+ * @param buf Receive buffer
+ * @param len Bytes available in @p buf
+ * @return http_parse_result_t Parse outcome
+ */
+http_parse_result_t http_parser_execute(http_request_t *req, const char *buf, size_t len);
+
+/**
+ * @brief Check whether the request line and all headers have been parsed
+ *
+ * @param req Parser state
+ * @return true if only (part of) the body is outstanding or parsing is done
+ */
+bool http_parser_headers_complete(const http_request_t *req);
+
+/**
+ * @brief Resolve a span into a view of the buffer
+ *
+ * @param buf Receive buffer passed to http_parser_execute()
+ * @param span Span to resolve
+ * @return http_view_t View of the field
+ */
+http_view_t http_parser_view(const char *buf, http_span_t span);
+
+/**
+ * @brief Look up a header by name (case-insensitive)
+ *
+ * @param req Parser state
+ * @param buf Receive buffer passed to http_parser_execute()
+ * @param name Header name without the colon
+ * @return http_view_t Header value, empty view if absent
+ */
+http_view_t http_parser_header(const http_request_t *req, const char *buf, const char *name);
+
+/**
+ * @brief View of the body bytes received so far
+ *
+ * @param req Parser state
+ * @param buf Receive buffer passed to http_parser_execute()
+ * @param len Bytes available in @p buf
+ * @return http_view_t Body view, empty if headers are not complete
+ */
+http_view_t http_parser_body(const http_request_t *req, const char *buf, size_t len);
+
+/**
+ * @brief Compare a view with a NUL-terminated string
+ *
+ * @param view View to compare
+ * @param str String to compare with
+ * @return true if equal
+ */
+bool http_view_equals(http_view_t view, const char *str);
+
+/**
+ * @brief Search a view for a substring
+ *
+ * @param view View to search
+ * @param needle NUL-terminated substring
+ * @return true if found
+ */
+bool http_view_contains(http_view_t view, const char *needle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_PARSER_H
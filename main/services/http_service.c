@@ -9,7 +9,12 @@
  */
 
 #include "http_service.h"
+#include "http_parser.h"
+#include "service_registry.h"
 #include "logging/attack_logger.h"
+#include "logging/payload_store.h"
+#include "security/attack_signatures.h"
+#include "security/indicators.h"
 #include "utils/helpers.h"
 #include "utils/md5_hash.h"
 #include "esp_log.h"
@@ -19,212 +24,267 @@
 static const char *TAG = "http_service";
 
 // Fake admin panel HTML
-static const char *FAKE_LOGIN_HTML = 
-    "<!DOCTYPE html>\n"
-    "<html lang='en'>\n"
-    "<head>\n"
-    "    <meta charset='UTF-8'>\n"
-    "    <meta name='viewport' content='width=device-width, initial-scale=1.0'>\n"
-    "    <title>Router Admin Panel</title>\n"
-    "    <style>\n"
-    "        body { font-family: Arial, sans-serif; margin: 40px; }\n"
-    "        .container { max-width: 400px; margin: 0 auto; padding: 20px; border: 1px solid #ccc; }\n"
-    "        .error { color: red; margin-top: 10px; }\n"
-    "    </style>\n"
-    "</head>\n"
-    "<body>\n"
-    "    <div class='container'>\n"
-    "        <h2>Router Administration</h2>\n"
-    "        <div class='error'>Access Denied: Invalid credentials</div>\n"
-    "        <p>Please contact your network administrator.</p>\n"
-    "    </div>\n"
-    "</body>\n"
-    "</html>";
-
-static const char *HTTP_RESPONSE_TEMPLATE = 
-    "HTTP/1.1 %d %s\r\n"
-    "Content-Type: text/html\r\n"
-    "Content-Length: %d\r\n"
-    "Connection: close\r\n"
-    "Server: Apache/2.4.41 (Ubuntu)\r\n"
-    "\r\n"
-    "%s";
-
-void http_service_init(void)
+#define FAKE_LOGIN_HTML \
+    "<!DOCTYPE html>\n" \
+    "<html lang='en'>\n" \
+    "<head>\n" \
+    "    <meta charset='UTF-8'>\n" \
+    "    <meta name='viewport' content='width=device-width, initial-scale=1.0'>\n" \
+    "    <title>Router Admin Panel</title>\n" \
+    "    <style>\n" \
+    "        body { font-family: Arial, sans-serif; margin: 40px; }\n" \
+    "        .container { max-width: 400px; margin: 0 auto; padding: 20px; border: 1px solid #ccc; }\n" \
+    "        .error { color: red; margin-top: 10px; }\n" \
+    "    </style>\n" \
+    "</head>\n" \
+    "<body>\n" \
+    "    <div class='container'>\n" \
+    "        <h2>Router Administration</h2>\n" \
+    "        <div class='error'>Access Denied: Invalid credentials</div>\n" \
+    "        <p>Please contact your network administrator.</p>\n" \
+    "    </div>\n" \
+    "</body>\n" \
+    "</html>"
+
+#define ERROR_HTML "<html><body><h1>Error</h1><p>An error occurred.</p></body></html>"
+
+// Body lengths are spelled out so the whole response can be a literal;
+// the static asserts below catch an edit that forgets to update them
+#define FAKE_LOGIN_HTML_LEN 647
+#define ERROR_HTML_LEN 65
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+#define HTTP_CANNED_RESPONSE(status, body_len, body) \
+    "HTTP/1.1 " status "\r\n" \
+    "Content-Type: text/html\r\n" \
+    "Content-Length: " STRINGIFY(body_len) "\r\n" \
+    "Connection: close\r\n" \
+    "Server: Apache/2.4.41 (Ubuntu)\r\n" \
+    "\r\n" \
+    body
+
+_Static_assert(sizeof(FAKE_LOGIN_HTML) - 1 == FAKE_LOGIN_HTML_LEN, "FAKE_LOGIN_HTML_LEN is stale");
+_Static_assert(sizeof(ERROR_HTML) - 1 == ERROR_HTML_LEN, "ERROR_HTML_LEN is stale");
+
+// Fully rendered responses, kept in flash and sent without formatting
+static const char RESPONSE_LOGIN_FORBIDDEN[] =
+    HTTP_CANNED_RESPONSE("403 Forbidden", FAKE_LOGIN_HTML_LEN, FAKE_LOGIN_HTML);
+static const char RESPONSE_BAD_REQUEST[] =
+    HTTP_CANNED_RESPONSE("400 Bad Request", ERROR_HTML_LEN, ERROR_HTML);
+
+typedef enum {
+    HTTP_RESPONSE_LOGIN_FORBIDDEN = 0,
+    HTTP_RESPONSE_BAD_REQUEST,
+    HTTP_RESPONSE_COUNT
+} http_canned_response_t;
+
+_Static_assert(sizeof(http_request_t) <= CONNECTION_STATE_SIZE, "http_request_t must fit in service_state");
+
+static const struct {
+    const char *data;
+    size_t len;
+} CANNED_RESPONSES[HTTP_RESPONSE_COUNT] = {
+    [HTTP_RESPONSE_LOGIN_FORBIDDEN] = { RESPONSE_LOGIN_FORBIDDEN, sizeof(RESPONSE_LOGIN_FORBIDDEN) - 1 },
+    [HTTP_RESPONSE_BAD_REQUEST] = { RESPONSE_BAD_REQUEST, sizeof(RESPONSE_BAD_REQUEST) - 1 },
+};
+
+// Internal function prototypes
+static void send_canned_response(socket_conn_t *conn, http_canned_response_t response);
+static void log_http_attack(const socket_conn_t *conn, const http_request_t *req,
+                            const signature_matches_t *matches);
+static void copy_view(char *dst, size_t dst_size, http_view_t view);
+static void extract_credentials_from_post(http_view_t body, char *username, size_t username_size,
+                                          char *password, size_t password_size);
+static void copy_form_field(http_view_t body, const char *const *names, size_t name_count,
+                            char *dst, size_t dst_size);
+static bool find_form_field(http_view_t body, const char *name, http_view_t *value);
+static void url_decode(char *str);
+
+esp_err_t http_service_init(void)
 {
     ESP_LOGI(TAG, "HTTP service initialized");
+    return ESP_OK;
 }
 
-void http_service_handle_request(int sock_fd, const char *data, size_t len, 
-                                 const char *client_ip, uint16_t port)
+bool http_service_handle_request(socket_conn_t *conn, const char *data, size_t len)
 {
-    // Parse HTTP request
-    char method[16] = {0};
-    char path[128] = {0};
-    char user_agent[256] = {0};
-    char authorization[256] = {0};
-    
-    if (!parse_http_request(data, method, path, user_agent, authorization)) {
-        ESP_LOGW(TAG, "Invalid HTTP request from %s", client_ip);
-        send_error_response(sock_fd, 400, "Bad Request");
-        return;
-    }
-    
-    ESP_LOGI(TAG, "HTTP %s %s from %s (User-Agent: %s)", 
-             method, path, client_ip, user_agent);
-    
-    // Check for common attack paths
-    if (strstr(path, "/shell") || strstr(path, "/cmd") || 
-        strstr(path, "/exec") || strstr(path, "..")) {
-        ESP_LOGW(TAG, "Potential path traversal attack from %s: %s", client_ip, path);
+    http_request_t *req = (http_request_t *)conn->service_state;
+    const char *client_ip = conn->client_ip;
+
+    // Resume where the previous recv() left off
+    http_parse_result_t result = http_parser_execute(req, data, len);
+
+    if (result == HTTP_PARSE_INCOMPLETE) {
+        if (len < CONNECTION_RX_BUFFER_SIZE) {
+            return true;
+        }
+        // Buffer is full; answer if at least the headers made it in
+        result = http_parser_headers_complete(req) ? HTTP_PARSE_DONE : HTTP_PARSE_ERROR;
     }
-    
-    // Send fake response
-    send_fake_response(sock_fd);
-    
-    // Log the attack
-    log_http_attack(client_ip, port, method, path, user_agent, authorization, data, len);
-}
 
-static bool parse_http_request(const char *data, char *method, char *path, 
-                               char *user_agent, char *authorization)
-{
-    if (data == NULL || strlen(data) < 10) {
+    if (result == HTTP_PARSE_ERROR) {
+        ESP_LOGW(TAG, "Invalid HTTP request from %s", client_ip);
+        send_canned_response(conn, HTTP_RESPONSE_BAD_REQUEST);
         return false;
     }
-    
-    // Parse request line
-    sscanf(data, "%15s %127s", method, path);
-    
-    // Parse headers
-    const char *ptr = data;
-    while (*ptr && (ptr = strstr(ptr, "\r\n")) != NULL) {
-        ptr += 2; // Skip CRLF
-        
-        if (strncasecmp(ptr, "User-Agent:", 11) == 0) {
-            ptr += 11;
-            while (*ptr == ' ') ptr++;
-            const char *end = strstr(ptr, "\r\n");
-            if (end && (end - ptr) < 255) {
-                strncpy(user_agent, ptr, end - ptr);
-                user_agent[end - ptr] = '\0';
-            }
-        }
-        else if (strncasecmp(ptr, "Authorization:", 14) == 0) {
-            ptr += 14;
-            while (*ptr == ' ') ptr++;
-            const char *end = strstr(ptr, "\r\n");
-            if (end && (end - ptr) < 255) {
-                strncpy(authorization, ptr, end - ptr);
-                authorization[end - ptr] = '\0';
-            }
-        }
-        else if (*ptr == '\r' && *(ptr + 1) == '\n') {
-            break; // End of headers
-        }
+
+    http_view_t method = http_parser_view(data, req->method);
+    http_view_t path = http_parser_view(data, req->target);
+    http_view_t user_agent = http_parser_header(req, data, "User-Agent");
+
+    ESP_LOGI(TAG, "HTTP %.*s %.*s from %s (User-Agent: %.*s)",
+             (int)method.len, method.ptr, (int)path.len, path.ptr, client_ip,
+             (int)user_agent.len, user_agent.ptr);
+
+    // Match known exploits against path, headers and body in one pass
+    signature_matches_t matches;
+    attack_signatures_scan(data, len, &matches);
+    for (int i = 0; i < matches.count; i++) {
+        ESP_LOGW(TAG, "Signature %u (%s) matched from %s: %.*s",
+                 matches.ids[i], attack_signatures_name(matches.ids[i]),
+                 client_ip, (int)path.len, path.ptr);
     }
-    
-    return true;
-}
 
-static void send_fake_response(int sock_fd)
-{
-    char response[2048];
-    snprintf(response, sizeof(response), HTTP_RESPONSE_TEMPLATE,
-             403, "Forbidden", strlen(FAKE_LOGIN_HTML), FAKE_LOGIN_HTML);
-    
-    send(sock_fd, response, strlen(response), 0);
+    // Send fake response
+    send_canned_response(conn, HTTP_RESPONSE_LOGIN_FORBIDDEN);
+
+    // Log the attack
+    log_http_attack(conn, req, &matches);
+    return false;
 }
 
-static void send_error_response(int sock_fd, int code, const char *message)
+static void send_canned_response(socket_conn_t *conn, http_canned_response_t response)
 {
-    char response[512];
-    const char *body = "<html><body><h1>Error</h1><p>An error occurred.</p></body></html>";
-    
-    snprintf(response, sizeof(response), HTTP_RESPONSE_TEMPLATE,
-             code, message, strlen(body), body);
-    
-    send(sock_fd, response, strlen(response), 0);
+    // Single send straight from flash, no formatting or stack copy
+    socket_manager_send(conn, CANNED_RESPONSES[response].data, CANNED_RESPONSES[response].len);
 }
 
-static void log_http_attack(const char *client_ip, uint16_t port, 
-                            const char *method, const char *path,
-                            const char *user_agent, const char *authorization,
-                            const char *payload, size_t payload_len)
+static void log_http_attack(const socket_conn_t *conn, const http_request_t *req,
+                            const signature_matches_t *matches)
 {
-    attack_log_t log_entry = {0};
+    const char *data = conn->rx_buf;
+    http_view_t method = http_parser_view(data, req->method);
+    http_view_t path = http_parser_view(data, req->target);
+    http_view_t authorization = http_parser_header(req, data, "Authorization");
+    http_view_t body = http_parser_body(req, data, conn->rx_len);
+    attack_log_t log_entry;
     
-    log_entry.timestamp = time(NULL);
-    strncpy(log_entry.source_ip, client_ip, sizeof(log_entry.source_ip) - 1);
-    log_entry.target_port = port;
-    strcpy(log_entry.service, "HTTP");
+    service_registry_log_entry(&log_entry, conn, "HTTP");
     strncpy(log_entry.username, "N/A", sizeof(log_entry.username) - 1);
     strncpy(log_entry.password, "N/A", sizeof(log_entry.password) - 1);
-    strncpy(log_entry.user_agent, user_agent, sizeof(log_entry.user_agent) - 1);
+    copy_view(log_entry.user_agent, sizeof(log_entry.user_agent),
+              http_parser_header(req, data, "User-Agent"));
     
     // Extract credentials from Authorization header if present
-    if (authorization[0] != '\0') {
-        strncpy(log_entry.password, authorization, sizeof(log_entry.password) - 1);
+    if (authorization.len > 0) {
+        copy_view(log_entry.password, sizeof(log_entry.password), authorization);
+    }
+    
+    // Extract potential credentials from POST data, searching only the
+    // body bytes actually received
+    if (http_view_equals(method, "POST")) {
+        if (body.len > 0) {
+            extract_credentials_from_post(body, log_entry.username, sizeof(log_entry.username),
+                                          log_entry.password, sizeof(log_entry.password));
+        }
     }
     
-    // Extract potential credentials from POST data
-    if (strcmp(method, "POST") == 0) {
-        extract_credentials_from_post(payload, log_entry.username, log_entry.password);
+    // Digest of everything received on the connection
+    payload_hasher_hex(&conn->payload_hash, log_entry.payload_hash);
+    
+    // Dropper URLs and hosts from the target and body; headers like Host
+    // and Referer name the honeypot itself
+    indicator_set_t indicators;
+    indicators_init(&indicators);
+    indicators_scan(&indicators, path.ptr, path.len);
+    indicators_flush(&indicators);
+    indicators_scan(&indicators, body.ptr, body.len);
+    indicators_flush(&indicators);
+    strcpy(log_entry.indicators, indicators.text);
+    if (indicators.count > 0) {
+        ESP_LOGW(TAG, "Indicators from %s: %s", conn->client_ip, indicators.text);
     }
     
-    // Generate payload hash
-    generate_md5_hash((const uint8_t *)payload, 
-                     payload_len > 512 ? 512 : payload_len, 
-                     log_entry.payload_hash);
+    // Count repeats; the first sighting keeps a sample of the payload
+    payload_ref_t payload;
+    if (payload_store_observe(log_entry.payload_hash, (const uint8_t *)data, conn->rx_len,
+                              log_entry.timestamp, &payload) == ESP_OK) {
+        log_entry.payload_hits = payload.hits;
+        log_entry.payload_first_seen = payload.first_seen;
+    }
     
     // Additional metadata
+    char signature_ids[48];
+    attack_signatures_format_ids(matches, signature_ids, sizeof(signature_ids));
     snprintf(log_entry.metadata, sizeof(log_entry.metadata),
-             "Method: %s, Path: %s", method, path);
+             "Sigs: %s, Method: %.*s, Path: %.*s",
+             matches->count > 0 ? signature_ids : "none",
+             (int)method.len, method.ptr, (int)path.len, path.ptr);
     
     attack_logger_log(&log_entry);
+    service_registry_count_attack(conn->port);
 }
 
-static void extract_credentials_from_post(const char *data, char *username, char *password)
+static void copy_view(char *dst, size_t dst_size, http_view_t view)
+{
+    size_t n = view.len < dst_size - 1 ? view.len : dst_size - 1;
+    memcpy(dst, view.ptr, n);
+    dst[n] = '\0';
+}
+
+static void extract_credentials_from_post(http_view_t body, char *username, size_t username_size,
+                                          char *password, size_t password_size)
 {
     // Look for common POST field names
-    const char *patterns[] = {
-        "username=", "user=", "login=", "uname=",
-        "password=", "pass=", "pwd=", "passwd="
-    };
+    static const char *const USERNAME_FIELDS[] = { "username=", "user=", "login=", "uname=" };
+    static const char *const PASSWORD_FIELDS[] = { "password=", "pass=", "pwd=", "passwd=" };
     
-    for (int i = 0; i < 4; i++) { // username patterns
-        const char *found = strstr(data, patterns[i]);
-        if (found) {
-            const char *start = found + strlen(patterns[i]);
-            const char *end = strchr(start, '&');
-            if (!end) end = strchr(start, ' ');
-            if (!end) end = start + strlen(start);
-            
-            size_t len = end - start;
-            if (len < sizeof(username) - 1) {
-                strncpy(username, start, len);
-                username[len] = '\0';
-                url_decode(username);
-            }
+    copy_form_field(body, USERNAME_FIELDS, sizeof(USERNAME_FIELDS) / sizeof(USERNAME_FIELDS[0]),
+                    username, username_size);
+    copy_form_field(body, PASSWORD_FIELDS, sizeof(PASSWORD_FIELDS) / sizeof(PASSWORD_FIELDS[0]),
+                    password, password_size);
+}
+
+static void copy_form_field(http_view_t body, const char *const *names, size_t name_count,
+                            char *dst, size_t dst_size)
+{
+    // Later names win; a value too long for the field is left out
+    for (size_t i = 0; i < name_count; i++) {
+        http_view_t value;
+        if (find_form_field(body, names[i], &value) && value.len < dst_size - 1) {
+            copy_view(dst, dst_size, value);
+            url_decode(dst);
         }
     }
+}
+
+static bool find_form_field(http_view_t body, const char *name, http_view_t *value)
+{
+    size_t name_len = strlen(name);
+    const char *end = body.ptr + body.len;
+    const char *p = body.ptr;
     
-    for (int i = 4; i < 8; i++) { // password patterns
-        const char *found = strstr(data, patterns[i]);
-        if (found) {
-            const char *start = found + strlen(patterns[i]);
-            const char *end = strchr(start, '&');
-            if (!end) end = strchr(start, ' ');
-            if (!end) end = start + strlen(start);
-            
-            size_t len = end - start;
-            if (len < sizeof(password) - 1) {
-                strncpy(password, start, len);
-                password[len] = '\0';
-                url_decode(password);
+    // The body is not NUL-terminated, so every search stays within its span
+    while ((size_t)(end - p) >= name_len) {
+        const char *hit = memchr(p, name[0], (size_t)(end - p) - name_len + 1);
+        if (hit == NULL) {
+            return false;
+        }
+        if (memcmp(hit, name, name_len) == 0) {
+            const char *start = hit + name_len;
+            const char *stop = start;
+            while (stop < end && *stop != '&' && *stop != ' ') {
+                stop++;
             }
+            value->ptr = start;
+            value->len = (size_t)(stop - start);
+            return true;
         }
+        p = hit + 1;
     }
+    return false;
 }
 
 static void url_decode(char *str)
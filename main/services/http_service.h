@@ -0,0 +1,33 @@
+#ifndef HTTP_SERVICE_H
+#define HTTP_SERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "networking/socket_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the HTTP service emulation
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t http_service_init(void);
+
+/**
+ * @brief Handle data received on a HTTP connection
+ * 
+ * @param conn Connection the data arrived on
+ * @param data Received bytes (NUL-terminated)
+ * @param len Number of bytes received
+ * @return true to keep the connection open for more data
+ */
+bool http_service_handle_request(socket_conn_t *conn, const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_SERVICE_H
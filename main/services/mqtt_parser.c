@@ -0,0 +1,287 @@
+/*
+ * MQTT Packet Parser
+ *
+ * Resumable, non-allocating decoder for the MQTT fixed header and the
+ * CONNECT packet. The fixed header is read a byte at a time across
+ * recv() calls, so the remaining-length varint may be split anywhere, and
+ * an oversize packet is refused as soon as its length is known. CONNECT
+ * fields are returned as spans of the receive buffer, never copied.
+ */
+
+#include "mqtt_parser.h"
+#include <string.h>
+
+typedef enum {
+    STATE_TYPE = 0,
+    STATE_LENGTH,
+    STATE_BODY,
+    STATE_ERROR,
+    STATE_TOO_LARGE
+} parser_state_t;
+
+#define VARINT_MAX_BYTES 4
+#define CONNECT_RESERVED 0x01
+#define CONNECT_CLEAN_SESSION 0x02
+#define CONNECT_WILL_BITS 0x38        // Will QoS and retain
+#define V31_CLIENT_ID_MAX 23
+#define PROTOCOL_NAME_MAX 6          // "MQIsdp"
+#define NO_CODE 0xFF
+
+// CONNACK codes per outcome: 3.x return codes and MQTT 5 reason codes
+static const uint8_t RETURN_CODES[] = {
+    [MQTT_CONNACK_ACCEPTED] = 0x00,
+    [MQTT_CONNACK_BAD_VERSION] = 0x01,
+    [MQTT_CONNACK_BAD_CLIENT_ID] = 0x02,
+    [MQTT_CONNACK_BAD_CREDENTIALS] = 0x04,
+    [MQTT_CONNACK_NOT_AUTHORIZED] = 0x05,
+    [MQTT_CONNACK_MALFORMED] = NO_CODE,
+    [MQTT_CONNACK_TOO_LARGE] = NO_CODE,
+};
+
+static const uint8_t REASON_CODES[] = {
+    [MQTT_CONNACK_ACCEPTED] = 0x00,
+    [MQTT_CONNACK_BAD_VERSION] = 0x84,
+    [MQTT_CONNACK_BAD_CLIENT_ID] = 0x85,
+    [MQTT_CONNACK_BAD_CREDENTIALS] = 0x86,
+    [MQTT_CONNACK_NOT_AUTHORIZED] = 0x87,
+    [MQTT_CONNACK_MALFORMED] = 0x81,
+    [MQTT_CONNACK_TOO_LARGE] = 0x95,
+};
+
+// Bounded cursor over the packet body; running past the end latches an error
+typedef struct {
+    const uint8_t *buf;
+    size_t pos;
+    size_t end;
+    bool error;
+} reader_t;
+
+// Internal function prototypes
+static size_t body_offset(const mqtt_parser_t *parser);
+static uint8_t read_u8(reader_t *r);
+static uint16_t read_u16(reader_t *r);
+static mqtt_span_t read_field(reader_t *r);
+static void skip_properties(reader_t *r);
+
+mqtt_parse_result_t mqtt_parser_execute(mqtt_parser_t *parser, const uint8_t *buf, size_t len)
+{
+    while (parser->state < STATE_BODY && parser->pos < len) {
+        uint8_t c = buf[parser->pos++];
+
+        if (parser->state == STATE_TYPE) {
+            parser->header = c;
+            parser->state = STATE_LENGTH;
+            continue;
+        }
+
+        // 7 bits per byte, least significant first. A zero after the first
+        // byte means the length was not minimally encoded.
+        if (parser->length_bytes > 0 && c == 0) {
+            parser->state = STATE_ERROR;
+            break;
+        }
+        parser->remaining |= (uint32_t)(c & 0x7F) << (7 * parser->length_bytes);
+        parser->length_bytes++;
+
+        if (1 + parser->length_bytes + parser->remaining > MQTT_MAX_PACKET_SIZE) {
+            parser->state = STATE_TOO_LARGE;
+        } else if (!(c & 0x80)) {
+            parser->state = STATE_BODY;
+        } else if (parser->length_bytes == VARINT_MAX_BYTES) {
+            parser->state = STATE_ERROR;
+        }
+    }
+
+    switch (parser->state) {
+        case STATE_BODY:
+            return len >= body_offset(parser) + parser->remaining ? MQTT_PARSE_DONE : MQTT_PARSE_INCOMPLETE;
+        case STATE_ERROR:
+            return MQTT_PARSE_ERROR;
+        case STATE_TOO_LARGE:
+            return MQTT_PARSE_TOO_LARGE;
+        default:
+            return MQTT_PARSE_INCOMPLETE;
+    }
+}
+
+uint8_t mqtt_parser_packet_type(const mqtt_parser_t *parser)
+{
+    return parser->header >> 4;
+}
+
+bool mqtt_parser_peek_level(const mqtt_parser_t *parser, const uint8_t *buf, size_t len,
+                            uint8_t *level)
+{
+    size_t off = body_offset(parser);
+
+    *level = 0;
+
+    // A packet refused mid-length has no known body offset
+    if (parser->state < STATE_BODY || mqtt_parser_packet_type(parser) != MQTT_PACKET_CONNECT ||
+        (buf[off - 1] & 0x80)) {
+        return true;
+    }
+    if (len < off + 2) {
+        return false;
+    }
+
+    // The level follows the protocol name, "MQTT" or "MQIsdp"; any longer
+    // name is not MQTT and has no level worth waiting for
+    size_t name_len = (size_t)buf[off] << 8 | buf[off + 1];
+    if (name_len > PROTOCOL_NAME_MAX) {
+        return true;
+    }
+    if (len <= off + 2 + name_len) {
+        return false;
+    }
+    *level = buf[off + 2 + name_len];
+    return true;
+}
+
+mqtt_connack_code_t mqtt_parser_decode_connect(const mqtt_parser_t *parser, const uint8_t *buf,
+                                               mqtt_connect_t *connect)
+{
+    size_t off = body_offset(parser);
+    reader_t r = { buf, off, off + parser->remaining, false };
+
+    memset(connect, 0, sizeof(*connect));
+
+    mqtt_span_t name = read_field(&r);
+    connect->level = read_u8(&r);
+    connect->flags = read_u8(&r);
+    connect->keepalive = read_u16(&r);
+    if (r.error) {
+        return MQTT_CONNACK_MALFORMED;
+    }
+
+    bool v31 = name.len == 6 && memcmp(buf + name.off, "MQIsdp", 6) == 0;
+    bool v3x = name.len == 4 && memcmp(buf + name.off, "MQTT", 4) == 0;
+    if (!v31 && !v3x) {
+        return MQTT_CONNACK_MALFORMED;
+    }
+    if ((v31 && connect->level != MQTT_LEVEL_3_1) ||
+        (v3x && connect->level != MQTT_LEVEL_3_1_1 && connect->level != MQTT_LEVEL_5)) {
+        return MQTT_CONNACK_BAD_VERSION;
+    }
+
+    uint8_t flags = connect->flags;
+    bool v5 = connect->level == MQTT_LEVEL_5;
+    if ((flags & CONNECT_RESERVED) ||
+        ((flags >> 3) & 0x03) == 0x03 ||
+        (!(flags & MQTT_CONNECT_WILL) && (flags & CONNECT_WILL_BITS)) ||
+        (!v5 && (flags & MQTT_CONNECT_PASSWORD) && !(flags & MQTT_CONNECT_USERNAME))) {
+        return MQTT_CONNACK_MALFORMED;
+    }
+
+    // Payload fields come in a fixed order, each present only if flagged
+    if (v5) {
+        skip_properties(&r);
+    }
+    connect->client_id = read_field(&r);
+    if (flags & MQTT_CONNECT_WILL) {
+        if (v5) {
+            skip_properties(&r);
+        }
+        connect->will_topic = read_field(&r);
+        read_field(&r);
+    }
+    if (flags & MQTT_CONNECT_USERNAME) {
+        connect->username = read_field(&r);
+    }
+    if (flags & MQTT_CONNECT_PASSWORD) {
+        connect->password = read_field(&r);
+    }
+    if (r.error || r.pos != r.end) {
+        return MQTT_CONNACK_MALFORMED;
+    }
+
+    // 3.1 wants 1 to 23 characters; 3.1.1 allows an empty ID for clean sessions
+    if (connect->level == MQTT_LEVEL_3_1 &&
+        (connect->client_id.len == 0 || connect->client_id.len > V31_CLIENT_ID_MAX)) {
+        return MQTT_CONNACK_BAD_CLIENT_ID;
+    }
+    if (connect->level == MQTT_LEVEL_3_1_1 && connect->client_id.len == 0 &&
+        !(flags & CONNECT_CLEAN_SESSION)) {
+        return MQTT_CONNACK_BAD_CLIENT_ID;
+    }
+    return MQTT_CONNACK_ACCEPTED;
+}
+
+size_t mqtt_connack_encode(uint8_t level, mqtt_connack_code_t code, uint8_t *out)
+{
+    if (level == MQTT_LEVEL_5) {
+        // Flags, reason code and an empty property list
+        out[0] = MQTT_PACKET_CONNACK << 4;
+        out[1] = 3;
+        out[2] = 0;
+        out[3] = REASON_CODES[code];
+        out[4] = 0;
+        return 5;
+    }
+
+    if (RETURN_CODES[code] == NO_CODE) {
+        return 0;
+    }
+    out[0] = MQTT_PACKET_CONNACK << 4;
+    out[1] = 2;
+    out[2] = 0;
+    out[3] = RETURN_CODES[code];
+    return 4;
+}
+
+static size_t body_offset(const mqtt_parser_t *parser)
+{
+    return 1 + (size_t)parser->length_bytes;
+}
+
+static uint8_t read_u8(reader_t *r)
+{
+    if (r->error || r->pos >= r->end) {
+        r->error = true;
+        return 0;
+    }
+    return r->buf[r->pos++];
+}
+
+static uint16_t read_u16(reader_t *r)
+{
+    uint16_t high = read_u8(r);
+    return (uint16_t)(high << 8 | read_u8(r));
+}
+
+static mqtt_span_t read_field(reader_t *r)
+{
+    mqtt_span_t span = { 0, 0 };
+    uint16_t len = read_u16(r);
+
+    if (r->error || len > r->end - r->pos) {
+        r->error = true;
+        return span;
+    }
+    span.off = (uint16_t)r->pos;
+    span.len = len;
+    r->pos += len;
+    return span;
+}
+
+static void skip_properties(reader_t *r)
+{
+    uint32_t len = 0;
+
+    for (int i = 0; i < VARINT_MAX_BYTES; i++) {
+        uint8_t c = read_u8(r);
+        len |= (uint32_t)(c & 0x7F) << (7 * i);
+        if (!(c & 0x80)) {
+            break;
+        }
+        if (i == VARINT_MAX_BYTES - 1) {
+            r->error = true;
+        }
+    }
+
+    if (r->error || len > r->end - r->pos) {
+        r->error = true;
+        return;
+    }
+    r->pos += len;
+}
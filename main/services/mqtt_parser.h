@@ -0,0 +1,156 @@
+#ifndef MQTT_PARSER_H
+#define MQTT_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_MAX_PACKET_SIZE 1024     ///< Larger packets are rejected from their fixed header
+#define MQTT_CONNACK_MAX_SIZE 5       ///< Longest CONNACK built by mqtt_connack_encode()
+
+#define MQTT_PACKET_CONNECT 1         ///< CONNECT control packet type
+#define MQTT_PACKET_CONNACK 2         ///< CONNACK control packet type
+
+#define MQTT_LEVEL_3_1 3              ///< Protocol level of MQTT 3.1 ("MQIsdp")
+#define MQTT_LEVEL_3_1_1 4            ///< Protocol level of MQTT 3.1.1
+#define MQTT_LEVEL_5 5                ///< Protocol level of MQTT 5.0
+
+#define MQTT_CONNECT_WILL 0x04        ///< Connect flag: will topic and payload present
+#define MQTT_CONNECT_PASSWORD 0x40    ///< Connect flag: password present
+#define MQTT_CONNECT_USERNAME 0x80    ///< Connect flag: username present
+
+/**
+ * @brief Fixed header parse outcome
+ */
+typedef enum {
+    MQTT_PARSE_INCOMPLETE = 0,    ///< Need more bytes
+    MQTT_PARSE_DONE,              ///< Whole packet received
+    MQTT_PARSE_ERROR,             ///< Malformed remaining length
+    MQTT_PARSE_TOO_LARGE          ///< Packet exceeds MQTT_MAX_PACKET_SIZE
+} mqtt_parse_result_t;
+
+/**
+ * @brief CONNACK outcome, independent of the protocol version
+ */
+typedef enum {
+    MQTT_CONNACK_ACCEPTED = 0,
+    MQTT_CONNACK_BAD_VERSION,     ///< Unsupported protocol level
+    MQTT_CONNACK_BAD_CLIENT_ID,   ///< Client identifier not allowed
+    MQTT_CONNACK_BAD_CREDENTIALS, ///< Bad username or password
+    MQTT_CONNACK_NOT_AUTHORIZED,
+    MQTT_CONNACK_MALFORMED,       ///< Malformed packet, MQTT 5 only
+    MQTT_CONNACK_TOO_LARGE        ///< Packet too large, MQTT 5 only
+} mqtt_connack_code_t;
+
+/**
+ * @brief Location of a field inside the receive buffer
+ */
+typedef struct {
+    uint16_t off;
+    uint16_t len;
+} mqtt_span_t;
+
+/**
+ * @brief Resumable fixed header parser state
+ *
+ * Zero-initialized state is ready to parse one packet. Only the fixed
+ * header is read byte by byte; the body is left in the buffer until the
+ * whole packet is there.
+ */
+typedef struct {
+    uint16_t pos;                          ///< Next byte to examine
+    uint8_t state;                         ///< Internal state machine position
+    uint8_t header;                        ///< First byte: packet type and flags
+    uint8_t length_bytes;                  ///< Remaining length bytes read so far
+    uint32_t remaining;                    ///< Remaining length decoded so far
+} mqtt_parser_t;
+
+/**
+ * @brief Fields of a CONNECT packet
+ *
+ * Spans point into the receive buffer; absent fields are empty.
+ */
+typedef struct {
+    uint8_t level;                         ///< Protocol level, MQTT_LEVEL_*
+    uint8_t flags;                         ///< Connect flags, MQTT_CONNECT_*
+    uint16_t keepalive;                    ///< Keep alive interval, seconds
+    mqtt_span_t client_id;
+    mqtt_span_t will_topic;
+    mqtt_span_t username;
+    mqtt_span_t password;                  ///< Binary, not NUL-terminated
+} mqtt_connect_t;
+
+/**
+ * @brief Continue parsing a packet
+ *
+ * @p buf must hold every byte of the packet received so far, at the same
+ * address as in earlier calls. The size check happens as soon as the
+ * remaining length is known, before the body has arrived.
+ *
+ * @param parser Parser state
+ * @param buf Receive buffer
+ * @param len Bytes available in @p buf
+ * @return mqtt_parse_result_t Parse outcome
+ */
+mqtt_parse_result_t mqtt_parser_execute(mqtt_parser_t *parser, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Control packet type of the packet being parsed
+ *
+ * @param parser Parser state, past the first byte
+ * @return uint8_t Packet type, MQTT_PACKET_*
+ */
+uint8_t mqtt_parser_packet_type(const mqtt_parser_t *parser);
+
+/**
+ * @brief Protocol level of a CONNECT whose body is still incomplete
+ *
+ * The level sits at most a few bytes into the body, so a caller refusing
+ * the packet can wait for it and answer the same way however the bytes
+ * were split across recv() calls.
+ *
+ * @param parser Parser state, past the fixed header
+ * @param buf Receive buffer passed to mqtt_parser_execute()
+ * @param len Bytes available in @p buf
+ * @param[out] level Protocol level, 0 if the packet is not a CONNECT or
+ *             does not name an MQTT protocol
+ * @return true once @p level is final, false if more bytes are needed
+ */
+bool mqtt_parser_peek_level(const mqtt_parser_t *parser, const uint8_t *buf, size_t len,
+                            uint8_t *level);
+
+/**
+ * @brief Decode a complete CONNECT packet
+ *
+ * Accepts MQTT 3.1, 3.1.1 and 5.0. MQTT 5 properties are skipped.
+ * Nothing is copied; @p connect refers to @p buf.
+ *
+ * @param parser Parser state that returned MQTT_PARSE_DONE
+ * @param buf Receive buffer passed to mqtt_parser_execute()
+ * @param connect Receives the fields
+ * @return mqtt_connack_code_t MQTT_CONNACK_ACCEPTED if the packet is valid,
+ *         otherwise the reason to refuse it
+ */
+mqtt_connack_code_t mqtt_parser_decode_connect(const mqtt_parser_t *parser, const uint8_t *buf,
+                                               mqtt_connect_t *connect);
+
+/**
+ * @brief Build the CONNACK for an outcome in a client's protocol version
+ *
+ * @param level Client protocol level, 0 if unknown
+ * @param code Outcome
+ * @param out Receives up to MQTT_CONNACK_MAX_SIZE bytes
+ * @return size_t CONNACK length, 0 if this version has no code for
+ *         @p code and the connection should just be closed
+ */
+size_t mqtt_connack_encode(uint8_t level, mqtt_connack_code_t code, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_PARSER_H
@@ -0,0 +1,169 @@
+/*
+ * MQTT Service - CONNECT capture
+ *
+ * Open brokers on 1883 are probed with a bare CONNECT and brute-forced
+ * with credentials. The first packet of a connection is decoded in place
+ * as it arrives; client ID, credentials, will topic and keepalive are
+ * logged, and the client is refused with the CONNACK code its protocol
+ * version expects: bad username or password if it sent credentials, not
+ * authorized otherwise, or the protocol error it made.
+ */
+
+#include "mqtt_service.h"
+#include "mqtt_parser.h"
+#include "service_registry.h"
+#include "logging/attack_logger.h"
+#include "logging/payload_store.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "mqtt_service";
+
+_Static_assert(sizeof(mqtt_parser_t) <= CONNECTION_STATE_SIZE, "mqtt_parser_t must fit in service_state");
+_Static_assert(MQTT_MAX_PACKET_SIZE <= CONNECTION_RX_BUFFER_SIZE, "An accepted packet must fit the receive buffer");
+
+static const char *const OUTCOME_NAMES[] = {
+    [MQTT_CONNACK_ACCEPTED] = "accepted",
+    [MQTT_CONNACK_BAD_VERSION] = "bad version",
+    [MQTT_CONNACK_BAD_CLIENT_ID] = "bad client id",
+    [MQTT_CONNACK_BAD_CREDENTIALS] = "bad credentials",
+    [MQTT_CONNACK_NOT_AUTHORIZED] = "not authorized",
+    [MQTT_CONNACK_MALFORMED] = "malformed",
+    [MQTT_CONNACK_TOO_LARGE] = "too large",
+};
+
+// Internal function prototypes
+static void send_connack(socket_conn_t *conn, uint8_t level, mqtt_connack_code_t code);
+static void log_connect(const socket_conn_t *conn, const mqtt_parser_t *parser,
+                        const mqtt_connect_t *connect, mqtt_connack_code_t code);
+static const char *level_name(uint8_t level);
+static void copy_span(char *dst, size_t dst_size, const char *buf, mqtt_span_t span);
+
+esp_err_t mqtt_service_init(void)
+{
+    ESP_LOGI(TAG, "MQTT service initialized");
+    return ESP_OK;
+}
+
+bool mqtt_service_handle_request(socket_conn_t *conn, const char *data, size_t len)
+{
+    mqtt_parser_t *parser = (mqtt_parser_t *)conn->service_state;
+    const uint8_t *buf = (const uint8_t *)data;
+    mqtt_connect_t connect;
+    mqtt_connack_code_t code;
+
+    // Resume where the previous recv() left off
+    mqtt_parse_result_t result = mqtt_parser_execute(parser, buf, len);
+
+    if (result == MQTT_PARSE_INCOMPLETE) {
+        return true;
+    }
+
+    if (result == MQTT_PARSE_ERROR) {
+        ESP_LOGW(TAG, "Malformed MQTT packet length from %s", conn->client_ip);
+        return false;
+    }
+
+    // A client must open with CONNECT; anything else is dropped unanswered
+    if (mqtt_parser_packet_type(parser) != MQTT_PACKET_CONNECT) {
+        ESP_LOGW(TAG, "MQTT packet type %u before CONNECT from %s",
+                 mqtt_parser_packet_type(parser), conn->client_ip);
+        return false;
+    }
+
+    if (result == MQTT_PARSE_TOO_LARGE) {
+        // Refused from its fixed header; wait for the protocol level so the
+        // answer is MQTT 5 whenever the client is, however it was split
+        memset(&connect, 0, sizeof(connect));
+        if (!mqtt_parser_peek_level(parser, buf, len, &connect.level)) {
+            return true;
+        }
+        code = MQTT_CONNACK_TOO_LARGE;
+    } else {
+        code = mqtt_parser_decode_connect(parser, buf, &connect);
+        if (code == MQTT_CONNACK_ACCEPTED) {
+            code = connect.flags & (MQTT_CONNECT_USERNAME | MQTT_CONNECT_PASSWORD) ?
+                   MQTT_CONNACK_BAD_CREDENTIALS : MQTT_CONNACK_NOT_AUTHORIZED;
+        }
+    }
+
+    send_connack(conn, connect.level, code);
+    log_connect(conn, parser, &connect, code);
+    return false;
+}
+
+static void send_connack(socket_conn_t *conn, uint8_t level, mqtt_connack_code_t code)
+{
+    uint8_t connack[MQTT_CONNACK_MAX_SIZE];
+    size_t len = mqtt_connack_encode(level, code, connack);
+
+    // Before MQTT 5 a malformed CONNECT just gets the connection closed
+    if (len > 0) {
+        socket_manager_send(conn, connack, len);
+    }
+}
+
+static void log_connect(const socket_conn_t *conn, const mqtt_parser_t *parser,
+                        const mqtt_connect_t *connect, mqtt_connack_code_t code)
+{
+    const char *data = conn->rx_buf;
+    attack_log_t log_entry;
+    char will_topic[48];
+
+    service_registry_log_entry(&log_entry, conn, "MQTT");
+    strcpy(log_entry.username, "N/A");
+    strcpy(log_entry.password, "N/A");
+    if (connect->flags & MQTT_CONNECT_USERNAME) {
+        copy_span(log_entry.username, sizeof(log_entry.username), data, connect->username);
+    }
+    if (connect->flags & MQTT_CONNECT_PASSWORD) {
+        copy_span(log_entry.password, sizeof(log_entry.password), data, connect->password);
+    }
+
+    // The client ID is what identifies the client software
+    copy_span(log_entry.user_agent, sizeof(log_entry.user_agent), data, connect->client_id);
+    copy_span(will_topic, sizeof(will_topic), data, connect->will_topic);
+
+    // Digest of everything received; the first sighting keeps the packet
+    payload_hasher_hex(&conn->payload_hash, log_entry.payload_hash);
+    payload_ref_t payload;
+    if (payload_store_observe(log_entry.payload_hash, (const uint8_t *)data, conn->rx_len,
+                              log_entry.timestamp, &payload) == ESP_OK) {
+        log_entry.payload_hits = payload.hits;
+        log_entry.payload_first_seen = payload.first_seen;
+    }
+
+    snprintf(log_entry.metadata, sizeof(log_entry.metadata),
+             "MQTT %s, keepalive %u, will: %s, CONNACK %s (%lu bytes)",
+             level_name(connect->level), (unsigned)connect->keepalive,
+             will_topic[0] != '\0' ? will_topic : "none", OUTCOME_NAMES[code],
+             (unsigned long)(1 + parser->length_bytes + parser->remaining));
+
+    ESP_LOGI(TAG, "MQTT CONNECT from %s: client %s, %s / %s (%s)", conn->client_ip,
+             log_entry.user_agent, log_entry.username, log_entry.password, OUTCOME_NAMES[code]);
+
+    attack_logger_log(&log_entry);
+    service_registry_count_attack(conn->port);
+}
+
+static const char *level_name(uint8_t level)
+{
+    switch (level) {
+        case MQTT_LEVEL_3_1:
+            return "3.1";
+        case MQTT_LEVEL_3_1_1:
+            return "3.1.1";
+        case MQTT_LEVEL_5:
+            return "5.0";
+        default:
+            return "unknown";
+    }
+}
+
+static void copy_span(char *dst, size_t dst_size, const char *buf, mqtt_span_t span)
+{
+    size_t n = span.len < dst_size - 1 ? span.len : dst_size - 1;
+    memcpy(dst, buf + span.off, n);
+    dst[n] = '\0';
+}
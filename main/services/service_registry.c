@@ -0,0 +1,207 @@
+/*
+ * Service Registry - Emulated services and the ports they own
+ *
+ * Every emulated service is one descriptor in the table below. The core
+ * never names a service: listeners, dispatch and per-service counters are
+ * all derived from this table, so a new service only needs its own files
+ * and a line here.
+ *
+ * Ports map to service ids through a small open-addressed table built at
+ * init. With a handful of ports in 16 slots a lookup is one multiply and
+ * almost always a single probe, and the id doubles as the metrics slot.
+ */
+
+#include "service_registry.h"
+#include "http_service.h"
+#include "telnet_service.h"
+#include "ftp_service.h"
+#include "mqtt_service.h"
+#include "esp_log.h"
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "service_registry";
+
+#define PORT_TABLE_BITS 4
+#define PORT_TABLE_SIZE (1u << PORT_TABLE_BITS)
+
+static const service_descriptor_t services[] = {
+    {
+        .name = "http",
+        .init = http_service_init,
+        .handler = http_service_handle_request,
+        .ports = {80, 8080}
+    },
+    {
+        .name = "telnet",
+        .init = telnet_service_init,
+        .handler = telnet_service_handle_request,
+        .on_connect = telnet_service_on_connect,
+        .ports = {23, 2323}
+    },
+    {
+        .name = "ftp",
+        .init = ftp_service_init,
+        .handler = ftp_service_handle_request,
+        .on_connect = ftp_service_on_connect,
+        .on_close = ftp_service_on_close,
+        .ports = {21, FTP_PASV_PORT}
+    },
+    {
+        .name = "mqtt",
+        .init = mqtt_service_init,
+        .handler = mqtt_service_handle_request,
+        .ports = {1883}
+    },
+};
+
+#define SERVICE_COUNT (sizeof(services) / sizeof(services[0]))
+
+_Static_assert(SERVICE_COUNT <= SERVICE_REGISTRY_MAX, "more services than metrics slots");
+_Static_assert(SERVICE_COUNT * SERVICE_MAX_PORTS <= PORT_TABLE_SIZE / 2,
+               "port table must stay at most half full");
+
+typedef struct {
+    uint16_t port;                          ///< 0 while the slot is empty
+    uint8_t id;
+} port_entry_t;
+
+static port_entry_t port_table[PORT_TABLE_SIZE];
+
+// Internal function prototypes
+static uint32_t port_slot(uint16_t port);
+static esp_err_t insert_port(uint16_t port, uint8_t id);
+
+esp_err_t service_registry_init(void)
+{
+    memset(port_table, 0, sizeof(port_table));
+
+    for (uint8_t id = 0; id < SERVICE_COUNT; id++) {
+        for (int i = 0; i < SERVICE_MAX_PORTS && services[id].ports[i] != 0; i++) {
+            esp_err_t err = insert_port(services[id].ports[i], id);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+
+    for (uint8_t id = 0; id < SERVICE_COUNT; id++) {
+        if (services[id].init == NULL) {
+            continue;
+        }
+        esp_err_t err = services[id].init();
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Service %s failed to initialize: %s", services[id].name,
+                     esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    ESP_LOGI(TAG, "%u services registered", (unsigned)SERVICE_COUNT);
+    return ESP_OK;
+}
+
+uint8_t service_registry_count(void)
+{
+    return SERVICE_COUNT;
+}
+
+const service_descriptor_t *service_registry_get(uint8_t id)
+{
+    return id < SERVICE_COUNT ? &services[id] : NULL;
+}
+
+uint8_t service_registry_lookup(uint16_t port)
+{
+    if (port == 0) {
+        return SERVICE_ID_NONE;
+    }
+
+    // The table is never more than half full, so an empty slot ends every probe
+    for (uint32_t slot = port_slot(port); ; slot = (slot + 1) & (PORT_TABLE_SIZE - 1)) {
+        if (port_table[slot].port == port) {
+            return port_table[slot].id;
+        }
+        if (port_table[slot].port == 0) {
+            return SERVICE_ID_NONE;
+        }
+    }
+}
+
+uint8_t service_registry_default_ports(uint16_t *ports, uint8_t max_ports)
+{
+    uint8_t count = 0;
+
+    for (uint8_t id = 0; id < SERVICE_COUNT; id++) {
+        for (int i = 0; i < SERVICE_MAX_PORTS && services[id].ports[i] != 0; i++) {
+            if (count == max_ports) {
+                ESP_LOGW(TAG, "No room to listen on port %u", services[id].ports[i]);
+                continue;
+            }
+            ports[count++] = services[id].ports[i];
+        }
+    }
+    return count;
+}
+
+void service_registry_on_connect(socket_conn_t *conn)
+{
+    uint8_t id = service_registry_lookup(conn->port);
+
+    metrics_count_service(id, METRIC_SERVICE_CONNECTIONS);
+    if (id != SERVICE_ID_NONE && services[id].on_connect != NULL) {
+        services[id].on_connect(conn);
+    }
+}
+
+void service_registry_on_close(socket_conn_t *conn)
+{
+    uint8_t id = service_registry_lookup(conn->port);
+
+    if (id != SERVICE_ID_NONE && services[id].on_close != NULL) {
+        services[id].on_close(conn);
+    }
+}
+
+void service_registry_count_attack(uint16_t port)
+{
+    metrics_count(METRIC_ATTACKS_LOGGED);
+    metrics_count_service(service_registry_lookup(port), METRIC_SERVICE_ATTACKS);
+}
+
+void service_registry_log_entry(attack_log_t *log_entry, const socket_conn_t *conn,
+                                const char *service)
+{
+    _Static_assert(sizeof(log_entry->source_ip) == sizeof(conn->client_ip),
+                   "source_ip must hold client_ip as is");
+
+    memset(log_entry, 0, sizeof(*log_entry));
+    log_entry->timestamp = time(NULL);
+    memcpy(log_entry->source_ip, conn->client_ip, sizeof(log_entry->source_ip));
+    log_entry->target_port = conn->port;
+    strncpy(log_entry->service, service, sizeof(log_entry->service) - 1);
+}
+
+static uint32_t port_slot(uint16_t port)
+{
+    // Multiplicative hashing; the top bits are the best mixed
+    return ((uint32_t)port * 0x9e3779b1u) >> (32 - PORT_TABLE_BITS);
+}
+
+static esp_err_t insert_port(uint16_t port, uint8_t id)
+{
+    uint8_t owner = service_registry_lookup(port);
+    if (owner != SERVICE_ID_NONE) {
+        ESP_LOGE(TAG, "Port %u claimed by both %s and %s", port, services[owner].name,
+                 services[id].name);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t slot = port_slot(port);
+    while (port_table[slot].port != 0) {
+        slot = (slot + 1) & (PORT_TABLE_SIZE - 1);
+    }
+    port_table[slot].port = port;
+    port_table[slot].id = id;
+    return ESP_OK;
+}
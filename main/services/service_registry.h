@@ -0,0 +1,119 @@
+#ifndef SERVICE_REGISTRY_H
+#define SERVICE_REGISTRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "logging/attack_logger.h"
+#include "networking/socket_manager.h"
+#include "utils/metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SERVICE_MAX_PORTS 2                    ///< Default ports per service
+#define SERVICE_REGISTRY_MAX METRIC_SERVICE_SLOTS ///< Services the registry can hold
+#define SERVICE_ID_NONE 0xFF                   ///< No service for the port
+
+/**
+ * @brief Emulated service descriptor
+ *
+ * A service's id is its index in the registry table, which is also its
+ * slot in the per-service metrics.
+ */
+typedef struct {
+    const char *name;                      ///< Short lowercase name, used as a metric label
+    esp_err_t (*init)(void);               ///< Called once by service_registry_init(), may be NULL
+    socket_service_handler_t handler;      ///< Handles data received on a connection
+    void (*on_connect)(socket_conn_t *conn); ///< Sends the greeting on a new connection, may be NULL
+    void (*on_close)(socket_conn_t *conn); ///< Called as a connection closes, may be NULL
+    uint16_t ports[SERVICE_MAX_PORTS];     ///< Default listening ports, unused entries 0
+} service_descriptor_t;
+
+/**
+ * @brief Build the port lookup and initialize every service
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t service_registry_init(void);
+
+/**
+ * @brief Number of registered services
+ *
+ * @return uint8_t Service count; ids run from 0 to count - 1
+ */
+uint8_t service_registry_count(void);
+
+/**
+ * @brief Get a service descriptor
+ *
+ * @param id Service id
+ * @return const service_descriptor_t* Descriptor, NULL if @p id is invalid
+ */
+const service_descriptor_t *service_registry_get(uint8_t id);
+
+/**
+ * @brief Find the service that owns a port
+ *
+ * @param port TCP port
+ * @return uint8_t Service id, SERVICE_ID_NONE if no service owns the port
+ */
+uint8_t service_registry_lookup(uint16_t port);
+
+/**
+ * @brief Collect the default listening ports of every service
+ *
+ * @param ports Receives the ports, in registry order
+ * @param max_ports Capacity of @p ports
+ * @return uint8_t Number of ports written
+ */
+uint8_t service_registry_default_ports(uint16_t *ports, uint8_t max_ports);
+
+/**
+ * @brief Count a new connection and let its service greet the client
+ *
+ * Called from the listener task right after the connection is tracked.
+ *
+ * @param conn Connection just accepted
+ */
+void service_registry_on_connect(socket_conn_t *conn);
+
+/**
+ * @brief Let the service of a connection know it is closing
+ *
+ * Installed as the socket manager close handler.
+ *
+ * @param conn Connection about to be closed
+ */
+void service_registry_on_close(socket_conn_t *conn);
+
+/**
+ * @brief Count a detected attack against the service owning a port
+ *
+ * Also counts towards METRIC_ATTACKS_LOGGED. Lock-free; safe from any task
+ * on either core.
+ *
+ * @param port Local port the attack arrived on
+ */
+void service_registry_count_attack(uint16_t port);
+
+/**
+ * @brief Start an attack log entry for a connection
+ *
+ * Clears @p log_entry and fills in what every service records the same
+ * way: the time, the peer address, the local port and the service name.
+ *
+ * @param log_entry Entry to fill
+ * @param conn Connection the attack arrived on
+ * @param service Service name as logged, e.g. "HTTP"
+ */
+void service_registry_log_entry(attack_log_t *log_entry, const socket_conn_t *conn,
+                                const char *service);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERVICE_REGISTRY_H
@@ -0,0 +1,489 @@
+/*
+ * Telnet Service - Option negotiation and login capture
+ *
+ * The byte stream is consumed by a resumable state machine, so option
+ * negotiation, CR NUL / CR LF line endings and backspace behave the same
+ * however the stream is split across recv() calls. Bots pipeline their
+ * credentials in one segment right after answering the negotiation; both
+ * lines are captured from that single read.
+ *
+ * There is no line buffer per session. Cleaned line bytes are compacted
+ * in place at the front of the connection's receive buffer, which never
+ * overtakes the raw bytes still to be read. The username and password
+ * stay there once entered, so every shell command line is logged with
+ * the credentials that got the session in. Everything else fits in a
+ * few dozen bytes of service state.
+ */
+
+#include "telnet_service.h"
+#include "service_registry.h"
+#include "telnet_shell.h"
+#include "logging/attack_logger.h"
+#include "security/indicators.h"
+#include "utils/config.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "telnet_service";
+
+// Commands and options (RFC 854, 857, 858, 1073)
+#define TELNET_SE 240
+#define TELNET_EC 247
+#define TELNET_EL 248
+#define TELNET_SB 250
+#define TELNET_WILL 251
+#define TELNET_WONT 252
+#define TELNET_DO 253
+#define TELNET_DONT 254
+#define TELNET_IAC 255
+
+#define OPT_ECHO 1
+#define OPT_SGA 3
+#define OPT_NAWS 31
+
+#define OPT_BIT(opt) (1u << (opt))
+
+// Options this side performs, and options accepted from the client
+#define LOCAL_OPTIONS (OPT_BIT(OPT_ECHO) | OPT_BIT(OPT_SGA))
+#define REMOTE_OPTIONS (OPT_BIT(OPT_ECHO) | OPT_BIT(OPT_NAWS))
+
+#define TELNET_MAX_LINE 255                 // Longer lines are truncated
+#define TELNET_OUTPUT_SIZE 256              // Replies staged per recv() before sending
+
+// busybox telnetd's opening requests, then the banner and first prompt,
+// sent as one segment
+static const char GREETING[] =
+    "\xff\xfd\x01"                          // IAC DO ECHO
+    "\xff\xfd\x1f"                          // IAC DO NAWS
+    "\xff\xfb\x01"                          // IAC WILL ECHO
+    "\xff\xfb\x03"                          // IAC WILL SGA
+    TELNET_BANNER TELNET_LOGIN_PROMPT;
+
+typedef enum {
+    PARSE_DATA = 0,
+    PARSE_CR,                               // After CR; a following LF or NUL is dropped
+    PARSE_IAC,
+    PARSE_OPTION,                           // After IAC DO/DONT/WILL/WONT
+    PARSE_SB,                               // Inside subnegotiation
+    PARSE_SB_IAC
+} telnet_parse_t;
+
+typedef enum {
+    PHASE_USERNAME = 0,
+    PHASE_PASSWORD,
+    PHASE_SHELL
+} telnet_phase_t;
+
+/**
+ * @brief Per-connection session, kept in conn->service_state
+ *
+ * Option state follows RFC 1143: a request we sent is acknowledged
+ * silently, and an option is only answered when its state changes, so
+ * negotiation cannot loop. Options above 31 are always refused.
+ */
+typedef struct {
+    uint32_t local_on;                      ///< Options we perform
+    uint32_t local_asked;                   ///< WILL sent, awaiting DO/DONT
+    uint32_t remote_on;                     ///< Options the client performs
+    uint32_t remote_asked;                  ///< DO sent, awaiting WILL/WONT
+    uint16_t user_len;                      ///< Username held at the start of rx_buf
+    uint16_t pass_len;                      ///< Password held after the username
+    uint16_t line_len;                      ///< Current line, held after the password
+    uint8_t parse;                          ///< telnet_parse_t
+    uint8_t verb;                           ///< Negotiation verb awaiting its option
+    uint8_t phase;                          ///< telnet_phase_t
+    uint8_t attempts;                       ///< Passwords received
+} telnet_session_t;
+
+_Static_assert(sizeof(telnet_session_t) <= CONNECTION_STATE_SIZE,
+               "telnet_session_t must fit in service_state");
+_Static_assert(3 * TELNET_MAX_LINE < CONNECTION_RX_BUFFER_SIZE,
+               "credentials and line must leave room to receive");
+
+/**
+ * @brief Replies gathered while one read is processed
+ */
+typedef struct {
+    socket_conn_t *conn;
+    size_t len;
+    char buf[TELNET_OUTPUT_SIZE];
+} telnet_output_t;
+
+// Internal function prototypes
+static bool process_byte(socket_conn_t *conn, telnet_session_t *session, telnet_output_t *out,
+                         uint8_t c);
+static bool line_byte(socket_conn_t *conn, telnet_session_t *session, telnet_output_t *out,
+                      uint8_t c);
+static bool end_of_line(socket_conn_t *conn, telnet_session_t *session, telnet_output_t *out);
+static void erase_char(telnet_session_t *session, telnet_output_t *out);
+static void negotiate(telnet_session_t *session, telnet_output_t *out, uint8_t verb, uint8_t option);
+static void log_login_attempt(const socket_conn_t *conn, const telnet_session_t *session,
+                              bool accepted);
+static void log_command(const socket_conn_t *conn, const telnet_session_t *session);
+static void fill_log_entry(attack_log_t *log_entry, const socket_conn_t *conn,
+                           const telnet_session_t *session);
+static size_t held_bytes(const telnet_session_t *session);
+static void shell_write(void *ctx, const char *data, size_t len);
+static bool echoing(const telnet_session_t *session);
+static void out_put(telnet_output_t *out, const char *data, size_t len);
+static void out_str(telnet_output_t *out, const char *str);
+static void out_flush(telnet_output_t *out);
+
+esp_err_t telnet_service_init(void)
+{
+    // A built-in out of its slot would never be found; fail rather than
+    // answer "not found" to a command bots expect to work
+    esp_err_t err = telnet_shell_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Shell command table is inconsistent");
+        return err;
+    }
+    ESP_LOGI(TAG, "Telnet service initialized");
+    return ESP_OK;
+}
+
+void telnet_service_on_connect(socket_conn_t *conn)
+{
+    telnet_session_t *session = (telnet_session_t *)conn->service_state;
+
+    // Treat the opening requests as outstanding so their answers are
+    // taken as acknowledgements; the service state starts zeroed
+    session->local_asked = OPT_BIT(OPT_ECHO) | OPT_BIT(OPT_SGA);
+    session->remote_asked = OPT_BIT(OPT_ECHO) | OPT_BIT(OPT_NAWS);
+    socket_manager_send(conn, GREETING, sizeof(GREETING) - 1);
+}
+
+bool telnet_service_handle_request(socket_conn_t *conn, const char *data, size_t len)
+{
+    telnet_session_t *session = (telnet_session_t *)conn->service_state;
+    telnet_output_t out = { .conn = conn, .len = 0 };
+    bool keep_open = true;
+
+    // Everything before the kept lines is new; cleaned bytes are written
+    // back into the same buffer, never ahead of the byte being read
+    for (size_t i = held_bytes(session); i < len && keep_open; i++) {
+        keep_open = process_byte(conn, session, &out, (uint8_t)data[i]);
+    }
+    out_flush(&out);
+
+    conn->rx_len = held_bytes(session);
+    conn->rx_buf[conn->rx_len] = '\0';
+    return keep_open;
+}
+
+static bool process_byte(socket_conn_t *conn, telnet_session_t *session, telnet_output_t *out,
+                         uint8_t c)
+{
+    switch (session->parse) {
+        case PARSE_CR:
+            session->parse = PARSE_DATA;
+            if (c == '\n' || c == '\0') {
+                return true;
+            }
+            // Bare CR: the byte starts the next line
+            return process_byte(conn, session, out, c);
+        case PARSE_DATA:
+            if (c == TELNET_IAC) {
+                session->parse = PARSE_IAC;
+                return true;
+            }
+            return line_byte(conn, session, out, c);
+        case PARSE_IAC:
+            session->parse = PARSE_DATA;
+            switch (c) {
+                case TELNET_IAC:
+                    // Escaped 0xff data byte
+                    return line_byte(conn, session, out, c);
+                case TELNET_DO:
+                case TELNET_DONT:
+                case TELNET_WILL:
+                case TELNET_WONT:
+                    session->verb = c;
+                    session->parse = PARSE_OPTION;
+                    break;
+                case TELNET_SB:
+                    session->parse = PARSE_SB;
+                    break;
+                case TELNET_EC:
+                    erase_char(session, out);
+                    break;
+                case TELNET_EL:
+                    session->line_len = 0;
+                    break;
+                default:
+                    // NOP, GA, AYT, BRK and friends need no answer
+                    break;
+            }
+            return true;
+        case PARSE_OPTION:
+            session->parse = PARSE_DATA;
+            negotiate(session, out, session->verb, c);
+            return true;
+        case PARSE_SB:
+            // Window size and the like are not needed; skip to IAC SE
+            if (c == TELNET_IAC) {
+                session->parse = PARSE_SB_IAC;
+            }
+            return true;
+        case PARSE_SB_IAC:
+            session->parse = c == TELNET_SE ? PARSE_DATA : PARSE_SB;
+            return true;
+        default:
+            session->parse = PARSE_DATA;
+            return true;
+    }
+}
+
+static bool line_byte(socket_conn_t *conn, telnet_session_t *session, telnet_output_t *out,
+                      uint8_t c)
+{
+    switch (c) {
+        case '\r':
+            session->parse = PARSE_CR;
+            return end_of_line(conn, session, out);
+        case '\n':
+            return end_of_line(conn, session, out);
+        case '\b':
+        case 0x7f:
+            erase_char(session, out);
+            return true;
+        default:
+            break;
+    }
+
+    if (c < 0x20 || session->line_len >= TELNET_MAX_LINE) {
+        return true;
+    }
+
+    conn->rx_buf[held_bytes(session)] = (char)c;
+    session->line_len++;
+    if (echoing(session)) {
+        // An escaped 0xff is echoed escaped again
+        if (c == TELNET_IAC) {
+            out_put(out, (const char *)&c, 1);
+        }
+        out_put(out, (const char *)&c, 1);
+    }
+    return true;
+}
+
+static bool end_of_line(socket_conn_t *conn, telnet_session_t *session, telnet_output_t *out)
+{
+    out_str(out, "\r\n");
+
+    switch (session->phase) {
+        case PHASE_USERNAME:
+            if (session->line_len == 0) {
+                out_str(out, TELNET_LOGIN_PROMPT);
+                return true;
+            }
+            session->user_len = session->line_len;
+            session->line_len = 0;
+            session->phase = PHASE_PASSWORD;
+            out_str(out, TELNET_PASSWORD_PROMPT);
+            return true;
+        case PHASE_PASSWORD:
+            session->attempts++;
+            session->pass_len = session->line_len;
+            session->line_len = 0;
+            if (session->attempts >= TELNET_ACCEPTED_ATTEMPT) {
+                log_login_attempt(conn, session, true);
+                session->phase = PHASE_SHELL;
+                telnet_shell_start(shell_write, out);
+                out_str(out, TELNET_SHELL_PROMPT);
+                return true;
+            }
+            log_login_attempt(conn, session, false);
+            session->user_len = 0;
+            session->pass_len = 0;
+            session->phase = PHASE_USERNAME;
+            out_str(out, "Login incorrect\r\n");
+            if (session->attempts >= TELNET_MAX_LOGIN_ATTEMPTS) {
+                return false;
+            }
+            out_str(out, TELNET_LOGIN_PROMPT);
+            return true;
+        default:
+            break;
+    }
+
+    // Shell: every non-empty line is logged before it is answered
+    bool keep_open = true;
+    if (session->line_len > 0) {
+        log_command(conn, session);
+        keep_open = telnet_shell_execute(conn->rx_buf + session->user_len + session->pass_len,
+                                         session->line_len, shell_write, out);
+    }
+    session->line_len = 0;
+    if (keep_open) {
+        out_str(out, TELNET_SHELL_PROMPT);
+    }
+    return keep_open;
+}
+
+static void erase_char(telnet_session_t *session, telnet_output_t *out)
+{
+    if (session->line_len == 0) {
+        return;
+    }
+    session->line_len--;
+    if (echoing(session)) {
+        out_str(out, "\b \b");
+    }
+}
+
+static void negotiate(telnet_session_t *session, telnet_output_t *out, uint8_t verb, uint8_t option)
+{
+    uint32_t bit = option < 32 ? OPT_BIT(option) : 0;
+    bool local = verb == TELNET_DO || verb == TELNET_DONT;
+    bool enable = verb == TELNET_DO || verb == TELNET_WILL;
+    uint32_t *on = local ? &session->local_on : &session->remote_on;
+    uint32_t *asked = local ? &session->local_asked : &session->remote_asked;
+    uint32_t supported = local ? LOCAL_OPTIONS : REMOTE_OPTIONS;
+    uint8_t reply;
+
+    if (*asked & bit) {
+        // Answer to our own request
+        *asked &= ~bit;
+        if (enable) {
+            *on |= bit;
+        } else {
+            *on &= ~bit;
+        }
+        return;
+    }
+
+    if (enable) {
+        if (*on & bit) {
+            return;
+        }
+        if (supported & bit) {
+            *on |= bit;
+            reply = local ? TELNET_WILL : TELNET_DO;
+        } else {
+            reply = local ? TELNET_WONT : TELNET_DONT;
+        }
+    } else {
+        if (!(*on & bit)) {
+            return;
+        }
+        *on &= ~bit;
+        reply = local ? TELNET_WONT : TELNET_DONT;
+    }
+
+    char msg[3] = { (char)TELNET_IAC, (char)reply, (char)option };
+    out_put(out, msg, sizeof(msg));
+}
+
+static void log_login_attempt(const socket_conn_t *conn, const telnet_session_t *session,
+                              bool accepted)
+{
+    attack_log_t log_entry;
+
+    fill_log_entry(&log_entry, conn, session);
+    snprintf(log_entry.metadata, sizeof(log_entry.metadata), "Login attempt %u, %s",
+             (unsigned)session->attempts, accepted ? "accepted" : "refused");
+
+    ESP_LOGI(TAG, "Telnet login from %s: %s / %s (%s)", conn->client_ip, log_entry.username,
+             log_entry.password, accepted ? "accepted" : "refused");
+
+    attack_logger_log(&log_entry);
+    service_registry_count_attack(conn->port);
+}
+
+static void log_command(const socket_conn_t *conn, const telnet_session_t *session)
+{
+    const char *line = conn->rx_buf + session->user_len + session->pass_len;
+    attack_log_t log_entry;
+
+    indicator_set_t indicators;
+
+    fill_log_entry(&log_entry, conn, session);
+    snprintf(log_entry.metadata, sizeof(log_entry.metadata), "Cmd: %.*s",
+             (int)session->line_len, line);
+
+    indicators_init(&indicators);
+    indicators_scan(&indicators, line, session->line_len);
+    indicators_flush(&indicators);
+    strcpy(log_entry.indicators, indicators.text);
+
+    ESP_LOGI(TAG, "Telnet command from %s: %.*s", conn->client_ip, (int)session->line_len, line);
+    if (indicators.count > 0) {
+        ESP_LOGW(TAG, "Indicators from %s: %s", conn->client_ip, indicators.text);
+    }
+
+    attack_logger_log(&log_entry);
+}
+
+static void fill_log_entry(attack_log_t *log_entry, const socket_conn_t *conn,
+                           const telnet_session_t *session)
+{
+    size_t n;
+
+    service_registry_log_entry(log_entry, conn, "TELNET");
+
+    n = session->user_len < sizeof(log_entry->username) - 1 ?
+        session->user_len : sizeof(log_entry->username) - 1;
+    memcpy(log_entry->username, conn->rx_buf, n);
+    n = session->pass_len < sizeof(log_entry->password) - 1 ?
+        session->pass_len : sizeof(log_entry->password) - 1;
+    memcpy(log_entry->password, conn->rx_buf + session->user_len, n);
+
+    payload_hasher_hex(&conn->payload_hash, log_entry->payload_hash);
+}
+
+static size_t held_bytes(const telnet_session_t *session)
+{
+    return session->user_len + session->pass_len + session->line_len;
+}
+
+static void shell_write(void *ctx, const char *data, size_t len)
+{
+    telnet_output_t *out = (telnet_output_t *)ctx;
+
+    // Shell output is data, so 0xff has to be sent as IAC IAC
+    while (len > 0) {
+        const char *iac = memchr(data, TELNET_IAC, len);
+        size_t n = iac != NULL ? (size_t)(iac - data) + 1 : len;
+
+        out_put(out, data, n);
+        if (iac != NULL) {
+            out_put(out, iac, 1);
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+static bool echoing(const telnet_session_t *session)
+{
+    // Passwords are never echoed
+    return (session->local_on & OPT_BIT(OPT_ECHO)) && session->phase != PHASE_PASSWORD;
+}
+
+static void out_put(telnet_output_t *out, const char *data, size_t len)
+{
+    if (out->len + len > sizeof(out->buf)) {
+        out_flush(out);
+    }
+    if (len > sizeof(out->buf)) {
+        // Canned output larger than the staging buffer goes straight out
+        socket_manager_send(out->conn, data, len);
+        return;
+    }
+    memcpy(out->buf + out->len, data, len);
+    out->len += len;
+}
+
+static void out_str(telnet_output_t *out, const char *str)
+{
+    out_put(out, str, strlen(str));
+}
+
+static void out_flush(telnet_output_t *out)
+{
+    if (out->len > 0) {
+        socket_manager_send(out->conn, out->buf, out->len);
+        out->len = 0;
+    }
+}
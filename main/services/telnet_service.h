@@ -0,0 +1,44 @@
+#ifndef TELNET_SERVICE_H
+#define TELNET_SERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "networking/socket_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the Telnet service emulation
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t telnet_service_init(void);
+
+/**
+ * @brief Send the option negotiation, banner and login prompt
+ * 
+ * @param conn Connection just accepted
+ */
+void telnet_service_on_connect(socket_conn_t *conn);
+
+/**
+ * @brief Handle data received on a Telnet connection
+ * 
+ * Bytes are consumed as they arrive: negotiation is answered and the
+ * cleaned login line is kept at the start of the receive buffer, so any
+ * split of the stream across recv() calls gives the same result.
+ * 
+ * @param conn Connection the data arrived on
+ * @param data Received bytes (NUL-terminated)
+ * @param len Number of bytes received
+ * @return true to keep the connection open for more data
+ */
+bool telnet_service_handle_request(socket_conn_t *conn, const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELNET_SERVICE_H
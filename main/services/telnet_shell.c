@@ -0,0 +1,547 @@
+/*
+ * Telnet Shell - Canned busybox shell for logged-in sessions
+ *
+ * Bots that get in run a fixed probe sequence (enable, system, shell, sh,
+ * /bin/busybox <random applet>, cat /proc/cpuinfo, echo -e '\x..') before
+ * they fetch a dropper. Each line is split into commands and words in
+ * place, and each command is looked up in a perfect hash of busybox
+ * applets: the first byte, last byte and length of the name select one
+ * of 32 slots, so a lookup is one multiply and one compare. All output
+ * comes from rodata or is produced while the line is read, so a session
+ * costs nothing beyond its receive buffer.
+ */
+
+#include "telnet_shell.h"
+#include "utils/helpers.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "telnet_shell";
+
+#define BUILTIN_TABLE_BITS 5
+#define BUILTIN_TABLE_SIZE (1u << BUILTIN_TABLE_BITS)
+#define BUILTIN_HASH_SEED 0xae73f6afu       // Chosen offline: no two applets share a slot
+
+#define ECHO_CHUNK 64
+
+static const char BANNER[] =
+    "\r\n"
+    "BusyBox v1.19.4 (2016-03-01 11:12:46 CST) built-in shell (ash)\r\n"
+    "Enter 'help' for a list of built-in commands.\r\n"
+    "\r\n";
+
+static const char BUSYBOX_USAGE[] =
+    "BusyBox v1.19.4 (2016-03-01 11:12:46 CST) multi-call binary.\r\n"
+    "Copyright (C) 1998-2011 Erik Andersen, Rob Landley, Denys Vlasenko\r\n"
+    "and others. Licensed under GPLv2.\r\n"
+    "See source distribution for full notice.\r\n"
+    "\r\n"
+    "Usage: busybox [function] [arguments]...\r\n"
+    "   or: function [arguments]...\r\n";
+
+static const char PROC_CPUINFO[] =
+    "processor\t: 0\r\n"
+    "model name\t: ARMv7 Processor rev 5 (v7l)\r\n"
+    "BogoMIPS\t: 38.40\r\n"
+    "Features\t: half thumb fastmult vfp edsp neon vfpv3 tls vfpv4 idiva idivt\r\n"
+    "CPU implementer\t: 0x41\r\n"
+    "CPU architecture: 7\r\n"
+    "CPU variant\t: 0x0\r\n"
+    "CPU part\t: 0xc07\r\n"
+    "CPU revision\t: 5\r\n"
+    "\r\n"
+    "Hardware\t: Generic DT based system\r\n"
+    "Revision\t: 0000\r\n"
+    "Serial\t\t: 0000000000000000\r\n";
+
+static const char PROC_MOUNTS[] =
+    "rootfs / rootfs rw 0 0\r\n"
+    "/dev/root / squashfs ro,relatime 0 0\r\n"
+    "proc /proc proc rw,relatime 0 0\r\n"
+    "sysfs /sys sysfs rw,relatime 0 0\r\n"
+    "tmpfs /dev tmpfs rw,relatime,size=512k,mode=755 0 0\r\n"
+    "tmpfs /tmp tmpfs rw,relatime 0 0\r\n"
+    "devpts /dev/pts devpts rw,relatime,mode=600 0 0\r\n";
+
+static const char PROC_VERSION[] =
+    "Linux version 3.10.14 (root@build) (gcc version 4.9.4 (Buildroot 2016.02) ) "
+    "#1 SMP PREEMPT Wed Mar 2 11:05:12 CST 2016\r\n";
+
+static const char UNAME_ALL[] =
+    "Linux localhost 3.10.14 #1 SMP PREEMPT Wed Mar 2 11:05:12 CST 2016 armv7l GNU/Linux\r\n";
+
+static const char PS_OUTPUT[] =
+    "  PID USER       VSZ STAT COMMAND\r\n"
+    "    1 root      1532 S    init\r\n"
+    "    2 root         0 SW   [kthreadd]\r\n"
+    "    3 root         0 SW   [ksoftirqd/0]\r\n"
+    "  412 root      1528 S    /sbin/syslogd -n\r\n"
+    "  455 root      1532 S    /usr/sbin/telnetd -F\r\n"
+    "  501 root      4260 S    /usr/bin/ipcam\r\n"
+    "  733 root      1536 S    -sh\r\n"
+    "  741 root      1532 R    ps\r\n";
+
+static const char LS_OUTPUT[] =
+    "bin   dev   etc   lib   mnt   proc  root  sbin  sys   tmp   usr   var\r\n";
+
+static const struct {
+    const char *path;
+    const char *data;
+    size_t len;
+} PROC_FILES[] = {
+    { "/proc/cpuinfo", PROC_CPUINFO, sizeof(PROC_CPUINFO) - 1 },
+    { "/proc/mounts", PROC_MOUNTS, sizeof(PROC_MOUNTS) - 1 },
+    { "/proc/version", PROC_VERSION, sizeof(PROC_VERSION) - 1 },
+};
+
+typedef struct {
+    const char *ptr;
+    size_t len;
+} shell_word_t;
+
+/**
+ * @brief One parsed command, words pointing into the line
+ */
+typedef struct {
+    shell_word_t argv[TELNET_SHELL_MAX_ARGS];
+    int argc;
+    bool discard_output;                    ///< Piped or redirected
+} shell_command_t;
+
+/**
+ * @brief Output sink for one command
+ */
+typedef struct {
+    telnet_shell_write_t write;
+    void *ctx;
+    bool discard;
+} shell_output_t;
+
+typedef bool (*shell_builtin_fn)(const shell_command_t *cmd, int arg0, shell_output_t *out);
+
+typedef struct {
+    const char *name;
+    size_t len;
+    shell_builtin_fn run;
+} shell_builtin_t;
+
+// Internal function prototypes
+static size_t parse_command(const char *line, size_t len, size_t pos, shell_command_t *cmd);
+static bool run_command(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static const shell_builtin_t *lookup(shell_word_t name);
+static uint32_t builtin_slot(const char *name, size_t len);
+static shell_word_t basename_of(shell_word_t word);
+static bool word_equals(shell_word_t word, const char *str);
+static void put(shell_output_t *out, const char *data, size_t len);
+static void put_str(shell_output_t *out, const char *str);
+static void put_word(shell_output_t *out, shell_word_t word);
+static bool cmd_silent(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_busybox(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_cat(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_echo(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_uname(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_ps(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_ls(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_wget(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_tftp(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_ftpget(const shell_command_t *cmd, int arg0, shell_output_t *out);
+static bool cmd_exit(const shell_command_t *cmd, int arg0, shell_output_t *out);
+
+#define BUILTIN(name, fn) { name, sizeof(name) - 1, fn }
+
+// Indexed by builtin_slot(); telnet_shell_init() checks every entry
+static const shell_builtin_t BUILTINS[BUILTIN_TABLE_SIZE] = {
+    [1] = BUILTIN("cd", cmd_silent),
+    [2] = BUILTIN("mkdir", cmd_silent),
+    [3] = BUILTIN("chmod", cmd_silent),
+    [4] = BUILTIN("shell", cmd_silent),
+    [5] = BUILTIN("enable", cmd_silent),
+    [7] = BUILTIN("tftp", cmd_tftp),
+    [8] = BUILTIN("system", cmd_silent),
+    [9] = BUILTIN("sh", cmd_silent),
+    [10] = BUILTIN("echo", cmd_echo),
+    [12] = BUILTIN("ps", cmd_ps),
+    [15] = BUILTIN("cp", cmd_silent),
+    [16] = BUILTIN("ls", cmd_ls),
+    [17] = BUILTIN("busybox", cmd_busybox),
+    [18] = BUILTIN("rm", cmd_silent),
+    [19] = BUILTIN("exit", cmd_exit),
+    [22] = BUILTIN("grep", cmd_silent),
+    [24] = BUILTIN("kill", cmd_silent),
+    [25] = BUILTIN("linuxshell", cmd_silent),
+    [28] = BUILTIN("uname", cmd_uname),
+    [29] = BUILTIN("ftpget", cmd_ftpget),
+    [30] = BUILTIN("wget", cmd_wget),
+    [31] = BUILTIN("cat", cmd_cat),
+};
+
+esp_err_t telnet_shell_init(void)
+{
+    for (uint32_t slot = 0; slot < BUILTIN_TABLE_SIZE; slot++) {
+        const shell_builtin_t *builtin = &BUILTINS[slot];
+        if (builtin->name != NULL && builtin_slot(builtin->name, builtin->len) != slot) {
+            ESP_LOGE(TAG, "Built-in '%s' is not in its hash slot", builtin->name);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    return ESP_OK;
+}
+
+void telnet_shell_start(telnet_shell_write_t write, void *ctx)
+{
+    write(ctx, BANNER, sizeof(BANNER) - 1);
+}
+
+bool telnet_shell_execute(const char *line, size_t len, telnet_shell_write_t write, void *ctx)
+{
+    size_t pos = 0;
+
+    while (pos < len) {
+        shell_command_t cmd;
+        pos = parse_command(line, len, pos, &cmd);
+        if (cmd.argc == 0) {
+            continue;
+        }
+
+        shell_output_t out = { .write = write, .ctx = ctx, .discard = cmd.discard_output };
+        if (!run_command(&cmd, 0, &out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t parse_command(const char *line, size_t len, size_t pos, shell_command_t *cmd)
+{
+    bool collecting = true;
+
+    cmd->argc = 0;
+    cmd->discard_output = false;
+
+    while (pos < len) {
+        char c = line[pos];
+
+        if (c == ' ' || c == '\t') {
+            pos++;
+            continue;
+        }
+
+        // Separators end the command; a single | sends its output elsewhere
+        if (c == ';' || c == '|' || c == '&') {
+            pos++;
+            if (pos < len && line[pos] == c) {
+                pos++;
+            } else if (c == '|') {
+                cmd->discard_output = true;
+            }
+            return pos;
+        }
+
+        // Redirections end the argument list; output to a file is not shown
+        if (c == '>' || c == '<') {
+            cmd->discard_output |= c == '>';
+            collecting = false;
+            pos++;
+            continue;
+        }
+
+        // A word runs to the next unquoted blank, separator or redirection
+        size_t start = pos;
+        char quote = 0;
+        while (pos < len) {
+            c = line[pos];
+            if (quote != 0) {
+                if (c == quote) {
+                    quote = 0;
+                }
+            } else if (c == '\'' || c == '"') {
+                quote = c;
+            } else if (c == ' ' || c == '\t' || c == ';' || c == '|' || c == '&' ||
+                       c == '>' || c == '<') {
+                break;
+            }
+            pos++;
+        }
+
+        if (collecting && cmd->argc < TELNET_SHELL_MAX_ARGS) {
+            shell_word_t word = { line + start, pos - start };
+            // Drop one pair of enclosing quotes, the usual way arguments are quoted
+            if (word.len >= 2 && (word.ptr[0] == '\'' || word.ptr[0] == '"') &&
+                word.ptr[word.len - 1] == word.ptr[0]) {
+                word.ptr++;
+                word.len -= 2;
+            }
+            cmd->argv[cmd->argc++] = word;
+        }
+    }
+    return pos;
+}
+
+static bool run_command(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    const shell_builtin_t *builtin = lookup(basename_of(cmd->argv[arg0]));
+
+    if (builtin == NULL) {
+        put_str(out, "-sh: ");
+        put_word(out, cmd->argv[arg0]);
+        put_str(out, ": not found\r\n");
+        return true;
+    }
+    return builtin->run(cmd, arg0, out);
+}
+
+static const shell_builtin_t *lookup(shell_word_t name)
+{
+    if (name.len == 0 || name.len > UINT8_MAX) {
+        return NULL;
+    }
+
+    const shell_builtin_t *builtin = &BUILTINS[builtin_slot(name.ptr, name.len)];
+    if (builtin->name == NULL || builtin->len != name.len ||
+        memcmp(builtin->name, name.ptr, name.len) != 0) {
+        return NULL;
+    }
+    return builtin;
+}
+
+static uint32_t builtin_slot(const char *name, size_t len)
+{
+    uint32_t key = ((uint32_t)(uint8_t)name[0] << 16) |
+                   ((uint32_t)(uint8_t)name[len - 1] << 8) | (uint32_t)len;
+    return (key * BUILTIN_HASH_SEED) >> (32 - BUILTIN_TABLE_BITS);
+}
+
+static shell_word_t basename_of(shell_word_t word)
+{
+    // Applets are reached through /bin/<name> links as often as by name
+    for (size_t i = word.len; i > 0; i--) {
+        if (word.ptr[i - 1] == '/') {
+            shell_word_t base = { word.ptr + i, word.len - i };
+            return base;
+        }
+    }
+    return word;
+}
+
+static bool word_equals(shell_word_t word, const char *str)
+{
+    return strlen(str) == word.len && memcmp(word.ptr, str, word.len) == 0;
+}
+
+static void put(shell_output_t *out, const char *data, size_t len)
+{
+    if (!out->discard && len > 0) {
+        out->write(out->ctx, data, len);
+    }
+}
+
+static void put_str(shell_output_t *out, const char *str)
+{
+    put(out, str, strlen(str));
+}
+
+static void put_word(shell_output_t *out, shell_word_t word)
+{
+    put(out, word.ptr, word.len);
+}
+
+static bool cmd_silent(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    return true;
+}
+
+static bool cmd_busybox(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    if (arg0 + 1 >= cmd->argc) {
+        put(out, BUSYBOX_USAGE, sizeof(BUSYBOX_USAGE) - 1);
+        return true;
+    }
+
+    // "busybox <applet> ..." runs the applet; bots probe with a random name
+    // and expect the real error back
+    shell_word_t applet = cmd->argv[arg0 + 1];
+    if (lookup(applet) == NULL) {
+        put_word(out, applet);
+        put_str(out, ": applet not found\r\n");
+        return true;
+    }
+    return run_command(cmd, arg0 + 1, out);
+}
+
+static bool cmd_cat(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    for (int i = arg0 + 1; i < cmd->argc; i++) {
+        bool found = false;
+        for (size_t f = 0; f < sizeof(PROC_FILES) / sizeof(PROC_FILES[0]); f++) {
+            if (word_equals(cmd->argv[i], PROC_FILES[f].path)) {
+                put(out, PROC_FILES[f].data, PROC_FILES[f].len);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            put_str(out, "cat: can't open '");
+            put_word(out, cmd->argv[i]);
+            put_str(out, "': No such file or directory\r\n");
+        }
+    }
+    return true;
+}
+
+static bool cmd_echo(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    bool newline = true;
+    bool escapes = false;
+    int i = arg0 + 1;
+
+    // Leading -n/-e/-E words, alone or combined, are options
+    for (; i < cmd->argc; i++) {
+        shell_word_t word = cmd->argv[i];
+        size_t j = 1;
+        if (word.len < 2 || word.ptr[0] != '-') {
+            break;
+        }
+        while (j < word.len && (word.ptr[j] == 'n' || word.ptr[j] == 'e' || word.ptr[j] == 'E')) {
+            j++;
+        }
+        if (j < word.len) {
+            break;
+        }
+        for (j = 1; j < word.len; j++) {
+            if (word.ptr[j] == 'n') {
+                newline = false;
+            } else {
+                escapes = word.ptr[j] == 'e';
+            }
+        }
+    }
+
+    // Decode into a small chunk; \x escapes are how droppers are written out
+    char chunk[ECHO_CHUNK];
+    size_t n = 0;
+
+    for (int first = i; i < cmd->argc; i++) {
+        shell_word_t word = cmd->argv[i];
+
+        if (i > first) {
+            chunk[n++] = ' ';
+        }
+        for (size_t j = 0; j < word.len; j++) {
+            char c = word.ptr[j];
+
+            if (escapes && c == '\\' && j + 1 < word.len) {
+                char e = word.ptr[++j];
+                int value = 0;
+
+                switch (e) {
+                    case 'x':
+                        for (int d = 0; d < 2 && j + 1 < word.len && hex_value(word.ptr[j + 1]) >= 0; d++) {
+                            value = value * 16 + hex_value(word.ptr[++j]);
+                        }
+                        c = (char)value;
+                        break;
+                    case '0':
+                        for (int d = 0; d < 3 && j + 1 < word.len &&
+                             word.ptr[j + 1] >= '0' && word.ptr[j + 1] <= '7'; d++) {
+                            value = value * 8 + (word.ptr[++j] - '0');
+                        }
+                        c = (char)value;
+                        break;
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'a': c = '\a'; break;
+                    case 'b': c = '\b'; break;
+                    case 'e': c = '\x1b'; break;
+                    case '\\': c = '\\'; break;
+                    case 'c':
+                        // \c ends all output, including the newline
+                        put(out, chunk, n);
+                        return true;
+                    default:
+                        chunk[n++] = '\\';
+                        c = e;
+                        break;
+                }
+            }
+
+            // The terminal turns \n into CR LF
+            if (c == '\n') {
+                chunk[n++] = '\r';
+            }
+            chunk[n++] = c;
+            if (n > sizeof(chunk) - 3) {
+                put(out, chunk, n);
+                n = 0;
+            }
+        }
+        if (n > sizeof(chunk) - 3) {
+            put(out, chunk, n);
+            n = 0;
+        }
+    }
+
+    if (newline) {
+        chunk[n++] = '\r';
+        chunk[n++] = '\n';
+    }
+    put(out, chunk, n);
+    return true;
+}
+
+static bool cmd_uname(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    if (arg0 + 1 >= cmd->argc) {
+        put_str(out, "Linux\r\n");
+    } else if (word_equals(cmd->argv[arg0 + 1], "-m")) {
+        put_str(out, "armv7l\r\n");
+    } else if (word_equals(cmd->argv[arg0 + 1], "-r")) {
+        put_str(out, "3.10.14\r\n");
+    } else if (word_equals(cmd->argv[arg0 + 1], "-s")) {
+        put_str(out, "Linux\r\n");
+    } else {
+        put(out, UNAME_ALL, sizeof(UNAME_ALL) - 1);
+    }
+    return true;
+}
+
+static bool cmd_ps(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    put(out, PS_OUTPUT, sizeof(PS_OUTPUT) - 1);
+    return true;
+}
+
+static bool cmd_ls(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    put(out, LS_OUTPUT, sizeof(LS_OUTPUT) - 1);
+    return true;
+}
+
+static bool cmd_wget(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    // The command line is already logged; the download just fails
+    if (arg0 + 1 >= cmd->argc) {
+        put_str(out, "BusyBox v1.19.4 (2016-03-01 11:12:46 CST) multi-call binary.\r\n\r\n"
+                     "Usage: wget [-c|--continue] [-s|--spider] [-q|--quiet] [-O|--output-document FILE]\r\n");
+        return true;
+    }
+    put_str(out, "wget: server returned error: HTTP/1.1 404 Not Found\r\n");
+    return true;
+}
+
+static bool cmd_tftp(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    put_str(out, "tftp: timeout\r\n");
+    return true;
+}
+
+static bool cmd_ftpget(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    put_str(out, "ftpget: can't connect to remote host: Connection timed out\r\n");
+    return true;
+}
+
+static bool cmd_exit(const shell_command_t *cmd, int arg0, shell_output_t *out)
+{
+    return false;
+}
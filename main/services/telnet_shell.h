@@ -0,0 +1,59 @@
+#ifndef TELNET_SHELL_H
+#define TELNET_SHELL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELNET_SHELL_MAX_ARGS 16  ///< Words kept per command, extras are ignored
+
+/**
+ * @brief Destination for shell output
+ *
+ * @param ctx Context given to the shell call
+ * @param data Output bytes, may contain any value
+ * @param len Length of @p data
+ */
+typedef void (*telnet_shell_write_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Check the built-in command table
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the
+ *         table no longer matches its hash
+ */
+esp_err_t telnet_shell_init(void);
+
+/**
+ * @brief Write the banner shown after a successful login
+ *
+ * @param write Output sink
+ * @param ctx Passed to @p write
+ */
+void telnet_shell_start(telnet_shell_write_t write, void *ctx);
+
+/**
+ * @brief Run one command line
+ *
+ * The line is split on ; | && || into commands, each answered from a
+ * canned table of busybox applets. Output of a command that is piped or
+ * redirected is discarded. Nothing is copied or allocated; @p line only
+ * needs to stay valid for the call.
+ *
+ * @param line Command line, without its line ending
+ * @param len Length of @p line
+ * @param write Output sink
+ * @param ctx Passed to @p write
+ * @return true to keep the session, false if the line asked to exit
+ */
+bool telnet_shell_execute(const char *line, size_t len, telnet_shell_write_t write, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELNET_SHELL_H
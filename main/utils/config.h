@@ -5,22 +5,50 @@
 #define HONEYPOT_VERSION "1.2.0"
 
 // Network Configuration
-#define MAX_LISTENING_PORTS 6
+#define MAX_LISTENING_PORTS 8
 #define MAX_CONCURRENT_CONNECTIONS 6
-#define CONNECTION_TIMEOUT_MS 10000
+#define CONNECTION_TIMEOUT_MS 10000            // Idle time between received data
+#define CONNECTION_HANDSHAKE_TIMEOUT_MS 5000   // Accept to first received byte
+#define CONNECTION_SESSION_TIMEOUT_MS 120000   // Total lifetime of a connection
 #define RATE_LIMIT_WINDOW_MS 60000
 #define RATE_LIMIT_MAX_CONNECTIONS 10
+#define RATE_LIMIT_TRACKED_SOURCES 256  // Sources with a token bucket, power of two
+#define RATE_LIMIT_SUBNET24_WINDOW_MS 60000
+#define RATE_LIMIT_SUBNET24_MAX_CONNECTIONS 30
+#define RATE_LIMIT_SUBNET24_TRACKED 128  // /24s with a token bucket, power of two
+#define RATE_LIMIT_SUBNET16_WINDOW_MS 300000
+#define RATE_LIMIT_SUBNET16_MAX_CONNECTIONS 150
+#define RATE_LIMIT_SUBNET16_TRACKED 64   // /16s with a token bucket, power of two
+#define HEAVY_HITTER_WINDOW_MS 60000    // Sketch counts halve this often
+#define HEAVY_HITTER_HOST_LIMIT 60      // Decayed attempts before an address is refused
+#define HEAVY_HITTER_SUBNET_LIMIT 240   // Decayed attempts before a /24 is refused
+#define CONNECTION_RX_BUFFER_SIZE 1024  // Per-connection receive buffer
+#define CONNECTION_STATE_SIZE 128       // Per-connection service parser state
 
 // Logging Configuration
 #define LOG_BUFFER_SIZE 4096
 #define MAX_PAYLOAD_SIZE 1024
-#define FLASH_LOG_SIZE 16384  // 16KB for log storage
-#define MAX_LOG_ENTRIES 100
+#define FLASH_LOG_PARTITION "attack_log"  // Raw data partition for the log store
+#define LOG_RAM_BUFFER_SIZE 16384       // Recent encoded records kept in RAM
+#define LOG_QUEUE_DEPTH 16              // Records waiting for the writer task, power of two
+#define LOG_FLUSH_INTERVAL_MS 2000      // Longest a partial batch waits before being written
+#define LOG_WRITER_TASK_PRIORITY 1
+#define LOG_WRITER_STACK_SIZE 4096
+#define PAYLOAD_STORE_PARTITION "payloads"  // Raw data partition for payload samples
+#define PAYLOAD_STORE_MAX_ENTRIES 96    // Unique payloads tracked in RAM
+#define PAYLOAD_STORE_PENDING 4         // New samples waiting for the writer task
 
 // Service Banners
 #define FTP_BANNER "220 FTP Server Ready\r\n"
+#define FTP_PASV_PORT 50000             // Passive data port announced by PASV and EPSV
+#define FTP_MAX_TRANSFERS 4             // Passive transfers open at once across all sessions
+#define FTP_MAGIC_SIZE 16               // Leading bytes of an upload kept for its record
 #define TELNET_BANNER "\r\nWelcome to Device Login\r\n\r\n"
-#define MQTT_BANNER_CONNACK "\x20\x02\x00\x05"  // CONNACK, Not authorized
+#define TELNET_LOGIN_PROMPT "login: "
+#define TELNET_PASSWORD_PROMPT "Password: "
+#define TELNET_SHELL_PROMPT "# "
+#define TELNET_ACCEPTED_ATTEMPT 1       // Login attempt let into the shell; earlier ones are refused
+#define TELNET_MAX_LOGIN_ATTEMPTS 3     // Failed logins before the session is closed
 
 // WiFi Configuration (to be set via menuconfig)
 #ifndef CONFIG_WIFI_SSID
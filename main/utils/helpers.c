@@ -0,0 +1,32 @@
+/*
+ * Helpers - Small routines shared across modules
+ */
+
+#include "helpers.h"
+
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool parse_hash(const char *hex, uint8_t *out, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        int hi = hex_value(hex[i * 2]);
+        int lo = hi < 0 ? -1 : hex_value(hex[i * 2 + 1]);
+        if (lo < 0) {
+            return false;
+        }
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return hex[len * 2] == '\0';
+}
@@ -0,0 +1,34 @@
+#ifndef HELPERS_H
+#define HELPERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Value of one hexadecimal digit
+ *
+ * @param c Digit, either case
+ * @return int 0-15, or -1 if @p c is not a hex digit
+ */
+int hex_value(char c);
+
+/**
+ * @brief Decode a hex payload hash into bytes
+ *
+ * @param hex NUL-terminated string of exactly 2 * @p len hex digits
+ * @param out Receives @p len bytes; undefined on failure
+ * @param len Digest length in bytes
+ * @return bool true if @p hex was well formed
+ */
+bool parse_hash(const char *hex, uint8_t *out, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HELPERS_H
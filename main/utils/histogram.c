@@ -0,0 +1,76 @@
+/*
+ * Latency Histogram
+ *
+ * Fixed-size log-linear histogram used for latency reporting. The top
+ * two bits below the leading one pick a sub-bucket within each power of
+ * two, so recording is a handful of instructions and never allocates.
+ */
+
+#include "histogram.h"
+#include <string.h>
+
+#define SUB_BUCKETS (1u << HISTOGRAM_SUB_BITS)
+
+void histogram_record(histogram_t *hist, int64_t value)
+{
+    uint32_t v = value <= 0 ? 0 : (value > UINT32_MAX ? UINT32_MAX : (uint32_t)value);
+
+    hist->buckets[histogram_bucket_index(v)]++;
+    hist->count++;
+    hist->sum += v;
+    if (v > hist->max) {
+        hist->max = v;
+    }
+}
+
+uint32_t histogram_percentile(const histogram_t *hist, uint8_t percentile)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    uint64_t target = ((uint64_t)hist->count * percentile + 99) / 100;
+    uint64_t seen = 0;
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target && seen > 0) {
+            uint32_t upper = histogram_bucket_upper(i);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+
+    return hist->max;
+}
+
+void histogram_reset(histogram_t *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+int histogram_bucket_index(uint32_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+
+    // Octave from the highest set bit, sub-bucket from the bits below it
+    int octave = 31 - __builtin_clz(value);
+    int shift = octave - HISTOGRAM_SUB_BITS;
+    int bucket = (shift + 1) * SUB_BUCKETS + (int)((value >> shift) & (SUB_BUCKETS - 1));
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+uint32_t histogram_bucket_upper(int bucket)
+{
+    if (bucket >= HISTOGRAM_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    if (bucket < (int)SUB_BUCKETS) {
+        return (uint32_t)bucket;
+    }
+
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint32_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (1u << shift) - 1;
+}
@@ -0,0 +1,72 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTOGRAM_SUB_BITS 2  ///< Each power of two is split into 2^SUB_BITS buckets
+#define HISTOGRAM_BUCKETS 88  ///< Log-linear buckets, last one is open-ended
+
+/**
+ * @brief Fixed-size latency histogram with log-linear buckets
+ *
+ * Values below 4 get a bucket each; above that every power of two is
+ * split into four equal buckets, so a bucket is never wider than a
+ * quarter of its lower bound. Values are microseconds by convention;
+ * 88 buckets resolve values up to ~7.3 s.
+ */
+typedef struct {
+    uint32_t buckets[HISTOGRAM_BUCKETS];   ///< Sample counts per bucket
+    uint32_t count;                        ///< Total samples recorded
+    uint32_t max;                          ///< Largest sample seen
+    uint64_t sum;                          ///< Sum of all samples
+} histogram_t;
+
+/**
+ * @brief Record one sample
+ *
+ * @param hist Histogram to update
+ * @param value Sample value (negative values are clamped to 0)
+ */
+void histogram_record(histogram_t *hist, int64_t value);
+
+/**
+ * @brief Estimate a percentile from the bucket counts
+ *
+ * @param hist Histogram to query
+ * @param percentile Percentile in the range 0-100
+ * @return uint32_t Upper bound of the bucket containing the percentile, 0 if empty
+ */
+uint32_t histogram_percentile(const histogram_t *hist, uint8_t percentile);
+
+/**
+ * @brief Clear all samples
+ *
+ * @param hist Histogram to reset
+ */
+void histogram_reset(histogram_t *hist);
+
+/**
+ * @brief Bucket a value falls into
+ *
+ * @param value Sample value
+ * @return int Bucket index, values past the range land in the last bucket
+ */
+int histogram_bucket_index(uint32_t value);
+
+/**
+ * @brief Largest value counted in a bucket
+ *
+ * @param bucket Bucket index
+ * @return uint32_t Inclusive upper bound, UINT32_MAX for the open-ended last bucket
+ */
+uint32_t histogram_bucket_upper(int bucket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,204 @@
+/*
+ * JSON Writer - Streaming, escaping JSON encoder
+ *
+ * Emits a document token by token into a small staging chunk that is
+ * handed to a caller-supplied sink whenever it fills. Nothing is ever
+ * formatted into a record-sized buffer, so there is no size limit.
+ */
+
+#include "json_writer.h"
+#include <string.h>
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Internal function prototypes
+static void put(json_writer_t *w, const char *data, size_t len);
+static void put_char(json_writer_t *w, char c);
+static void flush(json_writer_t *w);
+static void before_value(json_writer_t *w);
+static void open_container(json_writer_t *w, char c);
+static void close_container(json_writer_t *w, char c);
+static bool needs_escape(unsigned char c);
+
+void json_writer_init(json_writer_t *w, json_sink_t sink, void *ctx)
+{
+    w->sink = sink;
+    w->ctx = ctx;
+    w->err = ESP_OK;
+    w->depth = 0;
+    w->first = 0;
+    w->after_key = false;
+    w->len = 0;
+}
+
+void json_writer_begin_object(json_writer_t *w)
+{
+    open_container(w, '{');
+}
+
+void json_writer_end_object(json_writer_t *w)
+{
+    close_container(w, '}');
+}
+
+void json_writer_begin_array(json_writer_t *w)
+{
+    open_container(w, '[');
+}
+
+void json_writer_end_array(json_writer_t *w)
+{
+    close_container(w, ']');
+}
+
+void json_writer_key(json_writer_t *w, const char *key)
+{
+    json_writer_string(w, key, strlen(key));
+    put_char(w, ':');
+    w->after_key = true;
+}
+
+void json_writer_string(json_writer_t *w, const char *str, size_t len)
+{
+    before_value(w);
+    put_char(w, '"');
+
+    // Copy unescaped runs in one go, escape the bytes in between
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)str[i];
+        if (!needs_escape(c)) {
+            continue;
+        }
+
+        put(w, str + run, i - run);
+        run = i + 1;
+
+        switch (c) {
+            case '"':  put(w, "\\\"", 2); break;
+            case '\\': put(w, "\\\\", 2); break;
+            case '\n': put(w, "\\n", 2); break;
+            case '\r': put(w, "\\r", 2); break;
+            case '\t': put(w, "\\t", 2); break;
+            default: {
+                char escape[6] = { '\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf] };
+                put(w, escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    put(w, str + run, len - run);
+
+    put_char(w, '"');
+}
+
+void json_writer_int(json_writer_t *w, int64_t value)
+{
+    char digits[20];
+    size_t n = 0;
+    uint64_t magnitude = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+
+    before_value(w);
+    if (value < 0) {
+        put_char(w, '-');
+    }
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    put(w, digits + sizeof(digits) - n, n);
+}
+
+void json_writer_field_string(json_writer_t *w, const char *key, const char *value)
+{
+    json_writer_key(w, key);
+    json_writer_string(w, value, strlen(value));
+}
+
+void json_writer_field_int(json_writer_t *w, const char *key, int64_t value)
+{
+    json_writer_key(w, key);
+    json_writer_int(w, value);
+}
+
+esp_err_t json_writer_finish(json_writer_t *w)
+{
+    flush(w);
+    return w->err;
+}
+
+static void put(json_writer_t *w, const char *data, size_t len)
+{
+    while (len > 0 && w->err == ESP_OK) {
+        size_t space = sizeof(w->chunk) - w->len;
+        size_t n = len < space ? len : space;
+
+        memcpy(w->chunk + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+
+        if (w->len == sizeof(w->chunk)) {
+            flush(w);
+        }
+    }
+}
+
+static void put_char(json_writer_t *w, char c)
+{
+    put(w, &c, 1);
+}
+
+static void flush(json_writer_t *w)
+{
+    if (w->len > 0 && w->err == ESP_OK) {
+        w->err = w->sink(w->ctx, w->chunk, w->len);
+    }
+    w->len = 0;
+}
+
+static void before_value(json_writer_t *w)
+{
+    if (w->after_key) {
+        // Value of a key: the comma went before the key
+        w->after_key = false;
+        return;
+    }
+
+    if (w->depth > 0) {
+        uint8_t bit = 1u << (w->depth - 1);
+        if (w->first & bit) {
+            w->first &= ~bit;
+        } else {
+            put_char(w, ',');
+        }
+    }
+}
+
+static void open_container(json_writer_t *w, char c)
+{
+    before_value(w);
+    put_char(w, c);
+
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        w->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    w->depth++;
+    w->first |= 1u << (w->depth - 1);
+}
+
+static void close_container(json_writer_t *w, char c)
+{
+    if (w->depth == 0) {
+        w->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    w->depth--;
+    put_char(w, c);
+}
+
+static bool needs_escape(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\' || c >= 0x7f;
+}
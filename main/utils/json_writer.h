@@ -0,0 +1,141 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_WRITER_CHUNK_SIZE 64   ///< Bytes staged before the sink is called
+#define JSON_WRITER_MAX_DEPTH 8     ///< Deepest nesting of objects and arrays
+
+/**
+ * @brief Destination for encoded output
+ *
+ * @param ctx Sink context given to json_writer_init()
+ * @param data Encoded bytes, not NUL-terminated
+ * @param len Length of @p data
+ * @return esp_err_t ESP_OK to continue, any error stops the writer
+ */
+typedef esp_err_t (*json_sink_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Streaming JSON encoder state
+ *
+ * Output goes to the sink in small chunks as it is produced, so documents
+ * and string values of any length need only this struct in memory. The
+ * first sink error is latched; later calls do nothing and
+ * json_writer_finish() returns it.
+ */
+typedef struct {
+    json_sink_t sink;
+    void *ctx;
+    esp_err_t err;                         ///< First sink error, ESP_OK otherwise
+    uint8_t depth;                         ///< Open objects and arrays
+    uint8_t first;                         ///< Bit per level: no value written yet
+    bool after_key;                        ///< A key was written, its value is next
+    size_t len;                            ///< Staged bytes in @p chunk
+    char chunk[JSON_WRITER_CHUNK_SIZE];
+} json_writer_t;
+
+/**
+ * @brief Start a document
+ *
+ * @param w Writer to initialize
+ * @param sink Destination for output
+ * @param ctx Passed through to @p sink
+ */
+void json_writer_init(json_writer_t *w, json_sink_t sink, void *ctx);
+
+/**
+ * @brief Open an object, as a value or at the top level
+ *
+ * @param w Writer
+ */
+void json_writer_begin_object(json_writer_t *w);
+
+/**
+ * @brief Close the innermost object
+ *
+ * @param w Writer
+ */
+void json_writer_end_object(json_writer_t *w);
+
+/**
+ * @brief Open an array, as a value or at the top level
+ *
+ * @param w Writer
+ */
+void json_writer_begin_array(json_writer_t *w);
+
+/**
+ * @brief Close the innermost array
+ *
+ * @param w Writer
+ */
+void json_writer_end_array(json_writer_t *w);
+
+/**
+ * @brief Write an object key; the next call writes its value
+ *
+ * @param w Writer
+ * @param key NUL-terminated key, escaped like any string
+ */
+void json_writer_key(json_writer_t *w, const char *key);
+
+/**
+ * @brief Write a string value, escaping quotes, backslashes, control
+ *        bytes and non-ASCII bytes
+ *
+ * Bytes 0x80-0xff are written as \\u00XX so arbitrary attacker input
+ * always yields valid JSON.
+ *
+ * @param w Writer
+ * @param str String bytes
+ * @param len Length of @p str
+ */
+void json_writer_string(json_writer_t *w, const char *str, size_t len);
+
+/**
+ * @brief Write an integer value
+ *
+ * @param w Writer
+ * @param value Value to write
+ */
+void json_writer_int(json_writer_t *w, int64_t value);
+
+/**
+ * @brief Write a key and NUL-terminated string value
+ *
+ * @param w Writer
+ * @param key Key
+ * @param value Value
+ */
+void json_writer_field_string(json_writer_t *w, const char *key, const char *value);
+
+/**
+ * @brief Write a key and integer value
+ *
+ * @param w Writer
+ * @param key Key
+ * @param value Value
+ */
+void json_writer_field_int(json_writer_t *w, const char *key, int64_t value);
+
+/**
+ * @brief Hand any staged output to the sink
+ *
+ * @param w Writer
+ * @return esp_err_t ESP_OK on success, the first sink error otherwise
+ */
+esp_err_t json_writer_finish(json_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,201 @@
+/*
+ * MD5 Hash - Incremental payload digests
+ *
+ * A small RFC 1321 MD5 plus the per-connection payload hasher built on
+ * it. The hasher is fed every received chunk, so a payload's digest
+ * covers the whole session without keeping the bytes around.
+ */
+
+#include "md5_hash.h"
+#include <string.h>
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+// Per-round shift amounts and sine-derived constants from RFC 1321
+static const uint8_t SHIFTS[4][4] = {
+    { 7, 12, 17, 22 }, { 5, 9, 14, 20 }, { 4, 11, 16, 23 }, { 6, 10, 15, 21 },
+};
+
+static const uint32_t K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Internal function prototypes
+static void md5_block(uint32_t state[4], const uint8_t block[64]);
+static void to_hex(const uint8_t *digest, size_t len, char *hex_out);
+
+void md5_init(md5_ctx_t *ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+    ctx->length = 0;
+}
+
+void md5_update(md5_ctx_t *ctx, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+    size_t used = ctx->length % 64;
+
+    ctx->length += len;
+
+    // Top up a partial block first
+    if (used > 0) {
+        size_t n = 64 - used < len ? 64 - used : len;
+        memcpy(ctx->block + used, bytes, n);
+        bytes += n;
+        len -= n;
+        if (used + n < 64) {
+            return;
+        }
+        md5_block(ctx->state, ctx->block);
+    }
+
+    // Whole blocks straight from the input
+    while (len >= 64) {
+        md5_block(ctx->state, bytes);
+        bytes += 64;
+        len -= 64;
+    }
+    memcpy(ctx->block, bytes, len);
+}
+
+void md5_final(md5_ctx_t *ctx, uint8_t digest[MD5_DIGEST_SIZE])
+{
+    uint64_t bits = ctx->length * 8;
+    size_t used = ctx->length % 64;
+
+    // 0x80, zeros up to 56 mod 64, then the bit length little-endian
+    ctx->block[used++] = 0x80;
+    if (used > 56) {
+        memset(ctx->block + used, 0, 64 - used);
+        md5_block(ctx->state, ctx->block);
+        used = 0;
+    }
+    memset(ctx->block + used, 0, 56 - used);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[56 + i] = (uint8_t)(bits >> (8 * i));
+    }
+    md5_block(ctx->state, ctx->block);
+
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            digest[i * 4 + j] = (uint8_t)(ctx->state[i] >> (8 * j));
+        }
+    }
+}
+
+void generate_md5_hash(const uint8_t *data, size_t len, char *hex_out)
+{
+    md5_ctx_t ctx;
+    uint8_t digest[MD5_DIGEST_SIZE];
+
+    md5_init(&ctx);
+    md5_update(&ctx, data, len);
+    md5_final(&ctx, digest);
+    to_hex(digest, sizeof(digest), hex_out);
+}
+
+void payload_hasher_init(payload_hasher_t *hasher)
+{
+#if CONFIG_HONEYPOT_PAYLOAD_SHA256
+    mbedtls_sha256_init(&hasher->sha256);
+    mbedtls_sha256_starts(&hasher->sha256, 0);
+#else
+    md5_init(&hasher->md5);
+#endif
+}
+
+void payload_hasher_update(payload_hasher_t *hasher, const void *data, size_t len)
+{
+#if CONFIG_HONEYPOT_PAYLOAD_SHA256
+    mbedtls_sha256_update(&hasher->sha256, data, len);
+#else
+    md5_update(&hasher->md5, data, len);
+#endif
+}
+
+void payload_hasher_hex(const payload_hasher_t *hasher, char *hex_out)
+{
+    // Finish a copy so the running digest can keep growing
+#if CONFIG_HONEYPOT_PAYLOAD_SHA256
+    mbedtls_sha256_context copy;
+    uint8_t digest[32];
+
+    mbedtls_sha256_init(&copy);
+    mbedtls_sha256_clone(&copy, &hasher->sha256);
+    mbedtls_sha256_finish(&copy, digest);
+    mbedtls_sha256_free(&copy);
+#else
+    md5_ctx_t copy = hasher->md5;
+    uint8_t digest[MD5_DIGEST_SIZE];
+
+    md5_final(&copy, digest);
+#endif
+    to_hex(digest, MD5_DIGEST_SIZE, hex_out);
+}
+
+void payload_hasher_free(payload_hasher_t *hasher)
+{
+#if CONFIG_HONEYPOT_PAYLOAD_SHA256
+    mbedtls_sha256_free(&hasher->sha256);
+#else
+    (void)hasher;
+#endif
+}
+
+static void md5_block(uint32_t state[4], const uint8_t block[64])
+{
+    uint32_t m[16];
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+
+    for (int i = 0; i < 16; i++) {
+        m[i] = (uint32_t)block[i * 4] | (uint32_t)block[i * 4 + 1] << 8 |
+               (uint32_t)block[i * 4 + 2] << 16 | (uint32_t)block[i * 4 + 3] << 24;
+    }
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+
+        switch (i / 16) {
+            case 0:  f = (b & c) | (~b & d); g = i; break;
+            case 1:  f = (d & b) | (~d & c); g = (5 * i + 1) % 16; break;
+            case 2:  f = b ^ c ^ d;          g = (3 * i + 5) % 16; break;
+            default: f = c ^ (b | ~d);       g = (7 * i) % 16; break;
+        }
+
+        f += a + K[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b += ROTL(f, SHIFTS[i / 16][i % 4]);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+static void to_hex(const uint8_t *digest, size_t len, char *hex_out)
+{
+    for (size_t i = 0; i < len; i++) {
+        hex_out[i * 2] = HEX_DIGITS[digest[i] >> 4];
+        hex_out[i * 2 + 1] = HEX_DIGITS[digest[i] & 0xf];
+    }
+    hex_out[len * 2] = '\0';
+}
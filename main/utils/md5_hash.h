@@ -0,0 +1,114 @@
+#ifndef MD5_HASH_H
+#define MD5_HASH_H
+
+#include "sdkconfig.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if CONFIG_HONEYPOT_PAYLOAD_SHA256
+#include "mbedtls/sha256.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MD5_DIGEST_SIZE 16                  ///< Bytes in an MD5 digest
+#define PAYLOAD_HASH_HEX_SIZE 33            ///< 32 hex digits plus terminator
+
+/**
+ * @brief Incremental MD5 state
+ */
+typedef struct {
+    uint32_t state[4];
+    uint64_t length;                       ///< Bytes hashed so far
+    uint8_t block[64];                     ///< Partial input block
+} md5_ctx_t;
+
+/**
+ * @brief Running digest of everything received on a connection
+ *
+ * MD5 by default. With CONFIG_HONEYPOT_PAYLOAD_SHA256 it is SHA-256
+ * through mbedtls, which uses the SHA accelerator when available,
+ * truncated to 128 bits so stored records and payload store keys keep
+ * their size.
+ */
+typedef struct {
+#if CONFIG_HONEYPOT_PAYLOAD_SHA256
+    mbedtls_sha256_context sha256;
+#else
+    md5_ctx_t md5;
+#endif
+} payload_hasher_t;
+
+/**
+ * @brief Start an MD5 digest
+ *
+ * @param ctx Context to initialize
+ */
+void md5_init(md5_ctx_t *ctx);
+
+/**
+ * @brief Add bytes to an MD5 digest
+ *
+ * @param ctx Context
+ * @param data Bytes to add
+ * @param len Length of @p data
+ */
+void md5_update(md5_ctx_t *ctx, const void *data, size_t len);
+
+/**
+ * @brief Finish an MD5 digest; the context must be re-initialized to reuse it
+ *
+ * @param ctx Context
+ * @param digest Receives the digest
+ */
+void md5_final(md5_ctx_t *ctx, uint8_t digest[MD5_DIGEST_SIZE]);
+
+/**
+ * @brief One-shot MD5 as lowercase hex
+ *
+ * @param data Bytes to hash
+ * @param len Length of @p data
+ * @param hex_out Receives PAYLOAD_HASH_HEX_SIZE bytes
+ */
+void generate_md5_hash(const uint8_t *data, size_t len, char *hex_out);
+
+/**
+ * @brief Start a payload digest
+ *
+ * @param hasher Hasher to initialize
+ */
+void payload_hasher_init(payload_hasher_t *hasher);
+
+/**
+ * @brief Add received bytes to a payload digest
+ *
+ * @param hasher Hasher
+ * @param data Bytes to add
+ * @param len Length of @p data
+ */
+void payload_hasher_update(payload_hasher_t *hasher, const void *data, size_t len);
+
+/**
+ * @brief Digest of everything added so far, as lowercase hex
+ *
+ * The hasher is left running, so more data can still be added.
+ *
+ * @param hasher Hasher
+ * @param hex_out Receives PAYLOAD_HASH_HEX_SIZE bytes
+ */
+void payload_hasher_hex(const payload_hasher_t *hasher, char *hex_out);
+
+/**
+ * @brief Release a payload digest
+ *
+ * @param hasher Hasher
+ */
+void payload_hasher_free(payload_hasher_t *hasher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MD5_HASH_H
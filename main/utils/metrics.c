@@ -0,0 +1,188 @@
+/*
+ * Metrics - Per-core sharded counters and latency histograms
+ *
+ * Events are counted by the listener task, the service worker and the
+ * log writer, which may run on different cores. Each core updates its
+ * own shard with relaxed atomic adds, and shards start on separate cache
+ * lines, so writers never contend on a line or take a lock. Readers
+ * merge the shards into a snapshot.
+ *
+ * Histogram sums are 64-bit but kept as two 32-bit words, since 64-bit
+ * atomics take a lock on the ESP32: whoever carries out of the low word
+ * bumps the high word.
+ */
+
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct {
+    atomic_uint buckets[HISTOGRAM_BUCKETS];
+    atomic_uint max;
+    atomic_uint sum_low;
+    atomic_uint sum_high;
+} shard_histogram_t;
+
+typedef struct {
+    _Alignas(32) atomic_uint counters[METRIC_COUNTER_COUNT];
+    atomic_uint services[METRIC_SERVICE_SLOTS][METRIC_SERVICE_COUNTER_COUNT];
+    shard_histogram_t latency[METRIC_LATENCY_COUNT];
+} metrics_shard_t;
+
+static metrics_shard_t shards[portNUM_PROCESSORS];
+
+// Internal function prototypes
+static metrics_shard_t *local_shard(void);
+static void merge_histogram(histogram_t *out, const shard_histogram_t *shard);
+
+void metrics_count(metric_counter_t counter)
+{
+    if (counter >= METRIC_COUNTER_COUNT) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&local_shard()->counters[counter], 1, memory_order_relaxed);
+}
+
+void metrics_count_service(unsigned slot, metric_service_counter_t counter)
+{
+    if (slot >= METRIC_SERVICE_SLOTS || counter >= METRIC_SERVICE_COUNTER_COUNT) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&local_shard()->services[slot][counter], 1, memory_order_relaxed);
+}
+
+void metrics_record_latency(metric_latency_t latency, int64_t value_us)
+{
+    if (latency >= METRIC_LATENCY_COUNT) {
+        return;
+    }
+
+    uint32_t v = value_us <= 0 ? 0 : (value_us > UINT32_MAX ? UINT32_MAX : (uint32_t)value_us);
+    shard_histogram_t *hist = &local_shard()->latency[latency];
+
+    atomic_fetch_add_explicit(&hist->buckets[histogram_bucket_index(v)], 1, memory_order_relaxed);
+
+    uint32_t low = atomic_fetch_add_explicit(&hist->sum_low, v, memory_order_relaxed);
+    if (low + v < low) {
+        atomic_fetch_add_explicit(&hist->sum_high, 1, memory_order_relaxed);
+    }
+
+    uint32_t max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    while (v > max &&
+           !atomic_compare_exchange_weak_explicit(&hist->max, &max, v,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+uint32_t metrics_get_counter(metric_counter_t counter)
+{
+    uint32_t total = 0;
+
+    if (counter >= METRIC_COUNTER_COUNT) {
+        return 0;
+    }
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        total += atomic_load_explicit(&shards[core].counters[counter], memory_order_relaxed);
+    }
+    return total;
+}
+
+uint32_t metrics_get_service_counter(unsigned slot, metric_service_counter_t counter)
+{
+    uint32_t total = 0;
+
+    if (slot >= METRIC_SERVICE_SLOTS || counter >= METRIC_SERVICE_COUNTER_COUNT) {
+        return 0;
+    }
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        total += atomic_load_explicit(&shards[core].services[slot][counter], memory_order_relaxed);
+    }
+    return total;
+}
+
+esp_err_t metrics_get_snapshot(metrics_snapshot_t *snapshot)
+{
+    if (snapshot == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const metrics_shard_t *shard = &shards[core];
+
+        for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+            snapshot->counters[i] += atomic_load_explicit(&shard->counters[i], memory_order_relaxed);
+        }
+        for (int s = 0; s < METRIC_SERVICE_SLOTS; s++) {
+            for (int i = 0; i < METRIC_SERVICE_COUNTER_COUNT; i++) {
+                snapshot->services[s][i] += atomic_load_explicit(&shard->services[s][i],
+                                                                 memory_order_relaxed);
+            }
+        }
+        for (int i = 0; i < METRIC_LATENCY_COUNT; i++) {
+            merge_histogram(&snapshot->latency_us[i], &shard->latency[i]);
+        }
+    }
+    return ESP_OK;
+}
+
+void metrics_reset(void)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        metrics_shard_t *shard = &shards[core];
+
+        for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+            atomic_store_explicit(&shard->counters[i], 0, memory_order_relaxed);
+        }
+        for (int s = 0; s < METRIC_SERVICE_SLOTS; s++) {
+            for (int i = 0; i < METRIC_SERVICE_COUNTER_COUNT; i++) {
+                atomic_store_explicit(&shard->services[s][i], 0, memory_order_relaxed);
+            }
+        }
+        for (int i = 0; i < METRIC_LATENCY_COUNT; i++) {
+            shard_histogram_t *hist = &shard->latency[i];
+            for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+                atomic_store_explicit(&hist->buckets[b], 0, memory_order_relaxed);
+            }
+            atomic_store_explicit(&hist->max, 0, memory_order_relaxed);
+            atomic_store_explicit(&hist->sum_low, 0, memory_order_relaxed);
+            atomic_store_explicit(&hist->sum_high, 0, memory_order_relaxed);
+        }
+    }
+}
+
+static metrics_shard_t *local_shard(void)
+{
+    // A task migrating right after this only lands in the other shard;
+    // the atomic add keeps the count exact either way
+    return &shards[xPortGetCoreID()];
+}
+
+static void merge_histogram(histogram_t *out, const shard_histogram_t *shard)
+{
+    // Count is derived from the buckets so percentiles stay consistent
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        uint32_t n = atomic_load_explicit(&shard->buckets[b], memory_order_relaxed);
+        out->buckets[b] += n;
+        out->count += n;
+    }
+
+    // Re-read if the high word moved while the low word was being read
+    uint32_t high;
+    uint32_t low;
+    do {
+        high = atomic_load_explicit(&shard->sum_high, memory_order_relaxed);
+        low = atomic_load_explicit(&shard->sum_low, memory_order_relaxed);
+    } while (high != atomic_load_explicit(&shard->sum_high, memory_order_relaxed));
+    out->sum += ((uint64_t)high << 32) | low;
+
+    uint32_t max = atomic_load_explicit(&shard->max, memory_order_relaxed);
+    if (max > out->max) {
+        out->max = max;
+    }
+}
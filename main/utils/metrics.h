@@ -0,0 +1,123 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "esp_err.h"
+#include "histogram.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRIC_SERVICE_SLOTS 8  ///< Services that can have their own counters
+
+/**
+ * @brief Event counters
+ */
+typedef enum {
+    METRIC_CONNECTIONS = 0,                ///< Connections accepted and tracked
+    METRIC_RATE_LIMITED,                   ///< Connections refused by the rate limiter
+    METRIC_ATTACKS_LOGGED,                 ///< Attacks recorded by any service
+    METRIC_LOOP_WAKEUPS,                   ///< select() returns in the main loop
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+/**
+ * @brief Counters kept for each service slot
+ */
+typedef enum {
+    METRIC_SERVICE_CONNECTIONS = 0,        ///< Connections accepted for the service
+    METRIC_SERVICE_ATTACKS,                ///< Attacks the service detected
+    METRIC_SERVICE_COUNTER_COUNT
+} metric_service_counter_t;
+
+/**
+ * @brief Latency histograms, all in microseconds
+ */
+typedef enum {
+    METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE = 0, ///< Connection accepted to first data received
+    METRIC_LATENCY_FIRST_BYTE_TO_RESPONSE,   ///< First data received to first reply sent
+    METRIC_LATENCY_ENQUEUE_TO_COMMIT,        ///< attack_logger_log() to the record reaching flash
+    METRIC_LATENCY_COUNT
+} metric_latency_t;
+
+/**
+ * @brief Point-in-time copy of every counter and histogram
+ */
+typedef struct {
+    uint32_t counters[METRIC_COUNTER_COUNT];         ///< Indexed by metric_counter_t
+    uint32_t services[METRIC_SERVICE_SLOTS][METRIC_SERVICE_COUNTER_COUNT]; ///< By slot, then counter
+    histogram_t latency_us[METRIC_LATENCY_COUNT];    ///< Indexed by metric_latency_t
+} metrics_snapshot_t;
+
+/**
+ * @brief Count one event
+ *
+ * Lock-free; safe from any task on either core.
+ *
+ * @param counter Counter to increment
+ */
+void metrics_count(metric_counter_t counter);
+
+/**
+ * @brief Count one event for a service
+ *
+ * Lock-free; safe from any task on either core. Out-of-range slots are
+ * ignored.
+ *
+ * @param slot Service slot, below METRIC_SERVICE_SLOTS
+ * @param counter Counter to increment
+ */
+void metrics_count_service(unsigned slot, metric_service_counter_t counter);
+
+/**
+ * @brief Record one latency sample
+ *
+ * Lock-free; safe from any task on either core.
+ *
+ * @param latency Histogram to update
+ * @param value_us Sample in microseconds (negative values are clamped to 0)
+ */
+void metrics_record_latency(metric_latency_t latency, int64_t value_us);
+
+/**
+ * @brief Current value of one counter, summed over the shards
+ *
+ * @param counter Counter to read
+ * @return uint32_t Count since boot or the last reset
+ */
+uint32_t metrics_get_counter(metric_counter_t counter);
+
+/**
+ * @brief Current value of one service counter, summed over the shards
+ *
+ * @param slot Service slot
+ * @param counter Counter to read
+ * @return uint32_t Count since boot or the last reset, 0 for an invalid slot
+ */
+uint32_t metrics_get_service_counter(unsigned slot, metric_service_counter_t counter);
+
+/**
+ * @brief Merge the per-core shards into a snapshot
+ *
+ * Never blocks writers. Samples recorded while the snapshot is taken may
+ * or may not be included; each histogram's count always equals the sum
+ * of its buckets.
+ *
+ * @param snapshot Receives the merged values
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t metrics_get_snapshot(metrics_snapshot_t *snapshot);
+
+/**
+ * @brief Zero every counter and histogram
+ *
+ * Updates racing with the reset may survive it.
+ */
+void metrics_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
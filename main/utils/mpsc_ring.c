@@ -0,0 +1,87 @@
+/*
+ * MPSC Ring - Lock-free many-to-one handoff
+ *
+ * Bounded queue after Dmitry Vyukov's design: a producer claims a slot by
+ * advancing the enqueue index with a CAS, fills it, then publishes it by
+ * bumping the slot's sequence number. The consumer reads a slot only once
+ * its sequence says it is complete.
+ */
+
+#include "mpsc_ring.h"
+#include <string.h>
+
+bool mpsc_ring_init(mpsc_ring_t *ring, atomic_uint *sequences, void *storage,
+                    size_t item_size, uint32_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+
+    ring->sequences = sequences;
+    ring->storage = storage;
+    ring->item_size = item_size;
+    ring->mask = capacity - 1;
+
+    for (uint32_t i = 0; i < capacity; i++) {
+        atomic_init(&sequences[i], i);
+    }
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+    return true;
+}
+
+bool mpsc_ring_push(mpsc_ring_t *ring, const void *item)
+{
+    uint32_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    uint32_t slot;
+
+    while (1) {
+        slot = pos & ring->mask;
+        uint32_t seq = atomic_load_explicit(&ring->sequences[slot], memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0) {
+            // Slot is free for this lap; try to claim it
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Consumer has not freed this slot yet
+            return false;
+        } else {
+            // Another producer claimed it first
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(ring->storage + slot * ring->item_size, item, ring->item_size);
+    atomic_store_explicit(&ring->sequences[slot], pos + 1, memory_order_release);
+    return true;
+}
+
+bool mpsc_ring_pop(mpsc_ring_t *ring, void *item)
+{
+    uint32_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    uint32_t slot = pos & ring->mask;
+    uint32_t seq = atomic_load_explicit(&ring->sequences[slot], memory_order_acquire);
+
+    if (seq != pos + 1) {
+        return false;
+    }
+
+    memcpy(item, ring->storage + slot * ring->item_size, ring->item_size);
+
+    // Advance before releasing the slot so depth never exceeds capacity,
+    // then hand the slot back to producers for the next lap
+    atomic_store_explicit(&ring->dequeue_pos, pos + 1, memory_order_relaxed);
+    atomic_store_explicit(&ring->sequences[slot], pos + ring->mask + 1, memory_order_release);
+    return true;
+}
+
+uint32_t mpsc_ring_depth(const mpsc_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    return head - tail;
+}
@@ -0,0 +1,73 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bounded lock-free multi-producer single-consumer ring
+ *
+ * Fixed-size items are copied in and out of caller-provided storage. Each
+ * slot carries a sequence number, so producers only contend on the
+ * enqueue index and never block each other or the consumer.
+ */
+typedef struct {
+    atomic_uint *sequences;                ///< Per-slot sequence numbers, one per slot
+    uint8_t *storage;                      ///< Item storage, capacity * item_size bytes
+    size_t item_size;                      ///< Size of one item in bytes
+    uint32_t mask;                         ///< Capacity - 1, capacity is a power of two
+    _Alignas(32) atomic_uint enqueue_pos;  ///< Next slot to claim (producers)
+    _Alignas(32) atomic_uint dequeue_pos;  ///< Next slot to read (consumer)
+} mpsc_ring_t;
+
+/**
+ * @brief Initialize a ring over caller-provided storage
+ *
+ * @param ring Ring to initialize
+ * @param sequences Storage for @p capacity sequence numbers
+ * @param storage Storage for @p capacity items
+ * @param item_size Size of one item in bytes
+ * @param capacity Number of slots, must be a power of two
+ * @return true on success, false if the capacity is not a power of two
+ */
+bool mpsc_ring_init(mpsc_ring_t *ring, atomic_uint *sequences, void *storage,
+                    size_t item_size, uint32_t capacity);
+
+/**
+ * @brief Copy an item into the ring (any producer)
+ *
+ * @param ring Ring to push to
+ * @param item Item to copy in
+ * @return true on success, false if the ring is full
+ */
+bool mpsc_ring_push(mpsc_ring_t *ring, const void *item);
+
+/**
+ * @brief Copy the oldest item out of the ring (consumer only)
+ *
+ * @param ring Ring to pop from
+ * @param item Receives the item
+ * @return true on success, false if the ring is empty or the oldest
+ *         slot is still being written
+ */
+bool mpsc_ring_pop(mpsc_ring_t *ring, void *item);
+
+/**
+ * @brief Number of slots claimed but not yet consumed
+ *
+ * @param ring Ring to inspect
+ * @return uint32_t Approximate depth
+ */
+uint32_t mpsc_ring_depth(const mpsc_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MPSC_RING_H
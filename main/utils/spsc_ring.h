@@ -0,0 +1,66 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Lock-free single-producer single-consumer ring of pointers
+ *
+ * Exactly one task may push and exactly one (other) task may pop. The
+ * producer and consumer indices sit on separate cache lines so the two
+ * cores do not contend on the same line.
+ */
+typedef struct {
+    void **slots;                          ///< Caller-provided storage
+    uint32_t mask;                         ///< Capacity - 1, capacity is a power of two
+    _Alignas(32) atomic_uint head;         ///< Next slot to write (producer)
+    _Alignas(32) atomic_uint tail;         ///< Next slot to read (consumer)
+} spsc_ring_t;
+
+/**
+ * @brief Initialize a ring over caller-provided storage
+ *
+ * @param ring Ring to initialize
+ * @param slots Storage for @p capacity pointers
+ * @param capacity Number of slots, must be a power of two
+ * @return true on success, false if the capacity is not a power of two
+ */
+bool spsc_ring_init(spsc_ring_t *ring, void **slots, uint32_t capacity);
+
+/**
+ * @brief Push an item (producer side)
+ *
+ * @param ring Ring to push to
+ * @param item Item to push
+ * @return true on success, false if the ring is full
+ */
+bool spsc_ring_push(spsc_ring_t *ring, void *item);
+
+/**
+ * @brief Pop an item (consumer side)
+ *
+ * @param ring Ring to pop from
+ * @return void* Oldest item, NULL if the ring is empty
+ */
+void *spsc_ring_pop(spsc_ring_t *ring);
+
+/**
+ * @brief Number of items currently queued
+ *
+ * @param ring Ring to inspect
+ * @return uint32_t Approximate depth, exact when called by either endpoint
+ */
+uint32_t spsc_ring_depth(const spsc_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPSC_RING_H
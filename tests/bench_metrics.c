@@ -0,0 +1,91 @@
+/*
+ * Metric update cost, sharded vs locked
+ *
+ * Two tasks, pinned as the listener and worker would be, each count a
+ * connection and record a latency sample per iteration: once through
+ * metrics.c's per-core shards and once into a single histogram behind a
+ * FreeRTOS mutex, as the counters would need without sharding.
+ *
+ * Usage: bench_metrics [updates per task]
+ */
+
+#include "utils/metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_UPDATES 10000000L
+
+static long updates;
+static bool use_mutex;
+static SemaphoreHandle_t lock;
+static histogram_t locked_hist;
+static uint32_t locked_count;
+static atomic_int done;
+static int64_t finished_us[2];
+
+// Internal function prototypes
+static void writer_task(void *arg);
+static double run(bool with_mutex);
+
+int main(int argc, char **argv)
+{
+    updates = argc > 1 ? atol(argv[1]) : DEFAULT_UPDATES;
+    if (updates <= 0) {
+        updates = DEFAULT_UPDATES;
+    }
+    lock = xSemaphoreCreateMutex();
+
+    double sharded = run(false);
+    double locked = run(true);
+
+    printf("2 tasks x %ld updates\n", updates);
+    printf("per-core shards: %6.1f M updates/s\n", sharded);
+    printf("mutex:           %6.1f M updates/s\n", locked);
+    return 0;
+}
+
+static double run(bool with_mutex)
+{
+    use_mutex = with_mutex;
+    atomic_store(&done, 0);
+    metrics_reset();
+
+    int64_t start = esp_timer_get_time();
+    for (uintptr_t core = 0; core < 2; core++) {
+        xTaskCreatePinnedToCore(writer_task, "writer", 4096, (void *)core, 5, NULL, (BaseType_t)core);
+    }
+    while (atomic_load(&done) < 2) {
+        vTaskDelay(1);
+    }
+
+    // Time to the last update, not to the tick that noticed it
+    int64_t end = finished_us[0] > finished_us[1] ? finished_us[0] : finished_us[1];
+    return 2.0 * updates / (end - start);
+}
+
+static void writer_task(void *arg)
+{
+    uint32_t x = 12345 + (uint32_t)(uintptr_t)arg;
+
+    for (long i = 0; i < updates; i++) {
+        x = x * 1103515245u + 12345u;
+        uint32_t sample = (x >> 8) & 0xfffff;
+        if (use_mutex) {
+            xSemaphoreTake(lock, portMAX_DELAY);
+            locked_count++;
+            histogram_record(&locked_hist, sample);
+            xSemaphoreGive(lock);
+        } else {
+            metrics_count(METRIC_CONNECTIONS);
+            metrics_record_latency(METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE, sample);
+        }
+    }
+    finished_us[(uintptr_t)arg] = esp_timer_get_time();
+    atomic_fetch_add(&done, 1);
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,101 @@
+/*
+ * Rate limiter cost under a flood
+ *
+ * Runs rate_limiter_check() on simulated time (esp_timer_get_time() is
+ * wrapped at link time) with 4000 connections a second from 10k, 100k
+ * and 1M random sources, then with 1000 a second from a botnet rotating
+ * through one /16, and reports checks per second of real time.
+ *
+ * Usage: bench_rate_limiter [checks]
+ */
+
+#include "security/rate_limiter.h"
+#include "esp_log.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_CHECKS 4000000
+
+static int64_t fake_us;
+static uint64_t rng_state = 88172645463325252ull;
+static volatile uint32_t sink;
+
+int64_t __wrap_esp_timer_get_time(void);
+
+// Internal function prototypes
+static uint32_t next_random(void);
+static double now_seconds(void);
+
+int64_t __wrap_esp_timer_get_time(void)
+{
+    return fake_us;
+}
+
+int main(int argc, char **argv)
+{
+    long checks = argc > 1 ? atol(argv[1]) : DEFAULT_CHECKS;
+    if (checks <= 0) {
+        checks = DEFAULT_CHECKS;
+    }
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    static const int SOURCES[] = { 10000, 100000, 1000000 };
+    for (size_t k = 0; k < sizeof(SOURCES) / sizeof(SOURCES[0]); k++) {
+        int n = SOURCES[k];
+        uint32_t *addrs = malloc(sizeof(uint32_t) * n);
+        if (addrs == NULL) {
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            addrs[i] = next_random();
+        }
+
+        fake_us = 0;
+        rate_limiter_init();
+        double start = now_seconds();
+        for (long i = 0; i < checks; i++) {
+            fake_us += 250;
+            sink += rate_limiter_check(addrs[next_random() % n]);
+        }
+        double seconds = now_seconds() - start;
+
+        rate_limiter_stats_t stats;
+        rate_limiter_get_stats(&stats);
+        printf("%7d sources: %5.1f M checks/s, %u evictions, max probe %u\n", n,
+               checks / seconds / 1e6, stats.levels[RATE_LIMIT_LEVEL_HOST].evictions,
+               stats.levels[RATE_LIMIT_LEVEL_HOST].max_probe);
+        free(addrs);
+    }
+
+    // Every attempt a new host of 198.51.0.0/16: all three levels are hit
+    fake_us = 0;
+    rate_limiter_init();
+    uint32_t admitted = 0;
+    double start = now_seconds();
+    for (long i = 0; i < checks; i++) {
+        fake_us += 1000;
+        admitted += rate_limiter_check(htonl(0xc6330000u | (next_random() & 0xffff))) ==
+                    RATE_LIMIT_ALLOWED;
+    }
+    double seconds = now_seconds() - start;
+    printf("rotating /16: %5.1f M checks/s, %.1f admitted per minute\n",
+           checks / seconds / 1e6, admitted / (checks / 1000.0 / 60.0));
+    return 0;
+}
+
+static uint32_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,67 @@
+#ifndef ESP_HTTP_SERVER_H
+#define ESP_HTTP_SERVER_H
+
+/*
+ * The slice of esp_http_server that web_ui.c uses
+ *
+ * No host implementation: a test that starts the web interface provides
+ * these functions itself and calls the registered handler directly.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *httpd_handle_t;
+
+typedef struct httpd_req {
+    const char *uri;
+    void *user_ctx;
+} httpd_req_t;
+
+typedef enum {
+    HTTP_GET = 1,
+} httpd_method_t;
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+} httpd_uri_t;
+
+typedef struct {
+    unsigned task_priority;
+    size_t stack_size;
+    uint16_t server_port;
+    uint16_t ctrl_port;
+    uint16_t max_open_sockets;
+    bool lru_purge_enable;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() { \
+        .task_priority = 5, \
+        .stack_size = 4096, \
+        .server_port = 80, \
+        .ctrl_port = 32768, \
+        .max_open_sockets = 7, \
+        .lru_purge_enable = false, \
+    }
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESP_HTTP_SERVER_H
@@ -0,0 +1,215 @@
+/*
+ * Emulated flash partitions
+ *
+ * The data partitions from partitions.csv held in RAM with NOR semantics,
+ * see host_flash.h.
+ */
+
+#include "esp_partition.h"
+#include "host_flash.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define ATTACK_LOG_SIZE 0x40000
+#define PAYLOADS_SIZE 0x10000
+
+typedef struct {
+    esp_partition_t partition;
+    uint8_t *cells;
+    host_flash_stats_t stats;
+} host_partition_t;
+
+static uint8_t attack_log_cells[ATTACK_LOG_SIZE];
+static uint8_t payloads_cells[PAYLOADS_SIZE];
+
+static host_partition_t partitions[] = {
+    {
+        .partition = { ESP_PARTITION_TYPE_DATA, 0x40, 0x190000, ATTACK_LOG_SIZE,
+                       HOST_FLASH_SECTOR_SIZE, "attack_log" },
+        .cells = attack_log_cells
+    },
+    {
+        .partition = { ESP_PARTITION_TYPE_DATA, 0x41, 0x1D0000, PAYLOADS_SIZE,
+                       HOST_FLASH_SECTOR_SIZE, "payloads" },
+        .cells = payloads_cells
+    },
+};
+
+#define PARTITION_COUNT (sizeof(partitions) / sizeof(partitions[0]))
+
+static bool erased = false;
+static long tear_budget = -1;
+static bool powered_off = false;
+
+// Internal function prototypes
+static host_partition_t *find(const esp_partition_t *partition);
+static host_partition_t *find_label(const char *label);
+static void erase_all_once(void);
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    erase_all_once();
+
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        const esp_partition_t *p = &partitions[i].partition;
+        if (p->type == type &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (label == NULL || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset,
+                             void *dst, size_t size)
+{
+    host_partition_t *hp = find(partition);
+
+    if (hp == NULL || dst == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(dst, hp->cells + src_offset, size);
+    hp->stats.reads++;
+    hp->stats.read_bytes += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size)
+{
+    host_partition_t *hp = find(partition);
+    const uint8_t *bytes = src;
+
+    if (hp == NULL || src == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dst_offset > partition->size || size > partition->size - dst_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (powered_off) {
+        return ESP_FAIL;
+    }
+
+    hp->stats.writes++;
+    for (size_t i = 0; i < size; i++) {
+        if (tear_budget == 0) {
+            powered_off = true;
+            return ESP_FAIL;
+        }
+        if (tear_budget > 0) {
+            tear_budget--;
+        }
+
+        // Programming only pulls bits low
+        uint8_t *cell = &hp->cells[dst_offset + i];
+        if ((*cell & bytes[i]) != bytes[i]) {
+            hp->stats.program_violations++;
+        }
+        *cell &= bytes[i];
+        hp->stats.write_bytes++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    host_partition_t *hp = find(partition);
+
+    if (hp == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset % HOST_FLASH_SECTOR_SIZE != 0 || size % HOST_FLASH_SECTOR_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (powered_off) {
+        return ESP_FAIL;
+    }
+
+    memset(hp->cells + offset, 0xFF, size);
+    hp->stats.erases += size / HOST_FLASH_SECTOR_SIZE;
+    return ESP_OK;
+}
+
+void host_flash_reset(void)
+{
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        memset(partitions[i].cells, 0xFF, partitions[i].partition.size);
+        memset(&partitions[i].stats, 0, sizeof(host_flash_stats_t));
+    }
+    erased = true;
+    tear_budget = -1;
+    powered_off = false;
+}
+
+uint8_t *host_flash_contents(const char *label, size_t *size)
+{
+    host_partition_t *hp = find_label(label);
+
+    erase_all_once();
+    if (hp == NULL) {
+        return NULL;
+    }
+    if (size != NULL) {
+        *size = hp->partition.size;
+    }
+    return hp->cells;
+}
+
+void host_flash_stats(const char *label, host_flash_stats_t *stats, bool clear)
+{
+    host_partition_t *hp = find_label(label);
+
+    if (hp == NULL) {
+        return;
+    }
+    if (stats != NULL) {
+        memcpy(stats, &hp->stats, sizeof(host_flash_stats_t));
+    }
+    if (clear) {
+        memset(&hp->stats, 0, sizeof(host_flash_stats_t));
+    }
+}
+
+void host_flash_tear_after(long bytes)
+{
+    tear_budget = bytes;
+    powered_off = false;
+}
+
+static host_partition_t *find(const esp_partition_t *partition)
+{
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        if (&partitions[i].partition == partition) {
+            return &partitions[i];
+        }
+    }
+    return NULL;
+}
+
+static host_partition_t *find_label(const char *label)
+{
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        if (strcmp(partitions[i].partition.label, label) == 0) {
+            return &partitions[i];
+        }
+    }
+    return NULL;
+}
+
+static void erase_all_once(void)
+{
+    // A new device ships with its flash erased
+    if (!erased) {
+        host_flash_reset();
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief CRC-32 (IEEE 802.3), chainable like the ROM routine
+ *
+ * @param crc CRC of the preceding bytes, 0 to start
+ * @param buf Data
+ * @param len Length of @p buf
+ * @return uint32_t CRC including @p buf
+ */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESP_ROM_CRC_H
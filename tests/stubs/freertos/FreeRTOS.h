@@ -0,0 +1,65 @@
+/*
+ * Host stand-in for FreeRTOS.h
+ *
+ * Tasks are POSIX threads (see freertos_host.c). A tick is 10 ms, as with
+ * the default CONFIG_FREERTOS_HZ, so delays keep their on-target length.
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / CONFIG_FREERTOS_HZ)
+#define portNUM_PROCESSORS 2
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * CONFIG_FREERTOS_HZ) / 1000U))
+
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+/**
+ * @brief Spinlock taken by portENTER_CRITICAL()
+ *
+ * On target a critical section also masks interrupts on the calling core;
+ * on the host it only spins, which is what keeps the other core out.
+ */
+typedef struct {
+    atomic_flag locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { ATOMIC_FLAG_INIT }
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+/**
+ * @brief Core the calling task was pinned to, 0 if it was not pinned
+ */
+BaseType_t xPortGetCoreID(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FREERTOS_H
@@ -0,0 +1,304 @@
+/*
+ * FreeRTOS on POSIX threads
+ *
+ * Just enough of the kernel for the firmware modules to run on the host:
+ * each task is a thread, notifications are a counter behind a condition
+ * variable, mutexes are pthread mutexes and critical sections are spin
+ * locks. Priorities are recorded but
+ * not enforced, and pinning only sets what xPortGetCoreID() reports.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_HOST_TASKS 16
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t function;
+    void *parameters;
+    const char *name;
+    UBaseType_t priority;
+    BaseType_t core_id;
+    bool in_use;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notify_count;
+};
+
+struct host_mutex {
+    pthread_mutex_t lock;
+};
+
+static struct host_task tasks[MAX_HOST_TASKS];
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct host_task *current_task = NULL;
+
+// Internal function prototypes
+static void *task_entry(void *arg);
+static struct host_task *task_alloc(void);
+static void deadline_after(struct timespec *ts, TickType_t ticks);
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    return xTaskCreatePinnedToCore(function, name, stack_depth, parameters, priority,
+                                   created_task, tskNO_AFFINITY);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name,
+                                   uint32_t stack_depth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *created_task,
+                                   BaseType_t core_id)
+{
+    (void)stack_depth;
+
+    struct host_task *task = task_alloc();
+    if (task == NULL) {
+        return pdFAIL;
+    }
+
+    task->function = function;
+    task->parameters = parameters;
+    task->name = name;
+    task->priority = priority;
+    task->core_id = core_id == tskNO_AFFINITY ? 0 : core_id;
+    task->notify_count = 0;
+
+    if (pthread_create(&task->thread, NULL, task_entry, task) != 0) {
+        task->in_use = false;
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+
+    if (created_task != NULL) {
+        *created_task = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == current_task) {
+        if (current_task != NULL) {
+            current_task->in_use = false;
+        }
+        pthread_exit(NULL);
+    }
+
+    pthread_cancel(task->thread);
+    task->in_use = false;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {
+        .tv_sec = (time_t)(ticks * portTICK_PERIOD_MS / 1000),
+        .tv_nsec = (long)(ticks * portTICK_PERIOD_MS % 1000) * 1000000L
+    };
+
+    // The thread may be cancelled while asleep, as a deleted task would be
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake_time, TickType_t increment)
+{
+    *previous_wake_time += increment;
+
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*previous_wake_time - now) > 0) {
+        vTaskDelay(*previous_wake_time - now);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+    return (TickType_t)(ms / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return current_task != NULL ? current_task->core_id : 0;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    while (atomic_flag_test_and_set_explicit(&mux->locked, memory_order_acquire)) {
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    atomic_flag_clear_explicit(&mux->locked, memory_order_release);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify_count++;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    struct host_task *task = current_task;
+    struct timespec deadline;
+    uint32_t count;
+
+    if (task == NULL) {
+        return 0;
+    }
+    if (ticks_to_wait != portMAX_DELAY) {
+        deadline_after(&deadline, ticks_to_wait);
+    }
+
+    pthread_mutex_lock(&task->lock);
+    while (task->notify_count == 0 && ticks_to_wait != 0) {
+        int rc = ticks_to_wait == portMAX_DELAY ?
+                 pthread_cond_wait(&task->notified, &task->lock) :
+                 pthread_cond_timedwait(&task->notified, &task->lock, &deadline);
+        if (rc == ETIMEDOUT) {
+            break;
+        }
+    }
+    count = task->notify_count;
+    if (count > 0) {
+        task->notify_count = clear_on_exit ? 0 : count - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return count;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&tasks_lock);
+    for (int i = 0; i < MAX_HOST_TASKS; i++) {
+        count += tasks[i].in_use;
+    }
+    pthread_mutex_unlock(&tasks_lock);
+    return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *task_status_array, UBaseType_t array_size,
+                                 uint32_t *total_run_time)
+{
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&tasks_lock);
+    for (int i = 0; i < MAX_HOST_TASKS && count < array_size; i++) {
+        if (!tasks[i].in_use) {
+            continue;
+        }
+        TaskStatus_t *status = &task_status_array[count++];
+        memset(status, 0, sizeof(*status));
+        status->xHandle = &tasks[i];
+        status->pcTaskName = tasks[i].name;
+        status->xTaskNumber = (UBaseType_t)i;
+        status->eCurrentState = eBlocked;
+        status->uxCurrentPriority = tasks[i].priority;
+        status->uxBasePriority = tasks[i].priority;
+        status->xCoreID = tasks[i].core_id;
+    }
+    pthread_mutex_unlock(&tasks_lock);
+
+    if (total_run_time != NULL) {
+        *total_run_time = 0;
+    }
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    struct host_mutex *mutex = malloc(sizeof(*mutex));
+    if (mutex != NULL) {
+        pthread_mutex_init(&mutex->lock, NULL);
+    }
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+    if (ticks_to_wait == portMAX_DELAY) {
+        return pthread_mutex_lock(&semaphore->lock) == 0 ? pdTRUE : pdFALSE;
+    }
+    if (ticks_to_wait == 0) {
+        return pthread_mutex_trylock(&semaphore->lock) == 0 ? pdTRUE : pdFALSE;
+    }
+
+    struct timespec deadline;
+    deadline_after(&deadline, ticks_to_wait);
+    return pthread_mutex_timedlock(&semaphore->lock, &deadline) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return pthread_mutex_unlock(&semaphore->lock) == 0 ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    pthread_mutex_destroy(&semaphore->lock);
+    free(semaphore);
+}
+
+static void *task_entry(void *arg)
+{
+    struct host_task *task = arg;
+
+    current_task = task;
+    task->function(task->parameters);
+
+    // Returning from a task function is an error on FreeRTOS; end quietly here
+    task->in_use = false;
+    return NULL;
+}
+
+static struct host_task *task_alloc(void)
+{
+    struct host_task *task = NULL;
+
+    pthread_mutex_lock(&tasks_lock);
+    for (int i = 0; i < MAX_HOST_TASKS; i++) {
+        if (!tasks[i].in_use) {
+            task = &tasks[i];
+            task->in_use = true;
+            pthread_mutex_init(&task->lock, NULL);
+            pthread_cond_init(&task->notified, NULL);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&tasks_lock);
+    return task;
+}
+
+static void deadline_after(struct timespec *ts, TickType_t ticks)
+{
+    uint64_t ns = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL;
+
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += (time_t)(ns / 1000000000ULL);
+    ts->tv_nsec += (long)(ns % 1000000000ULL);
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * Controls for the emulated flash behind esp_partition_*()
+ *
+ * The emulation follows partitions.csv and behaves like NOR flash:
+ * erasing sets a whole 4 KB sector to 0xFF and programming can only
+ * clear bits. Tests use these hooks to inspect the cells, count the work
+ * done and cut power part-way through a write.
+ */
+
+#ifndef HOST_FLASH_H
+#define HOST_FLASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_FLASH_SECTOR_SIZE 4096
+
+/**
+ * @brief Operation counters for one partition
+ */
+typedef struct {
+    uint32_t reads;                        ///< esp_partition_read() calls
+    uint64_t read_bytes;                   ///< Bytes read
+    uint32_t writes;                       ///< esp_partition_write() calls
+    uint64_t write_bytes;                  ///< Bytes programmed
+    uint32_t erases;                       ///< Sectors erased
+    uint32_t program_violations;           ///< Bytes whose program tried to set a 0 bit back to 1
+} host_flash_stats_t;
+
+/**
+ * @brief Erase every partition and clear all counters and faults
+ */
+void host_flash_reset(void);
+
+/**
+ * @brief Raw cells of a partition, for inspection or corruption
+ *
+ * @param label Partition label
+ * @param size Receives the partition size, may be NULL
+ * @return uint8_t* Partition contents, NULL if there is no such partition
+ */
+uint8_t *host_flash_contents(const char *label, size_t *size);
+
+/**
+ * @brief Get and optionally clear a partition's counters
+ *
+ * @param label Partition label
+ * @param stats Receives the counters, may be NULL
+ * @param clear Reset the counters after reading them
+ */
+void host_flash_stats(const char *label, host_flash_stats_t *stats, bool clear);
+
+/**
+ * @brief Cut power after a number of further programmed bytes
+ *
+ * The write that crosses the budget programs the bytes before it and
+ * fails; every later write fails until the fault is cleared, as if the
+ * device were off.
+ *
+ * @param bytes Bytes still programmed, -1 to clear the fault
+ */
+void host_flash_tear_after(long bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_FLASH_H
